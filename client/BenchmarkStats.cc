@@ -0,0 +1,244 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#include "BenchmarkStats.h"
+
+#include <json/writer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+// Student's t critical values for df = 1 ~ 30
+// two-sided 95% (= one-sided 97.5%) and one-sided 95%
+const double T_TWO_SIDED_95[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+};
+const double T_ONE_SIDED_95[] = {
+    6.314, 2.920, 2.353, 2.132, 2.015, 1.943, 1.895, 1.860, 1.833, 1.812,
+    1.796, 1.782, 1.771, 1.761, 1.753, 1.746, 1.740, 1.734, 1.729, 1.725,
+    1.721, 1.717, 1.714, 1.711, 1.708, 1.706, 1.703, 1.701, 1.699, 1.697
+};
+constexpr size_t T_TABLE_SIZE = sizeof(T_TWO_SIDED_95) / sizeof(double);
+
+} // anon namespace
+
+namespace arras_render {
+
+void
+BenchmarkStats::add(const std::string& milestone, const double sec)
+{
+    auto itr = mSamples.find(milestone);
+    if (itr == mSamples.end()) {
+        mMilestoneOrder.push_back(milestone);
+        itr = mSamples.emplace(milestone, std::vector<double>()).first;
+    }
+    itr->second.push_back(sec);
+}
+
+BenchmarkStats::Stats
+BenchmarkStats::getStats(const std::string& milestone) const
+{
+    auto itr = mSamples.find(milestone);
+    if (itr == mSamples.end()) return Stats();
+    return calcStats(itr->second);
+}
+
+Json::Value
+BenchmarkStats::toJson() const
+{
+    Json::Value root;
+    root["trials"] = static_cast<Json::UInt64>(mTrialTotal);
+
+    Json::Value milestones(Json::objectValue);
+    for (const auto& name : mMilestoneOrder) {
+        const std::vector<double>& samples = mSamples.at(name);
+        const Stats stats = calcStats(samples);
+
+        Json::Value item;
+        item["n"] = static_cast<Json::UInt64>(stats.mN);
+        item["mean"] = stats.mMean;
+        item["stddev"] = stats.mStdDev;
+        item["ciLow"] = stats.mCiLow;
+        item["ciHigh"] = stats.mCiHigh;
+        Json::Value sampleArray(Json::arrayValue);
+        for (double sec : samples) sampleArray.append(sec);
+        item["samples"] = sampleArray;
+        milestones[name] = item;
+    }
+    root["milestones"] = milestones;
+
+    for (const auto& itr : mSection) {
+        root[itr.first] = itr.second;
+    }
+    return root;
+}
+
+bool
+BenchmarkStats::save(const std::string& filename, std::string& error) const
+{
+    error.clear();
+
+    std::ofstream fout(filename, std::ios::trunc);
+    if (!fout) {
+        std::ostringstream ostr;
+        ostr << "Can not create file. filename:" << filename;
+        error = ostr.str();
+        return false;
+    }
+
+    Json::StyledWriter jw;
+    fout << jw.write(toJson());
+    fout.close();
+    return true;
+}
+
+// static function
+bool
+BenchmarkStats::load(const std::string& filename, Json::Value& json, std::string& error)
+{
+    error.clear();
+
+    std::ifstream fin(filename);
+    if (!fin) {
+        std::ostringstream ostr;
+        ostr << "Could not open file. filename:" << filename;
+        error = ostr.str();
+        return false;
+    }
+
+    Json::Reader reader;
+    if (!reader.parse(fin, json)) {
+        std::ostringstream ostr;
+        ostr << "Could not parse JSON. filename:" << filename << ' ' << reader.getFormattedErrorMessages();
+        error = ostr.str();
+        return false;
+    }
+    return true;
+}
+
+bool
+BenchmarkStats::compare(const Json::Value& baseline, const double minRelative, std::string& report) const
+{
+    const Json::Value& baseMilestones = baseline["milestones"];
+
+    bool regression = false;
+    std::ostringstream ostr;
+    ostr << "Benchmark baseline comparison (minRelative:" << minRelative * 100.0 << "%) {\n";
+    for (const auto& name : mMilestoneOrder) {
+        const Stats curr = calcStats(mSamples.at(name));
+        if (!baseMilestones.isMember(name)) {
+            ostr << "  " << name << " : not in baseline\n";
+            continue;
+        }
+        const Stats base = statsFromJson(baseMilestones[name]);
+
+        const double diff = curr.mMean - base.mMean;
+        const double relative = (base.mMean > 0.0) ? diff / base.mMean : 0.0;
+
+        // Welch's t-test
+        bool significant = false;
+        double t = 0.0;
+        if (curr.mN > 1 && base.mN > 1) {
+            const double v0 = curr.mStdDev * curr.mStdDev / static_cast<double>(curr.mN);
+            const double v1 = base.mStdDev * base.mStdDev / static_cast<double>(base.mN);
+            const double se = std::sqrt(v0 + v1);
+            if (se > 0.0) {
+                t = diff / se;
+                const double df = ((v0 + v1) * (v0 + v1) /
+                                   (v0 * v0 / static_cast<double>(curr.mN - 1) +
+                                    v1 * v1 / static_cast<double>(base.mN - 1)));
+                significant = t > tCritical(df, true);
+            } else {
+                significant = diff > 0.0; // no variance at all
+            }
+        }
+
+        const bool isRegression = significant && relative > minRelative;
+        if (isRegression) regression = true;
+
+        ostr << "  " << std::setw(28) << std::left << name << std::right << std::fixed << std::setprecision(3)
+             << " base:" << base.mMean << "+-" << base.mStdDev << "(n:" << base.mN << ")"
+             << " curr:" << curr.mMean << "+-" << curr.mStdDev << "(n:" << curr.mN << ")"
+             << " diff:" << std::showpos << relative * 100.0 << std::noshowpos << "%"
+             << " t:" << t
+             << (isRegression ? " REGRESSION" : (significant ? " slower(below threshold)" : "")) << '\n';
+    }
+    ostr << "}";
+    report = ostr.str();
+    return regression;
+}
+
+std::string
+BenchmarkStats::show() const
+{
+    std::ostringstream ostr;
+    ostr << "BenchmarkStats (trials:" << mTrialTotal << ") {\n";
+    for (const auto& name : mMilestoneOrder) {
+        const Stats stats = calcStats(mSamples.at(name));
+        ostr << "  " << std::setw(28) << std::left << name << std::right << std::fixed << std::setprecision(3)
+             << " n:" << stats.mN
+             << " mean:" << stats.mMean
+             << " stddev:" << stats.mStdDev
+             << " ci95:[" << stats.mCiLow << ", " << stats.mCiHigh << "] sec\n";
+    }
+    ostr << "}";
+    return ostr.str();
+}
+
+// static function
+BenchmarkStats::Stats
+BenchmarkStats::calcStats(const std::vector<double>& samples)
+{
+    Stats stats;
+    stats.mN = samples.size();
+    if (!stats.mN) return stats;
+
+    double sum = 0.0;
+    for (double v : samples) sum += v;
+    stats.mMean = sum / static_cast<double>(stats.mN);
+
+    if (stats.mN > 1) {
+        double sqSum = 0.0;
+        for (double v : samples) sqSum += (v - stats.mMean) * (v - stats.mMean);
+        stats.mStdDev = std::sqrt(sqSum / static_cast<double>(stats.mN - 1)); // sample stddev
+        const double halfWidth =
+            tCritical(static_cast<double>(stats.mN - 1), false) * stats.mStdDev / std::sqrt(static_cast<double>(stats.mN));
+        stats.mCiLow = stats.mMean - halfWidth;
+        stats.mCiHigh = stats.mMean + halfWidth;
+    } else {
+        stats.mCiLow = stats.mCiHigh = stats.mMean;
+    }
+    return stats;
+}
+
+// static function
+BenchmarkStats::Stats
+BenchmarkStats::statsFromJson(const Json::Value& json)
+{
+    Stats stats;
+    stats.mN = json.get("n", 0).asUInt64();
+    stats.mMean = json.get("mean", 0.0).asDouble();
+    stats.mStdDev = json.get("stddev", 0.0).asDouble();
+    stats.mCiLow = json.get("ciLow", 0.0).asDouble();
+    stats.mCiHigh = json.get("ciHigh", 0.0).asDouble();
+    return stats;
+}
+
+// static function
+double
+BenchmarkStats::tCritical(const double df, const bool oneSided)
+{
+    if (df < 1.0) return oneSided ? T_ONE_SIDED_95[0] : T_TWO_SIDED_95[0];
+    const size_t id = static_cast<size_t>(std::floor(df)); // conservative for the fractional Welch df
+    if (id > T_TABLE_SIZE) return oneSided ? 1.645 : 1.960; // normal approximation
+    return oneSided ? T_ONE_SIDED_95[id - 1] : T_TWO_SIDED_95[id - 1];
+}
+
+} // namespace arras_render
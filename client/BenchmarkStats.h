@@ -0,0 +1,65 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <json/json.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace arras_render {
+
+class BenchmarkStats
+//
+// Benchmark milestone times (sec) collected over repeated trials of the same benchmark
+// configuration. Computes mean, standard deviation and 95% confidence interval of each milestone,
+// saves them as a JSON baseline file and compares a new run against a baseline by Welch's t-test.
+// The same JSON also carries additional report sections (see setSection()).
+//
+{
+public:
+    struct Stats {
+        size_t mN {0};
+        double mMean {0.0};
+        double mStdDev {0.0};
+        double mCiLow {0.0};  // 95% confidence interval of the mean
+        double mCiHigh {0.0};
+    };
+
+    void add(const std::string& milestone, const double sec);
+    void addTrial() { mTrialTotal++; }
+    size_t getTrialTotal() const { return mTrialTotal; }
+
+    // milestones in the order of the first add()
+    const std::vector<std::string>& getMilestones() const { return mMilestoneOrder; }
+    Stats getStats(const std::string& milestone) const;
+
+    // Additional report section (e.g. scenario result, startup report) stored in the output JSON
+    void setSection(const std::string& name, const Json::Value& value) { mSection[name] = value; }
+
+    Json::Value toJson() const;
+    bool save(const std::string& filename, std::string& error) const;
+    static bool load(const std::string& filename, Json::Value& json, std::string& error);
+
+    // Compares this run against the baseline JSON. A milestone is a regression when the mean is
+    // slower than the baseline by more than minRelative (fraction) and the difference is statistically
+    // significant (one-sided Welch's t-test, 95%). Returns true if any regression is found.
+    bool compare(const Json::Value& baseline, const double minRelative, std::string& report) const;
+
+    std::string show() const;
+
+    static Stats calcStats(const std::vector<double>& samples);
+    static Stats statsFromJson(const Json::Value& json);
+
+private:
+    static double tCritical(const double df, const bool oneSided);
+
+    size_t mTrialTotal {0};
+    std::vector<std::string> mMilestoneOrder;
+    std::map<std::string, std::vector<double>> mSamples;
+    std::map<std::string, Json::Value> mSection;
+};
+
+} // namespace arras_render
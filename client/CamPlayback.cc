@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "CamPlayback.h"
+#include "ThreadRole.h"
 
 #include <scene_rdl2/render/util/StrUtil.h>
 #include <scene_rdl2/scene/rdl2/ValueContainerDeq.h>
@@ -423,6 +424,8 @@ CamPlayback::processCurrPlaybackEvent()
 void
 CamPlayback::threadMain(CamPlayback* camPlayback)
 {
+    ThreadRoleScope threadRole(ThreadRole::CAM_PLAYBACK);
+
     // First of all change camPlayback's threadState condition and do notify_one to caller.
     camPlayback->mThreadState = ThreadState::IDLE;
     camPlayback->mCvBoot.notify_one(); // notify to CamPlayback's constructor
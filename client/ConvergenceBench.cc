@@ -0,0 +1,201 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#include "ConvergenceBench.h"
+#include "ParallelFor.h"
+#include "PixelKernels.h"
+
+#include <scene_rdl2/render/util/StrUtil.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+constexpr unsigned NUM_CHANNELS = 4; // RGBA, alpha is not measured
+constexpr float REL_MSE_EPSILON = 0.01f;
+
+struct ErrorSum {
+    double mSqErr {0.0};
+    double mRelSqErr {0.0};
+};
+
+ErrorSum
+sumError(const float* live, const float* ref, const size_t pixelTotal)
+{
+    ErrorSum sum;
+    arras_render::getPixelKernels().mSumSqError(live, ref, pixelTotal, REL_MSE_EPSILON, sum.mSqErr, sum.mRelSqErr);
+    return sum;
+}
+
+} // anon namespace
+
+namespace arras_render {
+
+ConvergenceBench::ConvergenceBench(const unsigned threadTotal)
+    : mThreadTotal(std::max(threadTotal, 1u))
+{
+}
+
+void
+ConvergenceBench::setReference(std::vector<float>&& rgba, const unsigned width, const unsigned height)
+{
+    mReference = std::move(rgba);
+    mWidth = width;
+    mHeight = height;
+    mSamples.clear();
+}
+
+bool
+ConvergenceBench::addSample(const float sec,
+                            const float progress,
+                            const std::vector<float>& beauty,
+                            const unsigned width,
+                            const unsigned height,
+                            std::string& error)
+{
+    if (width != mWidth || height != mHeight) {
+        std::ostringstream ostr;
+        ostr << "resolution mismatch. live:" << width << 'x' << height
+             << " reference:" << mWidth << 'x' << mHeight;
+        error = ostr.str();
+        return false;
+    }
+    const size_t pixelTotal = static_cast<size_t>(width) * height;
+    if (beauty.size() < pixelTotal * NUM_CHANNELS || mReference.size() < pixelTotal * NUM_CHANNELS) {
+        error = "beauty buffer size mismatch";
+        return false;
+    }
+
+    Sample sample;
+    sample.mSec = sec;
+    sample.mProgress = progress;
+    sample.mMetric = computeMetric(beauty.data(), mReference.data(), pixelTotal, mThreadTotal);
+    mSamples.push_back(sample);
+    return true;
+}
+
+bool
+ConvergenceBench::getThresholdTime(const float relMse, float& sec) const
+{
+    for (const auto& itr : mSamples) {
+        if (itr.mMetric.mRelMse <= relMse) {
+            sec = itr.mSec;
+            return true;
+        }
+    }
+    return false;
+}
+
+// static function
+ConvergenceBench::Metric
+ConvergenceBench::computeMetric(const float* live,
+                                const float* ref,
+                                const size_t pixelTotal,
+                                const unsigned threadTotal)
+{
+    Metric metric;
+    if (!pixelTotal) return metric;
+
+    // one pixel range per part, summed in the part order so that the result does not depend on timing
+    const size_t chunk = (pixelTotal + threadTotal - 1) / threadTotal;
+    std::vector<ErrorSum> partial(threadTotal);
+    parallelFor(0, threadTotal, threadTotal, [&](const unsigned partBegin, const unsigned partEnd) {
+            for (unsigned t = partBegin; t < partEnd; ++t) {
+                const size_t start = std::min(chunk * t, pixelTotal);
+                const size_t end = std::min(start + chunk, pixelTotal);
+                partial[t] = sumError(live + start * NUM_CHANNELS, ref + start * NUM_CHANNELS, end - start);
+            }
+        });
+
+    ErrorSum total;
+    for (const auto& itr : partial) {
+        total.mSqErr += itr.mSqErr;
+        total.mRelSqErr += itr.mRelSqErr;
+    }
+    const double sampleTotal = static_cast<double>(pixelTotal) * 3.0;
+    const double mse = total.mSqErr / sampleTotal;
+    metric.mRmse = static_cast<float>(std::sqrt(mse));
+    metric.mPsnr = (mse > 0.0) ? static_cast<float>(-10.0 * std::log10(mse)) : INFINITY;
+    metric.mRelMse = static_cast<float>(total.mRelSqErr / sampleTotal);
+    return metric;
+}
+
+std::string
+ConvergenceBench::show() const
+{
+    namespace str_util = scene_rdl2::str_util;
+
+    std::ostringstream ostr;
+    ostr << "Convergence (reference " << mWidth << 'x' << mHeight << ", samples:" << mSamples.size() << ") {\n";
+    for (const auto& itr : mSamples) {
+        ostr << "  " << std::setw(10) << str_util::secStr(itr.mSec)
+             << std::fixed
+             << " progress:" << std::setw(6) << std::setprecision(2) << itr.mProgress * 100.0f << '%'
+             << " rmse:" << std::setprecision(6) << itr.mMetric.mRmse
+             << " psnr:" << std::setprecision(2) << itr.mMetric.mPsnr
+             << " relMse:" << std::setprecision(6) << itr.mMetric.mRelMse << '\n';
+        ostr.unsetf(std::ios::floatfield);
+    }
+    ostr << "  thresholds (relMse) {\n";
+    for (float threshold : mThresholds) {
+        float sec = 0.0f;
+        ostr << "    " << std::setw(10) << threshold << " : "
+             << (getThresholdTime(threshold, sec) ? str_util::secStr(sec) : std::string("not reached")) << '\n';
+    }
+    ostr << "  }\n"
+         << "}";
+    return ostr.str();
+}
+
+Json::Value
+ConvergenceBench::toJson() const
+{
+    Json::Value root;
+    root["width"] = mWidth;
+    root["height"] = mHeight;
+
+    Json::Value samples(Json::arrayValue);
+    for (const auto& itr : mSamples) {
+        Json::Value sample;
+        sample["sec"] = itr.mSec;
+        sample["progress"] = itr.mProgress;
+        sample["rmse"] = itr.mMetric.mRmse;
+        sample["psnr"] = std::isfinite(itr.mMetric.mPsnr) ? itr.mMetric.mPsnr : -1.0f;
+        sample["relMse"] = itr.mMetric.mRelMse;
+        samples.append(sample);
+    }
+    root["samples"] = samples;
+
+    Json::Value thresholds(Json::arrayValue);
+    for (float threshold : mThresholds) {
+        Json::Value item;
+        item["relMse"] = threshold;
+        float sec = 0.0f;
+        if (getThresholdTime(threshold, sec)) item["sec"] = sec;
+        thresholds.append(item);
+    }
+    root["thresholds"] = thresholds;
+    return root;
+}
+
+bool
+ConvergenceBench::saveCsv(const std::string& filename, std::string& error) const
+{
+    std::ofstream fout(filename, std::ios::trunc);
+    if (!fout) {
+        error = "Can not create file. filename:" + filename;
+        return false;
+    }
+    fout << "sec,progress,rmse,psnr,relMse\n";
+    for (const auto& itr : mSamples) {
+        fout << itr.mSec << ',' << itr.mProgress << ',' << itr.mMetric.mRmse << ','
+             << itr.mMetric.mPsnr << ',' << itr.mMetric.mRelMse << '\n';
+    }
+    return true;
+}
+
+} // namespace arras_render
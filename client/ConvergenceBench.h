@@ -0,0 +1,74 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <json/json.h>
+
+#include <string>
+#include <vector>
+
+namespace arras_render {
+
+class ConvergenceBench
+//
+// Convergence-rate benchmark. Compares the live beauty (RGBA float) against a converged reference
+// image and records RMSE, PSNR and relative MSE against the wall-clock time since the render start,
+// and the time at which the relative MSE first falls below each of the thresholds.
+// The error sum splits the image over threads by parallelFor and runs the dispatched mSumSqError
+// pixel kernel (PixelKernels.h) on each part.
+//
+{
+public:
+    struct Metric {
+        float mRmse {0.0f};
+        float mPsnr {0.0f};   // peak = 1.0
+        float mRelMse {0.0f}; // mean of (live - ref)^2 / (ref^2 + 0.01)
+    };
+
+    struct Sample {
+        float mSec {0.0f};
+        float mProgress {0.0f};
+        Metric mMetric;
+    };
+
+    explicit ConvergenceBench(const unsigned threadTotal);
+
+    // reference : RGBA float, top to bottom scanline
+    void setReference(std::vector<float>&& rgba, const unsigned width, const unsigned height);
+    void setThresholds(const std::vector<float>& relMse) { mThresholds = relMse; }
+    void clear() { mSamples.clear(); } // start a new render
+
+    // beauty : RGBA float, top to bottom scanline
+    bool addSample(const float sec,
+                   const float progress,
+                   const std::vector<float>& beauty,
+                   const unsigned width,
+                   const unsigned height,
+                   std::string& error);
+
+    const std::vector<Sample>& getSamples() const { return mSamples; }
+    const std::vector<float>& getThresholds() const { return mThresholds; }
+    bool getThresholdTime(const float relMse, float& sec) const;
+
+    static Metric computeMetric(const float* live,
+                                const float* ref,
+                                const size_t pixelTotal,
+                                const unsigned threadTotal);
+
+    std::string show() const;
+    Json::Value toJson() const;
+    bool saveCsv(const std::string& filename, std::string& error) const;
+
+private:
+    const unsigned mThreadTotal;
+
+    unsigned mWidth {0};
+    unsigned mHeight {0};
+    std::vector<float> mReference;
+
+    std::vector<float> mThresholds;
+    std::vector<Sample> mSamples;
+};
+
+} // namespace arras_render
@@ -3,6 +3,11 @@
 
 #include "DebugConsoleSetup.h"
 #include "ImageView.h"
+#include "OutboundSession.h"
+#include "StallWatchdog.h"
+#include "StartupReport.h"
+#include "ThreadRole.h"
+#include "Trace.h"
 
 #include <mcrt_messages/RenderMessages.h>
 #include <mcrt_messages/ViewportMessage.h>
@@ -11,8 +16,14 @@ namespace arras_render {
 
 void
 debugConsoleSetup(int port,
-                  std::shared_ptr<arras4::sdk::SDK> &sdk,
+                  std::shared_ptr<RenderSession> &sdk,
                   std::shared_ptr<mcrt_dataio::ClientReceiverFb> &fbReceiver,
+                  std::shared_ptr<EditLatency> &editLatency,
+                  std::shared_ptr<FramePublisher> &framePublisher,
+                  std::shared_ptr<JpegPipeline> &jpegPipeline,
+                  std::shared_ptr<HeatMapAccum> &heatMapAccum,
+                  std::shared_ptr<RenderEta> &renderEta,
+                  std::shared_ptr<NodeStats> &nodeStats,
                   std::atomic<ImageView *> &imageView)
 {
     std::cout << "debug-console port:" << port << '\n';
@@ -68,6 +79,61 @@ debugConsoleSetup(int port,
                              imageView.load()->setOverlayParam(offX, offY, fontSize);
                              return true;
                          });
+    sParserImageView.opt("history", "...command...", "frame history command",
+                         [&](Arg& arg) -> bool {
+                             if (!imageView.load()) {
+                                 return arg.msg("mImageView is null\n");
+                             }
+                             std::shared_ptr<FrameHistory> history = imageView.load()->getFrameHistory();
+                             if (!history) return arg.msg("frame history is not enabled (--history-mb)\n");
+                             return history->getParser().main(arg.childArg());
+                         });
+    sParserImageView.opt("poseCache", "...command...", "camera pose cache command",
+                         [&](Arg& arg) -> bool {
+                             if (!imageView.load()) {
+                                 return arg.msg("mImageView is null\n");
+                             }
+                             std::shared_ptr<PoseCache> poseCache = imageView.load()->getPoseCache();
+                             if (!poseCache) return arg.msg("pose cache is not enabled (--pose-cache-mb)\n");
+                             return poseCache->getParser().main(arg.childArg());
+                         });
+    sParserImageView.opt("reproject", "...command...", "depth reprojection preview command",
+                         [&](Arg& arg) -> bool {
+                             if (!imageView.load()) {
+                                 return arg.msg("mImageView is null\n");
+                             }
+                             std::shared_ptr<DepthReprojector> reprojector = imageView.load()->getReprojector();
+                             if (!reprojector) return arg.msg("depth reprojection is not enabled (--reproject)\n");
+                             return reprojector->getParser().main(arg.childArg());
+                         });
+    sParserImageView.opt("denoise", "...command...", "background denoise command",
+                         [&](Arg& arg) -> bool {
+                             if (!imageView.load()) {
+                                 return arg.msg("mImageView is null\n");
+                             }
+                             std::shared_ptr<DenoiseStage> denoiseStage = imageView.load()->getDenoiseStage();
+                             if (!denoiseStage) return arg.msg("background denoise is not enabled (--denoise-async)\n");
+                             return denoiseStage->getParser().main(arg.childArg());
+                         });
+    sParserImageView.opt("displayTransform", "...command...", "exposure/gamma/view LUT command",
+                         [&](Arg& arg) -> bool {
+                             if (!imageView.load()) {
+                                 return arg.msg("mImageView is null\n");
+                             }
+                             std::shared_ptr<DisplayTransform> displayTransform =
+                                 imageView.load()->getDisplayTransform();
+                             if (!displayTransform) return arg.msg("display transform is not set\n");
+                             return displayTransform->getParser().main(arg.childArg());
+                         });
+    sParserImageView.opt("perfHud", "...command...", "client performance HUD command",
+                         [&](Arg& arg) -> bool {
+                             if (!imageView.load()) {
+                                 return arg.msg("mImageView is null\n");
+                             }
+                             std::shared_ptr<PerfHud> perfHud = imageView.load()->getPerfHud();
+                             if (!perfHud) return arg.msg("performance HUD is not set\n");
+                             return perfHud->getParser().main(arg.childArg());
+                         });
     sParserImageView.opt("showImgPos", "", "show image display screen pixel position",
                          [&](Arg& arg) -> bool {
                              if (!imageView.load()) {
@@ -82,6 +148,42 @@ debugConsoleSetup(int port,
 
     //------------------------------
 
+    parser.opt("editLatency", "...command...", "edit-to-pixel latency command",
+               [&](Arg& arg) -> bool { return editLatency->getParser().main(arg.childArg()); });
+    parser.opt("heatMap", "...command...", "accumulated heat map command",
+               [&](Arg& arg) -> bool {
+                   if (!heatMapAccum) return arg.msg("heat map accumulation is not enabled (--heatmap-exr/--heatmap-report)\n");
+                   return heatMapAccum->getParser().main(arg.childArg());
+               });
+    parser.opt("jpeg", "...command...", "jpeg snapshot/stream command",
+               [&](Arg& arg) -> bool {
+                   if (!jpegPipeline) return arg.msg("jpeg output is not enabled (--jpeg-snapshot/--jpeg-stream)\n");
+                   return jpegPipeline->getParser().main(arg.childArg());
+               });
+    parser.opt("eta", "...command...", "render completion ETA command",
+               [&](Arg& arg) -> bool { return renderEta->getParser().main(arg.childArg()); });
+    parser.opt("nodes", "...command...", "per MCRT node throughput command",
+               [&](Arg& arg) -> bool { return nodeStats->getParser().main(arg.childArg()); });
+    parser.opt("shmPublish", "...command...", "shared memory frame publisher command",
+               [&](Arg& arg) -> bool {
+                   if (!framePublisher) return arg.msg("shared memory publisher is not enabled (--shm-publish)\n");
+                   return framePublisher->getParser().main(arg.childArg());
+               });
+    parser.opt("startup", "...command...", "startup critical path command",
+               [&](Arg& arg) -> bool { return StartupReport::get().getParser().main(arg.childArg()); });
+    parser.opt("outbound", "...command...", "outbound message scheduler command",
+               [&](Arg& arg) -> bool {
+                   std::shared_ptr<OutboundSession> outbound = std::dynamic_pointer_cast<OutboundSession>(sdk);
+                   if (!outbound) return arg.msg("outbound scheduler is not used (--send-direct)\n");
+                   return outbound->getParser().main(arg.childArg());
+               });
+    parser.opt("stall", "...command...", "GUI/message thread stall watchdog command",
+               [&](Arg& arg) -> bool { return StallWatchdog::get().getParser().main(arg.childArg()); });
+    parser.opt("threadRole", "...command...", "thread role command",
+               [&](Arg& arg) -> bool { return ThreadRoles::get().getParser().main(arg.childArg()); });
+    parser.opt("trace", "...command...", "client pipeline trace command",
+               [&](Arg& arg) -> bool { return Trace::get().getParser().main(arg.childArg()); });
+
     parser.opt("display", "", "display current data",
                [&](Arg& arg) -> bool {
                    if (!imageView.load()) { return arg.msg("mImageView is null\n"); }
@@ -5,7 +5,14 @@
 
 #include <mcrt_dataio/client/receiver/ClientReceiverConsoleDriver.h>
 #include <mcrt_dataio/client/receiver/ClientReceiverFb.h>
-#include <sdk/sdk.h>
+
+#include "EditLatency.h"
+#include "FramePublisher.h"
+#include "HeatMapAccum.h"
+#include "JpegPipeline.h"
+#include "NodeStats.h"
+#include "RenderEta.h"
+#include "RenderSession.h"
 
 #include <atomic>
 #include <memory>
@@ -16,8 +23,14 @@ namespace arras_render {
 
 void
 debugConsoleSetup(int port,
-                  std::shared_ptr<arras4::sdk::SDK> &sdk,
+                  std::shared_ptr<RenderSession> &sdk,
                   std::shared_ptr<mcrt_dataio::ClientReceiverFb> &fbReceiver,
+                  std::shared_ptr<EditLatency> &editLatency,
+                  std::shared_ptr<FramePublisher> &framePublisher,
+                  std::shared_ptr<JpegPipeline> &jpegPipeline,
+                  std::shared_ptr<HeatMapAccum> &heatMapAccum,
+                  std::shared_ptr<RenderEta> &renderEta,
+                  std::shared_ptr<NodeStats> &nodeStats,
                   std::atomic<ImageView *> &imageView);
 
 } // namespace arras_render
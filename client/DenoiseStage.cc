@@ -0,0 +1,236 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#include "DenoiseStage.h"
+#include "ThreadRole.h"
+#include "Trace.h"
+
+#include <scene_rdl2/render/util/StrUtil.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace arras_render {
+
+DenoiseStage::DenoiseStage(const Config& config)
+    : mConfig(config)
+    , mReceiver(false) // no telemetry overlay
+    , mNextDenoise(Clock::now())
+{
+    mReceiver.setBeautyDenoiseMode(mcrt_dataio::ClientReceiverFb::DenoiseMode::ENABLE);
+    mThread = std::thread(threadMain, this);
+    parserConfigure();
+}
+
+DenoiseStage::~DenoiseStage()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mShutdown = true;
+    }
+    mCvJob.notify_all();
+    if (mThread.joinable()) mThread.join();
+}
+
+void
+DenoiseStage::setActive(const bool flag)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (flag && !mActive) {
+            // denoise the current state right away
+            mDirty = true;
+            mNextDenoise = Clock::now();
+        } else if (!flag && mActive) {
+            mRefresh = true; // the display goes back to the raw beauty
+        }
+        mActive = flag;
+    }
+    mCvJob.notify_one();
+}
+
+void
+DenoiseStage::setResultCallBack(const ResultCallBack& callBack)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mResultCallBack = callBack;
+}
+
+void
+DenoiseStage::push(mcrt::ProgressiveFrame::ConstPtr frameMsg)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQueue.push_back(std::move(frameMsg));
+        mQueueMax = std::max(mQueueMax, mQueue.size());
+    }
+    mCvJob.notify_one();
+}
+
+bool
+DenoiseStage::getResult(const uint32_t frameId, std::vector<unsigned char>& rgb888)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!mHasResult || mResultFrameId != frameId || mResult.size() != rgb888.size()) {
+        mRawFallbackTotal++;
+        return false;
+    }
+    std::copy(mResult.begin(), mResult.end(), rgb888.begin());
+    mResultUseTotal++;
+    return true;
+}
+
+std::string
+DenoiseStage::show() const
+{
+    namespace str_util = scene_rdl2::str_util;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    std::ostringstream ostr;
+    ostr << "DenoiseStage {\n"
+         << "  active:" << str_util::boolStr(mActive) << '\n'
+         << "  interval:" << str_util::secStr(getIntervalSecMain())
+         << " (min:" << str_util::secStr(mConfig.mMinIntervalSec)
+         << " max:" << str_util::secStr(mConfig.mMaxIntervalSec)
+         << " duty:" << mConfig.mDutyRatio << ")\n"
+         << "  decodeTotal:" << mDecodeTotal << " queueMax:" << mQueueMax << '\n'
+         << "  denoiseTotal:" << mDenoiseTotal << '\n'
+         << "  denoiseAverage:" << std::fixed << std::setprecision(2)
+         << (mDenoiseTotal ? static_cast<float>(mDenoiseUsTotal) / mDenoiseTotal / 1000.0f : 0.0f) << " ms"
+         << " last:" << static_cast<float>(mLastDenoiseUs) / 1000.0f << " ms\n";
+    if (mHasResult) {
+        ostr << "  result:syncId:" << mResultFrameId << " progress:" << mResultProgress * 100.0f << "%\n";
+    } else {
+        ostr << "  result:none\n";
+    }
+    ostr << "  displayed:denoised:" << mResultUseTotal << " raw:" << mRawFallbackTotal << '\n'
+         << "}";
+    return ostr.str();
+}
+
+// static function
+void
+DenoiseStage::threadMain(DenoiseStage* stage)
+{
+    ThreadRoleScope threadRole(ThreadRole::DENOISE);
+
+    std::deque<mcrt::ProgressiveFrame::ConstPtr> queue;
+    ResultCallBack refresh;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(stage->mMutex);
+            auto isReady = [&] {
+                return (stage->mShutdown || !stage->mQueue.empty() || stage->mRefresh ||
+                        stage->isDueMain(Clock::now()));
+            };
+            if (stage->mActive && stage->mDirty) {
+                stage->mCvJob.wait_until(lock, stage->mNextDenoise, isReady);
+            } else {
+                stage->mCvJob.wait(lock, isReady);
+            }
+            if (stage->mShutdown) break;
+            queue.swap(stage->mQueue);
+            if (stage->mRefresh) {
+                stage->mRefresh = false;
+                refresh = stage->mResultCallBack;
+            }
+        }
+        if (refresh) {
+            refresh();
+            refresh = nullptr;
+        }
+
+        // decode everything received so far, the display only needs the latest state
+        for (const auto& frameMsg : queue) {
+            TraceSpan span("denoiseStageDecode");
+            stage->mReceiver.decodeProgressiveFrame(*frameMsg, true,
+                                                    [&]() {} /*no-op callback for started condition */,
+                                                    [&](const std::string& comment) {
+                                                        std::cerr << ">> DenoiseStage.cc " << comment << '\n';
+                                                    },
+                                                    false);
+        }
+        // the completed frame is denoised without waiting for the interval
+        const bool completed = !queue.empty() && stage->mReceiver.getProgress() >= 1.0f;
+
+        bool run = false;
+        {
+            std::lock_guard<std::mutex> lock(stage->mMutex);
+            stage->mDecodeTotal += queue.size();
+            if (!queue.empty()) stage->mDirty = true;
+            run = stage->mActive && stage->mDirty && (completed || stage->isDueMain(Clock::now()));
+            if (run) stage->mDirty = false;
+        }
+        queue.clear();
+
+        if (run) stage->denoise();
+    }
+}
+
+void
+DenoiseStage::denoise()
+{
+    if (mReceiver.getProgress() < 0.0f) return; // no image data yet
+
+    TraceSpan span("denoise", mWork.size());
+    const Clock::time_point start = Clock::now();
+    const bool result = mReceiver.getBeautyRgb888(mWork, true, false);
+    const Clock::time_point end = Clock::now();
+    const uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    span.setSyncId(mReceiver.getFrameId());
+
+    ResultCallBack callBack;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mDenoiseTotal++;
+        mDenoiseUsTotal += us;
+        mLastDenoiseUs = us;
+        mNextDenoise = end + std::chrono::microseconds(static_cast<uint64_t>(getIntervalSecMain() * 1.0e6f));
+        if (result) {
+            mResult.swap(mWork);
+            mResultFrameId = mReceiver.getFrameId();
+            mResultProgress = mReceiver.getProgress();
+            mHasResult = true;
+            callBack = mResultCallBack;
+        }
+    }
+
+    if (!result) {
+        std::cerr << ">> DenoiseStage.cc denoise() failed. " << mReceiver.getErrorMsg() << '\n';
+        return;
+    }
+    if (callBack) callBack();
+}
+
+float
+DenoiseStage::getIntervalSecMain() const
+{
+    // idle time which keeps the denoise cost at mDutyRatio of the worker time
+    const float duty = std::max(std::min(mConfig.mDutyRatio, 1.0f), 0.01f);
+    const float costSec = static_cast<float>(mLastDenoiseUs) / 1.0e6f;
+    return std::max(std::min(costSec * (1.0f / duty - 1.0f), mConfig.mMaxIntervalSec), mConfig.mMinIntervalSec);
+}
+
+bool
+DenoiseStage::isDueMain(const Clock::time_point& now) const
+{
+    return mActive && mDirty && now >= mNextDenoise;
+}
+
+void
+DenoiseStage::parserConfigure()
+{
+    mParser.description("background denoise command");
+    mParser.opt("show", "", "show denoise stage statistics",
+                [&](Arg& arg) -> bool { return arg.msg(show() + '\n'); });
+    mParser.opt("active", "<on|off>", "switch denoise on/off (same as N key)",
+                [&](Arg& arg) -> bool {
+                    setActive((arg++).as<bool>(0));
+                    return arg.fmtMsg("active %s\n", scene_rdl2::str_util::boolStr(mActive).c_str());
+                });
+}
+
+} // namespace arras_render
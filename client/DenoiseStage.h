@@ -0,0 +1,114 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <scene_rdl2/common/grid_util/Arg.h>
+#include <scene_rdl2/common/grid_util/Parser.h>
+#include <mcrt_dataio/client/receiver/ClientReceiverFb.h>
+#include <mcrt_messages/ProgressiveFrame.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace arras_render {
+
+class DenoiseStage
+//
+// Background beauty denoise. The stage owns its own frame buffer receiver, the message thread only
+// queues the received ProgressiveFrame messages and the worker thread decodes them in order and
+// denoises the beauty at its own rate. The interval between denoise runs follows the cost of the last
+// run (mDutyRatio of the worker time is spent for denoising) within [mMinIntervalSec, mMaxIntervalSec],
+// and the completed frame is always denoised. The latest result is kept with the syncId and the
+// progress it was made from, the display uses it only for the same syncId and falls back to the raw
+// beauty otherwise, so neither decode nor display waits for the denoiser.
+// Messages are decoded even while inactive so that the receiver of the stage is up to date when
+// denoise is switched on. All APIs are MT-safe.
+//
+{
+public:
+    using Arg = scene_rdl2::grid_util::Arg;
+    using Parser = scene_rdl2::grid_util::Parser;
+    using Clock = std::chrono::steady_clock;
+    using ResultCallBack = std::function<void()>;
+
+    struct Config {
+        float mMinIntervalSec {0.1f};
+        float mMaxIntervalSec {2.0f};
+        float mDutyRatio {0.5f}; // 0.0 < ratio <= 1.0
+    };
+
+    explicit DenoiseStage(const Config& config);
+    ~DenoiseStage();
+
+    void setActive(const bool flag);
+    bool isActive() const { return mActive; }
+
+    // called by the worker thread (without any lock held) when a new result is ready or when the
+    // stage is switched off
+    void setResultCallBack(const ResultCallBack& callBack);
+
+    // message thread, only queues the message
+    void push(mcrt::ProgressiveFrame::ConstPtr frameMsg);
+
+    // Copies the latest denoised beauty (rgb888, top to bottom) of the frameId into rgb888 if its size
+    // matches. Returns false and keeps rgb888 untouched if there is no result for the frameId yet.
+    bool getResult(const uint32_t frameId, std::vector<unsigned char>& rgb888);
+
+    std::string show() const;
+
+    Parser& getParser() { return mParser; }
+
+private:
+    static void threadMain(DenoiseStage* stage);
+
+    void denoise(); // worker thread only
+    float getIntervalSecMain() const; // mMutex locked by the caller
+    bool isDueMain(const Clock::time_point& now) const; // mMutex locked by the caller
+
+    void parserConfigure();
+
+    const Config mConfig;
+    mcrt_dataio::ClientReceiverFb mReceiver; // accessed by the worker thread only
+    std::vector<unsigned char> mWork;        // worker thread only
+
+    std::atomic<bool> mActive {false};
+
+    mutable std::mutex mMutex;
+    ResultCallBack mResultCallBack;
+    std::vector<unsigned char> mResult;
+    uint32_t mResultFrameId {0};
+    float mResultProgress {0.0f};
+    bool mHasResult {false};
+
+    // statistics
+    uint64_t mDecodeTotal {0};
+    uint64_t mDenoiseTotal {0};
+    uint64_t mDenoiseUsTotal {0};
+    uint64_t mLastDenoiseUs {0};
+    uint64_t mResultUseTotal {0};
+    uint64_t mRawFallbackTotal {0};
+    size_t mQueueMax {0};
+
+    // worker
+    std::condition_variable mCvJob;
+    std::deque<mcrt::ProgressiveFrame::ConstPtr> mQueue;
+    bool mDirty {false};   // decoded data which is not denoised yet
+    bool mRefresh {false}; // display needs to be refreshed by the callback
+    Clock::time_point mNextDenoise;
+    bool mShutdown {false};
+    std::thread mThread;
+
+    Parser mParser;
+};
+
+} // namespace arras_render
@@ -0,0 +1,264 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#include "DepthReprojector.h"
+#include "ParallelFor.h"
+#include "Trace.h"
+
+#include <scene_rdl2/render/util/StrUtil.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+constexpr size_t MAX_INSTANCE_CAM = 64; // recent renders which can still deliver frames
+constexpr float FAR_DEPTH = 1.0e7f;     // depth of the pixels without depth (background)
+constexpr float NEAR_DEPTH = 1.0e-3f;
+constexpr uint64_t EMPTY = ~static_cast<uint64_t>(0);
+
+inline uint64_t
+packDepth(const float depth, const uint32_t srcId)
+{
+    // positive floats keep their order as unsigned integers
+    uint32_t bits;
+    std::memcpy(&bits, &depth, sizeof(bits));
+    return (static_cast<uint64_t>(bits) << 32) | srcId;
+}
+
+inline void
+atomicMin(std::atomic<uint64_t>& dst, const uint64_t val)
+{
+    uint64_t curr = dst.load(std::memory_order_relaxed);
+    while (val < curr && !dst.compare_exchange_weak(curr, val, std::memory_order_relaxed)) {}
+}
+
+class PhaseBarrier
+//
+// The bands of warp() wait here for each other between the passes
+//
+{
+public:
+    explicit PhaseBarrier(const unsigned total) : mTotal(total) {}
+
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        const unsigned generation = mGeneration;
+        if (++mArrived == mTotal) {
+            mArrived = 0;
+            mGeneration++;
+            mCv.notify_all();
+            return;
+        }
+        mCv.wait(lock, [&] { return generation != mGeneration; });
+    }
+
+private:
+    const unsigned mTotal;
+    unsigned mArrived {0};
+    unsigned mGeneration {0};
+    std::mutex mMutex;
+    std::condition_variable mCv;
+};
+
+} // anon namespace
+
+namespace arras_render {
+
+DepthReprojector::DepthReprojector(const std::string& depthAovName, const unsigned threadTotal)
+    : mDepthAovName(depthAovName)
+    , mThreadTotal(threadTotal ? threadTotal : defaultThreadTotal())
+{
+    parserConfigure();
+}
+
+void
+DepthReprojector::bindInstance(const int instance, const Mat4d& camMtx)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mInstanceCam.emplace_back(instance, camMtx);
+    while (mInstanceCam.size() > MAX_INSTANCE_CAM) mInstanceCam.pop_front();
+}
+
+void
+DepthReprojector::capture(const int instance,
+                          const std::vector<unsigned char>& rgb888,
+                          const std::vector<float>& depth,
+                          const unsigned depthStride,
+                          const unsigned width,
+                          const unsigned height)
+{
+    const size_t pixTotal = static_cast<size_t>(width) * height;
+    if (rgb888.size() < pixTotal * 3 || depthStride == 0 || depth.size() < pixTotal * depthStride) return;
+
+    TraceSpan span("reprojectCapture", pixTotal * 3);
+    std::lock_guard<std::mutex> lock(mMutex);
+    mSrcInstance = instance;
+    mSrcWidth = width;
+    mSrcHeight = height;
+    mSrcRgb.assign(rgb888.begin(), rgb888.begin() + pixTotal * 3);
+    mSrcDepth.resize(pixTotal);
+    for (size_t i = 0; i < pixTotal; ++i) mSrcDepth[i] = depth[i * depthStride];
+    mCaptureTotal++;
+}
+
+bool
+DepthReprojector::warp(const Mat4d& dstCamMtx,
+                       const float tanHalfFovX,
+                       std::vector<unsigned char>& rgb888,
+                       const unsigned width,
+                       const unsigned height)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mSrcRgb.empty() || width != mSrcWidth || height != mSrcHeight || tanHalfFovX <= 0.0f) return false;
+
+    Mat4d srcCamMtx;
+    if (!findCamMain(mSrcInstance, srcCamMtx)) return false;
+
+    TraceSpan span("reprojectWarp", mSrcRgb.size());
+    const auto start = std::chrono::steady_clock::now();
+
+    // row vector convention : source camera -> world -> destination camera
+    const Mat4d srcToDst = srcCamMtx * dstCamMtx.inverse();
+    const float m00 = srcToDst.vx.x, m01 = srcToDst.vx.y, m02 = srcToDst.vx.z;
+    const float m10 = srcToDst.vy.x, m11 = srcToDst.vy.y, m12 = srcToDst.vy.z;
+    const float m20 = srcToDst.vz.x, m21 = srcToDst.vz.y, m22 = srcToDst.vz.z;
+    const float m30 = srcToDst.vw.x, m31 = srcToDst.vw.y, m32 = srcToDst.vw.z;
+
+    const float fx = tanHalfFovX;
+    const float fy = tanHalfFovX * static_cast<float>(height) / static_cast<float>(width);
+    const float w = static_cast<float>(width);
+    const float h = static_cast<float>(height);
+    const size_t pixTotal = static_cast<size_t>(width) * height;
+
+    if (mZBufferSize != pixTotal) {
+        mZBuffer.reset(new std::atomic<uint64_t>[pixTotal]);
+        mZBufferSize = pixTotal;
+    }
+    rgb888.resize(pixTotal * 3);
+    std::atomic<size_t> holeTotal {0};
+
+    // The three passes share one parallelFor so that the band threads are created once per warp.
+    // parallelFor runs each band on its own thread, all bandTotal bands reach the barrier.
+    const unsigned bandTotal = std::max(std::min(mThreadTotal, height), 1u);
+    PhaseBarrier barrier(bandTotal);
+    parallelFor(0, height, bandTotal, [&](const unsigned y0, const unsigned y1) {
+            for (size_t i = static_cast<size_t>(y0) * width; i < static_cast<size_t>(y1) * width; ++i) {
+                mZBuffer[i].store(EMPTY, std::memory_order_relaxed);
+            }
+            barrier.wait();
+
+            // forward splat with depth test
+            std::vector<float> rowU(width), rowV(width), rowZ(width);
+            for (unsigned y = y0; y < y1; ++y) {
+                const float* depth = &mSrcDepth[static_cast<size_t>(y) * width];
+                const float ny = (1.0f - 2.0f * (static_cast<float>(y) + 0.5f) / h) * fy;
+                // branch free, vectorized by the compiler
+                for (unsigned x = 0; x < width; ++x) {
+                    const float d0 = depth[x];
+                    const float d = (d0 > 0.0f && d0 < FAR_DEPTH) ? d0 : FAR_DEPTH; // NaN -> FAR_DEPTH
+                    const float nx = (2.0f * (static_cast<float>(x) + 0.5f) / w - 1.0f) * fx;
+                    const float cx = nx * d;
+                    const float cy = ny * d;
+                    const float cz = -d;
+                    const float px = cx * m00 + cy * m10 + cz * m20 + m30;
+                    const float py = cx * m01 + cy * m11 + cz * m21 + m31;
+                    const float pz = cx * m02 + cy * m12 + cz * m22 + m32;
+                    const float dz = -pz;
+                    const float invZ = 1.0f / std::max(dz, NEAR_DEPTH);
+                    rowU[x] = (px * invZ / fx + 1.0f) * 0.5f * w;
+                    rowV[x] = (1.0f - py * invZ / fy) * 0.5f * h;
+                    rowZ[x] = dz;
+                }
+                for (unsigned x = 0; x < width; ++x) {
+                    const float u = rowU[x];
+                    const float v = rowV[x];
+                    if (rowZ[x] <= NEAR_DEPTH || !(u >= 0.0f && u < w && v >= 0.0f && v < h)) continue;
+                    const size_t dst = static_cast<size_t>(v) * width + static_cast<size_t>(u);
+                    const uint32_t src = static_cast<uint32_t>(static_cast<size_t>(y) * width + x);
+                    atomicMin(mZBuffer[dst], packDepth(rowZ[x], src));
+                }
+            }
+            barrier.wait();
+
+            // resolve and fill the cracks from the farthest valid neighbor
+            size_t holes = 0;
+            for (unsigned y = y0; y < y1; ++y) {
+                for (unsigned x = 0; x < width; ++x) {
+                    const size_t pix = static_cast<size_t>(y) * width + x;
+                    uint64_t key = mZBuffer[pix].load(std::memory_order_relaxed);
+                    if (key == EMPTY) {
+                        for (int dy = -1; dy <= 1; ++dy) {
+                            for (int dx = -1; dx <= 1; ++dx) {
+                                const int nx = static_cast<int>(x) + dx;
+                                const int ny = static_cast<int>(y) + dy;
+                                if (nx < 0 || ny < 0 || nx >= static_cast<int>(width) || ny >= static_cast<int>(height)) continue;
+                                const uint64_t nKey =
+                                    mZBuffer[static_cast<size_t>(ny) * width + nx].load(std::memory_order_relaxed);
+                                if (nKey != EMPTY && (key == EMPTY || nKey > key)) key = nKey;
+                            }
+                        }
+                    }
+                    unsigned char* dst = &rgb888[pix * 3];
+                    if (key == EMPTY) {
+                        dst[0] = dst[1] = dst[2] = 0;
+                        holes++;
+                    } else {
+                        std::memcpy(dst, &mSrcRgb[static_cast<size_t>(key & 0xffffffff) * 3], 3);
+                    }
+                }
+            }
+            holeTotal += holes;
+        });
+
+    mWarpTotal++;
+    mWarpUsTotal += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    mLastHoleFraction = static_cast<float>(holeTotal.load()) / static_cast<float>(pixTotal);
+    return true;
+}
+
+std::string
+DepthReprojector::show() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    std::ostringstream ostr;
+    ostr << "DepthReprojector {\n"
+         << "  depthAov:" << mDepthAovName << '\n'
+         << "  threadTotal:" << mThreadTotal << '\n'
+         << "  source:" << mSrcWidth << 'x' << mSrcHeight << " instance:" << mSrcInstance << '\n'
+         << "  captureTotal:" << mCaptureTotal << '\n'
+         << "  warpTotal:" << mWarpTotal << '\n'
+         << "  warpAverage:" << std::fixed << std::setprecision(2)
+         << (mWarpTotal ? static_cast<float>(mWarpUsTotal) / mWarpTotal / 1000.0f : 0.0f) << " ms\n"
+         << "  lastHole:" << mLastHoleFraction * 100.0f << "%\n"
+         << "}";
+    return ostr.str();
+}
+
+bool
+DepthReprojector::findCamMain(const int instance, Mat4d& camMtx) const
+{
+    for (auto itr = mInstanceCam.rbegin(); itr != mInstanceCam.rend(); ++itr) {
+        if (itr->first == instance) {
+            camMtx = itr->second;
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+DepthReprojector::parserConfigure()
+{
+    mParser.description("depth reprojection preview command");
+    mParser.opt("show", "", "show reprojection statistics",
+                [&](Arg& arg) -> bool { return arg.msg(show() + '\n'); });
+}
+
+} // namespace arras_render
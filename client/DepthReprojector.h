@@ -0,0 +1,96 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <scene_rdl2/common/grid_util/Arg.h>
+#include <scene_rdl2/common/grid_util/Parser.h>
+#include <scene_rdl2/common/math/Mat4.h>
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace arras_render {
+
+class DepthReprojector
+//
+// Preview of a camera move before the engine returns pixels of the new pose. The last received beauty
+// and the depth AOV of the same frame are kept with the camera matrix which rendered them (bound by
+// syncId). On a camera update, every source pixel is unprojected by its depth, moved into the new
+// camera and splatted with a depth test, the nearest pixel wins. Small cracks are filled from the
+// farthest valid neighbor and disoccluded areas stay black. Pixels without depth (background) are
+// treated as very far so that they follow the camera rotation only.
+// Perspective camera only, depth is the camera space z distance. The per pixel transform is written
+// as branch free loops over a row so that the compiler vectorizes it, and rows are split across
+// threads. capture() and warp() are called by the GUI paint after a camera move was sent, the source is
+// only captured when a camera move needs it. All APIs are MT-safe.
+//
+{
+public:
+    using Arg = scene_rdl2::grid_util::Arg;
+    using Parser = scene_rdl2::grid_util::Parser;
+    using Mat4d = scene_rdl2::math::Mat4d;
+
+    DepthReprojector(const std::string& depthAovName, const unsigned threadTotal);
+
+    const std::string& getDepthAovName() const { return mDepthAovName; }
+
+    // the render instance (syncId) renders from the camera matrix (camera to world)
+    void bindInstance(const int instance, const Mat4d& camMtx);
+
+    // rgb888 : top to bottom scanline, depth : top to bottom scanline with depthStride floats per pixel
+    void capture(const int instance,
+                 const std::vector<unsigned char>& rgb888,
+                 const std::vector<float>& depth,
+                 const unsigned depthStride,
+                 const unsigned width,
+                 const unsigned height);
+
+    // tanHalfFovX : tan(horizontal fov / 2) of the perspective camera
+    bool warp(const Mat4d& dstCamMtx,
+              const float tanHalfFovX,
+              std::vector<unsigned char>& rgb888,
+              const unsigned width,
+              const unsigned height);
+
+    std::string show() const;
+
+    Parser& getParser() { return mParser; }
+
+private:
+    bool findCamMain(const int instance, Mat4d& camMtx) const; // mMutex locked by the caller
+    void parserConfigure();
+
+    const std::string mDepthAovName;
+    const unsigned mThreadTotal;
+
+    mutable std::mutex mMutex;
+    std::deque<std::pair<int, Mat4d>> mInstanceCam; // (instance, camera matrix) of the recent renders
+
+    // source frame
+    int mSrcInstance {-1};
+    unsigned mSrcWidth {0};
+    unsigned mSrcHeight {0};
+    std::vector<unsigned char> mSrcRgb;
+    std::vector<float> mSrcDepth;
+
+    // work buffers of warp()
+    std::unique_ptr<std::atomic<uint64_t>[]> mZBuffer; // (depth bits << 32) | source pixel id
+    size_t mZBufferSize {0};
+
+    // statistics
+    uint64_t mCaptureTotal {0};
+    uint64_t mWarpTotal {0};
+    uint64_t mWarpUsTotal {0};
+    float mLastHoleFraction {0.0f};
+
+    Parser mParser;
+};
+
+} // namespace arras_render
@@ -0,0 +1,386 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#include "DisplayTransform.h"
+#include "ParallelFor.h"
+#include "PixelKernels.h"
+#include "Trace.h"
+
+#include <scene_rdl2/render/util/StrUtil.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+constexpr unsigned MAX_LUT_SIZE = 256;
+
+inline float
+clamp01(const float v)
+{
+    // NaN -> 0
+    return std::min(v > 0.0f ? v : 0.0f, 1.0f);
+}
+
+} // anon namespace
+
+namespace arras_render {
+
+DisplayTransform::DisplayTransform(const unsigned threadTotal)
+    : mThreadTotal(threadTotal ? threadTotal : defaultThreadTotal())
+{
+    updateShaperMain();
+    parserConfigure();
+}
+
+void
+DisplayTransform::setChangeCallBack(const ChangeCallBack& callBack)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mChangeCallBack = callBack;
+}
+
+void
+DisplayTransform::setExposure(const float stops)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mExposure = stops;
+    }
+    notifyChange();
+}
+
+float
+DisplayTransform::getExposure() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mExposure;
+}
+
+void
+DisplayTransform::setGamma(const float gamma)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mGamma = std::max(gamma, 0.01f);
+        updateShaperMain();
+    }
+    notifyChange();
+}
+
+float
+DisplayTransform::getGamma() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mGamma;
+}
+
+bool
+DisplayTransform::loadLut(const std::string& filename, std::string& error)
+{
+    std::ifstream fin(filename);
+    if (!fin) {
+        error = "Can not open file. filename:" + filename;
+        return false;
+    }
+
+    auto lut = std::make_shared<Lut>();
+    lut->mFilename = filename;
+    std::string line;
+    unsigned lineId = 0;
+    while (std::getline(fin, line)) {
+        lineId++;
+        std::istringstream istr(line);
+        std::string key;
+        if (!(istr >> key) || key[0] == '#') continue;
+
+        if (key == "TITLE") {
+            continue;
+        } else if (key == "LUT_1D_SIZE") {
+            error = "1D LUT is not supported. filename:" + filename;
+            return false;
+        } else if (key == "LUT_3D_SIZE") {
+            if (!(istr >> lut->mSize) || lut->mSize < 2 || lut->mSize > MAX_LUT_SIZE) {
+                error = "Bad LUT_3D_SIZE. line:" + std::to_string(lineId);
+                return false;
+            }
+            lut->mTable.reserve(static_cast<size_t>(lut->mSize) * lut->mSize * lut->mSize * 3);
+        } else if (key == "DOMAIN_MIN" || key == "DOMAIN_MAX") {
+            float* domain = (key == "DOMAIN_MIN") ? lut->mDomainMin : lut->mDomainMax;
+            if (!(istr >> domain[0] >> domain[1] >> domain[2])) {
+                error = "Bad " + key + ". line:" + std::to_string(lineId);
+                return false;
+            }
+        } else {
+            // table entry
+            float rgb[3];
+            std::istringstream entry(line);
+            if (lut->mSize == 0 || !(entry >> rgb[0] >> rgb[1] >> rgb[2])) {
+                error = "Unexpected line. line:" + std::to_string(lineId);
+                return false;
+            }
+            lut->mTable.insert(lut->mTable.end(), rgb, rgb + 3);
+        }
+    }
+
+    const size_t expected = static_cast<size_t>(lut->mSize) * lut->mSize * lut->mSize * 3;
+    if (lut->mSize == 0 || lut->mTable.size() != expected) {
+        error = "LUT table size mismatch. entries:" + std::to_string(lut->mTable.size() / 3) +
+            " expected:" + std::to_string(expected / 3);
+        return false;
+    }
+    for (int i = 0; i < 3; ++i) {
+        if (lut->mDomainMax[i] <= lut->mDomainMin[i]) {
+            error = "Bad LUT domain. filename:" + filename;
+            return false;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mLut = lut;
+    }
+    notifyChange();
+    return true;
+}
+
+void
+DisplayTransform::clearLut()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mLut.reset();
+    }
+    notifyChange();
+}
+
+void
+DisplayTransform::reset()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mExposure = 0.0f;
+        mGamma = 1.0f;
+        mLut.reset();
+        updateShaperMain();
+    }
+    notifyChange();
+}
+
+bool
+DisplayTransform::isIdentity() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mExposure == 0.0f && mGamma == 1.0f && !mLut;
+}
+
+bool
+DisplayTransform::apply(const std::vector<float>& src,
+                        const unsigned numChan,
+                        const unsigned width,
+                        const unsigned height,
+                        std::vector<unsigned char>& rgb888)
+{
+    const size_t pixTotal = static_cast<size_t>(width) * height;
+    if (numChan == 0 || src.size() < pixTotal * numChan) return false;
+
+    float scale;
+    std::shared_ptr<const std::vector<float>> shaperTable;
+    std::shared_ptr<const Lut> lut;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        scale = std::exp2(mExposure);
+        shaperTable = mShaper;
+        lut = mLut;
+    }
+
+    TraceSpan span("displayTransform", pixTotal * 3);
+    const auto start = std::chrono::steady_clock::now();
+
+    rgb888.resize(pixTotal * 3);
+    const PixelKernels& kernels = getPixelKernels();
+    const float* shaper = shaperTable->data();
+    constexpr float shaperMax = static_cast<float>(SHAPER_SIZE - 1);
+
+    // the shaper input is the LUT domain (DOMAIN_MIN ~ DOMAIN_MAX, HDR LUTs go beyond 1.0) mapped to 0~1
+    float offset[3] = {0.0f, 0.0f, 0.0f};
+    float invRange[3] = {1.0f, 1.0f, 1.0f};
+    if (lut) {
+        for (int c = 0; c < 3; ++c) {
+            offset[c] = lut->mDomainMin[c];
+            invRange[c] = 1.0f / (lut->mDomainMax[c] - lut->mDomainMin[c]);
+        }
+    }
+
+    parallelFor(0, height, mThreadTotal, [&](const unsigned y0, const unsigned y1) {
+            std::vector<float> rowBuff(static_cast<size_t>(width) * 3);
+            float* const row[3] = {&rowBuff[0], &rowBuff[width], &rowBuff[static_cast<size_t>(width) * 2]};
+            for (unsigned y = y0; y < y1; ++y) {
+                const float* in = &src[static_cast<size_t>(y) * width * numChan];
+
+                // planar rgb with exposure
+                for (unsigned c = 0; c < 3; ++c) {
+                    float* dst = row[c];
+                    if (c < numChan) {
+                        for (unsigned x = 0; x < width; ++x) dst[x] = in[x * numChan + c] * scale;
+                    } else if (numChan == 1) {
+                        for (unsigned x = 0; x < width; ++x) dst[x] = in[x] * scale;
+                    } else {
+                        for (unsigned x = 0; x < width; ++x) dst[x] = 0.0f;
+                    }
+                }
+
+                // gamma by the shaper table, branch free, vectorized by the compiler
+                for (unsigned c = 0; c < 3; ++c) {
+                    float* dst = row[c];
+                    const float o = offset[c];
+                    const float s = invRange[c];
+                    for (unsigned x = 0; x < width; ++x) {
+                        const float t = clamp01((dst[x] - o) * s) * shaperMax;
+                        const unsigned i0 = static_cast<unsigned>(t);
+                        const unsigned i1 = std::min(i0 + 1, SHAPER_SIZE - 1);
+                        const float w = t - static_cast<float>(i0);
+                        dst[x] = shaper[i0] + (shaper[i1] - shaper[i0]) * w;
+                    }
+                }
+
+                // view LUT, trilinear
+                if (lut) {
+                    const unsigned n = lut->mSize;
+                    const float nMax = static_cast<float>(n - 1);
+                    const float* table = lut->mTable.data();
+                    for (unsigned x = 0; x < width; ++x) {
+                        unsigned i0[3], i1[3];
+                        float w[3];
+                        for (int c = 0; c < 3; ++c) {
+                            const float t = clamp01(row[c][x]) * nMax; // already mapped to the LUT domain
+                            i0[c] = static_cast<unsigned>(t);
+                            i1[c] = std::min(i0[c] + 1, n - 1);
+                            w[c] = t - static_cast<float>(i0[c]);
+                        }
+                        auto at = [&](const unsigned r, const unsigned g, const unsigned b) {
+                            return &table[((static_cast<size_t>(b) * n + g) * n + r) * 3];
+                        };
+                        const float* c000 = at(i0[0], i0[1], i0[2]);
+                        const float* c100 = at(i1[0], i0[1], i0[2]);
+                        const float* c010 = at(i0[0], i1[1], i0[2]);
+                        const float* c110 = at(i1[0], i1[1], i0[2]);
+                        const float* c001 = at(i0[0], i0[1], i1[2]);
+                        const float* c101 = at(i1[0], i0[1], i1[2]);
+                        const float* c011 = at(i0[0], i1[1], i1[2]);
+                        const float* c111 = at(i1[0], i1[1], i1[2]);
+                        for (int c = 0; c < 3; ++c) {
+                            const float v00 = c000[c] + (c100[c] - c000[c]) * w[0];
+                            const float v10 = c010[c] + (c110[c] - c010[c]) * w[0];
+                            const float v01 = c001[c] + (c101[c] - c001[c]) * w[0];
+                            const float v11 = c011[c] + (c111[c] - c011[c]) * w[0];
+                            const float v0 = v00 + (v10 - v00) * w[1];
+                            const float v1 = v01 + (v11 - v01) * w[1];
+                            row[c][x] = v0 + (v1 - v0) * w[2];
+                        }
+                    }
+                }
+
+                kernels.mQuantizeRgb888(row[0], row[1], row[2], width, &rgb888[static_cast<size_t>(y) * width * 3]);
+            }
+        });
+
+    const uint64_t us =
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    std::lock_guard<std::mutex> lock(mMutex);
+    mApplyTotal++;
+    mApplyUsTotal += us;
+    return true;
+}
+
+std::string
+DisplayTransform::showOverlay() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mExposure == 0.0f && mGamma == 1.0f && !mLut) return "";
+
+    std::ostringstream ostr;
+    ostr << std::fixed << std::setprecision(1)
+         << "EV" << std::showpos << mExposure << std::noshowpos
+         << " G" << std::setprecision(2) << mGamma;
+    if (mLut) ostr << " LUT";
+    return ostr.str();
+}
+
+std::string
+DisplayTransform::show() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    std::ostringstream ostr;
+    ostr << "DisplayTransform {\n"
+         << "  exposure:" << mExposure << " stops\n"
+         << "  gamma:" << mGamma << '\n';
+    if (mLut) {
+        ostr << "  lut:" << mLut->mFilename << " size:" << mLut->mSize << '\n';
+    } else {
+        ostr << "  lut:none\n";
+    }
+    ostr << "  threadTotal:" << mThreadTotal << '\n'
+         << "  applyTotal:" << mApplyTotal << '\n'
+         << "  applyAverage:" << std::fixed << std::setprecision(2)
+         << (mApplyTotal ? static_cast<float>(mApplyUsTotal) / mApplyTotal / 1000.0f : 0.0f) << " ms\n"
+         << "}";
+    return ostr.str();
+}
+
+void
+DisplayTransform::updateShaperMain()
+{
+    auto shaper = std::make_shared<std::vector<float>>(SHAPER_SIZE);
+    const float invGamma = 1.0f / mGamma;
+    for (unsigned i = 0; i < SHAPER_SIZE; ++i) {
+        (*shaper)[i] = std::pow(static_cast<float>(i) / static_cast<float>(SHAPER_SIZE - 1), invGamma);
+    }
+    mShaper = shaper; // apply() in flight keeps the previous table
+}
+
+void
+DisplayTransform::notifyChange()
+{
+    ChangeCallBack callBack;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        callBack = mChangeCallBack;
+    }
+    if (callBack) callBack();
+}
+
+void
+DisplayTransform::parserConfigure()
+{
+    mParser.description("display transform command");
+    mParser.opt("show", "", "show display transform condition and statistics",
+                [&](Arg& arg) -> bool { return arg.msg(show() + '\n'); });
+    mParser.opt("exposure", "<stops>", "set exposure",
+                [&](Arg& arg) -> bool {
+                    setExposure((arg++).as<float>(0));
+                    return arg.fmtMsg("exposure %f\n", getExposure());
+                });
+    mParser.opt("gamma", "<gamma>", "set display gamma (1.0 : linear)",
+                [&](Arg& arg) -> bool {
+                    setGamma((arg++).as<float>(0));
+                    return arg.fmtMsg("gamma %f\n", getGamma());
+                });
+    mParser.opt("lut", "<filename>", "load 3D view LUT (.cube)",
+                [&](Arg& arg) -> bool {
+                    std::string error;
+                    if (!loadLut((arg++)(), error)) return arg.msg("loadLut failed. " + error + '\n');
+                    return arg.msg("LUT loaded\n");
+                });
+    mParser.opt("clearLut", "", "remove view LUT",
+                [&](Arg& arg) -> bool { clearLut(); return arg.msg("LUT removed\n"); });
+    mParser.opt("reset", "", "exposure 0, gamma 1 and no LUT",
+                [&](Arg& arg) -> bool { reset(); return arg.msg("reset\n"); });
+}
+
+} // namespace arras_render
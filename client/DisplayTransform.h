@@ -0,0 +1,95 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <scene_rdl2/common/grid_util/Arg.h>
+#include <scene_rdl2/common/grid_util/Parser.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace arras_render {
+
+class DisplayTransform
+//
+// Client side float to display conversion of the beauty or an AOV : exposure (stops), display gamma
+// and an optional 3D view LUT (.cube) applied in this order, then quantized to RGB888. Gamma is a 1D
+// shaper table which is rebuilt on a parameter change. Its input is the exposed value mapped from the
+// LUT domain (DOMAIN_MIN ~ DOMAIN_MAX, 0 ~ 1 without LUT) to 0 ~ 1 and clamped there, so an HDR LUT
+// sees the values above 1.0. The LUT is sampled by trilinear interpolation. The kernel works on a row at a time with branch free loops so that the
+// compiler vectorizes it, and rows are split across threads.
+// The caller keeps the float frame, so a parameter change only re-runs apply(). Exposure 0, gamma 1
+// and no LUT is the identity, which is the same as the RGB888 conversion of the receiver.
+// All APIs are MT-safe.
+//
+{
+public:
+    using Arg = scene_rdl2::grid_util::Arg;
+    using Parser = scene_rdl2::grid_util::Parser;
+    using ChangeCallBack = std::function<void()>;
+
+    explicit DisplayTransform(const unsigned threadTotal);
+
+    // called (without any lock held) when a parameter is changed
+    void setChangeCallBack(const ChangeCallBack& callBack);
+
+    void setExposure(const float stops);
+    float getExposure() const;
+    void setGamma(const float gamma);
+    float getGamma() const;
+    bool loadLut(const std::string& filename, std::string& error); // Adobe/Resolve .cube 3D LUT
+    void clearLut();
+    void reset(); // exposure 0, gamma 1, no LUT
+
+    bool isIdentity() const;
+
+    // src : top to bottom scanline with numChan floats per pixel (1 : gray, 2 : RG, 3/4 : RGB, alpha ignored)
+    bool apply(const std::vector<float>& src,
+               const unsigned numChan,
+               const unsigned width,
+               const unsigned height,
+               std::vector<unsigned char>& rgb888);
+
+    std::string showOverlay() const; // empty if identity
+    std::string show() const;
+
+    Parser& getParser() { return mParser; }
+
+private:
+    static constexpr unsigned SHAPER_SIZE = 4096;
+
+    struct Lut {
+        std::string mFilename;
+        unsigned mSize {0};
+        float mDomainMin[3] {0.0f, 0.0f, 0.0f};
+        float mDomainMax[3] {1.0f, 1.0f, 1.0f};
+        std::vector<float> mTable; // rgb, red index changes fastest
+    };
+
+    void updateShaperMain(); // mMutex locked by the caller
+    void notifyChange();
+
+    void parserConfigure();
+
+    const unsigned mThreadTotal;
+
+    mutable std::mutex mMutex;
+    ChangeCallBack mChangeCallBack;
+    float mExposure {0.0f};
+    float mGamma {1.0f};
+    std::shared_ptr<const std::vector<float>> mShaper; // clamped LUT domain 0~1 -> display encoded 0~1
+    std::shared_ptr<const Lut> mLut;
+
+    // statistics
+    uint64_t mApplyTotal {0};
+    uint64_t mApplyUsTotal {0};
+
+    Parser mParser;
+};
+
+} // namespace arras_render
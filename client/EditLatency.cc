@@ -0,0 +1,417 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#include "EditLatency.h"
+
+#include <scene_rdl2/render/util/StrUtil.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <numeric>
+#include <sstream>
+
+namespace {
+
+// upper bound (sec) of each histogram bucket. The last bucket holds everything else.
+const std::vector<float> HISTOGRAM_BUCKET_SEC = {0.01f, 0.02f, 0.05f, 0.1f, 0.2f, 0.5f, 1.0f, 2.0f, 5.0f};
+
+constexpr float ONE_PERCENT = 0.01f;
+constexpr float TEN_PERCENT = 0.1f;
+
+} // anon namespace
+
+namespace arras_render {
+
+void
+LatencyHistogram::add(const float sec)
+{
+    mSamples.push_back(sec);
+    if (mSamples.size() > mWindowSize) {
+        mSamples.pop_front();
+    }
+    mTotal++;
+    mLast = sec;
+}
+
+float
+LatencyHistogram::getMin() const
+{
+    if (mSamples.empty()) return 0.0f;
+    return *std::min_element(mSamples.begin(), mSamples.end());
+}
+
+float
+LatencyHistogram::getMax() const
+{
+    if (mSamples.empty()) return 0.0f;
+    return *std::max_element(mSamples.begin(), mSamples.end());
+}
+
+float
+LatencyHistogram::getMean() const
+{
+    if (mSamples.empty()) return 0.0f;
+    return std::accumulate(mSamples.begin(), mSamples.end(), 0.0f) / static_cast<float>(mSamples.size());
+}
+
+float
+LatencyHistogram::getPercentile(const float pct) const
+{
+    if (mSamples.empty()) return 0.0f;
+
+    std::vector<float> sorted(mSamples.begin(), mSamples.end());
+    std::sort(sorted.begin(), sorted.end());
+    float pos = std::max(0.0f, std::min(pct, 100.0f)) / 100.0f * static_cast<float>(sorted.size() - 1);
+    size_t id = static_cast<size_t>(pos);
+    if (id + 1 >= sorted.size()) return sorted.back();
+    float t = pos - static_cast<float>(id);
+    return sorted[id] * (1.0f - t) + sorted[id + 1] * t;
+}
+
+std::string
+LatencyHistogram::show(const std::string& name) const
+{
+    namespace str_util = scene_rdl2::str_util;
+
+    std::vector<size_t> count(HISTOGRAM_BUCKET_SEC.size() + 1, 0);
+    for (float sec : mSamples) {
+        size_t id = 0;
+        while (id < HISTOGRAM_BUCKET_SEC.size() && HISTOGRAM_BUCKET_SEC[id] <= sec) id++;
+        count[id]++;
+    }
+    size_t maxCount = *std::max_element(count.begin(), count.end());
+
+    constexpr size_t barWidth = 40;
+    std::ostringstream ostr;
+    ostr << name << " (window:" << mSamples.size() << " total:" << mTotal << ") {\n";
+    for (size_t i = 0; i < count.size(); ++i) {
+        std::ostringstream label;
+        if (i < HISTOGRAM_BUCKET_SEC.size()) {
+            label << "< " << str_util::secStr(HISTOGRAM_BUCKET_SEC[i]);
+        } else {
+            label << ">= " << str_util::secStr(HISTOGRAM_BUCKET_SEC.back());
+        }
+        size_t barLen = (maxCount > 0) ? (count[i] * barWidth + maxCount - 1) / maxCount : 0;
+        ostr << "  " << std::setw(16) << std::left << label.str() << std::right
+             << std::setw(6) << count[i] << ' ' << std::string(barLen, '*') << '\n';
+    }
+    ostr << "}";
+    return ostr.str();
+}
+
+std::string
+LatencyHistogram::showSummary(const std::string& name) const
+{
+    namespace str_util = scene_rdl2::str_util;
+
+    std::ostringstream ostr;
+    ostr << name << " n:" << mTotal;
+    if (!mSamples.empty()) {
+        ostr << " last:" << str_util::secStr(mLast)
+             << " min:" << str_util::secStr(getMin())
+             << " p50:" << str_util::secStr(getPercentile(50.0f))
+             << " p90:" << str_util::secStr(getPercentile(90.0f))
+             << " p99:" << str_util::secStr(getPercentile(99.0f))
+             << " max:" << str_util::secStr(getMax());
+    }
+    return ostr.str();
+}
+
+//------------------------------------------------------------------------------------------
+
+EditLatency::EditLatency()
+{
+    parserConfigure();
+}
+
+void
+EditLatency::sendRecord(const uint32_t syncId)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    Entry& entry = mEntry[syncId]; // overwrite if the same syncId is reused
+    entry = Entry();
+    entry.mSendTime = Clock::now();
+    entry.mSendId = mSendTotal++;
+
+    while (mEntry.size() > MAX_SYNC_ID_ENTRIES) {
+        // drop the oldest send, which is not always the smallest syncId
+        mEntry.erase(std::min_element(mEntry.begin(), mEntry.end(), [](const auto& a, const auto& b) {
+            return a.second.mSendId < b.second.mSendId;
+        }));
+    }
+}
+
+void
+EditLatency::supersede(const uint32_t syncId)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto itr = mEntry.find(syncId);
+        if (itr == mEntry.end()) return;
+        itr->second.mSuperseded = true;
+    }
+    mCv.notify_all(); // wake up waitMilestone()
+}
+
+void
+EditLatency::frameRecord(const uint32_t syncId, const float progress, const HasOutputFunc& hasOutput)
+{
+    const Clock::time_point now = Clock::now();
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        if (mOutputWatch.mActive && hasOutput) {
+            outputRecordMain(mOutputWatch.mName.empty() || hasOutput(mOutputWatch.mName), progress, now);
+        }
+
+        auto itr = mEntry.find(syncId);
+        if (itr == mEntry.end() || itr->second.mSuperseded) {
+            mCv.notify_all(); // wake up waitOutput()
+            return;
+        }
+
+        // Older edits which have not reached all the milestones never will : the engine already
+        // switched to the newer syncId.
+        for (auto& oldItr : mEntry) {
+            if (oldItr.second.mSendId < itr->second.mSendId) oldItr.second.mSuperseded = true;
+        }
+
+        Entry& entry = itr->second;
+        auto reach = [&](const Milestone milestone) {
+            float& latency = entry.mLatency[static_cast<int>(milestone)];
+            if (latency >= 0.0f) return; // already reached
+            latency = std::chrono::duration<float>(now - entry.mSendTime).count();
+            mHistogram[static_cast<int>(milestone)].add(latency);
+        };
+
+        reach(Milestone::FIRST_PIXEL);
+        if (progress >= ONE_PERCENT) reach(Milestone::ONE_PERCENT);
+        if (progress >= TEN_PERCENT) reach(Milestone::TEN_PERCENT);
+
+        const float percent = std::floor(progress * 100.0f);
+        if (entry.mProgressCurve.empty() || entry.mProgressCurve.back().first * 100.0f < percent) {
+            entry.mProgressCurve.emplace_back(progress,
+                                              std::chrono::duration<float>(now - entry.mSendTime).count());
+        }
+    }
+
+    mCv.notify_all();
+}
+
+bool
+EditLatency::waitMilestone(const uint32_t syncId,
+                           const Milestone milestone,
+                           const float timeoutSec,
+                           float& latencySec) const
+{
+    const int id = static_cast<int>(milestone);
+    std::unique_lock<std::mutex> lock(mMutex);
+    auto isDone = [&]() -> bool {
+        auto itr = mEntry.find(syncId);
+        if (itr == mEntry.end()) return true; // already dropped
+        return itr->second.mLatency[id] >= 0.0f || itr->second.mSuperseded;
+    };
+
+    mCv.wait_for(lock, std::chrono::duration<float>(timeoutSec), isDone);
+
+    auto itr = mEntry.find(syncId);
+    if (itr == mEntry.end() || itr->second.mLatency[id] < 0.0f) return false;
+    latencySec = itr->second.mLatency[id];
+    return true;
+}
+
+bool
+EditLatency::waitProgress(const uint32_t syncId,
+                          const float fraction,
+                          const float timeoutSec,
+                          float& latencySec) const
+{
+    auto findLatency = [&](const Entry& entry, float& latency) -> bool {
+        for (const auto& itr : entry.mProgressCurve) {
+            if (itr.first >= fraction) {
+                latency = itr.second;
+                return true;
+            }
+        }
+        return false;
+    };
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    float latency = 0.0f;
+    auto isDone = [&]() -> bool {
+        auto itr = mEntry.find(syncId);
+        if (itr == mEntry.end()) return true;
+        return findLatency(itr->second, latency) || itr->second.mSuperseded;
+    };
+
+    mCv.wait_for(lock, std::chrono::duration<float>(timeoutSec), isDone);
+
+    auto itr = mEntry.find(syncId);
+    if (itr == mEntry.end() || !findLatency(itr->second, latency)) return false;
+    latencySec = latency;
+    return true;
+}
+
+void
+EditLatency::watchOutput(const std::string& name, const float fraction)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mOutputWatch = OutputWatch();
+    mOutputWatch.mActive = true;
+    mOutputWatch.mName = name;
+    mOutputWatch.mFraction = fraction;
+    mOutputWatch.mStart = Clock::now();
+}
+
+bool
+EditLatency::waitOutput(const float timeoutSec, float& firstLatencySec, float& fractionLatencySec) const
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCv.wait_for(lock, std::chrono::duration<float>(timeoutSec),
+                 [&]() { return mOutputWatch.mFractionLatency >= 0.0f; });
+
+    if (mOutputWatch.mFirst < 0.0f) return false;
+    firstLatencySec = mOutputWatch.mFirst;
+    fractionLatencySec = mOutputWatch.mFractionLatency;
+    return true;
+}
+
+void
+EditLatency::outputRecordMain(const bool carried, const float progress, const Clock::time_point& now)
+{
+    OutputWatch& watch = mOutputWatch;
+    const float sec = std::chrono::duration<float>(now - watch.mStart).count();
+    if (watch.mFirst < 0.0f) {
+        if (!carried) {
+            watch.mStreak = 0; // only an every aov-interval frame of the old setting
+            return;
+        }
+        if (watch.mStreak++ == 0) {
+            watch.mStreakFirst = sec;
+            watch.mStreakFraction = -1.0f;
+        }
+        if (watch.mStreakFraction < 0.0f && progress >= watch.mFraction) watch.mStreakFraction = sec;
+        if (watch.mStreak < 2 && !watch.mName.empty()) return;
+        watch.mFirst = watch.mStreakFirst;
+        watch.mFractionLatency = watch.mStreakFraction;
+    } else if (watch.mFractionLatency < 0.0f && carried && progress >= watch.mFraction) {
+        watch.mFractionLatency = sec;
+    }
+}
+
+void
+EditLatency::clear()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mEntry.clear();
+    mOutputWatch = OutputWatch();
+    for (auto& itr : mHistogram) itr.clear();
+}
+
+size_t
+EditLatency::getTotal(const Milestone milestone) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mHistogram[static_cast<int>(milestone)].getTotal();
+}
+
+float
+EditLatency::getLast(const Milestone milestone) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mHistogram[static_cast<int>(milestone)].getLast();
+}
+
+std::string
+EditLatency::show() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    std::ostringstream ostr;
+    ostr << "EditLatency {\n";
+    for (int i = 0; i < MILESTONE_TOTAL; ++i) {
+        ostr << scene_rdl2::str_util::addIndent(mHistogram[i].show(showMilestone(static_cast<Milestone>(i)))) << '\n';
+    }
+    ostr << "}";
+    return ostr.str();
+}
+
+std::string
+EditLatency::showSummary() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    std::ostringstream ostr;
+    ostr << "Edit-to-pixel latency summary {\n";
+    for (int i = 0; i < MILESTONE_TOTAL; ++i) {
+        ostr << "  " << mHistogram[i].showSummary(showMilestone(static_cast<Milestone>(i))) << '\n';
+    }
+    ostr << "}";
+    return ostr.str();
+}
+
+std::string
+EditLatency::showSummaryCompare(const std::string& name, const EditLatency& other,
+                                const std::string& otherName) const
+{
+    std::scoped_lock lock(mMutex, other.mMutex);
+
+    std::ostringstream ostr;
+    ostr << "Edit-to-pixel latency A/B summary {\n";
+    for (int i = 0; i < MILESTONE_TOTAL; ++i) {
+        const std::string milestone = showMilestone(static_cast<Milestone>(i));
+        ostr << "  " << mHistogram[i].showSummary(milestone + " A(" + name + ")") << '\n'
+             << "  " << other.mHistogram[i].showSummary(milestone + " B(" + otherName + ")") << '\n';
+    }
+    ostr << "}";
+    return ostr.str();
+}
+
+std::string
+EditLatency::showOverlay() const
+{
+    namespace str_util = scene_rdl2::str_util;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    const LatencyHistogram& firstPixel = mHistogram[static_cast<int>(Milestone::FIRST_PIXEL)];
+    if (!firstPixel.getTotal()) return std::string();
+
+    std::ostringstream ostr;
+    ostr << "edit->pix " << str_util::secStr(firstPixel.getLast())
+         << " (p50 " << str_util::secStr(firstPixel.getPercentile(50.0f)) << ")";
+    const LatencyHistogram& tenPercent = mHistogram[static_cast<int>(Milestone::TEN_PERCENT)];
+    if (tenPercent.getTotal()) {
+        ostr << " 10% " << str_util::secStr(tenPercent.getLast());
+    }
+    return ostr.str();
+}
+
+// static function
+std::string
+EditLatency::showMilestone(const Milestone milestone)
+{
+    switch (milestone) {
+    case Milestone::FIRST_PIXEL : return "firstPixel";
+    case Milestone::ONE_PERCENT : return "onePercent";
+    case Milestone::TEN_PERCENT : return "tenPercent";
+    default : return "?";
+    }
+}
+
+void
+EditLatency::parserConfigure()
+{
+    mParser.description("edit-to-pixel latency command");
+    mParser.opt("show", "", "show latency histograms",
+                [&](Arg& arg) -> bool { return arg.msg(show() + '\n'); });
+    mParser.opt("summary", "", "show latency percentile summary",
+                [&](Arg& arg) -> bool { return arg.msg(showSummary() + '\n'); });
+    mParser.opt("clear", "", "clear all latency samples",
+                [&](Arg& arg) -> bool { clear(); return arg.msg("CLEAR\n"); });
+}
+
+} // namespace arras_render
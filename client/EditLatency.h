@@ -0,0 +1,159 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <scene_rdl2/common/grid_util/Arg.h>
+#include <scene_rdl2/common/grid_util/Parser.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace arras_render {
+
+class LatencyHistogram
+//
+// Rolling histogram of latency samples (sec). Only the most recent windowSize samples are
+// kept so the statistics follow the current interactive condition instead of averaging over
+// the whole session.
+//
+{
+public:
+    explicit LatencyHistogram(const size_t windowSize = 256)
+        : mWindowSize(windowSize)
+    {}
+
+    void add(const float sec);
+    void clear() { mSamples.clear(); mTotal = 0; mLast = 0.0f; }
+
+    size_t size() const { return mSamples.size(); }
+    size_t getTotal() const { return mTotal; } // total samples since clear
+    float getLast() const { return mLast; }
+    float getMin() const;
+    float getMax() const;
+    float getMean() const;
+    float getPercentile(const float pct) const; // pct : 0.0 ~ 100.0
+
+    std::string show(const std::string& name) const;
+    std::string showSummary(const std::string& name) const; // single line
+
+private:
+    size_t mWindowSize;
+    std::deque<float> mSamples;
+    size_t mTotal {0};
+    float mLast {0.0f};
+};
+
+class EditLatency
+//
+// This class measures the client-observed latency between sending a scene edit (RDLMessage) and
+// receiving new pixels for it. Send time is recorded by RDLMessage syncId and matched against the
+// first decoded frame which has the same syncId, then against the first frame which reaches 1% and
+// 10% progress. All APIs are MT-safe : sendRecord() is called from the GUI/script threads and
+// frameRecord() is called from the message handler thread.
+//
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using Parser = scene_rdl2::grid_util::Parser;
+    using Arg = scene_rdl2::grid_util::Arg;
+
+    enum class Milestone : int {
+        FIRST_PIXEL = 0,
+        ONE_PERCENT,
+        TEN_PERCENT,
+        SIZE
+    };
+
+    using HasOutputFunc = std::function<bool(const std::string& name)>; // the frame carries the output
+
+    EditLatency();
+
+    void sendRecord(const uint32_t syncId);
+    // the edit of the syncId never renders (i.e. a camera delta dropped by a queued stop)
+    void supersede(const uint32_t syncId);
+    // progress : 0.0 ~ 1.0, hasOutput is only needed by watchOutput()
+    void frameRecord(const uint32_t syncId, const float progress, const HasOutputFunc& hasOutput = nullptr);
+
+    // Wait until the milestone of the syncId is reached. Returns false if timed out or the edit
+    // was superseded by a newer edit before reaching the milestone.
+    bool waitMilestone(const uint32_t syncId, const Milestone milestone, const float timeoutSec,
+                       float& latencySec) const;
+    // Same as waitMilestone() but for an arbitrary progress fraction (0.0 ~ 1.0).
+    bool waitProgress(const uint32_t syncId, const float fraction, const float timeoutSec,
+                      float& latencySec) const;
+    // Watch the render output name from now on, called right before the AOV switch is sent. A non
+    // priority output is still sent every aov-interval frames, so the switch is reached by the first of
+    // two back to back frames which carry the output. An empty name is reached by the next frame.
+    void watchOutput(const std::string& name, const float fraction);
+    // Wait until the watched output is reached. fractionLatencySec is the first frame carrying the output
+    // which reaches the progress fraction, negative if timed out before. Latencies are from watchOutput().
+    bool waitOutput(const float timeoutSec, float& firstLatencySec, float& fractionLatencySec) const;
+
+    void clear();
+
+    size_t getTotal(const Milestone milestone) const;
+    float getLast(const Milestone milestone) const;
+
+    std::string show() const;
+    std::string showSummary() const;
+    std::string showOverlay() const; // single line for the overlay text
+    // milestone by milestone summary of two sessions (A/B comparison)
+    std::string showSummaryCompare(const std::string& name, const EditLatency& other,
+                                   const std::string& otherName) const;
+
+    static std::string showMilestone(const Milestone milestone);
+
+    Parser& getParser() { return mParser; }
+
+private:
+    static constexpr size_t MAX_SYNC_ID_ENTRIES = 64;
+    static constexpr int MILESTONE_TOTAL = static_cast<int>(Milestone::SIZE);
+
+    struct Entry {
+        Clock::time_point mSendTime;
+        uint64_t mSendId {0}; // send order, syncIds restart from 0 on a new session
+        float mLatency[MILESTONE_TOTAL] {-1.0f, -1.0f, -1.0f}; // negative : not reached yet
+        bool mSuperseded {false};
+
+        // progress vs latency, one point each time progress crosses a new whole percent
+        std::vector<std::pair<float, float>> mProgressCurve;
+    };
+
+    struct OutputWatch {
+        bool mActive {false};
+        std::string mName;
+        float mFraction {0.0f};
+        Clock::time_point mStart;
+        unsigned mStreak {0}; // back to back frames carrying the output
+        float mStreakFirst {-1.0f};
+        float mStreakFraction {-1.0f};
+        float mFirst {-1.0f};
+        float mFractionLatency {-1.0f};
+    };
+
+    void outputRecordMain(const bool carried, const float progress,
+                          const Clock::time_point& now); // mMutex locked by the caller
+
+    void parserConfigure();
+
+    mutable std::mutex mMutex;
+    mutable std::condition_variable mCv;
+
+    std::map<uint32_t, Entry> mEntry; // key is syncId
+    uint64_t mSendTotal {0};
+    OutputWatch mOutputWatch;
+    LatencyHistogram mHistogram[MILESTONE_TOTAL];
+
+    Parser mParser;
+};
+
+} // namespace arras_render
@@ -0,0 +1,386 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#include "FrameHistory.h"
+#include "JpegPipeline.h"
+#include "ThreadRole.h"
+#include "Trace.h"
+
+#include <scene_rdl2/render/util/StrUtil.h>
+#include <scene_rdl2/scene/rdl2/BinaryReader.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+constexpr size_t MAX_QUEUE = 2;
+constexpr size_t DECODED_CACHE_MAX = 2; // both sides of the wipe
+constexpr size_t MAX_PAYLOAD_FRACTION = 4; // a delta larger than 1/4 of the budget keeps only the manifest
+
+} // anon namespace
+
+namespace arras_render {
+
+FrameHistory::FrameHistory(const size_t maxBytes, const float minProgress, const unsigned quality)
+    : mMaxBytes(maxBytes)
+    , mMinProgress(std::min(std::max(minProgress, 0.0f), 1.0f))
+    , mQuality(quality)
+{
+    mThread = std::thread(threadMain, this);
+    parserConfigure();
+}
+
+FrameHistory::~FrameHistory()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mShutdown = true;
+    }
+    mCvJob.notify_all();
+    if (mThread.joinable()) mThread.join();
+}
+
+void
+FrameHistory::setViewChangeCallBack(const ViewChangeCallBack& callBack)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mViewChangeCallBack = callBack;
+}
+
+void
+FrameHistory::recordDelta(const int instance, const std::string& manifest, const std::string& payload)
+{
+    bool viewChanged = false;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        Entry& entry = mEntry[instance];
+        entry.mManifest = manifest;
+        entry.mPayloadDropped = (payload.size() > mMaxBytes / MAX_PAYLOAD_FRACTION);
+        if (entry.mPayloadDropped) {
+            entry.mPayload.clear();
+        } else {
+            entry.mPayload = payload;
+        }
+        viewChanged = evictMain();
+    }
+    if (viewChanged) notifyViewChange();
+}
+
+bool
+FrameHistory::isDue(const int instance, const float progress) const
+{
+    if (progress < mMinProgress) return false;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto itr = mEntry.find(instance);
+    if (itr == mEntry.end() || itr->second.mProgress < 0.0f) return true; // first near-converged frame
+    return progress >= 1.0f && itr->second.mProgress < 1.0f; // replace by the converged frame
+}
+
+void
+FrameHistory::push(const int instance,
+                   const float progress,
+                   const std::vector<unsigned char>& rgb888,
+                   const unsigned width,
+                   const unsigned height)
+{
+    const size_t size = static_cast<size_t>(width) * height * 3;
+    if (rgb888.size() < size) return;
+
+    TraceSpan span("historyPush", size);
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (progress < 1.0f && mQueue.size() >= MAX_QUEUE) return; // retried by the next frame
+
+        // marks the instance as captured so that isDue() does not queue the same render again
+        mEntry[instance].mProgress = progress;
+
+        mQueue.emplace_back();
+        Job& job = mQueue.back();
+        job.mInstance = instance;
+        job.mProgress = progress;
+        job.mWidth = width;
+        job.mHeight = height;
+        job.mRgb.assign(rgb888.begin(), rgb888.begin() + size);
+    }
+    mCvJob.notify_one();
+}
+
+bool
+FrameHistory::getFrame(const int instance,
+                       std::vector<unsigned char>& rgb888,
+                       unsigned& width,
+                       unsigned& height)
+{
+    std::vector<unsigned char> jpeg;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (const auto& itr : mDecoded) {
+            if (itr.mInstance == instance) {
+                rgb888 = itr.mRgb;
+                width = itr.mWidth;
+                height = itr.mHeight;
+                return true;
+            }
+        }
+        auto itr = mEntry.find(instance);
+        if (itr == mEntry.end() || itr->second.mJpeg.empty()) return false;
+        jpeg = itr->second.mJpeg;
+    }
+
+    // decode outside of the lock, the encode worker and the frame feed keep running
+    TraceSpan span("historyDecode", jpeg.size());
+    std::string error;
+    if (!JpegPipeline::decode(jpeg, rgb888, width, height, error)) {
+        std::cerr << ">> FrameHistory.cc getFrame() instance:" << instance << ' ' << error << '\n';
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    Decoded decoded;
+    decoded.mInstance = instance;
+    decoded.mRgb = rgb888;
+    decoded.mWidth = width;
+    decoded.mHeight = height;
+    mDecoded.push_back(std::move(decoded));
+    while (mDecoded.size() > DECODED_CACHE_MAX) mDecoded.pop_front();
+    return true;
+}
+
+std::vector<int>
+FrameHistory::getInstances() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::vector<int> instances;
+    for (const auto& itr : mEntry) {
+        if (!itr.second.mJpeg.empty()) instances.push_back(itr.first);
+    }
+    return instances;
+}
+
+int
+FrameHistory::getPrevInstance(const int instance) const
+{
+    const std::vector<int> instances = getInstances();
+    if (instances.empty()) return LIVE;
+    if (instance == LIVE) return instances.back();
+    auto itr = std::lower_bound(instances.begin(), instances.end(), instance);
+    return (itr == instances.begin()) ? instances.front() : *(itr - 1);
+}
+
+int
+FrameHistory::getNextInstance(const int instance) const
+{
+    if (instance == LIVE) return LIVE;
+    const std::vector<int> instances = getInstances();
+    auto itr = std::upper_bound(instances.begin(), instances.end(), instance);
+    return (itr == instances.end()) ? LIVE : *itr;
+}
+
+FrameHistory::View
+FrameHistory::getView() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mView;
+}
+
+void
+FrameHistory::setView(const View& view)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mView = view;
+        mView.mWipePos = std::min(std::max(mView.mWipePos, 0.0f), 1.0f);
+    }
+    notifyViewChange();
+}
+
+std::string
+FrameHistory::show() const
+{
+    namespace str_util = scene_rdl2::str_util;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    auto showInstance = [](const int instance) {
+        return (instance == LIVE) ? std::string("live") : std::to_string(instance);
+    };
+
+    std::ostringstream ostr;
+    ostr << "FrameHistory {\n"
+         << "  memory:" << str_util::byteStr(getBytesMain()) << " / " << str_util::byteStr(mMaxBytes) << '\n'
+         << "  minProgress:" << mMinProgress * 100.0f << "%\n"
+         << "  quality:" << mQuality << '\n'
+         << "  evictedTotal:" << mEvictedTotal << '\n'
+         << "  view:";
+    if (mView.mWipe) {
+        ostr << "wipe " << showInstance(mView.mWipeLeft) << " | " << showInstance(mView.mWipeRight)
+             << " at " << mView.mWipePos * 100.0f << "%\n";
+    } else {
+        ostr << showInstance(mView.mInstance) << '\n';
+    }
+    ostr << "  entries (total:" << mEntry.size() << ") {\n";
+    for (const auto& itr : mEntry) {
+        const Entry& entry = itr.second;
+        ostr << "    " << std::setw(5) << itr.first
+             << " delta:" << str_util::byteStr(entry.mManifest.size() + entry.mPayload.size())
+             << (entry.mPayloadDropped ? " (manifest only)" : "");
+        if (entry.mJpeg.empty()) {
+            ostr << " image:-";
+        } else {
+            ostr << " image:" << entry.mWidth << 'x' << entry.mHeight
+                 << ' ' << std::fixed << std::setprecision(1) << entry.mProgress * 100.0f << '%'
+                 << ' ' << str_util::byteStr(entry.mJpeg.size());
+        }
+        ostr << '\n';
+    }
+    ostr << "  }\n"
+         << "}";
+    return ostr.str();
+}
+
+std::string
+FrameHistory::showDelta(const int instance) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto itr = mEntry.find(instance);
+    if (itr == mEntry.end() || itr->second.mManifest.empty()) {
+        return "no scene delta for instance:" + std::to_string(instance);
+    }
+    return scene_rdl2::rdl2::BinaryReader::showManifest(itr->second.mManifest);
+}
+
+// static function
+void
+FrameHistory::threadMain(FrameHistory* history)
+{
+    ThreadRoleScope threadRole(ThreadRole::HISTORY);
+
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(history->mMutex);
+            history->mCvJob.wait(lock, [&] { return history->mShutdown || !history->mQueue.empty(); });
+            if (history->mShutdown) break; // queued snapshots are not needed anymore
+            job = std::move(history->mQueue.front());
+            history->mQueue.pop_front();
+        }
+        history->processJob(job);
+    }
+}
+
+void
+FrameHistory::processJob(Job& job)
+{
+    std::vector<unsigned char> jpeg;
+    std::string error;
+    {
+        TraceSpan span("historyEncode", job.mRgb.size());
+        if (!JpegPipeline::encode(job.mRgb.data(), job.mWidth, job.mHeight, mQuality, jpeg, error)) {
+            std::cerr << ">> FrameHistory.cc " << error << '\n';
+            return;
+        }
+    }
+
+    bool viewChanged = false;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        Entry& entry = mEntry[job.mInstance];
+        if (job.mProgress < entry.mProgress) return; // a later frame of the same render has been queued
+        entry.mJpeg.swap(jpeg);
+        entry.mWidth = job.mWidth;
+        entry.mHeight = job.mHeight;
+        entry.mProgress = job.mProgress;
+        mDecoded.erase(std::remove_if(mDecoded.begin(), mDecoded.end(),
+                                      [&](const Decoded& decoded) { return decoded.mInstance == job.mInstance; }),
+                       mDecoded.end());
+        viewChanged = evictMain();
+    }
+    if (viewChanged) notifyViewChange();
+}
+
+bool
+FrameHistory::evictMain()
+{
+    bool viewChanged = false;
+    while (mEntry.size() > 1 && getBytesMain() > mMaxBytes) {
+        auto itr = mEntry.begin(); // oldest instance, the newest one is always kept
+        const int instance = itr->first;
+        mEntry.erase(itr);
+        mEvictedTotal++;
+        mDecoded.erase(std::remove_if(mDecoded.begin(), mDecoded.end(),
+                                      [&](const Decoded& decoded) { return decoded.mInstance == instance; }),
+                       mDecoded.end());
+        if (mView.mInstance == instance || mView.mWipeLeft == instance || mView.mWipeRight == instance) {
+            mView = View();
+            viewChanged = true;
+        }
+    }
+    if (viewChanged) {
+        std::cerr << ">> FrameHistory.cc displayed instance has been evicted, back to the live image\n";
+    }
+    return viewChanged;
+}
+
+size_t
+FrameHistory::getBytesMain() const
+{
+    size_t total = 0;
+    for (const auto& itr : mEntry) total += itr.second.getBytes();
+    return total;
+}
+
+void
+FrameHistory::notifyViewChange()
+{
+    ViewChangeCallBack callBack;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        callBack = mViewChangeCallBack;
+    }
+    if (callBack) callBack();
+}
+
+void
+FrameHistory::parserConfigure()
+{
+    mParser.description("frame history command");
+    mParser.opt("show", "", "show stored instances and memory usage",
+                [&](Arg& arg) -> bool { return arg.msg(show() + '\n'); });
+    mParser.opt("flip", "<instance>", "display the stored image of the instance. -1 : live image",
+                [&](Arg& arg) -> bool {
+                    View view;
+                    view.mInstance = (arg++).as<int>(0);
+                    if (view.mInstance != LIVE) {
+                        const std::vector<int> instances = getInstances();
+                        if (!std::binary_search(instances.begin(), instances.end(), view.mInstance)) {
+                            return arg.msg("no image for instance:" + std::to_string(view.mInstance) + '\n');
+                        }
+                    }
+                    setView(view);
+                    return arg.msg(show() + '\n');
+                });
+    mParser.opt("wipe", "<instanceL> <instanceR> <pos>",
+                "wipe between 2 instances at pos (0.0 ~ 1.0 of width). -1 : live image",
+                [&](Arg& arg) -> bool {
+                    View view;
+                    view.mWipe = true;
+                    view.mWipeLeft = (arg++).as<int>(0);
+                    view.mWipeRight = (arg++).as<int>(0);
+                    view.mWipePos = (arg++).as<float>(0);
+                    setView(view);
+                    return arg.msg(show() + '\n');
+                });
+    mParser.opt("live", "", "back to the live image",
+                [&](Arg& arg) -> bool {
+                    setView(View());
+                    return arg.msg("live\n");
+                });
+    mParser.opt("delta", "<instance>", "show the scene delta manifest which started the instance",
+                [&](Arg& arg) -> bool { return arg.msg(showDelta((arg++).as<int>(0)) + '\n'); });
+}
+
+} // namespace arras_render
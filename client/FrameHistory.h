@@ -0,0 +1,143 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <scene_rdl2/common/grid_util/Arg.h>
+#include <scene_rdl2/common/grid_util/Parser.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace arras_render {
+
+class FrameHistory
+//
+// Bounded history of the rendered images, one entry per render instance (syncId of the RDL message).
+// Each entry keeps the scene delta which started the render and a JPEG snapshot of the displayed
+// beauty once the render is near-converged (progress >= minProgress). The snapshot is replaced by
+// the converged frame when the render reaches 100%. JPEG encoding runs on a worker thread, the
+// caller only copies the RGB888 buffer. When the total size exceeds the memory budget, the oldest
+// entries are evicted.
+// The view state (flip to a stored instance or a wipe between two instances) lives here as well so
+// that both the GUI keys and the debug console can drive it. All APIs are MT-safe.
+//
+{
+public:
+    using Arg = scene_rdl2::grid_util::Arg;
+    using Parser = scene_rdl2::grid_util::Parser;
+    using ViewChangeCallBack = std::function<void()>;
+
+    static constexpr int LIVE = -1; // instance id of the live image
+
+    struct View {
+        int mInstance {LIVE};       // flip : displayed instance
+        bool mWipe {false};
+        int mWipeLeft {LIVE};       // wipe : instance on the left of mWipePos
+        int mWipeRight {LIVE};      // wipe : instance on the right of mWipePos
+        float mWipePos {0.5f};      // 0.0 ~ 1.0 of the image width
+        bool isLive() const { return !mWipe && mInstance == LIVE; }
+    };
+
+    FrameHistory(const size_t maxBytes, const float minProgress, const unsigned quality = 90);
+    ~FrameHistory();
+
+    void setViewChangeCallBack(const ViewChangeCallBack& callBack); // called by the thread which changed the view
+
+    // called when the RDL message of the instance is sent
+    void recordDelta(const int instance, const std::string& manifest, const std::string& payload);
+
+    // Cheap check done before copying the RGB buffer. progress : 0.0 ~ 1.0
+    bool isDue(const int instance, const float progress) const;
+    // rgb888 : top to bottom scanline
+    void push(const int instance,
+              const float progress,
+              const std::vector<unsigned char>& rgb888,
+              const unsigned width,
+              const unsigned height);
+
+    // decoded image of the stored instance, false if not stored (yet)
+    bool getFrame(const int instance,
+                  std::vector<unsigned char>& rgb888,
+                  unsigned& width,
+                  unsigned& height);
+    std::vector<int> getInstances() const; // instances which have an image, oldest first
+    int getPrevInstance(const int instance) const; // LIVE : the newest one
+    int getNextInstance(const int instance) const; // LIVE : after the newest one
+
+    View getView() const;
+    void setView(const View& view);
+
+    std::string show() const;
+    std::string showDelta(const int instance) const;
+
+    Parser& getParser() { return mParser; }
+
+private:
+    struct Entry {
+        std::string mManifest;
+        std::string mPayload;
+        bool mPayloadDropped {false}; // too large for the budget, only the manifest is kept
+        std::vector<unsigned char> mJpeg;
+        unsigned mWidth {0};
+        unsigned mHeight {0};
+        float mProgress {-1.0f}; // negative : no image yet
+
+        size_t getBytes() const { return mManifest.size() + mPayload.size() + mJpeg.size(); }
+    };
+
+    struct Decoded {
+        int mInstance {LIVE};
+        std::vector<unsigned char> mRgb;
+        unsigned mWidth {0};
+        unsigned mHeight {0};
+    };
+
+    struct Job {
+        int mInstance {0};
+        float mProgress {0.0f};
+        unsigned mWidth {0};
+        unsigned mHeight {0};
+        std::vector<unsigned char> mRgb;
+    };
+
+    static void threadMain(FrameHistory* history);
+
+    void processJob(Job& job);
+    bool evictMain(); // mMutex locked by the caller, returns true if the view is reset to live
+    size_t getBytesMain() const; // mMutex locked by the caller
+    void notifyViewChange();
+
+    void parserConfigure();
+
+    const size_t mMaxBytes;
+    const float mMinProgress;
+    const unsigned mQuality;
+
+    mutable std::mutex mMutex;
+    std::map<int, Entry> mEntry; // key is instance
+    size_t mEvictedTotal {0};
+    View mView;
+
+    // last decoded images (both sides of the wipe), the display does not decode every paint
+    std::deque<Decoded> mDecoded;
+
+    // encode worker
+    std::condition_variable mCvJob;
+    std::deque<Job> mQueue;
+    bool mShutdown {false};
+    std::thread mThread;
+
+    ViewChangeCallBack mViewChangeCallBack;
+
+    Parser mParser;
+};
+
+} // namespace arras_render
@@ -0,0 +1,344 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#include "FramePublisher.h"
+#include "StallWatchdog.h"
+#include "ThreadRole.h"
+#include "Trace.h"
+
+#include <scene_rdl2/render/util/StrUtil.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+// beauty is always 4 channels with ClientReceiverFb
+constexpr unsigned NUM_BTY_CHANNELS = 4;
+
+constexpr uint64_t DATA_ALIGNMENT = 64;
+
+uint64_t
+alignUp(const uint64_t size)
+{
+    return (size + DATA_ALIGNMENT - 1) / DATA_ALIGNMENT * DATA_ALIGNMENT;
+}
+
+std::string
+errnoStr(const std::string& msg)
+{
+    return msg + " failed. " + std::strerror(errno);
+}
+
+} // anon namespace
+
+namespace arras_render {
+
+FramePublisher::FramePublisher(const std::string& shmName,
+                               const unsigned slotTotal,
+                               std::shared_ptr<mcrt_dataio::ClientReceiverFb> fbReceiver,
+                               const FrameMuxFunc& frameMuxFunc)
+    : mShmName((!shmName.empty() && shmName[0] == '/') ? shmName : '/' + shmName)
+    , mSlotTotal(std::max(slotTotal, 2u))
+    , mFbReceiver(fbReceiver)
+    , mFrameMuxFunc(frameMuxFunc)
+{
+    parserConfigure();
+
+    mThread = std::thread(threadMain, this);
+
+    // Wait until thread is booted
+    std::unique_lock<std::mutex> uqLock(mMutex);
+    mCvBoot.wait(uqLock, [&]{ return (mThreadState != ThreadState::INIT); });
+}
+
+FramePublisher::~FramePublisher()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mThreadShutdown = true;
+    }
+    mCvFrame.notify_one();
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+    close();
+}
+
+bool
+FramePublisher::open(std::string& error)
+{
+    mFd = shm_open(mShmName.c_str(), O_CREAT | O_RDWR, 0644);
+    if (mFd < 0) {
+        error = errnoStr("shm_open(" + mShmName + ")");
+        return false;
+    }
+    return resize(sizeof(shared_frame::SlotHeader), error);
+}
+
+void
+FramePublisher::setFbReceiver(std::shared_ptr<mcrt_dataio::ClientReceiverFb> fbReceiver)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mFbReceiver = fbReceiver;
+    mStageAll = true;
+}
+
+void
+FramePublisher::notifyFrame(const std::vector<std::string>& carried)
+{
+    mNotifyTotal++;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mFrameReady = true;
+        for (const auto& name : carried) {
+            if (std::find(mCarried.begin(), mCarried.end(), name) == mCarried.end()) mCarried.push_back(name);
+        }
+    }
+    mCvFrame.notify_one();
+}
+
+std::string
+FramePublisher::show() const
+{
+    namespace str_util = scene_rdl2::str_util;
+
+    const shared_frame::Header* header = static_cast<const shared_frame::Header*>(mAddr);
+    std::ostringstream ostr;
+    ostr << "FramePublisher {\n"
+         << "  shmName:" << mShmName << '\n'
+         << "  slotTotal:" << mSlotTotal << '\n'
+         << "  slotSize:" << (header ? str_util::byteStr(header->mSlotSize.load()) : std::string("-")) << '\n'
+         << "  notifyTotal:" << mNotifyTotal << '\n'
+         << "  publishTotal:" << mPublishTotal << '\n'
+         << "}";
+    return ostr.str();
+}
+
+// static function
+void
+FramePublisher::threadMain(FramePublisher* publisher)
+{
+    ThreadRoleScope threadRole(ThreadRole::PUBLISH);
+
+    // First of all change publisher's threadState condition and do notify_one to caller.
+    {
+        std::lock_guard<std::mutex> lock(publisher->mMutex);
+        publisher->mThreadState = ThreadState::IDLE;
+    }
+    publisher->mCvBoot.notify_one(); // notify to FramePublisher's constructor
+
+    std::vector<std::string> carried;
+    while (true) {
+        bool stageAll = false;
+        {
+            std::unique_lock<std::mutex> lock(publisher->mMutex);
+            publisher->mCvFrame.wait(lock, [&] {
+                    return publisher->mFrameReady || publisher->mThreadShutdown;
+                });
+            if (publisher->mThreadShutdown) break;
+            publisher->mFrameReady = false; // coalesce all the frames received so far
+            carried.clear();
+            carried.swap(publisher->mCarried);
+            stageAll = publisher->mStageAll;
+            publisher->mStageAll = false;
+        }
+
+        if (!publisher->mAddr) continue; // not opened
+
+        publisher->mThreadState = ThreadState::BUSY;
+        std::string error;
+        if (publisher->stage(carried, stageAll) && !publisher->publish(error)) {
+            std::cerr << ">> FramePublisher.cc publish failed. " << error << '\n';
+        }
+        publisher->mThreadState = ThreadState::IDLE;
+    }
+}
+
+bool
+FramePublisher::stage(const std::vector<std::string>& carried, const bool stageAll)
+{
+    TraceSpan span("shmStage");
+
+    std::shared_ptr<mcrt_dataio::ClientReceiverFb> fbReceiver;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        fbReceiver = mFbReceiver;
+    }
+
+    if (stageAll) mStage.clear(); // nothing is kept from the previous receiver
+
+    StallLockGuard lock(mFrameMuxFunc(), StallWatchdog::Lock::FRAME_MUX);
+
+    if (fbReceiver->getProgress() < 0.0f) return false; // image data is not received yet
+
+    mWidth = fbReceiver->getWidth();
+    mHeight = fbReceiver->getHeight();
+    mSyncId = fbReceiver->getFrameId();
+    mProgress = fbReceiver->getProgress();
+
+    const size_t outputTotal = std::min(static_cast<size_t>(fbReceiver->getTotalRenderOutput()),
+                                        static_cast<size_t>(shared_frame::MAX_BUFFERS - 1));
+    mStage.resize(outputTotal + 1);
+
+    StageBuffer& beauty = mStage[0];
+    beauty.mName = "beauty";
+    beauty.mChannels = NUM_BTY_CHANNELS;
+    beauty.mData.resize(mWidth * mHeight * NUM_BTY_CHANNELS);
+    fbReceiver->getBeauty(beauty.mData, true);
+    uint64_t stagedSize = beauty.mData.size() * sizeof(float);
+
+    for (size_t i = 0; i < outputTotal; ++i) {
+        StageBuffer& buffer = mStage[i + 1];
+        const unsigned id = static_cast<unsigned>(i);
+        const std::string& name = fbReceiver->getRenderOutputName(id);
+        const unsigned channels = static_cast<unsigned>(fbReceiver->getRenderOutputNumChan(id));
+        if (buffer.mName == name && buffer.mChannels == channels &&
+            buffer.mData.size() == mWidth * mHeight * channels &&
+            std::find(carried.begin(), carried.end(), name) == carried.end()) {
+            continue; // not updated since the previous copy
+        }
+        buffer.mName = name;
+        buffer.mChannels = channels;
+        buffer.mData.resize(mWidth * mHeight * buffer.mChannels);
+        stagedSize += buffer.mData.size() * sizeof(float);
+        fbReceiver->getRenderOutput(id, buffer.mData,
+                                    true,   // top2bottom
+                                    false); // closestFilterDepthOutput
+    }
+    span.setSize(stagedSize);
+    return true;
+}
+
+bool
+FramePublisher::publish(std::string& error)
+{
+    TraceSpan span("shmPublish");
+
+    uint64_t slotSize = alignUp(sizeof(shared_frame::SlotHeader));
+    for (const auto& buffer : mStage) {
+        slotSize += alignUp(buffer.mData.size() * sizeof(float));
+    }
+    span.setSize(slotSize);
+
+    shared_frame::Header* header = static_cast<shared_frame::Header*>(mAddr);
+    if (slotSize > header->mSlotSize.load()) {
+        if (!resize(slotSize, error)) return false;
+        header = static_cast<shared_frame::Header*>(mAddr);
+    }
+
+    const uint64_t frameSeq = header->mFrameSeq.load(std::memory_order_relaxed) + 1;
+    char* slotTop = static_cast<char*>(mAddr) + alignUp(sizeof(shared_frame::Header)) +
+        ((frameSeq - 1) % mSlotTotal) * header->mSlotSize.load(std::memory_order_relaxed);
+    shared_frame::SlotHeader* slot = reinterpret_cast<shared_frame::SlotHeader*>(slotTop);
+
+    // seqlock write : odd while writing. A slot of a grown segment is already odd (no frame yet)
+    const uint64_t lockSeq = slot->mSeqLock.load(std::memory_order_relaxed) | 1;
+    slot->mSeqLock.store(lockSeq, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot->mFrameSeq = frameSeq;
+    slot->mWidth = mWidth;
+    slot->mHeight = mHeight;
+    slot->mSyncId = mSyncId;
+    slot->mProgress = mProgress;
+    slot->mBufferTotal = static_cast<uint32_t>(mStage.size());
+
+    uint64_t offset = alignUp(sizeof(shared_frame::SlotHeader));
+    for (size_t i = 0; i < mStage.size(); ++i) {
+        const StageBuffer& buffer = mStage[i];
+        shared_frame::BufferDesc& desc = slot->mBuffer[i];
+        std::strncpy(desc.mName, buffer.mName.c_str(), shared_frame::NAME_LENGTH - 1);
+        desc.mName[shared_frame::NAME_LENGTH - 1] = '\0';
+        desc.mChannels = buffer.mChannels;
+        desc.mOffset = offset;
+
+        const size_t byteSize = buffer.mData.size() * sizeof(float);
+        std::memcpy(slotTop + offset, buffer.mData.data(), byteSize);
+        offset += alignUp(byteSize);
+    }
+
+    slot->mSeqLock.store(lockSeq + 1, std::memory_order_release);
+    mSeqLockMax = std::max(mSeqLockMax, lockSeq + 1);
+    header->mFrameSeq.store(frameSeq, std::memory_order_release);
+
+    mPublishTotal++;
+    return true;
+}
+
+bool
+FramePublisher::resize(const uint64_t slotSize, std::string& error)
+{
+    // Grow the segment. Readers detect the new slot size by Header::mSlotSize and re-mmap.
+    const bool firstMap = (mAddr == nullptr);
+    const uint64_t newSlotSize = alignUp(slotSize);
+    const size_t mapSize = alignUp(sizeof(shared_frame::Header)) + newSlotSize * mSlotTotal;
+
+    if (ftruncate(mFd, static_cast<off_t>(mapSize)) != 0) {
+        error = errnoStr("ftruncate(" + mShmName + ")");
+        return false;
+    }
+    if (mAddr) {
+        munmap(mAddr, mMapSize);
+        mAddr = nullptr;
+    }
+    void* addr = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, mFd, 0);
+    if (addr == MAP_FAILED) {
+        error = errnoStr("mmap(" + mShmName + ")");
+        return false;
+    }
+    mAddr = addr;
+    mMapSize = mapSize;
+
+    // The old slot layout is invalid from here. mSlotSize changes before any slot byte does, so a reader
+    // which has read the old layout sees the new size when it rechecks it after the copy.
+    shared_frame::Header* header = static_cast<shared_frame::Header*>(mAddr);
+    header->mMagic = shared_frame::MAGIC;
+    header->mVersion = shared_frame::VERSION;
+    header->mSlotTotal = mSlotTotal;
+    if (firstMap) header->mFrameSeq.store(0, std::memory_order_relaxed); // kept increasing from here
+    header->mSlotSize.store(newSlotSize, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    // Every slot is cleared and stays odd (no frame) until publish() writes it. The seqlock continues
+    // above every value written so far, so a reader never sees a sampled value again (ABA).
+    char* slotsTop = static_cast<char*>(mAddr) + alignUp(sizeof(shared_frame::Header));
+    std::memset(slotsTop, 0, newSlotSize * mSlotTotal);
+    for (unsigned i = 0; i < mSlotTotal; ++i) {
+        shared_frame::SlotHeader* slot = reinterpret_cast<shared_frame::SlotHeader*>(slotsTop + i * newSlotSize);
+        slot->mSeqLock.store(mSeqLockMax | 1, std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    return true;
+}
+
+void
+FramePublisher::close()
+{
+    if (mAddr) {
+        munmap(mAddr, mMapSize);
+        mAddr = nullptr;
+    }
+    if (mFd >= 0) {
+        ::close(mFd);
+        mFd = -1;
+        shm_unlink(mShmName.c_str());
+    }
+}
+
+void
+FramePublisher::parserConfigure()
+{
+    mParser.description("shared memory frame publisher command");
+    mParser.opt("show", "", "show publisher status",
+                [&](Arg& arg) -> bool { return arg.msg(show() + '\n'); });
+}
+
+} // namespace arras_render
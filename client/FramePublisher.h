@@ -0,0 +1,165 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <scene_rdl2/common/grid_util/Arg.h>
+#include <scene_rdl2/common/grid_util/Parser.h>
+
+#include <mcrt_dataio/client/receiver/ClientReceiverFb.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace arras_render {
+
+namespace shared_frame {
+//
+// Layout of the POSIX shared memory segment written by FramePublisher. Local readers include this
+// header, shm_open(name, O_RDONLY) and mmap the segment.
+//
+//   Header | slot[0] | slot[1] | ... | slot[mSlotTotal - 1]
+//   slot   : SlotHeader | buffer data (float32, interleaved channels, top to bottom scanline)
+//
+// Reader protocol (seqlock) :
+//   1) seq = Header::mFrameSeq. 0 means no frame yet. slot id = (seq - 1) % mSlotTotal.
+//   2) s0 = SlotHeader::mSeqLock (acquire). Retry when s0 is odd (slot is being written or has no
+//      frame yet after the segment has grown).
+//   3) read the slot header and the buffers you need.
+//   4) s1 = SlotHeader::mSeqLock (acquire after an acquire fence), then Header::mSlotSize. The data is
+//      valid when s0 == s1 and mSlotSize is still the one you mapped with.
+// The segment grows when new AOVs arrive. Readers re-mmap the segment when Header::mSlotSize has
+// changed and retry from 1). mSeqLock and mFrameSeq only increase, also across the growth.
+//
+constexpr uint32_t MAGIC = 0x46535241; // "ARSF"
+constexpr uint32_t VERSION = 1;
+constexpr unsigned MAX_BUFFERS = 32;
+constexpr unsigned NAME_LENGTH = 64;
+
+struct BufferDesc {
+    char mName[NAME_LENGTH]; // "beauty" or AOV name, null terminated
+    uint32_t mChannels;
+    uint32_t mPad;
+    uint64_t mOffset; // byte offset from the top of the slot
+};
+
+struct SlotHeader {
+    std::atomic<uint64_t> mSeqLock; // odd while the slot is written
+    uint64_t mFrameSeq;             // Header::mFrameSeq value of this frame
+    uint32_t mWidth;
+    uint32_t mHeight;
+    uint32_t mSyncId;
+    float mProgress;                // 0.0 ~ 1.0
+    uint32_t mBufferTotal;
+    uint32_t mPad;
+    BufferDesc mBuffer[MAX_BUFFERS];
+};
+
+struct Header {
+    uint32_t mMagic;
+    uint32_t mVersion;
+    uint32_t mSlotTotal;
+    uint32_t mPad;
+    std::atomic<uint64_t> mSlotSize; // byte size of each slot including SlotHeader
+    std::atomic<uint64_t> mFrameSeq; // sequence number of the latest complete frame
+};
+
+} // namespace shared_frame
+
+class FramePublisher
+//
+// Publishes the latest decoded frame (beauty and all render outputs) of ClientReceiverFb into a POSIX
+// shared memory ring, so that any number of local tools can map the live frames without copies.
+// The decode thread only calls notifyFrame(). The publisher thread copies the buffers out of
+// ClientReceiverFb under the frame mutex and writes them to the next ring slot outside of the lock.
+// Only the buffers carried by the decoded messages are copied under the lock, the other AOVs (sent
+// every aov-interval frames) are kept from the previous copy.
+// Frames which arrive while the publisher is busy are coalesced to the latest one.
+//
+{
+public:
+    using Arg = scene_rdl2::grid_util::Arg;
+    using Parser = scene_rdl2::grid_util::Parser;
+    using FrameMuxFunc = std::function<std::mutex&()>;
+
+    FramePublisher(const std::string& shmName,
+                   const unsigned slotTotal,
+                   std::shared_ptr<mcrt_dataio::ClientReceiverFb> fbReceiver,
+                   const FrameMuxFunc& frameMuxFunc);
+    ~FramePublisher();
+
+    bool open(std::string& error);
+
+    // switches to the receiver of a new session
+    void setFbReceiver(std::shared_ptr<mcrt_dataio::ClientReceiverFb> fbReceiver);
+
+    // called by the decode thread after every decoded frame, carried : buffer names of the message
+    void notifyFrame(const std::vector<std::string>& carried);
+
+    const std::string& getShmName() const { return mShmName; }
+
+    std::string show() const;
+
+    Parser& getParser() { return mParser; }
+
+private:
+    enum class ThreadState : int { INIT, IDLE, BUSY };
+
+    struct StageBuffer {
+        std::string mName;
+        unsigned mChannels {0};
+        std::vector<float> mData;
+    };
+
+    static void threadMain(FramePublisher* publisher);
+
+    // copy from ClientReceiverFb under the frame mutex, only the carried outputs unless stageAll
+    bool stage(const std::vector<std::string>& carried, const bool stageAll);
+    bool publish(std::string& error); // write the staged frame into the next slot
+    bool resize(const uint64_t slotSize, std::string& error);
+    void close();
+
+    void parserConfigure();
+
+    const std::string mShmName;
+    const unsigned mSlotTotal;
+    std::shared_ptr<mcrt_dataio::ClientReceiverFb> mFbReceiver;
+    FrameMuxFunc mFrameMuxFunc;
+
+    int mFd {-1};
+    void* mAddr {nullptr};
+    size_t mMapSize {0};
+    uint64_t mSeqLockMax {0}; // largest SlotHeader::mSeqLock written so far
+
+    // staged frame
+    unsigned mWidth {0};
+    unsigned mHeight {0};
+    uint32_t mSyncId {0};
+    float mProgress {0.0f};
+    std::vector<StageBuffer> mStage;
+
+    std::atomic<uint64_t> mPublishTotal {0};
+    std::atomic<uint64_t> mNotifyTotal {0};
+
+    std::thread mThread;
+    std::atomic<ThreadState> mThreadState {ThreadState::INIT};
+    std::atomic<bool> mThreadShutdown {false};
+    bool mFrameReady {false};
+    std::vector<std::string> mCarried; // union of the coalesced frames
+    bool mStageAll {true};             // new receiver, nothing is staged from it yet
+
+    mutable std::mutex mMutex;
+    std::condition_variable mCvBoot; // using at boot threadMain sequence
+    std::condition_variable mCvFrame;
+
+    Parser mParser;
+};
+
+} // namespace arras_render
@@ -0,0 +1,301 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#include "HeatMapAccum.h"
+#include "encodingUtil.h"
+#include "Trace.h"
+
+#include <scene_rdl2/render/util/StrUtil.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace arras_render {
+
+HeatMapAccum::HeatMapAccum(const unsigned tileSize)
+    : mTileSize(std::max(tileSize, 1u))
+{
+    parserConfigure();
+}
+
+bool
+HeatMapAccum::update(mcrt_dataio::ClientReceiverFb& fbReceiver)
+//
+// decode thread only : mFrame is filled outside of the lock
+//
+{
+    if (!fbReceiver.getHeatMapStatus()) return false;
+
+    TraceSpan span("heatMapAccum");
+    if (!fbReceiver.getHeatMap(mFrame, true)) return false;
+
+    const unsigned width = fbReceiver.getWidth();
+    const unsigned height = fbReceiver.getHeight();
+    if (mFrame.size() != static_cast<size_t>(width) * height) return false; // single channel
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (width != mWidth || height != mHeight) {
+        // the accumulated cost is meaningless for another resolution
+        reset(width, height);
+    }
+
+    const uint32_t syncId = fbReceiver.getFrameId();
+    if (!mHasCurrent || syncId != mSyncId) {
+        // new render : the latest frame of the previous render is its total cost
+        if (mHasCurrent) {
+            for (size_t i = 0; i < mTotal.size(); ++i) mTotal[i] += mCurrent[i];
+        }
+        mHasCurrent = true;
+        mSyncId = syncId;
+        ++mRenderTotal;
+    }
+    mCurrent.swap(mFrame);
+    return true;
+}
+
+void
+HeatMapAccum::clear()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    reset(mWidth, mHeight);
+    mPickPending = 0;
+    mPickData.clear();
+}
+
+unsigned
+HeatMapAccum::getWidth() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mWidth;
+}
+
+unsigned
+HeatMapAccum::getHeight() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mHeight;
+}
+
+unsigned
+HeatMapAccum::getRenderTotal() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mRenderTotal;
+}
+
+double
+HeatMapAccum::getTotalCost() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    double cost = 0.0;
+    for (size_t i = 0; i < mTotal.size(); ++i) cost += mTotal[i] + mCurrent[i];
+    return cost;
+}
+
+void
+HeatMapAccum::getTotal(std::vector<float>& total) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    total.resize(mTotal.size());
+    for (size_t i = 0; i < mTotal.size(); ++i) {
+        total[i] = static_cast<float>(mTotal[i] + mCurrent[i]);
+    }
+}
+
+std::vector<HeatMapAccum::Tile>
+HeatMapAccum::rankTiles(const size_t topN) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return rankTilesMain(topN);
+}
+
+void
+HeatMapAccum::setPickPending(const size_t total)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mPickPending = total;
+    mPickData.clear();
+}
+
+void
+HeatMapAccum::addPickData(const Json::Value& payload)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mPickData.size() >= mPickPending) return; // not requested by the hotspot report
+        mPickData.push_back(payload);
+    }
+    mCvPick.notify_all();
+}
+
+bool
+HeatMapAccum::waitPickData(const float timeoutSec) const
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    return mCvPick.wait_for(lock, std::chrono::duration<float>(timeoutSec),
+                            [&] { return mPickData.size() >= mPickPending; });
+}
+
+bool
+HeatMapAccum::saveExr(const std::string& filename, std::string& error) const
+{
+    std::vector<float> total;
+    getTotal(total);
+    if (total.empty()) {
+        error = "no heat map data has been received";
+        return false;
+    }
+    return writeExrImage(filename, "cost", total, getWidth(), getHeight(), 1, error);
+}
+
+bool
+HeatMapAccum::saveReport(const std::string& filename, const size_t topN, const unsigned picksPerTile,
+                         std::string& error) const
+{
+    std::ofstream fout(filename, std::ios::trunc);
+    if (!fout) {
+        error = "Can not create file. filename:" + filename;
+        return false;
+    }
+    Json::StyledWriter writer;
+    fout << writer.write(toJson(topN, picksPerTile));
+    return true;
+}
+
+std::string
+HeatMapAccum::show(const size_t topN) const
+{
+    namespace str_util = scene_rdl2::str_util;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    double totalCost = 0.0;
+    for (size_t i = 0; i < mTotal.size(); ++i) totalCost += mTotal[i] + mCurrent[i];
+
+    std::ostringstream ostr;
+    ostr << "HeatMapAccum {\n"
+         << "  resolution:" << mWidth << 'x' << mHeight << '\n'
+         << "  tileSize:" << mTileSize << '\n'
+         << "  renderTotal:" << mRenderTotal << '\n'
+         << "  totalCost:" << str_util::secStr(static_cast<float>(totalCost)) << '\n'
+         << "  hotspots (top " << topN << ") {\n";
+    const std::vector<Tile> tiles = rankTilesMain(topN);
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        const Tile& tile = tiles[i];
+        ostr << "    " << std::setw(3) << i
+             << " tile(" << tile.mX << ',' << tile.mY << ' ' << tile.mWidth << 'x' << tile.mHeight << ")"
+             << " cost:" << str_util::secStr(static_cast<float>(tile.mCost))
+             << ' ' << std::fixed << std::setprecision(2) << tile.mFraction * 100.0f << "%\n";
+    }
+    ostr << "  }\n"
+         << "}";
+    return ostr.str();
+}
+
+Json::Value
+HeatMapAccum::toJson(const size_t topN, const unsigned picksPerTile) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    double totalCost = 0.0;
+    for (size_t i = 0; i < mTotal.size(); ++i) totalCost += mTotal[i] + mCurrent[i];
+
+    Json::Value root;
+    root["width"] = mWidth;
+    root["height"] = mHeight;
+    root["tileSize"] = mTileSize;
+    root["renders"] = mRenderTotal;
+    root["totalCost"] = totalCost;
+
+    Json::Value& hotspots = root["hotspots"];
+    hotspots = Json::Value(Json::arrayValue);
+    const std::vector<Tile> tiles = rankTilesMain(topN);
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        const Tile& tile = tiles[i];
+        Json::Value item;
+        item["rank"] = static_cast<Json::UInt64>(i);
+        item["x"] = tile.mX;
+        item["y"] = tile.mY;
+        item["width"] = tile.mWidth;
+        item["height"] = tile.mHeight;
+        item["cost"] = tile.mCost;
+        item["fraction"] = tile.mFraction;
+        // pick requests are sent in the ranking order, picksPerTile requests per tile
+        for (unsigned j = 0; j < picksPerTile; ++j) {
+            const size_t pickId = i * picksPerTile + j;
+            if (pickId < mPickData.size()) item["pick"].append(mPickData[pickId]);
+        }
+        hotspots.append(item);
+    }
+    return root;
+}
+
+void
+HeatMapAccum::reset(const unsigned width, const unsigned height)
+{
+    mWidth = width;
+    mHeight = height;
+    mTotal.assign(static_cast<size_t>(width) * height, 0.0);
+    mCurrent.assign(static_cast<size_t>(width) * height, 0.0f);
+    mHasCurrent = false;
+    mRenderTotal = 0;
+}
+
+std::vector<HeatMapAccum::Tile>
+HeatMapAccum::rankTilesMain(const size_t topN) const
+{
+    std::vector<Tile> tiles;
+    if (mTotal.empty()) return tiles;
+
+    double totalCost = 0.0;
+    for (unsigned tileY = 0; tileY < mHeight; tileY += mTileSize) {
+        for (unsigned tileX = 0; tileX < mWidth; tileX += mTileSize) {
+            Tile tile;
+            tile.mX = tileX;
+            tile.mY = tileY;
+            tile.mWidth = std::min(mTileSize, mWidth - tileX);
+            tile.mHeight = std::min(mTileSize, mHeight - tileY);
+            for (unsigned y = tileY; y < tileY + tile.mHeight; ++y) {
+                const size_t offset = static_cast<size_t>(y) * mWidth;
+                for (unsigned x = tileX; x < tileX + tile.mWidth; ++x) {
+                    tile.mCost += mTotal[offset + x] + mCurrent[offset + x];
+                }
+            }
+            totalCost += tile.mCost;
+            tiles.push_back(tile);
+        }
+    }
+
+    const size_t total = std::min(topN, tiles.size());
+    std::partial_sort(tiles.begin(), tiles.begin() + total, tiles.end(),
+                      [](const Tile& a, const Tile& b) { return a.mCost > b.mCost; });
+    tiles.resize(total);
+    for (auto& itr : tiles) {
+        itr.mFraction = (totalCost > 0.0) ? static_cast<float>(itr.mCost / totalCost) : 0.0f;
+    }
+    return tiles;
+}
+
+void
+HeatMapAccum::parserConfigure()
+{
+    mParser.description("accumulated heat map command");
+    mParser.opt("show", "<n>", "show accumulated cost and top n hotspot tiles",
+                [&](Arg& arg) -> bool { return arg.msg(show((arg++).as<size_t>(0)) + '\n'); });
+    mParser.opt("clear", "", "clear accumulated cost",
+                [&](Arg& arg) -> bool {
+                    clear();
+                    return arg.msg("clear\n");
+                });
+    mParser.opt("saveExr", "<filename>", "save accumulated per pixel cost as float EXR",
+                [&](Arg& arg) -> bool {
+                    std::string error;
+                    if (!saveExr((arg++)(), error)) return arg.msg(error + '\n');
+                    return arg.msg("saved\n");
+                });
+}
+
+} // namespace arras_render
@@ -0,0 +1,96 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <scene_rdl2/common/grid_util/Arg.h>
+#include <scene_rdl2/common/grid_util/Parser.h>
+
+#include <mcrt_dataio/client/receiver/ClientReceiverFb.h>
+
+#include <json/json.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace arras_render {
+
+class HeatMapAccum
+//
+// Accumulates the *heatMap* built-in pass (per pixel render time in sec) over all the renders of
+// the session. The heat map of a render is cumulative, so the latest frame of each render (syncId)
+// is added to the total when the next render starts. Screen-space tiles of the total are ranked by
+// cost for the hotspot report, and pick data requested for the top tiles is attached to them in the
+// order of the requests. update() is called from the decode thread, all APIs are MT-safe.
+//
+{
+public:
+    using Arg = scene_rdl2::grid_util::Arg;
+    using Parser = scene_rdl2::grid_util::Parser;
+
+    struct Tile {
+        unsigned mX {0};      // top left, top to bottom scanline
+        unsigned mY {0};
+        unsigned mWidth {0};
+        unsigned mHeight {0};
+        double mCost {0.0};   // sec
+        float mFraction {0.0f}; // of the whole image cost
+    };
+
+    explicit HeatMapAccum(const unsigned tileSize = 32);
+
+    // returns false if the frame has no heat map
+    bool update(mcrt_dataio::ClientReceiverFb& fbReceiver);
+    void clear();
+
+    unsigned getWidth() const;
+    unsigned getHeight() const;
+    unsigned getRenderTotal() const; // renders seen so far including the current one
+    double getTotalCost() const;
+    void getTotal(std::vector<float>& total) const; // per pixel sec, top to bottom scanline
+
+    std::vector<Tile> rankTiles(const size_t topN) const;
+
+    // pick data of the hotspots : expected response count, then responses in arrival order
+    void setPickPending(const size_t total);
+    void addPickData(const Json::Value& payload);
+    bool waitPickData(const float timeoutSec) const;
+
+    bool saveExr(const std::string& filename, std::string& error) const;
+    bool saveReport(const std::string& filename, const size_t topN, const unsigned picksPerTile,
+                    std::string& error) const;
+
+    std::string show(const size_t topN) const;
+    Json::Value toJson(const size_t topN, const unsigned picksPerTile) const;
+
+    Parser& getParser() { return mParser; }
+
+private:
+    void reset(const unsigned width, const unsigned height); // mMutex locked by the caller
+    std::vector<Tile> rankTilesMain(const size_t topN) const; // mMutex locked by the caller
+    void parserConfigure();
+
+    const unsigned mTileSize;
+
+    mutable std::mutex mMutex;
+    mutable std::condition_variable mCvPick;
+
+    unsigned mWidth {0};
+    unsigned mHeight {0};
+    std::vector<double> mTotal;  // finished renders
+    std::vector<float> mCurrent; // latest frame of the current render
+    std::vector<float> mFrame;   // work buffer of update()
+    bool mHasCurrent {false};
+    uint32_t mSyncId {0};
+    unsigned mRenderTotal {0};
+
+    size_t mPickPending {0};
+    std::vector<Json::Value> mPickData;
+
+    Parser mParser;
+};
+
+} // namespace arras_render
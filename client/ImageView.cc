@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "ImageView.h"
+#include "PixelKernels.h"
 
 #ifdef __ARM_NEON__
 // This works around OIIO including x86 based headers due to detection of SSE
@@ -15,6 +16,7 @@
 
 #include <algorithm> // std::find
 #include <cmath>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <list>
@@ -48,6 +50,9 @@
 
 #include "encodingUtil.h"
 #include "outputRate.h"
+#include "StallWatchdog.h"
+#include "StartupReport.h"
+#include "Trace.h"
 
 //#define DEBUG_MSG_DISPLAY_FRAME
 //#define DEBUG_MSG_POPULATE_RGB_FRAME
@@ -58,6 +63,7 @@ constexpr int TARGET_HEIGHT = 600;
 constexpr int OVERLAY_X_OFFSET = 50;
 constexpr int OVERLAY_Y_OFFSET = 50;
 constexpr int SCROLL_PAD = 16;
+constexpr int AB_DIFF_GAIN = 4; // difference image amplification
 const std::string BEAUTY_PASS = "*beauty*";
 const std::string PIXINFO_PASS = "*pixInfo*";
 const std::string HEATMAP_PASS = "*heatMap*";
@@ -236,6 +242,8 @@ ImageView::ImageView(std::shared_ptr<mcrt_dataio::ClientReceiverFb> pFbReceiver,
     // script runs in another thread a QueuedConnection makes this thread safe
     connect(this, SIGNAL(displayFrameSignal()),
             this, SLOT(displayFrameSlot()), Qt::QueuedConnection);
+    connect(this, SIGNAL(frameQueuedSignal()),
+            this, SLOT(frameQueuedSlot()), Qt::QueuedConnection);
 
     connect(mButStart.get(), SIGNAL(released()),
             this, SLOT(handleStart()), Qt::QueuedConnection);
@@ -277,6 +285,14 @@ ImageView::ImageView(std::shared_ptr<mcrt_dataio::ClientReceiverFb> pFbReceiver,
     connect(this, SIGNAL(statusOverlaySignal(short, QString)),
             this, SLOT(handleStatusOverlay(short, QString)), Qt::QueuedConnection);
 
+    if (arras_render::StallWatchdog::get().isEnabled()) {
+        // event loop heartbeat of the stall watchdog
+        arras_render::StallWatchdog::get().attachGui();
+        mStallTimer.reset(new QTimer(this));
+        connect(mStallTimer.get(), SIGNAL(timeout()), this, SLOT(handleStallBeat()));
+        mStallTimer->start(arras_render::StallWatchdog::GUI_BEAT_INTERVAL_MS);
+    }
+
     if (!scriptName.empty()) {
         // set up the scripting environment
         mScripting.init(this, scriptName, exitScriptDone);
@@ -293,16 +309,120 @@ ImageView::ImageView(std::shared_ptr<mcrt_dataio::ClientReceiverFb> pFbReceiver,
 }
 
 void
-ImageView::setup(std::shared_ptr<arras4::sdk::SDK>& sdk)
+ImageView::setup(std::shared_ptr<arras_render::RenderSession>& sdk)
 {
     mSdk = sdk;
 }
 
+void
+ImageView::setAbCompare(std::shared_ptr<mcrt_dataio::ClientReceiverFb> pFbReceiverB,
+                        std::shared_ptr<arras_render::EditLatency> editLatencyB,
+                        const AbView abView,
+                        const std::string& sessionNameB)
+{
+    mFbReceiverB = pFbReceiverB;
+    mEditLatencyB = editLatencyB;
+    mAbView = abView;
+    mSessionNameB = sessionNameB;
+
+    std::ostringstream title;
+    title << windowTitle().toStdString() << " vs " << mSessionNameB;
+    setWindowTitle(QString::fromStdString(title.str()));
+
+    handleScaleSelect(mImgScale - 1); // widget size for the side by side view
+    QSize buttonSize = mButtonRow->sizeHint();
+    resize(getDisplayWidth() / mImgScale + 40, mImgHeight / mImgScale + buttonSize.height() + 32);
+    initImage();
+}
+
+bool
+ImageView::openAbLog(const std::string& filename, std::string& error)
+{
+    mAbLog.open(filename, std::ios::trunc);
+    if (!mAbLog) {
+        error = "Can not create file. filename:" + filename;
+        return false;
+    }
+    mAbLog << "sec,syncIdA,progressA,syncIdB,progressB\n";
+    mAbLogStart = std::chrono::steady_clock::now();
+    return true;
+}
+
+void
+ImageView::setupB(std::shared_ptr<arras_render::RenderSession>& sdkB)
+{
+    mSdkB = sdkB;
+}
+
+void
+ImageView::setFrameHistory(std::shared_ptr<arras_render::FrameHistory> frameHistory)
+{
+    mFrameHistory = frameHistory;
+    // the view is also changed by the debug console thread, repaint through the signal
+    mFrameHistory->setViewChangeCallBack([&]() { Q_EMIT displayFrameSignal(); });
+}
+
+void
+ImageView::setPoseCache(std::shared_ptr<arras_render::PoseCache> poseCache)
+{
+    mPoseCache = poseCache;
+    // a revisited pose which is only kept as JPEG is decoded by the pose cache worker
+    mPoseCache->setDecodeCallBack([&](const uint64_t key,
+                                      std::vector<unsigned char>& rgb888,
+                                      const unsigned width,
+                                      const unsigned height,
+                                      const float progress) {
+        poseDecoded(key, rgb888, width, height, progress);
+    });
+}
+
+void
+ImageView::setDenoiseStage(std::shared_ptr<arras_render::DenoiseStage> denoiseStage)
+{
+    mDenoiseStage = denoiseStage;
+    // a new denoise result is shown without waiting for the next received frame
+    mDenoiseStage->setResultCallBack([&]() { displayFrame(); });
+}
+
+void
+ImageView::setDisplayTransform(std::shared_ptr<arras_render::DisplayTransform> displayTransform)
+{
+    mDisplayTransform = displayTransform;
+    // changed by the key or the debug console thread
+    mDisplayTransform->setChangeCallBack([&]() { refreshDisplayTransform(); });
+}
+
+void
+ImageView::setPerfHud(std::shared_ptr<arras_render::PerfHud> perfHud)
+{
+    mPerfHud = perfHud;
+
+    // The HUD is a separate label on top of the viewport, so the frame is never redrawn for it and
+    // it keeps its own resolution regardless of the display scale.
+    mHudLabel.reset(new QLabel(mScrollArea->viewport()));
+    mHudLabel->setAttribute(Qt::WA_TransparentForMouseEvents);
+    mHudLabel->move(8, 8);
+    mHudLabel->hide();
+
+    // samples are taken while the HUD is hidden too, so it shows the history as soon as it is toggled on
+    mHudTimer.reset(new QTimer(this));
+    connect(mHudTimer.get(), SIGNAL(timeout()), this, SLOT(handleHudTimer()));
+    mHudTimer->start(arras_render::PerfHud::SAMPLE_INTERVAL_MS);
+}
+
 ImageView::~ImageView()
 {
     // these would get destroyed automatically but destroy them
     // manually to control the order they're destroyed.
     mSdk.reset();
+    mSdkB.reset();
+    if (mFrameHistory) mFrameHistory->setViewChangeCallBack(nullptr);
+    if (mPoseCache) mPoseCache->setDecodeCallBack(nullptr);
+    if (mDenoiseStage) mDenoiseStage->setResultCallBack(nullptr);
+    if (mDisplayTransform) mDisplayTransform->setChangeCallBack(nullptr);
+    mHudTimer.reset();
+    mHudLabel.reset();
+    mStallTimer.reset();
     mImage.reset();
     mScrollArea.reset();
 
@@ -327,11 +447,12 @@ ImageView::initImage()
 {
     // Avoiding locking the mutex as this should only be
     // called from the constructor
-    QImage image(mImgWidth, mImgHeight, QImage::Format_RGB888);
+    QImage image(getDisplayWidth(), mImgHeight, QImage::Format_RGB888);
     image.fill(Qt::black);
 
     if (mOverlay) {
         addOverlay(image);
+        if (isAbCompare()) addAbOverlay(image);
     }
 
     mImage->setPixmap(QPixmap::fromImage(image));
@@ -348,7 +469,9 @@ ImageView::exitProgram()
 void
 ImageView::displayFrame()
 {
-    std::lock_guard<std::mutex> guard(mFrameMux);
+    TraceSpan waitSpan("frameMuxWait");
+    arras_render::StallLockGuard guard(mFrameMux, arras_render::StallWatchdog::Lock::FRAME_MUX);
+    waitSpan.end();
 
     // ignore frames for the previous render
     // This appears to be broken ARRAS-3305
@@ -360,9 +483,33 @@ ImageView::displayFrame()
     std::cerr << ">> ImageView.cc displayFrame() passA\n";
 #endif // end DEBUG_MSG_DISPLAY_FRAME
     populateRGBFrame();
+    if (isAbCompare()) {
+        if (mBlankDisplay) mRgbFrameB.clear(); // B frames are converted by displayFrameB()
+        logAbProgress();
+    }
 #ifdef DEBUG_MSG_DISPLAY_FRAME
     std::cerr << ">> ImageView.cc displayFrame() passB\n";
 #endif // end DEBUG_MSG_DISPLAY_FRAME
+    if (mJpegPipeline && !mBlankDisplay) {
+        const float progress = mRenderProgress / 100.0f;
+        if (mJpegPipeline->isDue(progress, progress >= 1.0f)) {
+            mJpegPipeline->push(mRgbFrame, mImgWidth, mImgHeight, progress, progress >= 1.0f);
+        }
+    }
+    if (mFrameHistory && !mBlankDisplay && mCurrentOutput == BEAUTY_PASS) {
+        const int instance = static_cast<int>(mFbReceiver->getFrameId());
+        const float progress = mRenderProgress / 100.0f;
+        if (mFrameHistory->isDue(instance, progress)) {
+            mFrameHistory->push(instance, progress, mRgbFrame, mImgWidth, mImgHeight);
+        }
+    }
+    if (mPoseCache && !mBlankDisplay && mCurrentOutput == BEAUTY_PASS) {
+        const int instance = static_cast<int>(mFbReceiver->getFrameId());
+        const float progress = mRenderProgress / 100.0f;
+        if (mPoseCache->isDue(instance, progress)) {
+            mPoseCache->push(instance, progress, mRgbFrame, mImgWidth, mImgHeight);
+        }
+    }
     // Check to see if we received any new outputs (aka AOVs aka buffers)
     // in the first frame we will receive an initial list of outputs,
     // if the client is using AOV Output Rate Control then later frames
@@ -392,13 +539,36 @@ ImageView::displayFrame()
         std::cerr << ">> ImageView.cc displayFrame() FirstFrame mImgWidth:" << mImgWidth << " mImgHeight:" << mImgHeight << '\n';
     }
 
-    Q_EMIT displayFrameSignal();
+    if (mPerfHud) mPerfHud->displayQueued();
+    Q_EMIT frameQueuedSignal();
+}
+
+void
+ImageView::displayFrameB()
+{
+    // Only the B beauty is converted, the A frame and everything fed from it (jpeg, frame history,
+    // pose cache, reprojection) are unchanged. The A/B frame is composed by displayFrameSlot().
+    TraceSpan waitSpan("frameMuxWait");
+    arras_render::StallLockGuard guard(mFrameMux, arras_render::StallWatchdog::Lock::FRAME_MUX);
+    waitSpan.end();
+
+    if (mFbReceiverB->getProgress() < 0.0f) {
+        mRgbFrameB.clear();
+    } else {
+        TraceSpan spanB("populateRGBFrameB", mRgbFrameB.size());
+        mFbReceiverB->getBeautyRgb888(mRgbFrameB, true, false);
+    }
+    logAbProgress();
+
+    if (mPerfHud) mPerfHud->displayQueued();
+    Q_EMIT frameQueuedSignal();
 }
 
 void
 ImageView::setInitialCondition()
 {
     mRgbFrame.clear();
+    mRgbFrameB.clear();
 }
 
 void
@@ -416,6 +586,8 @@ ImageView::clearDisplayFrame()
 void
 ImageView::populateRGBFrame()
 {
+    TraceSpan span("populateRGBFrame", mRgbFrame.size());
+
     if (mBlankDisplay) {
 #ifdef DEBUG_MSG_POPULATE_RGB_FRAME
         std::cerr << ">> ImageView.cc populateRGBFrame() before memset()\n";
@@ -427,14 +599,27 @@ ImageView::populateRGBFrame()
         return;
     }
 
+    if (mDisplayTransform && !mDisplayTransform->isIdentity() && populateFloatFrame()) {
+        mRenderProgress = mFbReceiver->getProgress() * 100;
+        return;
+    }
+    mFloatFrame.clear();
+
     if (mCurrentOutput == BEAUTY_PASS) {
 #ifdef DEBUG_MSG_POPULATE_RGB_FRAME
         std::cerr << ">> ImageView.cc populateRGBFrame() before getBeautyRgb888()\n";
 #endif // end DEBUG_MSG_POPULATE_RGB_FRAME
-        if (!mFbReceiver->getBeautyRgb888(mRgbFrame,
-                                          true,
-                                          false)) {
+        // float beauty by the receiver, RGB888 (not sRGB) by the dispatched pixel kernel
+        if (!mFbReceiver->getBeauty(mBeautyFrame, true)) { // top2bottom
             std::cerr << "populateRGBFrame() failed. " << mFbReceiver->getErrorMsg() << '\n';
+        } else {
+            const size_t pixTotal = mBeautyFrame.size() / 4;
+            mRgbFrame.resize(pixTotal * 3);
+            getPixelKernels().mQuantizeRgba888(mBeautyFrame.data(), pixTotal, mRgbFrame.data());
+        }
+        if (mDenoiseStage && mDenoiseStage->isActive()) {
+            // latest denoised result of this render if any, otherwise the raw beauty stays
+            mDenoiseStage->getResult(mFbReceiver->getFrameId(), mRgbFrame);
         }
 #ifdef DEBUG_MSG_POPULATE_RGB_FRAME
         std::cerr << ">> ImageView.cc populateRGBFrame() after getBeautyRgb888()\n";
@@ -474,6 +659,50 @@ ImageView::populateRGBFrame()
     mRenderProgress = mFbReceiver->getProgress() * 100;
 }
 
+bool
+ImageView::populateFloatFrame()
+//
+// The float beauty or AOV is kept in mFloatFrame so that a display transform change only re-runs
+// the kernel. The other builtin passes stay RGB888 by the receiver. The background denoise result
+// is RGB888, the display transform shows the raw beauty.
+//
+{
+    if (mCurrentOutput == BEAUTY_PASS) {
+        mFbReceiver->getBeauty(mFloatFrame, true); // top2bottom
+        mFloatNumChan = 4; // RGBA
+    } else if (mCurrentOutput == PIXINFO_PASS || mCurrentOutput == HEATMAP_PASS ||
+               mCurrentOutput == WEIGHT_PASS || mCurrentOutput == BEAUTYODD_PASS) {
+        return false;
+    } else {
+        const unsigned total = mFbReceiver->getTotalRenderOutput();
+        unsigned id = 0;
+        while (id < total && mFbReceiver->getRenderOutputName(id) != mCurrentOutput) ++id;
+        if (id == total) return false;
+        const int numChan = mFbReceiver->getRenderOutputNumChan(id);
+        if (numChan <= 0) return false;
+        mFbReceiver->getRenderOutput(id, mFloatFrame,
+                                     true,   // top2bottom
+                                     false); // closestFilterDepthOutput
+        mFloatNumChan = static_cast<unsigned>(numChan);
+    }
+    // false if the size does not match (no image data yet)
+    return mDisplayTransform->apply(mFloatFrame, mFloatNumChan, mImgWidth, mImgHeight, mRgbFrame);
+}
+
+void
+ImageView::refreshDisplayTransform()
+{
+    {
+        arras_render::StallLockGuard guard(mFrameMux, arras_render::StallWatchdog::Lock::FRAME_MUX);
+        if (mFloatFrame.empty()) {
+            populateRGBFrame(); // the first change from the identity needs the float frame
+        } else {
+            mDisplayTransform->apply(mFloatFrame, mFloatNumChan, mImgWidth, mImgHeight, mRgbFrame);
+        }
+    }
+    Q_EMIT displayFrameSignal();
+}
+
 bool
 ImageView::savePPM(const std::string& filename) const
 {
@@ -543,25 +772,74 @@ ImageView::updateOutputsComboBox()
     }
 }
 
+void
+ImageView::frameQueuedSlot()
+//
+// Paint of a frame queued by displayFrame() or displayFrameB(). The other repaints (direct calls
+// and displayFrameSignal) do not touch the PerfHud queue depth.
+//
+{
+    displayFrameSlot();
+    if (mPerfHud) mPerfHud->displayDequeued();
+}
+
 void
 ImageView::displayFrameSlot()
 {
-    std::lock_guard<std::mutex> guard(mFrameMux);
+    buildPreview();
+
+    TraceSpan waitSpan("frameMuxWait");
+    arras_render::StallLockGuard guard(mFrameMux, arras_render::StallWatchdog::Lock::FRAME_MUX);
+    waitSpan.end();
+    TraceSpan paintSpan("paint", mRgbFrame.size());
+    const auto paintStart = std::chrono::steady_clock::now();
+    const bool firstPaint = (!mRgbFrame.empty() &&
+                             StartupReport::get().isDone(StartupReport::Phase::FIRST_DECODE) &&
+                             !StartupReport::get().isDone(StartupReport::Phase::FIRST_PAINT));
+    if (firstPaint) StartupReport::get().begin(StartupReport::Phase::FIRST_PAINT);
 
     if (mCboOutputs->count() != static_cast<int>(mOutputNames.size())) {
         updateOutputsComboBox();
     }
 
+    // the frame history is not used by the A/B comparison
+    const arras_render::FrameHistory::View historyView =
+        (mFrameHistory && !isAbCompare()) ? mFrameHistory->getView() : arras_render::FrameHistory::View();
+
     if (mRgbFrame.size() > 0) {
         // We got issues and the following QImage construction does not work properly if the input image size
         // is 1667 x 757. Result QImage is not properly converted and the resulting image is 1 pixel shifted
         // every scanline. Looks like this is a bug in the QImage constructor.
         // One of the easiest fixes is using another constructor that has a per-line-size argument.
         // QImage image(mRgbFrame.data(), mImgWidth, mImgHeight, QImage::Format_RGB888); // <- does not work
-        QImage image(mRgbFrame.data(), mImgWidth, mImgHeight, mImgWidth * 3, QImage::Format_RGB888);
+        unsigned char* pixels = mRgbFrame.data();
+        if (isAbCompare()) {
+            composeAbFrame();
+            pixels = mRgbFrameAb.data();
+        } else if (!historyView.isLive()) {
+            composeHistoryFrame(historyView);
+            pixels = mRgbFrameHistory.data();
+        } else if (isPoseCacheDisplay()) {
+            pixels = mRgbFramePose.data();
+        } else if (isWarpDisplay()) {
+            pixels = mRgbFrameWarp.data();
+        }
+        const unsigned displayWidth = getDisplayWidth();
+        QImage image(pixels, displayWidth, mImgHeight, displayWidth * 3, QImage::Format_RGB888);
 
         if (mOverlay) {
             addOverlay(image);
+            if (isAbCompare()) addAbOverlay(image);
+            if (pixels == mRgbFramePose.data()) {
+                boost::format cachedFmt("CACHED %0.1f%%");
+                cachedFmt % (mPoseProgress * 100.0f);
+                addPreviewOverlay(image, cachedFmt.str());
+            } else if (pixels == mRgbFrameWarp.data()) {
+                addPreviewOverlay(image, "REPROJECTED");
+            }
+        }
+        if (!historyView.isLive()) {
+            addHistoryOverlay(image, historyView); // a stored image is never mistaken for the live one
         }
 
         /* useful debug code
@@ -573,21 +851,39 @@ ImageView::displayFrameSlot()
         }
         */
 
-        QImage scaledImage = image.scaled(mImgWidth/mImgScale,mImgHeight/mImgScale);
-        mImage->setPixmap(QPixmap::fromImage(scaledImage));
+        if (mImgScale > 1) {
+            // box filter by the dispatched kernel instead of the nearest sampling of QImage::scaled()
+            const unsigned scaledWidth = displayWidth / mImgScale;
+            const unsigned scaledHeight = mImgHeight / mImgScale;
+            mRgbFrameScaled.resize(static_cast<size_t>(scaledWidth) * scaledHeight * 3);
+            getPixelKernels().mDownscaleRgb888(image.constBits(), image.bytesPerLine(),
+                                               scaledWidth, scaledHeight, mImgScale,
+                                               mRgbFrameScaled.data(), scaledWidth * 3);
+            QImage scaledImage(mRgbFrameScaled.data(), scaledWidth, scaledHeight, scaledWidth * 3,
+                               QImage::Format_RGB888);
+            mImage->setPixmap(QPixmap::fromImage(scaledImage));
+        } else {
+            mImage->setPixmap(QPixmap::fromImage(image));
+        }
     } else {
 
         // there isn't an image yet so create a black one
-        QImage image(mImgWidth, mImgHeight, QImage::Format_RGB888);
+        QImage image(getDisplayWidth(), mImgHeight, QImage::Format_RGB888);
         image.fill(Qt::black);
 
         if (mOverlay) {
             addOverlay(image);
+            if (isAbCompare()) addAbOverlay(image);
         }
 
-        QImage scaledImage = image.scaled(mImgWidth/mImgScale, mImgHeight/mImgScale);
+        QImage scaledImage = image.scaled(getDisplayWidth()/mImgScale, mImgHeight/mImgScale);
         mImage->setPixmap(QPixmap::fromImage(scaledImage));
     }
+    if (firstPaint) StartupReport::get().end(StartupReport::Phase::FIRST_PAINT);
+    if (mPerfHud) {
+        mPerfHud->framePainted(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() -
+                                                                       paintStart).count());
+    }
 }
 
 void
@@ -611,7 +907,507 @@ ImageView::addOverlay(QImage& image)
               % durationSeconds.count()
               % mRenderProgress;
 
-    qp.drawText(mOverlayXOffset, mImgHeight - mOverlayYOffset, QString::fromStdString(hmsPctFmt.str()));
+    std::string progressStr = hmsPctFmt.str();
+    if (mRenderEta) {
+        const std::string etaStr = mRenderEta->showOverlay();
+        if (!etaStr.empty()) progressStr += "  " + etaStr;
+    }
+    if (mDisplayTransform) {
+        const std::string transformStr = mDisplayTransform->showOverlay();
+        if (!transformStr.empty()) progressStr += "  " + transformStr;
+    }
+    qp.drawText(mOverlayXOffset, mImgHeight - mOverlayYOffset, QString::fromStdString(progressStr));
+
+    if (mEditLatency) {
+        const std::string latencyStr = mEditLatency->showOverlay();
+        if (!latencyStr.empty()) {
+            // one line above the elapsed time and progress
+            qp.drawText(mOverlayXOffset, mImgHeight - mOverlayYOffset - qp.fontMetrics().height(),
+                        QString::fromStdString(latencyStr));
+        }
+    }
+}
+
+unsigned
+ImageView::getDisplayWidth() const
+{
+    return (isAbCompare() && mAbView == AbView::SIDE_BY_SIDE) ? mImgWidth * 2 : mImgWidth;
+}
+
+void
+ImageView::composeAbFrame()
+//
+// mFrameMux must be locked by the caller. A frame which does not match the current resolution
+// (no image yet, or a frame of the previous resolution) is shown as black.
+//
+{
+    const size_t rowSize = static_cast<size_t>(mImgWidth) * 3;
+    const size_t frameSize = rowSize * mImgHeight;
+    const bool hasA = (mRgbFrame.size() == frameSize);
+    const bool hasB = (mRgbFrameB.size() == frameSize);
+
+    if (mAbView == AbView::SIDE_BY_SIDE) {
+        mRgbFrameAb.resize(frameSize * 2);
+        for (unsigned y = 0; y < mImgHeight; ++y) {
+            unsigned char* dst = &mRgbFrameAb[y * rowSize * 2];
+            if (hasA) std::memcpy(dst, &mRgbFrame[y * rowSize], rowSize);
+            else      std::memset(dst, 0, rowSize);
+            if (hasB) std::memcpy(dst + rowSize, &mRgbFrameB[y * rowSize], rowSize);
+            else      std::memset(dst + rowSize, 0, rowSize);
+        }
+    } else {
+        mRgbFrameAb.resize(frameSize);
+        if (hasA && hasB) {
+            getPixelKernels().mAbsDiffRgb888(mRgbFrame.data(), mRgbFrameB.data(), frameSize, AB_DIFF_GAIN,
+                                             mRgbFrameAb.data());
+        } else {
+            for (size_t i = 0; i < frameSize; ++i) {
+                const int a = hasA ? mRgbFrame[i] : 0;
+                const int b = hasB ? mRgbFrameB[i] : 0;
+                mRgbFrameAb[i] = static_cast<unsigned char>(std::min(std::abs(a - b) * AB_DIFF_GAIN, 255));
+            }
+        }
+    }
+}
+
+void
+ImageView::addAbOverlay(QImage& image)
+//
+// Session labels on top and the progress and edit latency of the B session on the right half.
+// The A session information is drawn by addOverlay().
+//
+{
+    QPainter qp(&image);
+    qp.setPen(*mFontColor);
+    qp.setFont(*mFont);
+
+    const int lineHeight = qp.fontMetrics().height();
+    if (mAbView == AbView::DIFFERENCE) {
+        std::ostringstream ostr;
+        ostr << "|" << mSessionName << " - " << mSessionNameB << "| x" << AB_DIFF_GAIN;
+        qp.drawText(mOverlayXOffset, mOverlayYOffset, QString::fromStdString(ostr.str()));
+        return;
+    }
+
+    const int offsetB = static_cast<int>(mImgWidth);
+    qp.drawText(mOverlayXOffset, mOverlayYOffset, QString::fromStdString("A : " + mSessionName));
+    qp.drawText(offsetB + mOverlayXOffset, mOverlayYOffset, QString::fromStdString("B : " + mSessionNameB));
+
+    boost::format pctFmt("%0.1f%%");
+    pctFmt % (std::max(mFbReceiverB->getProgress(), 0.0f) * 100.0f);
+    qp.drawText(offsetB + mOverlayXOffset, mImgHeight - mOverlayYOffset, QString::fromStdString(pctFmt.str()));
+
+    if (mEditLatencyB) {
+        const std::string latencyStr = mEditLatencyB->showOverlay();
+        if (!latencyStr.empty()) {
+            qp.drawText(offsetB + mOverlayXOffset, mImgHeight - mOverlayYOffset - lineHeight,
+                        QString::fromStdString(latencyStr));
+        }
+    }
+}
+
+void
+ImageView::composeHistoryFrame(const arras_render::FrameHistory::View& view)
+//
+// mFrameMux must be locked by the caller. A stored image which does not match the current
+// resolution is shown as black.
+//
+{
+    const size_t rowSize = static_cast<size_t>(mImgWidth) * 3;
+    const size_t frameSize = rowSize * mImgHeight;
+
+    auto getSrc = [&](const int instance, std::vector<unsigned char>& buff) -> const unsigned char* {
+        if (instance == arras_render::FrameHistory::LIVE) {
+            return (mRgbFrame.size() == frameSize) ? mRgbFrame.data() : nullptr;
+        }
+        unsigned width = 0, height = 0;
+        if (!mFrameHistory->getFrame(instance, buff, width, height) ||
+            width != mImgWidth || height != mImgHeight) {
+            return nullptr;
+        }
+        return buff.data();
+    };
+    auto setFrame = [&](const unsigned char* src) {
+        if (src == mRgbFrameHistory.data()) return; // decoded in place
+        if (src) mRgbFrameHistory.assign(src, src + frameSize);
+        else     mRgbFrameHistory.assign(frameSize, 0);
+    };
+
+    if (!view.mWipe) {
+        setFrame(getSrc(view.mInstance, mRgbFrameHistory));
+        return;
+    }
+
+    setFrame(getSrc(view.mWipeLeft, mRgbFrameHistory));
+    const unsigned char* right = getSrc(view.mWipeRight, mRgbFrameHistoryR);
+    const unsigned split = std::min(static_cast<unsigned>(view.mWipePos * mImgWidth), mImgWidth);
+    const size_t splitOffset = static_cast<size_t>(split) * 3;
+    for (unsigned y = 0; y < mImgHeight; ++y) {
+        unsigned char* dst = &mRgbFrameHistory[y * rowSize];
+        if (right) std::memcpy(dst + splitOffset, right + y * rowSize + splitOffset, rowSize - splitOffset);
+        else       std::memset(dst + splitOffset, 0, rowSize - splitOffset);
+        if (split < mImgWidth) std::memset(dst + splitOffset, 255, 3); // wipe line
+    }
+}
+
+void
+ImageView::addHistoryOverlay(QImage& image, const arras_render::FrameHistory::View& view)
+{
+    QPainter qp(&image);
+    qp.setPen(*mFontColor);
+    qp.setFont(*mFont);
+
+    auto label = [](const int instance) {
+        return (instance == arras_render::FrameHistory::LIVE) ? std::string("LIVE") : "#" + std::to_string(instance);
+    };
+
+    const int lineHeight = qp.fontMetrics().height();
+    if (!view.mWipe) {
+        qp.drawText(mOverlayXOffset, mOverlayYOffset + lineHeight,
+                    QString::fromStdString("HISTORY " + label(view.mInstance)));
+        return;
+    }
+    const int split = static_cast<int>(view.mWipePos * mImgWidth);
+    qp.drawText(mOverlayXOffset, mOverlayYOffset + lineHeight, QString::fromStdString(label(view.mWipeLeft)));
+    qp.drawText(split + mOverlayXOffset, mOverlayYOffset + lineHeight, QString::fromStdString(label(view.mWipeRight)));
+}
+
+void
+ImageView::updatePreview(int syncId, const std::string& payload, bool sceneEdit)
+//
+// Called after the RDL message of syncId is sent. Only binds the new pose here, the pose cache lookup
+// and the reprojection are built by buildPreview() from the next paint, off the send path. Requests
+// which arrive before that paint are collapsed into the last one.
+//
+{
+    if (!mPoseCache && !mReprojector) return;
+
+    const scene_rdl2::math::Mat4d camMtx = mRdlCam->get(scene_rdl2::rdl2::Node::sNodeXformKey);
+
+    uint64_t key = 0;
+    if (mPoseCache) {
+        using PoseCache = arras_render::PoseCache;
+        if (sceneEdit) mSceneHash = PoseCache::hashBytes(payload, mSceneHash);
+        key = PoseCache::makeKey(camMtx, mSceneHash);
+        mPoseCache->bindInstance(syncId, key);
+    }
+
+    float tanHalfFovX = 0.0f;
+    if (mReprojector) {
+        mReprojector->bindInstance(syncId, camMtx);
+        if (sceneEdit || !getTanHalfFovX(tanHalfFovX)) tanHalfFovX = 0.0f;
+    }
+
+    {
+        arras_render::StallLockGuard guard(mFrameMux, arras_render::StallWatchdog::Lock::FRAME_MUX);
+        // the previews of the previous render do not stand in for this one
+        mRgbFramePose.clear();
+        mPoseKey = key;
+        mPoseInstance = syncId;
+        mPoseProgress = 0.0f;
+        mRgbFrameWarp.clear();
+        mWarpInstance = syncId;
+
+        mPreviewPending = true;
+        mPreviewCamMtx = camMtx;
+        mPreviewTanHalfFovX = tanHalfFovX;
+    }
+    Q_EMIT displayFrameSignal();
+}
+
+void
+ImageView::buildPreview()
+//
+// GUI thread, called by displayFrameSlot() without mFrameMux. A revisited pose displays the cached
+// image, otherwise a camera move displays the last frame reprojected to the new pose. The fresh render
+// replaces either of them.
+//
+{
+    int syncId = 0;
+    uint64_t key = 0;
+    scene_rdl2::math::Mat4d camMtx;
+    float tanHalfFovX = 0.0f;
+    {
+        arras_render::StallLockGuard guard(mFrameMux, arras_render::StallWatchdog::Lock::FRAME_MUX);
+        if (!mPreviewPending) return;
+        mPreviewPending = false;
+        if (mCurrentOutput != BEAUTY_PASS) return;
+        syncId = mPoseInstance;
+        key = mPoseKey;
+        camMtx = mPreviewCamMtx;
+        tanHalfFovX = mPreviewTanHalfFovX;
+    }
+    TraceSpan span("buildPreview", 0, syncId);
+
+    // a pose only kept as JPEG is a miss here and arrives later by poseDecoded()
+    std::vector<unsigned char> rgb;
+    float progress = 0.0f;
+    unsigned width = 0, height = 0;
+    const bool hit = (mPoseCache &&
+                      mPoseCache->lookup(key, rgb, width, height, progress) &&
+                      width == mImgWidth && height == mImgHeight);
+
+    std::vector<unsigned char> rgbWarp;
+    bool warped = false;
+    if (!hit && mReprojector && tanHalfFovX > 0.0f) {
+        {
+            arras_render::StallLockGuard guard(mFrameMux, arras_render::StallWatchdog::Lock::FRAME_MUX);
+            captureReprojectSource();
+        }
+        warped = mReprojector->warp(camMtx, tanHalfFovX, rgbWarp, mImgWidth, mImgHeight);
+    }
+    if (!hit && !warped) return;
+
+    arras_render::StallLockGuard guard(mFrameMux, arras_render::StallWatchdog::Lock::FRAME_MUX);
+    if (mPreviewPending || syncId != mPoseInstance) return; // the camera moved on, built by the next paint
+    if (hit) {
+        mRgbFramePose.swap(rgb);
+        mPoseProgress = progress;
+    } else {
+        mRgbFrameWarp.swap(rgbWarp);
+    }
+}
+
+void
+ImageView::poseDecoded(uint64_t key, std::vector<unsigned char>& rgb888, unsigned width, unsigned height,
+                       float progress)
+{
+    {
+        arras_render::StallLockGuard guard(mFrameMux, arras_render::StallWatchdog::Lock::FRAME_MUX);
+        if (key != mPoseKey || mCurrentOutput != BEAUTY_PASS ||
+            width != mImgWidth || height != mImgHeight) {
+            return; // the camera moved on during the decode
+        }
+        mRgbFramePose.swap(rgb888);
+        mPoseProgress = progress;
+    }
+    Q_EMIT displayFrameSignal();
+}
+
+bool
+ImageView::getTanHalfFovX(float& tanHalfFovX) const
+{
+    if (mRdlCam->getSceneClass().getName() != "PerspectiveCamera") return false;
+    try {
+        const float focal = mRdlCam->get<scene_rdl2::rdl2::Float>("focal");
+        const float filmWidth = mRdlCam->get<scene_rdl2::rdl2::Float>("film_width_aperture");
+        if (focal <= 0.0f) return false;
+        tanHalfFovX = filmWidth * 0.5f / focal;
+    }
+    catch (const std::exception& e) {
+        std::cerr << ">> ImageView.cc getTanHalfFovX() " << e.what() << '\n';
+        return false;
+    }
+    return true;
+}
+
+bool
+ImageView::isWarpDisplay()
+{
+    if (mRgbFrameWarp.empty()) return false;
+    if (mCurrentOutput != BEAUTY_PASS ||
+        mRgbFrameWarp.size() != static_cast<size_t>(mImgWidth) * mImgHeight * 3 ||
+        static_cast<int>(mFbReceiver->getFrameId()) >= mWarpInstance) {
+        mRgbFrameWarp.clear(); // pixels of the new pose arrived
+        return false;
+    }
+    return true;
+}
+
+void
+ImageView::captureReprojectSource()
+//
+// GUI thread (buildPreview()), mFrameMux locked by the caller. Captured lazily by the first camera move after
+// a new render arrived, the received frames are not copied while the camera stays still.
+//
+{
+    const int instance = static_cast<int>(mFbReceiver->getFrameId());
+    if (mBlankDisplay || instance == mReprojectInstance || mFbReceiver->getProgress() < 0.0f) return;
+    if (instance != mDepthSyncId) return; // the depth AOV (aov-interval) is older than the beauty
+
+    // the output list changes by the AOV output rate control and by a new session
+    const unsigned total = mFbReceiver->getTotalRenderOutput();
+    const std::string& depthAovName = mReprojector->getDepthAovName();
+    if (mDepthOutputId < 0 || static_cast<unsigned>(mDepthOutputId) >= total ||
+        mFbReceiver->getRenderOutputName(static_cast<unsigned>(mDepthOutputId)) != depthAovName) {
+        mDepthOutputId = -1;
+        for (unsigned i = 0; i < total; ++i) {
+            if (mFbReceiver->getRenderOutputName(i) == depthAovName) {
+                mDepthOutputId = static_cast<int>(i);
+                break;
+            }
+        }
+        if (mDepthOutputId < 0) return; // no depth AOV (yet)
+    }
+
+    const unsigned id = static_cast<unsigned>(mDepthOutputId);
+    const int numChan = mFbReceiver->getRenderOutputNumChan(id);
+    if (numChan <= 0) return;
+    // beauty of the receiver, mRgbFrame may be older or hold the denoised image
+    if (!mFbReceiver->getBeautyRgb888(mReprojectRgb, true, false)) return;
+    mFbReceiver->getRenderOutput(id, mDepthFrame,
+                                 true,   // top2bottom
+                                 false); // closestFilterDepthOutput
+    mReprojector->capture(instance, mReprojectRgb, mDepthFrame,
+                          static_cast<unsigned>(numChan), mImgWidth, mImgHeight);
+    mReprojectInstance = instance;
+}
+
+void
+ImageView::noteFrameOutputs(uint32_t syncId, const HasOutputFunc& hasOutput)
+{
+    if (!mReprojector || !hasOutput(mReprojector->getDepthAovName())) return;
+    arras_render::StallLockGuard guard(mFrameMux, arras_render::StallWatchdog::Lock::FRAME_MUX);
+    mDepthSyncId = static_cast<int>(syncId);
+}
+
+bool
+ImageView::isPoseCacheDisplay()
+{
+    if (mRgbFramePose.empty()) return false;
+    if (mCurrentOutput != BEAUTY_PASS ||
+        mRgbFramePose.size() != static_cast<size_t>(mImgWidth) * mImgHeight * 3) {
+        mRgbFramePose.clear();
+        return false;
+    }
+    if (static_cast<int>(mFbReceiver->getFrameId()) == mPoseInstance &&
+        mRenderProgress / 100.0f >= mPoseProgress) {
+        mRgbFramePose.clear(); // the fresh render caught up
+        return false;
+    }
+    return true;
+}
+
+void
+ImageView::addPreviewOverlay(QImage& image, const std::string& label)
+{
+    QPainter qp(&image);
+    qp.setPen(*mFontColor);
+    qp.setFont(*mFont);
+    qp.drawText(mOverlayXOffset, mOverlayYOffset + qp.fontMetrics().height(), QString::fromStdString(label));
+}
+
+bool
+ImageView::processHistoryKey(int key)
+//
+// B : toggle live / previous instance
+// , : step to the older instance
+// . : step to the newer instance (back to live after the newest)
+// V : toggle wipe between the previous instance and live
+//
+{
+    using FrameHistory = arras_render::FrameHistory;
+
+    if (!mFrameHistory || isAbCompare()) return false;
+
+    FrameHistory::View view = mFrameHistory->getView();
+    const int liveInstance = static_cast<int>(mFbReceiver->getFrameId());
+    const int prevInstance = mFrameHistory->getPrevInstance(liveInstance);
+    switch (key) {
+    case Qt::Key_B :
+        if (view.isLive()) {
+            if (prevInstance == FrameHistory::LIVE || prevInstance >= liveInstance) {
+                std::cerr << "FrameHistory : no previous instance has been stored\n";
+                return true;
+            }
+            view.mInstance = prevInstance;
+        } else {
+            view = FrameHistory::View();
+        }
+        break;
+    case Qt::Key_Comma :
+        view.mWipe = false;
+        view.mInstance = mFrameHistory->getPrevInstance((view.mInstance == FrameHistory::LIVE) ?
+                                                        liveInstance : view.mInstance);
+        break;
+    case Qt::Key_Period :
+        view.mWipe = false;
+        view.mInstance = mFrameHistory->getNextInstance(view.mInstance);
+        break;
+    case Qt::Key_V :
+        if (view.mWipe) {
+            view = FrameHistory::View();
+        } else {
+            if (prevInstance == FrameHistory::LIVE || prevInstance >= liveInstance) {
+                std::cerr << "FrameHistory : no previous instance has been stored\n";
+                return true;
+            }
+            view.mWipe = true;
+            view.mWipeLeft = prevInstance;
+            view.mWipeRight = FrameHistory::LIVE;
+        }
+        break;
+    default :
+        return false;
+    }
+
+    std::cerr << "FrameHistory : view "
+              << (view.mWipe ? "wipe" : (view.mInstance == FrameHistory::LIVE ? "live" : std::to_string(view.mInstance)))
+              << '\n';
+    mFrameHistory->setView(view);
+    return true;
+}
+
+bool
+ImageView::processDisplayKey(int key)
+//
+// - : exposure -0.5 stop
+// = : exposure +0.5 stop
+// 0 : reset exposure, gamma and view LUT
+//
+{
+    if (!mDisplayTransform) return false;
+
+    switch (key) {
+    case Qt::Key_Minus : mDisplayTransform->setExposure(mDisplayTransform->getExposure() - 0.5f); break;
+    case Qt::Key_Equal : mDisplayTransform->setExposure(mDisplayTransform->getExposure() + 0.5f); break;
+    case Qt::Key_0 :     mDisplayTransform->reset(); break;
+    default : return false;
+    }
+    return true;
+}
+
+bool
+ImageView::processHudKey(int key)
+//
+// H : toggle the performance HUD
+//
+{
+    if (!mPerfHud || key != Qt::Key_H) return false;
+
+    mPerfHud->setActive(!mPerfHud->isActive());
+    updateHudLabel();
+    return true;
+}
+
+void
+ImageView::updateHudLabel()
+{
+    if (!mPerfHud->isActive()) {
+        if (mHudLabel->isVisible()) mHudLabel->hide();
+        return;
+    }
+    mPerfHud->render(mHudImage);
+    mHudLabel->setPixmap(QPixmap::fromImage(mHudImage));
+    mHudLabel->adjustSize();
+    if (!mHudLabel->isVisible()) {
+        mHudLabel->show();
+        mHudLabel->raise();
+    }
+}
+
+void
+ImageView::logAbProgress()
+//
+// One line per displayed frame of either session, mFrameMux must be locked by the caller.
+//
+{
+    if (!mAbLog.is_open()) return;
+
+    const float sec = std::chrono::duration<float>(std::chrono::steady_clock::now() - mAbLogStart).count();
+    mAbLog << sec << ','
+           << mFbReceiver->getFrameId() << ',' << std::max(mFbReceiver->getProgress(), 0.0f) << ','
+           << mFbReceiverB->getFrameId() << ',' << std::max(mFbReceiverB->getProgress(), 0.0f) << '\n';
 }
 
 void
@@ -643,7 +1439,11 @@ ImageView::sendCommand(const std::string &cmd,
         rdlMsg->mSyncId = static_cast<int>(mRenderInstance);
 
         mSceneCtx->commitAllChanges();
-        mSdk->sendMessage(rdlMsg);
+        if (mFrameHistory) mFrameHistory->recordDelta(rdlMsg->mSyncId, rdlMsg->mManifest, rdlMsg->mPayload);
+        if (mEditLatency) mEditLatency->sendRecord(static_cast<uint32_t>(rdlMsg->mSyncId));
+        if (mEditLatencyB) mEditLatencyB->sendRecord(static_cast<uint32_t>(rdlMsg->mSyncId));
+        sendMessageAll(rdlMsg);
+        updatePreview(rdlMsg->mSyncId, rdlMsg->mPayload, true);
         mRenderStart = std::chrono::steady_clock::now();
 
         if (!msgCallBack("sendWholeScene\n")) return false;
@@ -663,7 +1463,11 @@ ImageView::sendCommand(const std::string &cmd,
         rdlMsg->mSyncId = static_cast<int>(mRenderInstance);
 
         mSceneCtx->commitAllChanges(); // just in case
-        mSdk->sendMessage(rdlMsg);
+        if (mFrameHistory) mFrameHistory->recordDelta(rdlMsg->mSyncId, rdlMsg->mManifest, rdlMsg->mPayload);
+        if (mEditLatency) mEditLatency->sendRecord(static_cast<uint32_t>(rdlMsg->mSyncId));
+        if (mEditLatencyB) mEditLatencyB->sendRecord(static_cast<uint32_t>(rdlMsg->mSyncId));
+        sendMessageAll(rdlMsg);
+        updatePreview(rdlMsg->mSyncId, rdlMsg->mPayload, false);
         mRenderStart = std::chrono::steady_clock::now();
 
         if (!msgCallBack("sendEmptyScene\n")) return false;
@@ -695,7 +1499,7 @@ ImageView::changeImageSize(int width, int height)
     //        mImgScale = static_cast<unsigned int>(ceil(static_cast<float>(mImgHeight)/TARGET_HEIGHT));
     //    }
     //
-    unsigned w = mImgWidth / mImgScale;
+    unsigned w = getDisplayWidth() / mImgScale;
     unsigned h = mImgHeight / mImgScale;
     mImage->setFixedSize(w, h);
 
@@ -764,13 +1568,13 @@ ImageView::getImageDisplayWidgetPos(int& topLeftX, int& topLeftY)
 void
 ImageView::handleStartStop(bool start)
 {
-    std::lock_guard<std::mutex> guard(mSceneMux);
+    arras_render::StallLockGuard guard(mSceneMux, arras_render::StallWatchdog::Lock::SCENE_MUX);
     mPaused = !start;
 
     std::string msgDesc = start ? "Start" : "Stop";
 
     std::cout << "Sending Render " << msgDesc << " Message" << std::endl;
-    mSdk->sendMessage((mcrt::RenderMessages::createControlMessage(!start)));
+    sendMessageAll(mcrt::RenderMessages::createControlMessage(!start));
     mRenderStart = std::chrono::steady_clock::now();
 }
 
@@ -789,15 +1593,15 @@ ImageView::handleStop()
 void
 ImageView::handlePause()
 {
-    std::lock_guard<std::mutex> guard(mSceneMux);
+    arras_render::StallLockGuard guard(mSceneMux, arras_render::StallWatchdog::Lock::SCENE_MUX);
     mPaused = !mPaused;
 
     if (mPaused) {
         std::cout << "Pausing" << std::endl;
-        mSdk->sendMessage((mcrt::RenderMessages::createControlMessage(true)));
+        sendMessageAll(mcrt::RenderMessages::createControlMessage(true));
     } else {
         std::cout << "Un-pausing" << std::endl;
-        sendSceneUpdate(true);
+        sendSceneUpdate(true, false);
     }
 }
 
@@ -840,7 +1644,7 @@ ImageView::initCam()
             mRdlCam->beginUpdate();
             mRdlCam->set(scene_rdl2::rdl2::Node::sNodeXformKey, scene_rdl2::math::toDouble(camMtx));
             mRdlCam->endUpdate();
-            sendSceneUpdate(true);
+            sendSceneUpdate(true, false);
         });
 }
 
@@ -875,7 +1679,7 @@ ImageView::handlePrevOutput()
 {
     bool doDisplay = false;
     {
-        std::lock_guard<std::mutex> guard(mFrameMux);
+        arras_render::StallLockGuard guard(mFrameMux, arras_render::StallWatchdog::Lock::FRAME_MUX);
         if (mReceivedFirstFrame) {
             auto itr = std::find(mOutputNames.begin(), mOutputNames.end(), mCurrentOutput);
             if (itr != mOutputNames.end()) {
@@ -900,7 +1704,7 @@ ImageView::handleNextOutput()
 {
     bool doDisplay = false;
     {
-        std::lock_guard<std::mutex> guard(mFrameMux);
+        arras_render::StallLockGuard guard(mFrameMux, arras_render::StallWatchdog::Lock::FRAME_MUX);
         if (mReceivedFirstFrame) {
             auto itr = std::find(mOutputNames.begin(), mOutputNames.end(), mCurrentOutput);
             if (itr != mOutputNames.end()) {
@@ -936,13 +1740,27 @@ ImageView::handleStatusOverlay(short index, QString message)
     displayFrameSlot();
 }
 
+void
+ImageView::handleStallBeat()
+{
+    arras_render::StallWatchdog::get().beat();
+}
+
+void
+ImageView::handleHudTimer()
+{
+    // the console "active" command is picked up here within a sample interval
+    mPerfHud->sample(mEditLatency ? mEditLatency->getLast(arras_render::EditLatency::Milestone::FIRST_PIXEL) : -1.0f);
+    updateHudLabel();
+}
+
 void
 ImageView::handleAovSelect(int index)
 {
     bool doDisplay = false;
     const std::string bufferName = mCboOutputs->itemText(index).toStdString();
     {
-        std::lock_guard<std::mutex> guard(mFrameMux);
+        arras_render::StallLockGuard guard(mFrameMux, arras_render::StallWatchdog::Lock::FRAME_MUX);
         if (mReceivedFirstFrame && mCurrentOutput != bufferName) {
             mCurrentOutput = bufferName;
 
@@ -959,7 +1777,7 @@ ImageView::handleScaleSelect(int index)
 {
     mImgScale = index + 1;
 
-    unsigned int width = mImgWidth / mImgScale;
+    unsigned int width = getDisplayWidth() / mImgScale;
     unsigned int height = mImgHeight / mImgScale;
     mImage->setFixedSize(width, height);
     mScrollArea->setMaximumSize(width+SCROLL_PAD, height+SCROLL_PAD);
@@ -979,7 +1797,7 @@ ImageView::handleLightSelect(int index)
     const std::string shortName = mCboLights->itemText(index).toStdString();
     const std::string fullName = mCboLights->itemData(index).toString().toStdString();
     {
-        std::lock_guard<std::mutex> guard(mSceneMux);
+        arras_render::StallLockGuard guard(mSceneMux, arras_render::StallWatchdog::Lock::SCENE_MUX);
         mCurLight = mSceneCtx->getSceneObject(fullName)->asA<scene_rdl2::rdl2::Light>();
     }
 
@@ -997,7 +1815,7 @@ ImageView::handleExitProgram()
 void
 ImageView::handleNewColor(float red, float green, float blue)
 {
-    std::lock_guard<std::mutex> guard(mSceneMux);
+    arras_render::StallLockGuard guard(mSceneMux, arras_render::StallWatchdog::Lock::SCENE_MUX);
 
     scene_rdl2::math::Color newRdlColor(red, green, blue);
 
@@ -1012,7 +1830,7 @@ ImageView::handleNewColor(float red, float green, float blue)
 void
 ImageView::handleColorButton()
 {
-    std::lock_guard<std::mutex> guard(mSceneMux);
+    arras_render::StallLockGuard guard(mSceneMux, arras_render::StallWatchdog::Lock::SCENE_MUX);
 
     if (mCurLight != nullptr) {
         std::ostringstream title;
@@ -1060,11 +1878,11 @@ ImageView::sendCamUpdate(float dt, bool forceUpdate)
     mRdlCam->beginUpdate();
     mRdlCam->set(scene_rdl2::rdl2::Node::sNodeXformKey, scene_rdl2::math::toDouble(camMat));
     mRdlCam->endUpdate();
-    sendSceneUpdate(forceUpdate);
+    sendSceneUpdate(forceUpdate, false);
 }
 
 void
-ImageView::sendSceneUpdate(bool forceUpdate)
+ImageView::sendSceneUpdate(bool forceUpdate, bool sceneEdit)
 {
     // make sure we don't update too often
     if (!forceUpdate &&
@@ -1076,19 +1894,31 @@ ImageView::sendSceneUpdate(bool forceUpdate)
     }
 
     mPaused = false;
+    TraceSpan serializeSpan("serializeScene");
     scene_rdl2::rdl2::BinaryWriter w(*mSceneCtx);
     w.setDeltaEncoding(true);
 
     mcrt::RDLMessage::Ptr rdlMsg = std::make_shared<mcrt::RDLMessage>();
     w.toBytes(rdlMsg->mManifest, rdlMsg->mPayload);
     rdlMsg->mForceReload = false;
+    const size_t msgSize = rdlMsg->mManifest.size() + rdlMsg->mPayload.size();
+    serializeSpan.setSize(msgSize);
+    serializeSpan.end();
 
     mRenderProgress = 0.0;
     mRenderInstance = mRenderInstance + 1;
     rdlMsg->mSyncId = static_cast<int>(mRenderInstance);
 
     mSceneCtx->commitAllChanges();
-    mSdk->sendMessage(rdlMsg);
+    if (mFrameHistory) mFrameHistory->recordDelta(rdlMsg->mSyncId, rdlMsg->mManifest, rdlMsg->mPayload);
+    if (mEditLatency) mEditLatency->sendRecord(static_cast<uint32_t>(rdlMsg->mSyncId));
+    if (mEditLatencyB) mEditLatencyB->sendRecord(static_cast<uint32_t>(rdlMsg->mSyncId));
+    TraceSpan sendSpan("sendMessage", msgSize, rdlMsg->mSyncId);
+    // the same delta and syncId to both sessions of the A/B comparison
+    sendMessageAll(rdlMsg, sceneEdit ? arras_render::RenderSession::SendClass::BULK :
+                   arras_render::RenderSession::SendClass::CAMERA);
+    sendSpan.end();
+    updatePreview(rdlMsg->mSyncId, rdlMsg->mPayload, sceneEdit);
     mRenderStart = std::chrono::steady_clock::now();
 }
 
@@ -1098,7 +1928,18 @@ ImageView::handleSendCredit(int amount)
     std::cout << std::endl << "Sending credit: " << amount << std::endl;
     mcrt::CreditUpdate::Ptr creditMsg = std::make_shared<mcrt::CreditUpdate>();
     creditMsg->value() = amount;
-    mSdk->sendMessage(creditMsg);
+    TraceSpan span("sendCredit");
+    sendMessageAll(creditMsg);
+    if (mPerfHud) mPerfHud->creditSent(amount);
+}
+
+void
+ImageView::sendMessageAll(const arras4::api::MessageContentConstPtr& msg,
+                          const arras_render::RenderSession::SendClass sendClass)
+{
+    // sessions are OutboundSession unless --send-direct, sends are serialized by its send thread
+    mSdk->sendMessage(msg, sendClass);
+    if (mSdkB) mSdkB->sendMessage(msg, sendClass);
 }
 
 void
@@ -1139,10 +1980,14 @@ void
 ImageView::keyPressEvent(QKeyEvent * aKeyEvent)
 {
     auto getDenoiseCondition = [&]() {
+        if (mDenoiseStage) return mDenoiseStage->isActive();
         return (getFbReceiver()->getBeautyDenoiseMode() != mcrt_dataio::ClientReceiverFb::DenoiseMode::DISABLE);
     };
     auto setDenoiseCondition = [&](bool flag) {
-        if (flag) {
+        if (mDenoiseStage) {
+            // the display keeps fetching the raw beauty, denoise runs in the background stage
+            if (flag != mDenoiseStage->isActive()) mDenoiseStage->setActive(flag);
+        } else if (flag) {
             getFbReceiver()->setBeautyDenoiseMode(mcrt_dataio::ClientReceiverFb::DenoiseMode::ENABLE);
         } else {
             getFbReceiver()->setBeautyDenoiseMode(mcrt_dataio::ClientReceiverFb::DenoiseMode::DISABLE);
@@ -1153,6 +1998,16 @@ ImageView::keyPressEvent(QKeyEvent * aKeyEvent)
     mFreeCamera.setDenoise(getDenoiseCondition());
     mFreeCamera.initSwitchTelemetryPanel();
 
+    if (aKeyEvent->modifiers() == Qt::NoModifier && processHistoryKey(aKeyEvent->key())) {
+        return;
+    }
+    if (aKeyEvent->modifiers() == Qt::NoModifier && processDisplayKey(aKeyEvent->key())) {
+        return;
+    }
+    if (aKeyEvent->modifiers() == Qt::NoModifier && processHudKey(aKeyEvent->key())) {
+        return;
+    }
+
     KeyEvent evt(1,aKeyEvent->key(),aKeyEvent->modifiers());
     if (mFreeCamera.processKeyboardEvent(&evt, true)) {
         sendCamUpdate(1.0f);
@@ -12,14 +12,24 @@
 #include <mcrt_dataio/client/receiver/ClientReceiverFb.h>
 #endif
 
-#include <sdk/sdk.h>
 #include "NotifiedValue.h"
 #include "Scripting.h"
 #include "CamPlayback.h"
+#include "DenoiseStage.h"
+#include "DepthReprojector.h"
+#include "DisplayTransform.h"
+#include "EditLatency.h"
+#include "FrameHistory.h"
 #include "FreeCam.h"
+#include "JpegPipeline.h"
+#include "PerfHud.h"
+#include "PoseCache.h"
+#include "RenderEta.h"
+#include "RenderSession.h"
 
 #include <atomic>
 #include <chrono>
+#include <fstream>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -34,6 +44,7 @@
 #include <QLabel>
 #include <QPen>
 #include <QPushButton>
+#include <QTimer>
 #include <QVBoxLayout>
 
 namespace ImageViewDefaults {
@@ -47,6 +58,12 @@ class ImageView : public QWidget
     Q_OBJECT
 public:
     using MsgCallBack = std::function<bool(const std::string& msg)>;
+    using HasOutputFunc = std::function<bool(const std::string& name)>; // the frame carries the output
+
+    enum class AbView {
+        SIDE_BY_SIDE, // A on the left, B on the right
+        DIFFERENCE    // amplified absolute difference of A and B
+    };
 
     ImageView(std::shared_ptr<mcrt_dataio::ClientReceiverFb> pFbReceiver,
               std::unique_ptr<scene_rdl2::rdl2::SceneContext> sceneCtx,
@@ -66,13 +83,47 @@ public:
               QWidget* parent = 0);
     virtual ~ImageView();
     
-    void setup(std::shared_ptr<arras4::sdk::SDK>& sdk);
+    void setup(std::shared_ptr<arras_render::RenderSession>& sdk);
+    void setEditLatency(std::shared_ptr<arras_render::EditLatency> editLatency) { mEditLatency = editLatency; }
+    void setJpegPipeline(std::shared_ptr<arras_render::JpegPipeline> jpegPipeline) { mJpegPipeline = jpegPipeline; }
+    void setRenderEta(std::shared_ptr<arras_render::RenderEta> renderEta) { mRenderEta = renderEta; }
+    // before/after flipping : B key toggles the previous instance, ',' '.' step older/newer, V wipe
+    void setFrameHistory(std::shared_ptr<arras_render::FrameHistory> frameHistory);
+    std::shared_ptr<arras_render::FrameHistory> getFrameHistory() const { return mFrameHistory; }
+    // revisited camera poses show the cached image until the fresh render catches up
+    void setPoseCache(std::shared_ptr<arras_render::PoseCache> poseCache);
+    std::shared_ptr<arras_render::PoseCache> getPoseCache() const { return mPoseCache; }
+    // camera moves show the last frame warped by the depth AOV until pixels of the new pose arrive
+    void setReprojector(std::shared_ptr<arras_render::DepthReprojector> reprojector) { mReprojector = reprojector; }
+    std::shared_ptr<arras_render::DepthReprojector> getReprojector() const { return mReprojector; }
+    // N key denoise runs in the background stage instead of the beauty fetch of the display
+    void setDenoiseStage(std::shared_ptr<arras_render::DenoiseStage> denoiseStage);
+    std::shared_ptr<arras_render::DenoiseStage> getDenoiseStage() const { return mDenoiseStage; }
+    // exposure/gamma/view LUT of the float beauty or AOV : '-' '=' exposure -/+ half stop, '0' reset
+    void setDisplayTransform(std::shared_ptr<arras_render::DisplayTransform> displayTransform);
+    std::shared_ptr<arras_render::DisplayTransform> getDisplayTransform() const { return mDisplayTransform; }
+    // client performance HUD : H key toggles it, sampled and drawn by a timer of the Qt thread
+    void setPerfHud(std::shared_ptr<arras_render::PerfHud> perfHud);
+    std::shared_ptr<arras_render::PerfHud> getPerfHud() const { return mPerfHud; }
+
+    // A/B comparison : a second session (B) receives every scene update, render control and credit
+    // message sent to the first one (A) with the same syncId. B always shows the beauty.
+    // setAbCompare() needs to be called before show(), setupB() attaches the B session once connected.
+    void setAbCompare(std::shared_ptr<mcrt_dataio::ClientReceiverFb> pFbReceiverB,
+                      std::shared_ptr<arras_render::EditLatency> editLatencyB,
+                      const AbView abView,
+                      const std::string& sessionNameB);
+    bool openAbLog(const std::string& filename, std::string& error); // progress of both sessions as csv
+    void setupB(std::shared_ptr<arras_render::RenderSession>& sdkB);
+    bool isAbCompare() const { return static_cast<bool>(mFbReceiverB); }
 
     std::mutex& getFrameMux() { return mFrameMux; }
 
     void setInitialCondition();
 
     void displayFrame();
+    void displayFrameB(); // a new frame of the B session (A/B comparison)
+    void noteFrameOutputs(uint32_t syncId, const HasOutputFunc& hasOutput); // message thread, before displayFrame()
     void clearDisplayFrame();
     void exitProgram();
 
@@ -100,6 +151,7 @@ public:
 
 public Q_SLOTS:
     void displayFrameSlot();
+    void frameQueuedSlot();
     void handleStart();
     void handleStop();
     void handlePause();
@@ -117,9 +169,12 @@ public Q_SLOTS:
 
     void handleSendCredit(int);
     void handleStatusOverlay(short, QString);
+    void handleHudTimer();
+    void handleStallBeat();
 
 Q_SIGNALS:
     void displayFrameSignal();
+    void frameQueuedSignal(); // a received frame, counted by the PerfHud queue depth
     void setNewColorSignal(float red, float green, float blue);
     void statusOverlaySignal(short, QString);
     void sendCredit(int);
@@ -141,10 +196,36 @@ private:
     void addOverlay(QImage& image);
     void handleStartStop(bool start);
     void sendCamUpdate(float dt=-1.f, bool forceUpdate = true); 
-    void sendSceneUpdate(bool forceUpdate = true);
+    void sendSceneUpdate(bool forceUpdate = true, bool sceneEdit = true); // sceneEdit : not camera only
+    void updatePreview(int syncId, const std::string& payload, bool sceneEdit); // pose cache and reprojection
+    void buildPreview(); // preview requested by updatePreview(), from the paint
+    bool getTanHalfFovX(float& tanHalfFovX) const; // perspective camera only
+    void poseDecoded(uint64_t key, std::vector<unsigned char>& rgb888, unsigned width, unsigned height,
+                     float progress); // pose cache worker thread
     void updateOutputsComboBox();
+    void sendMessageAll(const arras4::api::MessageContentConstPtr& msg, // A and B session
+                        const arras_render::RenderSession::SendClass sendClass =
+                        arras_render::RenderSession::SendClass::AUTO);
+
+    unsigned getDisplayWidth() const; // image width including the B view
+    void composeAbFrame(); // mRgbFrame and mRgbFrameB -> mRgbFrameAb
+    void addAbOverlay(QImage& image);
+    void logAbProgress();
+
+    bool processHistoryKey(int key); // true if the key is used by the frame history
+    void composeHistoryFrame(const arras_render::FrameHistory::View& view); // -> mRgbFrameHistory
+    void addHistoryOverlay(QImage& image, const arras_render::FrameHistory::View& view);
+    bool isPoseCacheDisplay(); // mFrameMux locked by the caller
+    bool isWarpDisplay(); // mFrameMux locked by the caller
+    void captureReprojectSource();
+    void addPreviewOverlay(QImage& image, const std::string& label);
+    bool processDisplayKey(int key); // true if the key is used by the display transform
+    void refreshDisplayTransform();
+    bool processHudKey(int key); // true if the key is used by the performance HUD
+    void updateHudLabel();
 
     void populateRGBFrame();
+    bool populateFloatFrame(); // mFrameMux locked by the caller
     bool savePPM(const std::string& filename) const; // for debug
     bool saveQImagePPM(const std::string& filename, const QImage& image) const; // for debug
 
@@ -174,11 +255,39 @@ private:
 
     // Arras & Moonray
     std::mutex mSceneMux;
-    std::shared_ptr<arras4::sdk::SDK> mSdk;
+    std::shared_ptr<arras_render::RenderSession> mSdk;
 
     std::shared_ptr<mcrt_dataio::ClientReceiverFb> mFbReceiver;
     std::unique_ptr<scene_rdl2::rdl2::SceneContext> mSceneCtx;
     const unsigned mAovInterval;
+    std::shared_ptr<arras_render::EditLatency> mEditLatency; // edit-to-pixel latency by syncId
+    std::shared_ptr<arras_render::JpegPipeline> mJpegPipeline; // jpeg snapshot/stream of the displayed image
+    std::shared_ptr<arras_render::RenderEta> mRenderEta; // completion ETA of the A session render
+    std::shared_ptr<arras_render::FrameHistory> mFrameHistory; // stored images of the previous renders
+    std::shared_ptr<arras_render::PoseCache> mPoseCache; // best image by camera pose and scene state
+    uint64_t mSceneHash {0}; // hash of all the non-camera scene deltas for the pose cache key
+    std::shared_ptr<arras_render::DepthReprojector> mReprojector; // camera move preview
+    int mDepthOutputId {-1}; // render output id of the depth AOV, negative : not found yet
+    int mDepthSyncId {-1};   // syncId of the last frame which carried the depth AOV
+    int mReprojectInstance {-1}; // syncId of the last captured reprojection source
+    std::vector<float> mDepthFrame;
+    std::vector<unsigned char> mReprojectRgb;
+    std::shared_ptr<arras_render::DenoiseStage> mDenoiseStage; // background beauty denoise
+    std::shared_ptr<arras_render::DisplayTransform> mDisplayTransform; // float to display conversion
+    std::shared_ptr<arras_render::PerfHud> mPerfHud; // client performance HUD
+    std::unique_ptr<QLabel> mHudLabel; // on top of the scroll area viewport, not a part of the frame
+    std::unique_ptr<QTimer> mHudTimer;
+    QImage mHudImage;
+    std::unique_ptr<QTimer> mStallTimer; // GUI heartbeat of the StallWatchdog
+
+    // A/B comparison, the B session is driven by the same scene updates as the A session
+    std::shared_ptr<arras_render::RenderSession> mSdkB;
+    std::shared_ptr<mcrt_dataio::ClientReceiverFb> mFbReceiverB;
+    std::shared_ptr<arras_render::EditLatency> mEditLatencyB;
+    AbView mAbView {AbView::SIDE_BY_SIDE};
+    std::string mSessionNameB;
+    std::ofstream mAbLog;
+    std::chrono::steady_clock::time_point mAbLogStart;
 
     // Camera
     FreeCam mFreeCamera;
@@ -193,6 +302,23 @@ private:
     std::mutex mFrameMux;
     std::vector<unsigned char> mRgbFrame;
     std::vector<unsigned char> mRgbFrameCopy;
+    std::vector<float> mFloatFrame; // source of the display transform, empty if not used
+    std::vector<float> mBeautyFrame; // RGBA beauty of populateRGBFrame() without the display transform
+    unsigned mFloatNumChan {0};
+    std::vector<unsigned char> mRgbFrameB;  // beauty of the B session
+    std::vector<unsigned char> mRgbFrameAb; // composed A/B display image
+    std::vector<unsigned char> mRgbFrameScaled; // downscaled display image when mImgScale > 1
+    std::vector<unsigned char> mRgbFrameHistory; // flipped or wiped display image of the frame history
+    std::vector<unsigned char> mRgbFrameHistoryR; // decode buffer of the right side of the wipe
+    std::vector<unsigned char> mRgbFramePose; // pose cache image of the current render, empty if none
+    uint64_t mPoseKey {0};    // pose cache key of the last sent camera
+    int mPoseInstance {0};    // syncId of the render mRgbFramePose stands in for
+    float mPoseProgress {0.0f}; // progress of mRgbFramePose 0.0 ~ 1.0
+    std::vector<unsigned char> mRgbFrameWarp; // reprojected last frame for the current render, empty if none
+    int mWarpInstance {0};      // syncId of the render mRgbFrameWarp stands in for
+    bool mPreviewPending {false}; // updatePreview() request which is not built yet
+    scene_rdl2::math::Mat4d mPreviewCamMtx;
+    float mPreviewTanHalfFovX {0.0f}; // 0 : no reprojection (scene edit or not a perspective camera)
     std::vector<std::string> mOutputNames;
     unsigned int mNumBuiltinPasses;
     std::string mCurrentOutput;
@@ -213,9 +339,6 @@ private:
     std::string mOverlayFontName;
 
     std::chrono::steady_clock::duration mMinUpdateInterval;
-
-    // There is some possibility to send message by 2 different threads and we need MTsafe send operation.
-    std::mutex mMutexSendMessage; // mutex for sendMessage
 };
 
 #endif /* IMAGE_VIEW_H_ */
@@ -0,0 +1,468 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#include "JpegPipeline.h"
+#include "ThreadRole.h"
+#include "Trace.h"
+
+#include <scene_rdl2/render/util/StrUtil.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <csetjmp>
+#include <csignal>
+#include <cstdio> // jpeglib.h needs FILE
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <jpeglib.h>
+
+namespace {
+
+constexpr unsigned MAX_QUEUE_PER_THREAD = 2;
+
+constexpr std::chrono::seconds FIFO_REOPEN_INTERVAL(1); // retry while no reader is attached
+constexpr int FIFO_STALL_TIMEOUT_MS = 1000; // the reader stopped reading in the middle of a frame
+
+struct JpegError
+//
+// libjpeg error manager which returns to the caller instead of exit()
+//
+{
+    jpeg_error_mgr mPub;
+    jmp_buf mJmp;
+    char mMsg[JMSG_LENGTH_MAX];
+};
+
+void
+jpegErrorExit(j_common_ptr cinfo)
+{
+    JpegError* err = reinterpret_cast<JpegError*>(cinfo->err);
+    (*cinfo->err->format_message)(cinfo, err->mMsg);
+    std::longjmp(err->mJmp, 1);
+}
+
+jpeg_error_mgr*
+setupJpegError(JpegError& err)
+{
+    jpeg_std_error(&err.mPub);
+    err.mPub.error_exit = jpegErrorExit;
+    err.mMsg[0] = '\0';
+    return &err.mPub;
+}
+
+void
+consumeSigpipe()
+{
+    // SIGPIPE is blocked on the worker thread and stays pending after EPIPE, take it out
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGPIPE);
+    const timespec zero {0, 0};
+    while (sigtimedwait(&set, nullptr, &zero) > 0) {}
+}
+
+} // anon namespace
+
+namespace arras_render {
+
+JpegPipeline::JpegPipeline(const Config& config)
+    : mConfig(config)
+{
+    parserConfigure();
+}
+
+JpegPipeline::~JpegPipeline()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mShutdown = true;
+    }
+    mCvJob.notify_all();
+    for (auto& itr : mWorker) {
+        if (itr.joinable()) itr.join();
+    }
+    std::lock_guard<std::mutex> lock(mStreamMutex);
+    closeStreamMain();
+}
+
+bool
+JpegPipeline::open(std::string& error)
+{
+    if (!mConfig.mStreamPath.empty()) {
+        struct stat st;
+        if (stat(mConfig.mStreamPath.c_str(), &st) == 0 && S_ISFIFO(st.st_mode)) {
+            // opened when a reader is attached, see isStreamDue()
+            std::lock_guard<std::mutex> lock(mStreamMutex);
+            mStreamFifo = true;
+            if (!openFifoMain() && errno != ENXIO) {
+                error = "Could not open MJPEG stream. path:" + mConfig.mStreamPath + ' ' + std::strerror(errno);
+                return false;
+            }
+        } else {
+            mStreamFd = ::open(mConfig.mStreamPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (mStreamFd < 0) {
+                error = "Could not open MJPEG stream. path:" + mConfig.mStreamPath + ' ' + std::strerror(errno);
+                return false;
+            }
+        }
+    }
+
+    mLastSnapshotTime = Clock::now();
+    const unsigned threadTotal = std::max(mConfig.mThreadTotal, 1u);
+    for (unsigned i = 0; i < threadTotal; ++i) {
+        mWorker.emplace_back(threadMain, this);
+    }
+    return true;
+}
+
+bool
+JpegPipeline::isDue(const float progress, const bool final)
+{
+    // only called by the feeding thread
+    mSnapshotDue = false;
+    if (!mConfig.mSnapshotPrefix.empty()) {
+        if (progress < mLastSnapshotProgress) {
+            mLastSnapshotProgress = -1.0f; // new render started
+        }
+
+        const Clock::time_point now = Clock::now();
+        if (final) {
+            mSnapshotDue = true;
+        } else if (mConfig.mSnapshotIntervalSec > 0.0f &&
+                   std::chrono::duration<float>(now - mLastSnapshotTime).count() >= mConfig.mSnapshotIntervalSec) {
+            mSnapshotDue = true;
+        } else if (mConfig.mSnapshotIntervalPercent > 0.0f &&
+                   (mLastSnapshotProgress < 0.0f ||
+                    (progress - mLastSnapshotProgress) * 100.0f >= mConfig.mSnapshotIntervalPercent)) {
+            mSnapshotDue = true;
+        }
+        if (mSnapshotDue) {
+            mLastSnapshotTime = now;
+            mLastSnapshotProgress = progress;
+        }
+    }
+    return isStreamDue() || mSnapshotDue;
+}
+
+void
+JpegPipeline::push(const std::vector<unsigned char>& rgb888,
+                   const unsigned width,
+                   const unsigned height,
+                   const float progress,
+                   const bool final)
+{
+    if (rgb888.size() < static_cast<size_t>(width) * height * 3) return;
+
+    TraceSpan span("jpegPush", rgb888.size());
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!final && mQueue.size() >= mWorker.size() * MAX_QUEUE_PER_THREAD) {
+            mDroppedTotal++;
+            return;
+        }
+
+        mQueue.emplace_back();
+        Job& job = mQueue.back();
+        job.mSeq = mNextSeq++;
+        job.mWidth = width;
+        job.mHeight = height;
+        job.mSnapshot = mSnapshotDue;
+        job.mRgb.assign(rgb888.begin(), rgb888.begin() + static_cast<size_t>(width) * height * 3);
+    }
+    mCvJob.notify_one();
+}
+
+// static function
+bool
+JpegPipeline::encode(const unsigned char* rgb888,
+                     const unsigned width,
+                     const unsigned height,
+                     const unsigned quality,
+                     std::vector<unsigned char>& out,
+                     std::string& error)
+{
+    jpeg_compress_struct cinfo;
+    JpegError jerr;
+    cinfo.err = setupJpegError(jerr);
+    unsigned char* mem = nullptr;
+    unsigned long memSize = 0;
+    if (setjmp(jerr.mJmp)) {
+        jpeg_destroy_compress(&cinfo);
+        if (mem) free(mem);
+        error = std::string("jpeg encode failed. ") + jerr.mMsg;
+        return false;
+    }
+    jpeg_create_compress(&cinfo);
+    jpeg_mem_dest(&cinfo, &mem, &memSize);
+
+    cinfo.image_width = width;
+    cinfo.image_height = height;
+    cinfo.input_components = 3;
+    cinfo.in_color_space = JCS_RGB;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, static_cast<int>(std::min(quality, 100u)), TRUE);
+
+    jpeg_start_compress(&cinfo, TRUE);
+    const size_t rowStride = static_cast<size_t>(width) * 3;
+    while (cinfo.next_scanline < cinfo.image_height) {
+        JSAMPROW row = const_cast<JSAMPROW>(rgb888 + cinfo.next_scanline * rowStride);
+        jpeg_write_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+
+    if (!mem) {
+        error = "jpeg encode failed";
+        return false;
+    }
+    out.assign(mem, mem + memSize);
+    free(mem);
+    return true;
+}
+
+// static function
+bool
+JpegPipeline::decode(const std::vector<unsigned char>& jpeg,
+                     std::vector<unsigned char>& rgb888,
+                     unsigned& width,
+                     unsigned& height,
+                     std::string& error)
+{
+    if (jpeg.empty()) {
+        error = "empty jpeg data";
+        return false;
+    }
+
+    jpeg_decompress_struct cinfo;
+    JpegError jerr;
+    cinfo.err = setupJpegError(jerr);
+    if (setjmp(jerr.mJmp)) {
+        // corrupt or truncated data (i.e. a spill file of FrameHistory/PoseCache)
+        jpeg_destroy_decompress(&cinfo);
+        error = std::string("jpeg decode failed. ") + jerr.mMsg;
+        return false;
+    }
+    jpeg_create_decompress(&cinfo);
+
+    jpeg_mem_src(&cinfo, jpeg.data(), static_cast<unsigned long>(jpeg.size()));
+    if (jpeg_read_header(&cinfo, TRUE) != JPEG_HEADER_OK) {
+        jpeg_destroy_decompress(&cinfo);
+        error = "jpeg header read failed";
+        return false;
+    }
+    cinfo.out_color_space = JCS_RGB;
+    jpeg_start_decompress(&cinfo);
+
+    width = cinfo.output_width;
+    height = cinfo.output_height;
+    const size_t rowStride = static_cast<size_t>(width) * 3;
+    rgb888.resize(rowStride * height);
+    while (cinfo.output_scanline < cinfo.output_height) {
+        JSAMPROW row = &rgb888[cinfo.output_scanline * rowStride];
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    return true;
+}
+
+std::string
+JpegPipeline::show() const
+{
+    namespace str_util = scene_rdl2::str_util;
+
+    const uint64_t encoded = mEncodedTotal;
+    size_t queued = 0;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        queued = mQueue.size();
+    }
+
+    std::ostringstream ostr;
+    ostr << "JpegPipeline {\n"
+         << "  snapshotPrefix:" << (mConfig.mSnapshotPrefix.empty() ? "-" : mConfig.mSnapshotPrefix) << '\n'
+         << "  snapshotInterval:" << str_util::secStr(mConfig.mSnapshotIntervalSec)
+         << " " << mConfig.mSnapshotIntervalPercent << "%\n"
+         << "  stream:" << (mConfig.mStreamPath.empty() ? "-" : mConfig.mStreamPath) << '\n'
+         << "  quality:" << mConfig.mQuality << '\n'
+         << "  threads:" << mWorker.size() << '\n'
+         << "  queued:" << queued << '\n'
+         << "  encoded:" << encoded << '\n'
+         << "  dropped:" << mDroppedTotal << '\n'
+         << "  encodedBytes:" << str_util::byteStr(mEncodedBytes) << '\n'
+         << "  avgEncode:"
+         << str_util::secStr(encoded ? static_cast<float>(mEncodeUsTotal) / static_cast<float>(encoded) / 1.0e6f : 0.0f)
+         << '\n'
+         << "}";
+    return ostr.str();
+}
+
+// static function
+void
+JpegPipeline::threadMain(JpegPipeline* pipeline)
+{
+    ThreadRoleScope threadRole(ThreadRole::JPEG);
+
+    // EPIPE from the FIFO is handled by writeStream(), SIGPIPE only for this thread
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &set, nullptr);
+
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(pipeline->mMutex);
+            pipeline->mCvJob.wait(lock, [&] { return pipeline->mShutdown || !pipeline->mQueue.empty(); });
+            if (pipeline->mQueue.empty()) break; // shutdown after all the queued jobs are done
+            job = std::move(pipeline->mQueue.front());
+            pipeline->mQueue.pop_front();
+        }
+        pipeline->processJob(job);
+    }
+}
+
+void
+JpegPipeline::processJob(Job& job)
+{
+    std::vector<unsigned char> jpeg;
+    std::string error;
+    {
+        TraceSpan span("jpegEncode", job.mRgb.size());
+        const Clock::time_point start = Clock::now();
+        if (!encode(job.mRgb.data(), job.mWidth, job.mHeight, mConfig.mQuality, jpeg, error)) {
+            std::cerr << ">> JpegPipeline.cc " << error << '\n';
+            jpeg.clear();
+        } else {
+            mEncodedTotal++;
+            mEncodedBytes += jpeg.size();
+            mEncodeUsTotal +=
+                std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+        }
+    }
+
+    if (job.mSnapshot && !jpeg.empty()) {
+        std::ostringstream ostr;
+        ostr << mConfig.mSnapshotPrefix << '_' << std::setw(6) << std::setfill('0') << job.mSeq << ".jpg";
+        std::ofstream fout(ostr.str(), std::ios::binary | std::ios::trunc);
+        if (!fout) {
+            std::cerr << ">> JpegPipeline.cc Can not create file. filename:" << ostr.str() << '\n';
+        } else {
+            fout.write(reinterpret_cast<const char*>(jpeg.data()), static_cast<std::streamsize>(jpeg.size()));
+        }
+    }
+
+    // Every seq goes through the stream stage, otherwise the ordered write would stall on the gap.
+    writeStream(job.mSeq, std::move(jpeg));
+}
+
+void
+JpegPipeline::writeStream(const uint64_t seq, std::vector<unsigned char>&& jpeg)
+{
+    std::lock_guard<std::mutex> lock(mStreamMutex);
+    if (mStreamFd < 0 && !mStreamFifo) return; // a FIFO without reader still has to keep the seq order
+
+    mPending.emplace(seq, std::move(jpeg));
+    while (!mPending.empty() && mPending.begin()->first == mNextWriteSeq) {
+        const std::vector<unsigned char>& data = mPending.begin()->second;
+        if (!data.empty() && mStreamFd >= 0 && !writeAll(mStreamFd, data)) {
+            if (errno == EPIPE && mStreamFifo) {
+                closeStreamMain(); // reader is gone, reopened for the next reader
+            } else if (errno == EAGAIN) {
+                mDroppedTotal++; // FIFO is full, nothing of this frame is written
+            } else {
+                std::cerr << ">> JpegPipeline.cc MJPEG stream write failed. " << std::strerror(errno) << '\n';
+                if (mStreamFifo) closeStreamMain(); // reopened for the next reader
+            }
+        }
+        mPending.erase(mPending.begin());
+        mNextWriteSeq++;
+    }
+}
+
+bool
+JpegPipeline::isStreamDue()
+{
+    std::lock_guard<std::mutex> lock(mStreamMutex);
+    if (mStreamFd >= 0) return true;
+    if (!mStreamFifo || Clock::now() - mLastFifoOpenTime < FIFO_REOPEN_INTERVAL) return false;
+    return openFifoMain();
+}
+
+bool
+JpegPipeline::openFifoMain()
+{
+    // Non-blocking write-only open fails with ENXIO while no reader is attached. We never open the
+    // FIFO for read ourselves, so write() gets EPIPE when the reader goes away.
+    mLastFifoOpenTime = Clock::now();
+    mStreamFd = ::open(mConfig.mStreamPath.c_str(), O_WRONLY | O_NONBLOCK);
+    return mStreamFd >= 0;
+}
+
+void
+JpegPipeline::closeStreamMain()
+{
+    if (mStreamFd >= 0) {
+        close(mStreamFd);
+        mStreamFd = -1;
+    }
+}
+
+bool
+JpegPipeline::writeAll(const int fd, const std::vector<unsigned char>& data)
+//
+// Returns false with errno EAGAIN when the non-blocking FIFO is full before any byte is written,
+// with errno EPIPE when the reader is gone.
+// A frame which is partially written is finished while the reader keeps reading, it fails with
+// ETIMEDOUT when the reader stops for FIFO_STALL_TIMEOUT_MS.
+//
+{
+    TraceSpan span("jpegStreamWrite", data.size());
+
+    size_t done = 0;
+    while (done < data.size()) {
+        const ssize_t size = write(fd, data.data() + done, data.size() - done);
+        if (size < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EPIPE) {
+                consumeSigpipe(); // sigtimedwait() overwrites errno
+                errno = EPIPE;
+                return false;
+            }
+            if (errno == EAGAIN && done > 0) {
+                pollfd pfd {fd, POLLOUT, 0};
+                const int ready = poll(&pfd, 1, FIFO_STALL_TIMEOUT_MS);
+                if (ready > 0 && (pfd.revents & (POLLERR | POLLHUP))) {
+                    errno = EPIPE; // reader went away while the frame is partially written
+                    return false;
+                }
+                if (ready > 0 || (ready < 0 && errno == EINTR)) continue;
+                if (ready == 0) errno = ETIMEDOUT;
+            }
+            return false;
+        }
+        done += static_cast<size_t>(size);
+    }
+    return true;
+}
+
+void
+JpegPipeline::parserConfigure()
+{
+    mParser.description("jpeg output command");
+    mParser.opt("show", "", "show jpeg pipeline status",
+                [&](Arg& arg) -> bool { return arg.msg(show() + '\n'); });
+}
+
+} // namespace arras_render
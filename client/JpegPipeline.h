@@ -0,0 +1,134 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <scene_rdl2/common/grid_util/Arg.h>
+#include <scene_rdl2/common/grid_util/Parser.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace arras_render {
+
+class JpegPipeline
+//
+// JPEG output stage fed from the displayed RGB888 buffer.
+//   snapshot : writes <prefix>_<seq>.jpg every N sec and/or every N% of progress (and the final frame)
+//   stream   : appends every frame to a continuous MJPEG stream (regular file or FIFO)
+// The caller only copies the RGB888 buffer. Encoding runs on a worker pool, one frame per worker,
+// and the MJPEG stream is written in frame order. When all the workers are busy and the queue is
+// full, new frames are dropped instead of blocking the caller (message thread or GUI thread).
+// A FIFO is written non-blocking and is only opened while a reader is attached : frames are not
+// encoded for the stream until a reader opens it, a frame is dropped when the FIFO is full and the
+// stream is closed (and reopened for the next reader) when the reader goes away or stops reading.
+// libjpeg errors are returned as false by encode()/decode() instead of exiting the process.
+//
+{
+public:
+    using Arg = scene_rdl2::grid_util::Arg;
+    using Parser = scene_rdl2::grid_util::Parser;
+
+    struct Config {
+        std::string mSnapshotPrefix;     // empty : snapshot disabled
+        float mSnapshotIntervalSec {0.0f};
+        float mSnapshotIntervalPercent {0.0f};
+        std::string mStreamPath;         // empty : MJPEG stream disabled
+        unsigned mQuality {85};
+        unsigned mThreadTotal {2};
+    };
+
+    explicit JpegPipeline(const Config& config);
+    ~JpegPipeline();
+
+    bool open(std::string& error);
+
+    // Cheap check done before copying the RGB buffer. progress : 0.0 ~ 1.0
+    bool isDue(const float progress, const bool final);
+
+    // rgb888 : top to bottom scanline
+    void push(const std::vector<unsigned char>& rgb888,
+              const unsigned width,
+              const unsigned height,
+              const float progress,
+              const bool final);
+
+    static bool encode(const unsigned char* rgb888,
+                       const unsigned width,
+                       const unsigned height,
+                       const unsigned quality,
+                       std::vector<unsigned char>& out,
+                       std::string& error);
+    // rgb888 : top to bottom scanline
+    static bool decode(const std::vector<unsigned char>& jpeg,
+                       std::vector<unsigned char>& rgb888,
+                       unsigned& width,
+                       unsigned& height,
+                       std::string& error);
+
+    std::string show() const;
+
+    Parser& getParser() { return mParser; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Job {
+        uint64_t mSeq {0};
+        unsigned mWidth {0};
+        unsigned mHeight {0};
+        bool mSnapshot {false};
+        std::vector<unsigned char> mRgb;
+    };
+
+    static void threadMain(JpegPipeline* pipeline);
+
+    void processJob(Job& job);
+    void writeStream(const uint64_t seq, std::vector<unsigned char>&& jpeg);
+    bool isStreamDue(); // opens the FIFO when a reader is attached
+    bool openFifoMain(); // mStreamMutex locked by the caller
+    void closeStreamMain(); // mStreamMutex locked by the caller
+    bool writeAll(const int fd, const std::vector<unsigned char>& data);
+
+    void parserConfigure();
+
+    const Config mConfig;
+
+    // trigger
+    bool mSnapshotDue {false};
+    Clock::time_point mLastSnapshotTime;
+    float mLastSnapshotProgress {-1.0f};
+
+    // job queue
+    mutable std::mutex mMutex;
+    std::condition_variable mCvJob;
+    std::deque<Job> mQueue;
+    uint64_t mNextSeq {0};
+    bool mShutdown {false};
+    std::vector<std::thread> mWorker;
+
+    // ordered stream output
+    std::mutex mStreamMutex;
+    int mStreamFd {-1};
+    bool mStreamFifo {false};
+    Clock::time_point mLastFifoOpenTime;
+    uint64_t mNextWriteSeq {0};
+    std::map<uint64_t, std::vector<unsigned char>> mPending; // empty data : skip (snapshot only)
+
+    std::atomic<uint64_t> mEncodedTotal {0};
+    std::atomic<uint64_t> mDroppedTotal {0};
+    std::atomic<uint64_t> mEncodedBytes {0};
+    std::atomic<uint64_t> mEncodeUsTotal {0};
+
+    Parser mParser;
+};
+
+} // namespace arras_render
@@ -0,0 +1,109 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#include "MicroBench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+constexpr size_t MAX_ITERATIONS = size_t(1) << 30;
+
+} // anon namespace
+
+namespace arras_render {
+
+void
+MicroBench::add(const std::string& name, const Setup& setup)
+{
+    Case benchCase;
+    benchCase.mName = name;
+    benchCase.mSetup = setup;
+    mCases.push_back(std::move(benchCase));
+}
+
+void
+MicroBench::run(BenchmarkStats& stats)
+{
+    for (auto& itr : mCases) {
+        if (!mFilter.empty() && itr.mName.find(mFilter) == std::string::npos) continue;
+
+        const Func func = itr.mSetup();
+        if (!func) {
+            itr.mSkipped = true;
+            std::cout << "MICROBENCH " << itr.mName << " : skipped" << std::endl;
+            continue;
+        }
+
+        // warm-up (first touch of the buffers, lazy initialization) then calibration
+        timeIterations(func, 1);
+        size_t iterations = 1;
+        double sec = timeIterations(func, iterations);
+        while (sec < mMinSampleSec && iterations < MAX_ITERATIONS) {
+            const double scale = (sec > 0.0) ? mMinSampleSec / sec * 1.2 : 10.0;
+            iterations = std::min(std::max(static_cast<size_t>(iterations * std::min(scale, 10.0)), iterations * 2),
+                                  MAX_ITERATIONS);
+            sec = timeIterations(func, iterations);
+        }
+        itr.mIterations = iterations;
+
+        for (unsigned sampleId = 0; sampleId < mRepeat; ++sampleId) {
+            const double us = timeIterations(func, iterations) / static_cast<double>(iterations) * 1000000.0;
+            stats.add(itr.mName, us);
+        }
+        std::cout << "MICROBENCH " << itr.mName << " : iterations:" << iterations << std::endl;
+    }
+    for (unsigned sampleId = 0; sampleId < mRepeat; ++sampleId) {
+        stats.addTrial();
+    }
+}
+
+Json::Value
+MicroBench::toJson() const
+{
+    Json::Value json;
+    json["unit"] = "usPerIteration";
+    json["minSampleSec"] = mMinSampleSec;
+    Json::Value iterations;
+    Json::Value skipped(Json::arrayValue);
+    for (const auto& itr : mCases) {
+        if (itr.mSkipped) skipped.append(itr.mName);
+        else if (itr.mIterations) iterations[itr.mName] = static_cast<Json::UInt64>(itr.mIterations);
+    }
+    json["iterations"] = iterations;
+    json["skipped"] = skipped;
+    return json;
+}
+
+std::string
+MicroBench::show(const BenchmarkStats& stats) const
+{
+    std::ostringstream ostr;
+    ostr << "MicroBench (samples:" << mRepeat << " minSampleSec:" << mMinSampleSec << ") {\n";
+    for (const auto& name : stats.getMilestones()) {
+        const BenchmarkStats::Stats st = stats.getStats(name);
+        ostr << "  " << std::setw(36) << std::left << name << std::right << std::fixed << std::setprecision(3)
+             << " mean:" << std::setw(12) << st.mMean
+             << " stddev:" << std::setw(10) << st.mStdDev
+             << " ci95:[" << st.mCiLow << ", " << st.mCiHigh << "] us\n";
+    }
+    ostr << "}";
+    return ostr.str();
+}
+
+// static function
+double
+MicroBench::timeIterations(const Func& func, const size_t iterations)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        func();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace arras_render
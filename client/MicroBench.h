@@ -0,0 +1,61 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "BenchmarkStats.h"
+
+#include <json/json.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace arras_render {
+
+class MicroBench
+//
+// Runner of the client micro benchmarks (arras_render_microbench). A case is registered with a setup
+// function which is only called when the case passes the name filter and returns the function of a
+// single iteration. Each case runs a warm-up iteration, is calibrated once to the iteration count which
+// takes at least the minimum sample time, then is timed for the repeat count of samples with that same
+// iteration count. A sample is the mean time of an iteration in microseconds.
+// Samples are stored as BenchmarkStats milestones, so the JSON output is compared against a baseline
+// by the same statistical test as the arras_render --benchmark result.
+//
+{
+public:
+    using Func = std::function<void()>;
+    using Setup = std::function<Func()>; // returns an empty Func if the case can not run
+
+    MicroBench(const float minSampleSec, const unsigned repeat, const std::string& filter)
+        : mMinSampleSec(minSampleSec)
+        , mRepeat(repeat)
+        , mFilter(filter)
+    {}
+
+    void add(const std::string& name, const Setup& setup);
+
+    void run(BenchmarkStats& stats); // prints the progress to cout
+    Json::Value toJson() const; // iteration count and skipped cases
+
+    std::string show(const BenchmarkStats& stats) const;
+
+private:
+    struct Case {
+        std::string mName;
+        Setup mSetup;
+        size_t mIterations {0};
+        bool mSkipped {false};
+    };
+
+    static double timeIterations(const Func& func, const size_t iterations); // return sec
+
+    const float mMinSampleSec;
+    const unsigned mRepeat;
+    const std::string mFilter;
+
+    std::vector<Case> mCases;
+};
+
+} // namespace arras_render
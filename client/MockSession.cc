@@ -0,0 +1,328 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#include "MockSession.h"
+#include "ThreadRole.h"
+
+#include <mcrt_messages/CreditUpdate.h>
+#include <mcrt_messages/JSONMessage.h>
+#include <mcrt_messages/OutputRates.h>
+#include <mcrt_messages/ProgressiveFrame.h>
+#include <mcrt_messages/RDLMessage.h>
+#include <mcrt_messages/RenderMessages.h>
+
+#include <scene_rdl2/common/fb_util/ActivePixels.h>
+#include <scene_rdl2/common/fb_util/FbTypes.h>
+#include <scene_rdl2/common/fb_util/VariablePixelBuffer.h>
+#include <scene_rdl2/common/grid_util/PackTiles.h>
+#include <scene_rdl2/scene/rdl2/BinaryReader.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#include <unistd.h> // getpid
+
+namespace {
+
+constexpr unsigned TILE_SIZE = 8; // scene_rdl2 tiled buffer layout : 8x8 pixel tiles, row major tile order
+constexpr float DEFAULT_FPS = 10.0f;
+constexpr float SCANLINE_PASS_FRACTION = 0.2f;
+
+mcrt::BaseFrame::DataPtr
+makeDataPtr(const std::string& data)
+{
+    mcrt::BaseFrame::DataPtr ptr(new uint8_t[data.size()], std::default_delete<uint8_t[]>());
+    std::memcpy(ptr.get(), data.data(), data.size());
+    return ptr;
+}
+
+float
+hashNoise(unsigned x, unsigned y, uint64_t frame) // -1.0 ~ 1.0
+{
+    uint64_t h = (static_cast<uint64_t>(x) * 0x9e3779b1u) ^ (static_cast<uint64_t>(y) * 0x85ebca77u) ^
+                 (frame * 0xc2b2ae3d27d4eb4full);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return static_cast<float>(h & 0xffffff) / static_cast<float>(0x7fffff) - 1.0f;
+}
+
+} // anon namespace
+
+namespace arras_render {
+
+MockSession::MockSession(const Config& config)
+    : mConfig(config)
+{
+}
+
+MockSession::~MockSession()
+{
+    // Never runs on the mock thread : the message handler bound by the caller holds this session.
+    disconnect();
+    joinThread();
+}
+
+// static function
+bool
+MockSession::isTilePattern(const std::string& name)
+{
+    return name == "all" || name == "scanline" || name == "random";
+}
+
+std::string
+MockSession::createSession(arras4::client::SessionDefinition& def,
+                           const std::string& /*url*/,
+                           const arras4::client::SessionOptions& /*options*/)
+{
+    if (mConfig.mFps <= 0.0f) {
+        mConfig.mFps = DEFAULT_FPS;
+        if (def.has("mcrt") && def["mcrt"].isMember("fps") && def["mcrt"]["fps"].isNumeric()) {
+            mConfig.mFps = std::max(def["mcrt"]["fps"].asFloat(), 0.1f);
+        }
+    }
+
+    mSessionId = "mock-" + std::to_string(getpid());
+    joinThread(); // the thread of the previous session, if it was disconnected from its own handler
+    mShutdown = false;
+    mConnected = true;
+    mThread = std::thread(threadMain, this);
+    return mSessionId;
+}
+
+void
+MockSession::disconnect()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mShutdown = true;
+    }
+    mCvRender.notify_all();
+    mConnected = false;
+    // Called from the message handler, the thread leaves its loop after the handler returns and is
+    // joined by the next createSession(), disconnect() or the destructor. It is never detached
+    // because it keeps using this session until it returns.
+    if (mThread.get_id() != std::this_thread::get_id()) joinThread();
+}
+
+void
+MockSession::joinThread()
+{
+    if (mThread.joinable() && mThread.get_id() != std::this_thread::get_id()) mThread.join();
+}
+
+void
+MockSession::sendMessage(const arras4::api::MessageContentConstPtr& content)
+{
+    if (!mConnected || !content) return;
+
+    if (auto rdl = std::dynamic_pointer_cast<const mcrt::RDLMessage>(content)) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (rdl->mForceReload) mSceneCtx.reset();
+        recvRdl(rdl->mManifest, rdl->mPayload, static_cast<uint32_t>(rdl->mSyncId));
+
+    } else if (auto credit = std::dynamic_pointer_cast<const mcrt::CreditUpdate>(content)) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mCreditMode = true;
+        mCredit += credit->value();
+
+    } else if (std::dynamic_pointer_cast<const mcrt::OutputRates>(content)) {
+        // AOVs are sent with every frame
+        std::lock_guard<std::mutex> lock(mMutex);
+        mOutputRatesTotal++;
+
+    } else if (auto json = std::dynamic_pointer_cast<const mcrt::JSONMessage>(content)) {
+        if (json->messageId() == mcrt::RenderMessages::RENDER_CONTROL_ID) {
+            const std::string control =
+                json->messagePayload()[mcrt::RenderMessages::RENDER_CONTROL_PAYLOAD].asString();
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (control == mcrt::RenderMessages::RENDER_CONTROL_PAYLOAD_STOP) {
+                mRendering = false;
+            } else if (control == mcrt::RenderMessages::RENDER_CONTROL_PAYLOAD_START && mSceneCtx) {
+                mRendering = true;
+                mRenderStart = Clock::now();
+                mFrameCount = 0;
+            }
+        }
+        // other JSON messages (pick, ...) are ignored
+    }
+    mCvRender.notify_all();
+}
+
+void
+MockSession::recvRdl(const std::string& manifest, const std::string& payload, const uint32_t syncId)
+{
+    if (!mSceneCtx) {
+        mSceneCtx = std::make_unique<scene_rdl2::rdl2::SceneContext>();
+        mSceneCtx->setProxyModeEnabled(true);
+    }
+    scene_rdl2::rdl2::BinaryReader reader(*mSceneCtx);
+    reader.fromBytes(manifest, payload);
+    mSceneCtx->commitAllChanges();
+
+    const auto& sceneVars = mSceneCtx->getSceneVariables();
+    mWidth = std::max(sceneVars.getRezedWidth(), 1u);
+    mHeight = std::max(sceneVars.getRezedHeight(), 1u);
+
+    mSyncId = syncId;
+    mRendering = true;
+    mRenderStart = Clock::now();
+    mFrameCount = 0;
+}
+
+// static function
+void
+MockSession::threadMain(MockSession* session)
+{
+    ThreadRoleScope threadRole(ThreadRole::MOCK);
+
+    const auto interval = std::chrono::duration_cast<Clock::duration>
+        (std::chrono::duration<float>(1.0f / session->mConfig.mFps));
+
+    std::unique_lock<std::mutex> lock(session->mMutex);
+    Clock::time_point lastFrame = Clock::now();
+    while (!session->mShutdown) {
+        session->mCvRender.wait(lock, [&] {
+                return session->mShutdown ||
+                       (session->mRendering && (!session->mCreditMode || session->mCredit > 0));
+            });
+        if (session->mShutdown) break;
+
+        // After a stall (no credit, render stopped) the next frame goes out now and the pace restarts
+        // from it, catching up by lastFrame + interval would send a burst of frames.
+        const Clock::time_point now = Clock::now();
+        lastFrame = std::max(lastFrame + interval, session->mRenderStart);
+        if (lastFrame + interval < now) lastFrame = now;
+        if (session->mCvRender.wait_until(lock, lastFrame, [&] { return session->mShutdown; })) break;
+        if (!session->mRendering || (session->mCreditMode && session->mCredit <= 0)) continue;
+
+        session->renderFrame(); // unlocks while the message handler runs
+    }
+}
+
+void
+MockSession::renderFrame()
+{
+    const float elapsed = std::chrono::duration<float>(Clock::now() - mRenderStart).count();
+    const float progress = (mConfig.mDurationSec > 0.0f) ? std::min(elapsed / mConfig.mDurationSec, 1.0f) : 1.0f;
+    const bool final = progress >= 1.0f;
+
+    scene_rdl2::fb_util::ActivePixels activePixels;
+    activePixels.init(mWidth, mHeight);
+    const unsigned tileX = activePixels.getNumTilesX();
+    const unsigned alignedW = activePixels.getAlignedWidth();
+    const unsigned alignedH = activePixels.getAlignedHeight();
+
+    std::vector<unsigned> tiles;
+    fillTiles(final ? 1.0f : progress, tiles);
+
+    scene_rdl2::fb_util::RenderBuffer beauty;
+    beauty.init(alignedW, alignedH);
+    beauty.clear();
+    std::vector<scene_rdl2::fb_util::VariablePixelBuffer> aovs(mConfig.mAovs.size());
+    for (auto& itr : aovs) {
+        itr.init(scene_rdl2::fb_util::VariablePixelBuffer::FLOAT, alignedW, alignedH);
+        itr.clear();
+    }
+
+    const float noise = 0.5f * (1.0f - progress);
+    for (unsigned tileId : tiles) {
+        activePixels.setTileMask(tileId, ~static_cast<uint64_t>(0));
+        const unsigned x0 = (tileId % tileX) * TILE_SIZE;
+        const unsigned y0 = (tileId / tileX) * TILE_SIZE;
+        for (unsigned i = 0; i < TILE_SIZE * TILE_SIZE; ++i) {
+            const unsigned x = x0 + i % TILE_SIZE;
+            const unsigned y = y0 + i / TILE_SIZE;
+            const float checker = (((x / 32) + (y / 32)) & 1) ? 0.75f : 0.25f;
+            const float n = noise * hashNoise(x, y, mFrameCount);
+            scene_rdl2::fb_util::RenderColor& pix = beauty.getData()[tileId * TILE_SIZE * TILE_SIZE + i];
+            pix[0] = std::max(static_cast<float>(x) / static_cast<float>(mWidth) + n, 0.0f);
+            pix[1] = std::max(static_cast<float>(y) / static_cast<float>(mHeight) + n, 0.0f);
+            pix[2] = std::max(checker + n, 0.0f);
+            pix[3] = 1.0f;
+            for (size_t aovId = 0; aovId < aovs.size(); ++aovId) {
+                aovs[aovId].getFloatBuffer().getData()[tileId * TILE_SIZE * TILE_SIZE + i] =
+                    static_cast<float>(aovId + 1) * checker + n;
+            }
+        }
+    }
+
+    mcrt::ProgressiveFrame::Ptr frame = std::make_shared<mcrt::ProgressiveFrame>();
+    frame->mMachineId = -2; // merge computation
+    frame->mSnapshotId = static_cast<uint32_t>(mFrameCount);
+    frame->mSnapshotStartTime =
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    frame->mCoarsePassStatus = (progress < SCANLINE_PASS_FRACTION) ? 0 : 1;
+    frame->mHeader.mStatus = final ? mcrt::BaseFrame::FINISHED :
+                             (mFrameCount == 0 ? mcrt::BaseFrame::STARTED : mcrt::BaseFrame::RENDERING);
+    frame->mHeader.mProgress = progress;
+    frame->mHeader.mFrameId = mSyncId;
+    frame->mHeader.setViewport(0, 0, static_cast<int>(mWidth) - 1, static_cast<int>(mHeight) - 1);
+
+    namespace grid_util = scene_rdl2::grid_util;
+    std::string data;
+    grid_util::PackTiles::encode(false, // renderPrepMode
+                                 activePixels,
+                                 beauty,
+                                 data,
+                                 grid_util::PackTiles::PrecisionMode::F32,
+                                 true,   // noNumSampleMode
+                                 false); // withSha1Hash
+    frame->addBuffer(makeDataPtr(data), data.size(), "beauty", mcrt::BaseFrame::ENCODING_UNKNOWN);
+    for (size_t aovId = 0; aovId < aovs.size(); ++aovId) {
+        data.clear();
+        grid_util::PackTiles::encodeRenderOutput(activePixels,
+                                                 aovs[aovId],
+                                                 0.0f,  // defaultValue
+                                                 data,
+                                                 grid_util::PackTiles::PrecisionMode::F32,
+                                                 true,  // noNumSampleMode
+                                                 false, // doNormalizeMode
+                                                 false, // closestFilterStatus
+                                                 0,     // renderOutputType : regular
+                                                 false); // withSha1Hash
+        frame->addBuffer(makeDataPtr(data), data.size(), mConfig.mAovs[aovId].c_str(),
+                         mcrt::BaseFrame::ENCODING_UNKNOWN);
+    }
+
+    mFrameCount++;
+    if (mCreditMode) mCredit--;
+    if (final) mRendering = false;
+
+    // The message handler may call sendMessage(), deliver without the lock like the SDK receiver thread.
+    const arras4::api::Message msg(frame);
+    mMutex.unlock();
+    try {
+        if (mMessageHandler) mMessageHandler(msg);
+    } catch (const std::exception& e) {
+        if (mExceptionCallback) mExceptionCallback(e);
+    }
+    mMutex.lock();
+}
+
+void
+MockSession::fillTiles(const float progress, std::vector<unsigned>& tiles)
+{
+    const unsigned tileX = (mWidth + TILE_SIZE - 1) / TILE_SIZE;
+    const unsigned tileY = (mHeight + TILE_SIZE - 1) / TILE_SIZE;
+    const unsigned tileTotal = tileX * tileY;
+
+    tiles.clear();
+    if (mConfig.mTilePattern == "scanline" && progress < SCANLINE_PASS_FRACTION) {
+        const unsigned rows = std::max(static_cast<unsigned>(std::ceil(progress / SCANLINE_PASS_FRACTION * tileY)), 1u);
+        for (unsigned tileId = 0; tileId < std::min(rows, tileY) * tileX; ++tileId) tiles.push_back(tileId);
+    } else if (mConfig.mTilePattern == "random" && progress < 1.0f) {
+        for (unsigned tileId = 0; tileId < tileTotal; ++tileId) {
+            mRandomState ^= mRandomState << 13; // xorshift64
+            mRandomState ^= mRandomState >> 7;
+            mRandomState ^= mRandomState << 17;
+            if (mRandomState & 1) tiles.push_back(tileId);
+        }
+    } else {
+        for (unsigned tileId = 0; tileId < tileTotal; ++tileId) tiles.push_back(tileId);
+    }
+}
+
+} // namespace arras_render
@@ -0,0 +1,116 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "RenderSession.h"
+
+#include <scene_rdl2/scene/rdl2/SceneContext.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace arras_render {
+
+class MockSession : public RenderSession
+//
+// In-process stand-in for the coordinator and the render engine, so that the GUI, headless,
+// benchmark and script paths run without a pool. It accepts RDLMessage (initial and delta),
+// OutputRates, CreditUpdate and the render control messages, and sends synthetic ProgressiveFrame
+// messages back on its own thread the same way the merge computation does.
+//   resolution : rezed image size of the received scene variables
+//   fps        : Config::mFps, otherwise "fps" of the mcrt computation of the session definition
+//   progress   : reaches 100% after Config::mDurationSec, the final frame is FINISHED
+//   tiles      : all      : every tile on every frame
+//                scanline : tile rows arrive top to bottom during the first 20% then every tile
+//                random   : random half of the tiles on every frame
+//   credit     : flow control starts with the first CreditUpdate, every frame consumes one credit
+//   syncId     : every RDLMessage restarts the render with its syncId
+// The image is a fixed pattern plus noise which decays with progress, so the final frame is
+// noise free and usable as a convergence reference.
+//
+{
+public:
+    struct Config {
+        float mFps {0.0f};           // 0 : use the session definition
+        float mDurationSec {10.0f};
+        std::string mTilePattern {"random"};
+        std::vector<std::string> mAovs; // additional single channel float AOVs
+    };
+
+    explicit MockSession(const Config& config);
+    ~MockSession() override;
+
+    static bool isTilePattern(const std::string& name);
+
+    void setAsyncSend() override {}
+    void setMessageHandler(const MessageHandler& handler) override { mMessageHandler = handler; }
+    void setStatusHandler(const StatusHandler& handler) override { mStatusHandler = handler; }
+    void setExceptionCallback(const ExceptionCallback& callback) override { mExceptionCallback = callback; }
+    void setProgressChannel(const std::string&) override {}
+
+    std::string requestArrasUrl(const std::string&, const std::string&) override { return "mock://local"; }
+    bool resolveRez(arras4::client::SessionDefinition&, std::string&) override { return true; }
+    std::string createSession(arras4::client::SessionDefinition& def,
+                              const std::string& url,
+                              const arras4::client::SessionOptions& options) override;
+    bool waitForEngineReady(const unsigned) override { return mConnected; }
+    bool isEngineReady() override { return mConnected; }
+    bool isConnected() override { return mConnected; }
+    void disconnect() override;
+    std::string sessionId() override { return mSessionId; }
+
+    using RenderSession::sendMessage;
+    void sendMessage(const arras4::api::MessageContentConstPtr& content) override;
+
+    void progress(const std::string&) override {}
+    void progress(const std::string&, const float) override {}
+    void progress(const std::string&, const std::string&) override {}
+    void progressInfo(const std::string&, const std::string&) override {}
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static void threadMain(MockSession* session);
+    void joinThread(); // no-op on the mock thread itself
+
+    void recvRdl(const std::string& manifest, const std::string& payload, const uint32_t syncId);
+    void renderFrame(); // builds and delivers one ProgressiveFrame
+    void fillTiles(const float progress, std::vector<unsigned>& tiles);
+
+    Config mConfig;
+    MessageHandler mMessageHandler;
+    StatusHandler mStatusHandler;
+    ExceptionCallback mExceptionCallback;
+
+    std::string mSessionId;
+    std::atomic<bool> mConnected {false};
+
+    // render state, guarded by mMutex
+    std::unique_ptr<scene_rdl2::rdl2::SceneContext> mSceneCtx;
+    unsigned mWidth {0};
+    unsigned mHeight {0};
+    uint32_t mSyncId {0};
+    bool mRendering {false};
+    Clock::time_point mRenderStart;
+    uint64_t mFrameCount {0};   // frames of the current render
+    bool mCreditMode {false};
+    int mCredit {0};
+    uint64_t mOutputRatesTotal {0};
+
+    uint64_t mRandomState {0x9e3779b97f4a7c15ull};
+
+    std::thread mThread;
+    bool mShutdown {false};
+    std::mutex mMutex;
+    std::condition_variable mCvRender;
+};
+
+} // namespace arras_render
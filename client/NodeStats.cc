@@ -0,0 +1,260 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#include "NodeStats.h"
+#include "Trace.h"
+
+#include <mcrt_dataio/share/util/GlobalNodeInfo.h>
+#include <mcrt_dataio/share/util/McrtNodeInfo.h>
+#include <scene_rdl2/render/util/StrUtil.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+constexpr float PROGRESS_DROP_EPS = 1.0e-4f;
+
+float
+median(std::vector<float> values)
+{
+    if (values.empty()) return 0.0f;
+    const size_t mid = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + mid, values.end());
+    if (values.size() % 2) return values[mid];
+    const float upper = values[mid];
+    return (*std::max_element(values.begin(), values.begin() + mid) + upper) * 0.5f;
+}
+
+} // anon namespace
+
+namespace arras_render {
+
+NodeStats::NodeStats(const float stragglerThreshold)
+    : mStragglerThreshold(stragglerThreshold)
+{
+    parserConfigure();
+}
+
+void
+NodeStats::update(mcrt_dataio::ClientReceiverFb& fbReceiver)
+{
+    TraceSpan span("nodeStats");
+    const Clock::time_point now = Clock::now();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    bool restart = false;
+    fbReceiver.getGlobalNodeInfo().crawlAllMcrtNodeInfo([&](std::shared_ptr<mcrt_dataio::McrtNodeInfo> info) {
+            auto itr = mTrack.find(info->getMachineId());
+            if (itr != mTrack.end() && info->getProgress() < itr->second.mNode.mProgress - PROGRESS_DROP_EPS) {
+                restart = true;
+                return false;
+            }
+            return true;
+        });
+    if (restart) {
+        resetMain(); // frames of a new render
+    }
+    if (!mStarted) {
+        mStarted = true;
+        mOrigin = now;
+    }
+    const float sec = std::chrono::duration<float>(now - mOrigin).count();
+
+    fbReceiver.getGlobalNodeInfo().crawlAllMcrtNodeInfo([&](std::shared_ptr<mcrt_dataio::McrtNodeInfo> info) {
+            Track& track = mTrack[info->getMachineId()];
+            Node& node = track.mNode;
+            const float prevProgress = node.mProgress;
+            node.mMachineId = info->getMachineId();
+            node.mHostName = info->getHostName();
+            node.mCpuTotal = info->getCpuTotal();
+            node.mCpuUsage = info->getCpuUsage();
+            node.mProgress = info->getProgress();
+
+            if (node.mProgress > prevProgress) {
+                track.mAdvanceSec = sec;
+            } else if (track.mAdvanceSec >= 0.0f && node.mProgress < 1.0f) {
+                // this merged frame still carries the previous contribution of the node
+                const float age = sec - track.mAdvanceSec;
+                track.mAgeMax = std::max(track.mAgeMax, age);
+                track.mAgeSum += age;
+            }
+            if (track.mAdvanceSec >= 0.0f && node.mProgress < 1.0f) track.mAgeTotal++;
+
+            if (node.mProgress > 0.0f && node.mStartSec < 0.0f) {
+                node.mStartSec = sec;
+                track.mFirstSec = sec;
+                track.mFirstProgress = node.mProgress;
+            }
+            if (node.mProgress >= 1.0f && node.mFinishSec < 0.0f) {
+                node.mFinishSec = sec;
+            }
+            track.mLastSec = sec;
+            return true;
+        });
+}
+
+void
+NodeStats::reset()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    resetMain();
+}
+
+std::vector<NodeStats::Node>
+NodeStats::getNodes() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return evalNodes();
+}
+
+float
+NodeStats::getStragglerGapSec() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return stragglerGap(evalNodes());
+}
+
+std::string
+NodeStats::show() const
+{
+    namespace str_util = scene_rdl2::str_util;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    const std::vector<Node> nodes = evalNodes();
+    const float gap = stragglerGap(nodes);
+
+    auto secOrDash = [](const float sec) { return (sec < 0.0f) ? std::string("-") : str_util::secStr(sec); };
+
+    std::ostringstream ostr;
+    ostr << "NodeStats (nodes:" << nodes.size() << ") {\n"
+         << "  " << std::setw(4) << "id" << ' ' << std::setw(24) << "host"
+         << ' ' << std::setw(4) << "cpu" << ' ' << std::setw(6) << "usage"
+         << ' ' << std::setw(7) << "progress" << ' ' << std::setw(10) << "start"
+         << ' ' << std::setw(8) << "%/s" << ' ' << std::setw(6) << "share"
+         << ' ' << std::setw(10) << "finish" << ' ' << std::setw(10) << "latency"
+         << ' ' << std::setw(10) << "latencyMax" << '\n';
+    for (const auto& node : nodes) {
+        const bool projected = node.mFinishSec < 0.0f && node.mProjectedFinishSec >= 0.0f;
+        ostr << "  " << std::setw(4) << node.mMachineId << ' ' << std::setw(24) << node.mHostName
+             << ' ' << std::setw(4) << node.mCpuTotal
+             << ' ' << std::setw(5) << std::fixed << std::setprecision(1) << node.mCpuUsage * 100.0f << '%'
+             << ' ' << std::setw(7) << node.mProgress * 100.0f << '%'
+             << ' ' << std::setw(10) << secOrDash(node.mStartSec)
+             << ' ' << std::setw(8) << std::setprecision(3) << node.mRate * 100.0f
+             << ' ' << std::setw(5) << std::setprecision(1) << node.mShare * 100.0f << '%'
+             << ' ' << std::setw(10) << secOrDash(projected ? node.mProjectedFinishSec : node.mFinishSec)
+             << ' ' << std::setw(10) << secOrDash(node.mLatencySec)
+             << ' ' << std::setw(10) << secOrDash(node.mLatencyMaxSec)
+             << (projected ? " (projected)" : "")
+             << (node.mStraggler ? " STRAGGLER" : "") << '\n';
+    }
+    ostr << "  stragglerThreshold:" << mStragglerThreshold * 100.0f << "%\n"
+         << "  stragglerGap:" << secOrDash(gap) << '\n'
+         << "}";
+    return ostr.str();
+}
+
+Json::Value
+NodeStats::toJson() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    const std::vector<Node> nodes = evalNodes();
+
+    Json::Value root;
+    root["stragglerThreshold"] = mStragglerThreshold;
+    root["stragglerGapSec"] = stragglerGap(nodes);
+    root["nodes"] = Json::Value(Json::arrayValue);
+    for (const auto& node : nodes) {
+        Json::Value item;
+        item["machineId"] = node.mMachineId;
+        item["host"] = node.mHostName;
+        item["cpuTotal"] = node.mCpuTotal;
+        item["cpuUsage"] = node.mCpuUsage;
+        item["progress"] = node.mProgress;
+        item["startSec"] = node.mStartSec;
+        item["finishSec"] = node.mFinishSec;
+        item["projectedFinishSec"] = node.mProjectedFinishSec;
+        item["rate"] = node.mRate;
+        item["share"] = node.mShare;
+        item["latencySec"] = node.mLatencySec;
+        item["latencyMaxSec"] = node.mLatencyMaxSec;
+        item["straggler"] = node.mStraggler;
+        root["nodes"].append(item);
+    }
+    return root;
+}
+
+void
+NodeStats::resetMain()
+{
+    mStarted = false;
+    mTrack.clear();
+}
+
+std::vector<NodeStats::Node>
+NodeStats::evalNodes() const
+{
+    std::vector<Node> nodes;
+    float rateTotal = 0.0f;
+    for (const auto& itr : mTrack) {
+        const Track& track = itr.second;
+        Node node = track.mNode;
+
+        const float endSec = (node.mFinishSec >= 0.0f) ? node.mFinishSec : track.mLastSec;
+        if (track.mFirstSec >= 0.0f && endSec > track.mFirstSec) {
+            node.mRate = (node.mProgress - track.mFirstProgress) / (endSec - track.mFirstSec);
+        }
+        if (track.mAgeTotal > 0) {
+            node.mLatencySec = static_cast<float>(track.mAgeSum / track.mAgeTotal);
+            node.mLatencyMaxSec = track.mAgeMax;
+        }
+        if (node.mFinishSec >= 0.0f) {
+            node.mProjectedFinishSec = node.mFinishSec;
+        } else if (node.mRate > 0.0f) {
+            node.mProjectedFinishSec = track.mLastSec + (1.0f - node.mProgress) / node.mRate;
+        }
+        rateTotal += node.mRate;
+        nodes.push_back(node);
+    }
+
+    std::vector<float> finish;
+    for (auto& node : nodes) {
+        node.mShare = (rateTotal > 0.0f) ? node.mRate / rateTotal : 0.0f;
+        if (node.mProjectedFinishSec >= 0.0f) finish.push_back(node.mProjectedFinishSec);
+    }
+    if (finish.size() >= 2) {
+        const float limit = median(finish) * (1.0f + mStragglerThreshold);
+        for (auto& node : nodes) {
+            node.mStraggler = (node.mProjectedFinishSec > limit);
+        }
+    }
+    return nodes;
+}
+
+float
+NodeStats::stragglerGap(const std::vector<Node>& nodes) const
+{
+    std::vector<float> finish;
+    for (const auto& node : nodes) {
+        if (node.mProjectedFinishSec >= 0.0f) finish.push_back(node.mProjectedFinishSec);
+    }
+    if (finish.size() < 2) return -1.0f;
+    return *std::max_element(finish.begin(), finish.end()) - median(finish);
+}
+
+void
+NodeStats::parserConfigure()
+{
+    mParser.description("per MCRT node throughput command");
+    mParser.opt("show", "", "show per node throughput and stragglers",
+                [&](Arg& arg) -> bool { return arg.msg(show() + '\n'); });
+    mParser.opt("reset", "", "reset node statistics",
+                [&](Arg& arg) -> bool {
+                    reset();
+                    return arg.msg("reset\n");
+                });
+}
+
+} // namespace arras_render
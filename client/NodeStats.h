@@ -0,0 +1,99 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <scene_rdl2/common/grid_util/Arg.h>
+#include <scene_rdl2/common/grid_util/Parser.h>
+
+#include <mcrt_dataio/client/receiver/ClientReceiverFb.h>
+
+#include <json/json.h>
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace arras_render {
+
+class NodeStats
+//
+// Per MCRT node throughput of multi-machine sessions, taken from the merge telemetry (GlobalNodeInfo)
+// which ClientReceiverFb decodes with every frame. For each node (machineId) of the current render:
+//   start    : first progress of the node since the render started
+//   rate     : progress of the node's own share per sec
+//   share    : node rate / sum of all node rates
+//   finish   : time the node reached 100%, or projected by the rate while it is still rendering
+//   latency  : age of the node's contribution in the merged frames, i.e. the time since the node's
+//              progress last advanced, averaged over the merged frames received while it renders.
+//              The telemetry has no send timestamp of the node, so this is measured at the client :
+//              a node whose updates reach the merge late or rarely shows a larger latency.
+// A node is flagged as a straggler when its finish is more than the threshold behind the median
+// finish of all nodes. A new render is detected by the progress of any node going backwards.
+// update() is called from the decode thread, all APIs are MT-safe.
+//
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using Arg = scene_rdl2::grid_util::Arg;
+    using Parser = scene_rdl2::grid_util::Parser;
+
+    struct Node {
+        int mMachineId {-1};
+        std::string mHostName;
+        int mCpuTotal {0};
+        float mCpuUsage {0.0f}; // 0.0 ~ 1.0
+        float mProgress {0.0f}; // 0.0 ~ 1.0
+        float mStartSec {-1.0f};  // negative : not started
+        float mFinishSec {-1.0f}; // negative : not finished
+        float mProjectedFinishSec {-1.0f}; // negative : unknown
+        float mRate {0.0f};       // progress per sec
+        float mShare {0.0f};      // 0.0 ~ 1.0
+        float mLatencySec {-1.0f};    // mean contribution age, negative : unknown
+        float mLatencyMaxSec {-1.0f};
+        bool mStraggler {false};
+    };
+
+    explicit NodeStats(const float stragglerThreshold = 0.2f);
+
+    void update(mcrt_dataio::ClientReceiverFb& fbReceiver);
+    void reset();
+
+    std::vector<Node> getNodes() const; // machineId order, rate/share/straggler are up to date
+    float getStragglerGapSec() const;   // slowest finish - median finish, negative if unknown
+
+    std::string show() const;
+    Json::Value toJson() const;
+
+    Parser& getParser() { return mParser; }
+
+private:
+    struct Track {
+        Node mNode;
+        float mFirstSec {-1.0f};
+        float mFirstProgress {0.0f};
+        float mLastSec {0.0f};
+        float mAdvanceSec {-1.0f}; // last time the progress of the node went up
+        double mAgeSum {0.0};
+        unsigned mAgeTotal {0};
+        float mAgeMax {0.0f};
+    };
+
+    void resetMain();
+    std::vector<Node> evalNodes() const; // mMutex locked by the caller
+    float stragglerGap(const std::vector<Node>& nodes) const;
+    void parserConfigure();
+
+    const float mStragglerThreshold;
+
+    mutable std::mutex mMutex;
+    bool mStarted {false};
+    Clock::time_point mOrigin;
+    std::map<int, Track> mTrack; // key is machineId
+
+    Parser mParser;
+};
+
+} // namespace arras_render
@@ -0,0 +1,442 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#include "OutboundSession.h"
+#include "ThreadRole.h"
+#include "Trace.h"
+
+#include <mcrt_messages/CreditUpdate.h>
+#include <mcrt_messages/JSONMessage.h>
+#include <mcrt_messages/OutputRates.h>
+#include <mcrt_messages/RDLMessage.h>
+#include <mcrt_messages/RenderMessages.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+constexpr const char* CLASS_NAME[] = {"control", "credit", "camera", "bulk"};
+static_assert(sizeof(CLASS_NAME) / sizeof(CLASS_NAME[0]) == arras_render::OutboundSession::CLASS_TOTAL,
+              "CLASS_NAME has to match RenderSession::SendClass");
+
+// disconnect() gives up sending the queued messages after this
+constexpr std::chrono::seconds DRAIN_TIMEOUT(5);
+
+} // anon namespace
+
+namespace arras_render {
+
+OutboundSession::OutboundSession(std::shared_ptr<RenderSession> session)
+    : mSession(session)
+{
+    mThread = std::thread(threadMain, this);
+    parserConfigure();
+}
+
+OutboundSession::~OutboundSession()
+{
+    stop(false);
+}
+
+void
+OutboundSession::disconnect()
+{
+    stop(true); // the last control messages (i.e. stop render) have to reach the session
+    mSession->disconnect();
+}
+
+void
+OutboundSession::sendMessage(const arras4::api::MessageContentConstPtr& content, const SendClass sendClass)
+{
+    if (!content) return;
+
+    Entry entry;
+    entry.mContent = content;
+    entry.mQueueTime = Clock::now();
+    entry.mRdl = static_cast<bool>(std::dynamic_pointer_cast<const mcrt::RDLMessage>(content));
+    int classId = static_cast<int>((sendClass == SendClass::AUTO) ? classify(content) : sendClass);
+
+    bool queued = false;
+    std::vector<uint32_t> dropped;
+    DropCallBack dropCallBack;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!mStopped) {
+            bool stop = false;
+            if (classId == static_cast<int>(SendClass::CONTROL) && isRenderControl(content, stop)) {
+                if (stop) {
+                    dropCameraMain(dropped);
+                    dropStartMain();
+                } else if (requeueHeldMain()) {
+                    classId = static_cast<int>(SendClass::BULK); // the start follows the held camera
+                }
+            } else if (entry.mRdl) {
+                requeueHeldMain();
+            }
+
+            if (!collapseMain(entry, classId)) {
+                entry.mSeq = mSeq++;
+                mQueue[classId].push_back(std::move(entry));
+                mPendingTotal = getPendingMain();
+                mPendingMax = std::max(mPendingMax, mPendingTotal.load());
+            }
+            queued = true;
+            dropCallBack = mDropCallBack;
+        }
+    }
+    if (queued) {
+        mCvQueue.notify_one();
+        if (dropCallBack) {
+            for (const uint32_t syncId : dropped) dropCallBack(syncId);
+        }
+    } else {
+        mSession->sendMessage(content); // after disconnect()
+    }
+}
+
+void
+OutboundSession::setExceptionCallback(const ExceptionCallback& callback)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mExceptionCallback = callback; // send failures of the send thread
+    }
+    mSession->setExceptionCallback(callback);
+}
+
+void
+OutboundSession::setDropCallBack(const DropCallBack& callBack)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mDropCallBack = callBack;
+}
+
+std::string
+OutboundSession::show() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::ostringstream ostr;
+    ostr << "OutboundSession {\n"
+         << "  state:" << (mStopped ? "stopped" : "running")
+         << " pending:" << getPendingMain() << " pendingMax:" << mPendingMax
+         << " failed:" << mFailedTotal << '\n';
+    for (int i = 0; i < CLASS_TOTAL; ++i) {
+        ostr << "  " << std::setw(7) << std::left << CLASS_NAME[i] << std::right
+             << " sent:" << mSentTotal[i]
+             << " collapsed:" << mCollapsedTotal[i]
+             << " pending:" << mQueue[i].size() << '\n'
+             << "    " << mLatency[i].showSummary("queueLatency") << '\n';
+    }
+    ostr << "}";
+    return ostr.str();
+}
+
+Json::Value
+OutboundSession::toJson() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    Json::Value json;
+    json["pendingMax"] = static_cast<Json::UInt64>(mPendingMax);
+    json["failed"] = static_cast<Json::UInt64>(mFailedTotal);
+    for (int i = 0; i < CLASS_TOTAL; ++i) {
+        const LatencyHistogram& latency = mLatency[i];
+        Json::Value item;
+        item["sent"] = static_cast<Json::UInt64>(mSentTotal[i]);
+        item["collapsed"] = static_cast<Json::UInt64>(mCollapsedTotal[i]);
+        item["queueLatencyP50"] = latency.getPercentile(50.0f);
+        item["queueLatencyP99"] = latency.getPercentile(99.0f);
+        item["queueLatencyMax"] = latency.getMax();
+        json[CLASS_NAME[i]] = item;
+    }
+    return json;
+}
+
+// static function
+RenderSession::SendClass
+OutboundSession::classify(const arras4::api::MessageContentConstPtr& content)
+{
+    if (std::dynamic_pointer_cast<const mcrt::RDLMessage>(content)) return SendClass::BULK;
+    if (std::dynamic_pointer_cast<const mcrt::CreditUpdate>(content)) return SendClass::CREDIT;
+    return SendClass::CONTROL; // render control, OutputRates, pick, viewport and console messages
+}
+
+// static function
+bool
+OutboundSession::isRenderControl(const arras4::api::MessageContentConstPtr& content, bool& stop)
+{
+    auto json = std::dynamic_pointer_cast<const mcrt::JSONMessage>(content);
+    if (!json || json->messageId() != mcrt::RenderMessages::RENDER_CONTROL_ID) return false;
+    stop = (json->messagePayload()[mcrt::RenderMessages::RENDER_CONTROL_PAYLOAD].asString() ==
+            mcrt::RenderMessages::RENDER_CONTROL_PAYLOAD_STOP);
+    return true;
+}
+
+// static function
+std::string
+OutboundSession::showSendClass(const SendClass sendClass)
+{
+    const int id = static_cast<int>(sendClass);
+    if (sendClass == SendClass::AUTO) return "auto";
+    return (id >= 0 && id < CLASS_TOTAL) ? CLASS_NAME[id] : "?";
+}
+
+// static function
+void
+OutboundSession::threadMain(OutboundSession* session)
+{
+    ThreadRoleScope threadRole(ThreadRole::SEND);
+
+    while (true) {
+        Entry entry;
+        int classId = 0;
+        {
+            std::unique_lock<std::mutex> lock(session->mMutex);
+            session->mCvQueue.wait(lock, [&] { return session->mStopped || session->getPendingMain() > 0; });
+            if (session->mStopped) break;
+            session->popMain(entry, classId);
+            session->mLatency[classId].add(std::chrono::duration<float>(Clock::now() - entry.mQueueTime).count());
+            session->mSending = true;
+        }
+
+        bool failed = false;
+        {
+            auto rdl = std::dynamic_pointer_cast<const mcrt::RDLMessage>(entry.mContent);
+            TraceSpan span("outboundSend", 0, rdl ? rdl->mSyncId : -1);
+            try {
+                session->mSession->sendMessage(entry.mContent);
+            } catch (const std::exception& e) {
+                std::cerr << ">> OutboundSession.cc " << CLASS_NAME[classId]
+                          << " message send failed. " << e.what() << '\n';
+                failed = true;
+
+                ExceptionCallback callback;
+                {
+                    std::lock_guard<std::mutex> lock(session->mMutex);
+                    callback = session->mExceptionCallback;
+                }
+                if (callback) callback(e); // the same as a failure of the session's own thread
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(session->mMutex);
+            session->mSending = false;
+            if (failed) session->mFailedTotal++;
+            else session->mSentTotal[classId]++;
+        }
+        session->mCvDone.notify_all();
+    }
+}
+
+void
+OutboundSession::stop(const bool drain)
+{
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        if (mStopped) return;
+        if (drain &&
+            !mCvDone.wait_for(lock, DRAIN_TIMEOUT, [&] { return getPendingMain() == 0 && !mSending; })) {
+            std::cerr << ">> OutboundSession.cc drain timed out, " << getPendingMain()
+                      << " queued messages are dropped\n";
+        }
+        mStopped = true;
+        for (auto& itr : mQueue) itr.clear();
+        mHeldCamera = Entry();
+        mPendingTotal = 0;
+    }
+    mCvQueue.notify_all();
+    if (mThread.joinable()) mThread.join();
+}
+
+bool
+OutboundSession::collapseMain(const Entry& entry, const int classId)
+{
+    std::deque<Entry>& queue = mQueue[classId];
+    switch (static_cast<SendClass>(classId)) {
+    case SendClass::CONTROL : {
+        // only the latest output rates matter
+        if (!std::dynamic_pointer_cast<const mcrt::OutputRates>(entry.mContent)) return false;
+        auto itr = std::find_if(queue.begin(), queue.end(), [](const Entry& queued) {
+            return static_cast<bool>(std::dynamic_pointer_cast<const mcrt::OutputRates>(queued.mContent));
+        });
+        if (itr == queue.end()) return false;
+        itr->mContent = entry.mContent;
+    } break;
+
+    case SendClass::CREDIT : {
+        if (queue.empty()) return false;
+        auto credit = std::dynamic_pointer_cast<const mcrt::CreditUpdate>(entry.mContent);
+        auto queuedCredit = std::dynamic_pointer_cast<const mcrt::CreditUpdate>(queue.back().mContent);
+        if (!credit || !queuedCredit) return false;
+        mcrt::CreditUpdate::Ptr merged = std::make_shared<mcrt::CreditUpdate>();
+        merged->value() = queuedCredit->value() + credit->value();
+        queue.back().mContent = merged;
+    } break;
+
+    case SendClass::CAMERA : {
+        // a camera delta sets the whole camera transform, the queued one is obsolete unless it has to
+        // keep its place in front of another RDLMessage
+        if (!entry.mRdl || queue.empty() || !queue.back().mRdl || hasRdlAfterMain(queue.back().mSeq)) {
+            return false;
+        }
+        queue.back().mContent = entry.mContent;
+    } break;
+
+    default : return false;
+    }
+
+    mCollapsedTotal[classId]++;
+    return true;
+}
+
+void
+OutboundSession::dropCameraMain(std::vector<uint32_t>& syncIds)
+//
+// Camera deltas behind the last queued scene delta would restart the render which the stop ends.
+// The ones in front of a scene delta keep their place, the syncId has to increase.
+//
+{
+    bool hasScene = false;
+    uint64_t lastSceneSeq = 0;
+    for (int i = 0; i < CLASS_TOTAL; ++i) {
+        if (i == static_cast<int>(SendClass::CAMERA)) continue;
+        for (const auto& itr : mQueue[i]) {
+            if (!itr.mRdl || itr.mHeld) continue;
+            if (!hasScene || itr.mSeq > lastSceneSeq) lastSceneSeq = itr.mSeq;
+            hasScene = true;
+        }
+    }
+
+    for (const SendClass sendClass : {SendClass::CAMERA, SendClass::BULK}) {
+        const int classId = static_cast<int>(sendClass);
+        std::deque<Entry>& queue = mQueue[classId];
+        for (auto itr = queue.begin(); itr != queue.end();) {
+            const bool camera = (sendClass == SendClass::CAMERA) ? itr->mRdl : itr->mHeld;
+            if (!camera || (hasScene && itr->mSeq < lastSceneSeq)) {
+                ++itr;
+                continue;
+            }
+            if (!itr->mHeld) { // a held one is reported already
+                auto rdl = std::dynamic_pointer_cast<const mcrt::RDLMessage>(itr->mContent);
+                syncIds.push_back(static_cast<uint32_t>(rdl->mSyncId));
+            }
+            if (!mHeldCamera.mContent || itr->mSeq > mHeldCamera.mSeq) mHeldCamera = *itr; // FIFO, newest last
+            itr = queue.erase(itr);
+            mCollapsedTotal[classId]++;
+        }
+    }
+    mPendingTotal = getPendingMain();
+}
+
+void
+OutboundSession::dropStartMain()
+//
+// A render start waiting in BULK behind a held camera delta would run after the stop which is
+// sent at CONTROL priority, the stop cancels it.
+//
+{
+    std::deque<Entry>& queue = mQueue[static_cast<int>(SendClass::BULK)];
+    for (auto itr = queue.begin(); itr != queue.end();) {
+        bool stop = false;
+        if (!isRenderControl(itr->mContent, stop) || stop) {
+            ++itr;
+            continue;
+        }
+        itr = queue.erase(itr);
+        mCollapsedTotal[static_cast<int>(SendClass::BULK)]++;
+    }
+    mPendingTotal = getPendingMain();
+}
+
+bool
+OutboundSession::requeueHeldMain()
+{
+    if (!mHeldCamera.mContent) return false;
+    // BULK keeps it in order with the RDLMessages and out of the camera delta collapse
+    Entry entry = std::move(mHeldCamera);
+    mHeldCamera = Entry();
+    entry.mSeq = mSeq++;
+    entry.mHeld = true;
+    mQueue[static_cast<int>(SendClass::BULK)].push_back(std::move(entry));
+    mPendingTotal = getPendingMain();
+    return true;
+}
+
+bool
+OutboundSession::hasRdlAfterMain(const uint64_t seq) const
+{
+    for (const auto& queue : mQueue) {
+        for (const auto& itr : queue) {
+            if (itr.mRdl && itr.mSeq > seq) return true;
+        }
+    }
+    return false;
+}
+
+int
+OutboundSession::getOldestRdlClassMain() const
+{
+    int classId = -1;
+    uint64_t oldest = 0;
+    for (int i = 0; i < CLASS_TOTAL; ++i) {
+        for (const auto& itr : mQueue[i]) {
+            if (!itr.mRdl) continue;
+            if (classId < 0 || itr.mSeq < oldest) {
+                classId = i;
+                oldest = itr.mSeq;
+            }
+            break; // FIFO, the first RDLMessage is the oldest of the class
+        }
+    }
+    return classId;
+}
+
+bool
+OutboundSession::popMain(Entry& entry, int& classId)
+{
+    for (int i = 0; i < CLASS_TOTAL; ++i) {
+        if (mQueue[i].empty()) continue;
+        classId = i;
+        if (mQueue[i].front().mRdl) {
+            // RDLMessages are sent in the queued order, the front of the class holding the oldest one
+            // is either that RDLMessage or a message queued before it
+            classId = getOldestRdlClassMain();
+        }
+        entry = std::move(mQueue[classId].front());
+        mQueue[classId].pop_front();
+        mPendingTotal = getPendingMain();
+        return true;
+    }
+    return false;
+}
+
+size_t
+OutboundSession::getPendingMain() const
+{
+    size_t total = 0;
+    for (const auto& itr : mQueue) total += itr.size();
+    return total;
+}
+
+void
+OutboundSession::parserConfigure()
+{
+    mParser.description("outbound message scheduler command");
+    mParser.opt("show", "", "show per class sent/collapsed/pending count and queue latency",
+                [&](Arg& arg) -> bool { return arg.msg(show() + '\n'); });
+    mParser.opt("hist", "<control|credit|camera|bulk>", "show queue latency histogram of the class",
+                [&](Arg& arg) -> bool {
+                    const std::string name = (arg++)();
+                    for (int i = 0; i < CLASS_TOTAL; ++i) {
+                        if (name != CLASS_NAME[i]) continue;
+                        std::lock_guard<std::mutex> lock(mMutex);
+                        return arg.msg(mLatency[i].show(name + " queueLatency") + '\n');
+                    }
+                    return arg.msg("unknown class:" + name + '\n');
+                });
+}
+
+} // namespace arras_render
@@ -0,0 +1,171 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "EditLatency.h" // LatencyHistogram
+#include "RenderSession.h"
+
+#include <scene_rdl2/common/grid_util/Arg.h>
+#include <scene_rdl2/common/grid_util/Parser.h>
+
+#include <json/json.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace arras_render {
+
+class OutboundSession : public RenderSession
+//
+// Outbound message scheduler in front of another RenderSession. sendMessage() only queues the message
+// and a single send thread hands the messages to the session, so the producers (GUI, script, message
+// handler, debug console) never send concurrently and never wait behind a large scene send.
+// Queued messages are sent by class priority CONTROL > CREDIT > CAMERA > BULK, so a Stop/Pause goes
+// out before a scene resend which is still waiting. RDLMessages keep their order between them because
+// the syncId has to increase : a camera delta waits for a scene delta which was queued before it.
+// Superseded messages are collapsed while they wait : a new OutputRates replaces the queued one, credits
+// are summed into the queued CreditUpdate and a camera delta replaces the queued camera delta if no
+// other RDLMessage is behind it (EditLatency treats the dropped syncId as superseded).
+// A render control stop is sent at CONTROL priority like any other control message, the queued scene
+// deltas go out after it and are applied to the stopped render. The stop drops the queued camera deltas
+// which are not in front of a scene delta (their syncIds are reported by the drop callback) and a render
+// start which is still waiting. The newest dropped camera delta is held and queued again in front of the
+// next RDLMessage or render start, so the engine does not lose the pose. A stop which has to follow the
+// scene (i.e. delayed render) is sent with SendClass::BULK by the caller.
+// A send failure is reported to the exception callback.
+// disconnect() sends the queued messages first and stops the send thread, later messages are sent
+// directly. Queue latency (sendMessage() to the send of the session) is reported by class.
+//
+{
+public:
+    using Arg = scene_rdl2::grid_util::Arg;
+    using Parser = scene_rdl2::grid_util::Parser;
+    using Clock = std::chrono::steady_clock;
+    using DropCallBack = std::function<void(const uint32_t syncId)>;
+
+    static constexpr int CLASS_TOTAL = static_cast<int>(SendClass::AUTO);
+
+    explicit OutboundSession(std::shared_ptr<RenderSession> session);
+    ~OutboundSession() override;
+
+    void setAsyncSend() override { mSession->setAsyncSend(); }
+    void setMessageHandler(const MessageHandler& handler) override { mSession->setMessageHandler(handler); }
+    void setStatusHandler(const StatusHandler& handler) override { mSession->setStatusHandler(handler); }
+    void setExceptionCallback(const ExceptionCallback& callback) override;
+    void setProgressChannel(const std::string& channel) override { mSession->setProgressChannel(channel); }
+
+    std::string requestArrasUrl(const std::string& datacenter, const std::string& environment) override
+    {
+        return mSession->requestArrasUrl(datacenter, environment);
+    }
+    bool resolveRez(arras4::client::SessionDefinition& def, std::string& error) override
+    {
+        return mSession->resolveRez(def, error);
+    }
+    std::string createSession(arras4::client::SessionDefinition& def,
+                              const std::string& url,
+                              const arras4::client::SessionOptions& options) override
+    {
+        return mSession->createSession(def, url, options);
+    }
+    bool waitForEngineReady(const unsigned timeoutSec) override { return mSession->waitForEngineReady(timeoutSec); }
+    bool isEngineReady() override { return mSession->isEngineReady(); }
+    bool isConnected() override { return mSession->isConnected(); }
+    void disconnect() override;
+    std::string sessionId() override { return mSession->sessionId(); }
+
+    void sendMessage(const arras4::api::MessageContentConstPtr& content) override
+    {
+        sendMessage(content, SendClass::AUTO);
+    }
+    void sendMessage(const arras4::api::MessageContentConstPtr& content, const SendClass sendClass) override;
+
+    void progress(const std::string& stage) override { mSession->progress(stage); }
+    void progress(const std::string& stage, const float percentage) override
+    {
+        mSession->progress(stage, percentage);
+    }
+    void progress(const std::string& stage, const std::string& status) override
+    {
+        mSession->progress(stage, status);
+    }
+    void progressInfo(const std::string& key, const std::string& value) override
+    {
+        mSession->progressInfo(key, value);
+    }
+
+    size_t getPending() const { return mPendingTotal.load(std::memory_order_relaxed); } // lock free
+
+    // called by the sendMessage() caller (without any lock held) for each camera delta dropped by a stop
+    void setDropCallBack(const DropCallBack& callBack);
+
+    std::string show() const;
+    Json::Value toJson() const; // per class statistics
+
+    static SendClass classify(const arras4::api::MessageContentConstPtr& content);
+    static bool isRenderControl(const arras4::api::MessageContentConstPtr& content, bool& stop);
+    static std::string showSendClass(const SendClass sendClass);
+
+    Parser& getParser() { return mParser; }
+
+private:
+    struct Entry {
+        arras4::api::MessageContentConstPtr mContent;
+        Clock::time_point mQueueTime;
+        uint64_t mSeq {0};
+        bool mRdl {false};
+        bool mHeld {false}; // camera delta queued again by requeueHeldMain()
+    };
+
+    static void threadMain(OutboundSession* session);
+
+    void stop(const bool drain);
+
+    bool collapseMain(const Entry& entry, const int classId); // mMutex locked by the caller
+    void dropCameraMain(std::vector<uint32_t>& syncIds); // mMutex locked by the caller
+    void dropStartMain(); // mMutex locked by the caller
+    bool requeueHeldMain(); // mMutex locked by the caller
+    bool hasRdlAfterMain(const uint64_t seq) const; // mMutex locked by the caller
+    int getOldestRdlClassMain() const; // mMutex locked by the caller
+    bool popMain(Entry& entry, int& classId); // mMutex locked by the caller
+    size_t getPendingMain() const; // mMutex locked by the caller
+
+    void parserConfigure();
+
+    std::shared_ptr<RenderSession> mSession;
+
+    mutable std::mutex mMutex;
+    std::condition_variable mCvQueue; // new message or stop
+    std::condition_variable mCvDone;  // a message is sent
+    std::deque<Entry> mQueue[CLASS_TOTAL];
+    uint64_t mSeq {0};
+    bool mSending {false}; // send thread is in the sendMessage() of mSession
+    bool mStopped {false};
+    std::atomic<size_t> mPendingTotal {0}; // copy of getPendingMain() for the lock free read
+    Entry mHeldCamera; // newest camera delta dropped by a stop, mContent is empty if none
+    DropCallBack mDropCallBack;
+    ExceptionCallback mExceptionCallback;
+
+    // statistics
+    uint64_t mSentTotal[CLASS_TOTAL] {};
+    uint64_t mCollapsedTotal[CLASS_TOTAL] {};
+    uint64_t mFailedTotal {0};
+    size_t mPendingMax {0};
+    LatencyHistogram mLatency[CLASS_TOTAL];
+
+    std::thread mThread;
+
+    Parser mParser;
+};
+
+} // namespace arras_render
@@ -0,0 +1,49 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace arras_render {
+
+inline unsigned
+defaultThreadTotal(const unsigned maxThreadTotal = 8)
+{
+    return std::max(std::min(std::thread::hardware_concurrency(), maxThreadTotal), 1u);
+}
+
+template <typename Func>
+void
+parallelFor(const unsigned begin, const unsigned end, const unsigned threadTotal, const Func& func)
+//
+// Splits [begin, end) into contiguous bands and runs func(bandBegin, bandEnd) for each band.
+// The caller thread processes the first band. Used by the per-frame pixel kernels, the range is
+// image rows and the band count is small so that a thread per band is cheap enough. Band threads do
+// not enter a thread role (a name, a lock and a map insert per band and call), they keep the affinity
+// and the priority of the caller which they work for.
+//
+{
+    if (end <= begin) return;
+    const unsigned total = end - begin;
+    const unsigned bandTotal = std::max(std::min(threadTotal, total), 1u);
+    if (bandTotal == 1) {
+        func(begin, end);
+        return;
+    }
+
+    auto bandBegin = [&](const unsigned band) { return begin + static_cast<unsigned>(
+            static_cast<unsigned long long>(total) * band / bandTotal); };
+
+    std::vector<std::thread> threads;
+    threads.reserve(bandTotal - 1);
+    for (unsigned band = 1; band < bandTotal; ++band) {
+        threads.emplace_back([&func, b = bandBegin(band), e = bandBegin(band + 1)] { func(b, e); });
+    }
+    func(bandBegin(0), bandBegin(1));
+    for (auto& itr : threads) itr.join();
+}
+
+} // namespace arras_render
@@ -0,0 +1,246 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#include "PerfHud.h"
+
+#include <scene_rdl2/render/util/StrUtil.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include <QColor>
+#include <QFont>
+#include <QImage>
+#include <QPainter>
+#include <QPointF>
+#include <QString>
+
+namespace {
+
+constexpr const char* METRIC_NAME[] = {
+    "recv fps", "disp fps", "decode ms", "paint ms", "queue", "in MB/s", "credit", "edit ms"
+};
+static_assert(sizeof(METRIC_NAME) / sizeof(METRIC_NAME[0]) == arras_render::PerfHud::METRIC_TOTAL,
+              "METRIC_NAME has to match PerfHud::Metric");
+
+// panel layout in pixels, a sparkline has a pixel per sample
+constexpr int PAD = 4;
+constexpr int ROW_HEIGHT = 18;
+constexpr int LABEL_WIDTH = 64;
+constexpr int VALUE_WIDTH = 56;
+constexpr int SPARK_WIDTH = static_cast<int>(arras_render::PerfHud::RING_SIZE);
+constexpr int PANEL_WIDTH = PAD + LABEL_WIDTH + VALUE_WIDTH + SPARK_WIDTH + PAD;
+constexpr int PANEL_HEIGHT = PAD + ROW_HEIGHT * arras_render::PerfHud::METRIC_TOTAL + PAD;
+
+} // anon namespace
+
+namespace arras_render {
+
+PerfHud::PerfHud()
+{
+    for (auto& metric : mRing) {
+        for (auto& slot : metric) slot.store(0.0f, std::memory_order_relaxed);
+    }
+    mPrev.mTime = Clock::now();
+    parserConfigure();
+}
+
+void
+PerfHud::frameReceived(const size_t bytes)
+{
+    mRecvFrames.fetch_add(1, std::memory_order_relaxed);
+    mRecvBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void
+PerfHud::frameDecoded(const float ms)
+{
+    mDecodeCount.fetch_add(1, std::memory_order_relaxed);
+    mDecodeUs.fetch_add(static_cast<uint64_t>(ms * 1000.0f), std::memory_order_relaxed);
+}
+
+void
+PerfHud::displayQueued()
+{
+    mQueueDepth.fetch_add(1, std::memory_order_relaxed);
+}
+
+void
+PerfHud::displayDequeued()
+{
+    // a frame queued before the HUD was set does not take the depth below 0
+    int depth = mQueueDepth.load(std::memory_order_relaxed);
+    while (depth > 0 && !mQueueDepth.compare_exchange_weak(depth, depth - 1, std::memory_order_relaxed)) {}
+}
+
+void
+PerfHud::framePainted(const float ms)
+{
+    mPaintCount.fetch_add(1, std::memory_order_relaxed);
+    mPaintUs.fetch_add(static_cast<uint64_t>(ms * 1000.0f), std::memory_order_relaxed);
+}
+
+void
+PerfHud::creditSent(const int amount)
+{
+    mCreditTotal.fetch_add(amount, std::memory_order_relaxed);
+}
+
+void
+PerfHud::sample(const float editLatencySec)
+{
+    const Snapshot curr = takeSnapshot();
+    const float sec = std::chrono::duration<float>(curr.mTime - mPrev.mTime).count();
+    if (sec <= 0.0f) return;
+
+    auto perSec = [&](const uint64_t currVal, const uint64_t prevVal) {
+        return static_cast<float>(currVal - prevVal) / sec;
+    };
+    auto meanMs = [&](const uint64_t currUs, const uint64_t prevUs, const uint64_t currCount, const uint64_t prevCount) {
+        return (currCount > prevCount) ?
+            static_cast<float>(currUs - prevUs) / static_cast<float>(currCount - prevCount) / 1000.0f : 0.0f;
+    };
+
+    float value[METRIC_TOTAL];
+    value[static_cast<int>(Metric::RECV_FPS)] = perSec(curr.mRecvFrames, mPrev.mRecvFrames);
+    value[static_cast<int>(Metric::DISP_FPS)] = perSec(curr.mPaintCount, mPrev.mPaintCount);
+    value[static_cast<int>(Metric::DECODE_MS)] =
+        meanMs(curr.mDecodeUs, mPrev.mDecodeUs, curr.mDecodeCount, mPrev.mDecodeCount);
+    value[static_cast<int>(Metric::PAINT_MS)] =
+        meanMs(curr.mPaintUs, mPrev.mPaintUs, curr.mPaintCount, mPrev.mPaintCount);
+    value[static_cast<int>(Metric::QUEUE_DEPTH)] = static_cast<float>(mQueueDepth.load(std::memory_order_relaxed));
+    value[static_cast<int>(Metric::INBOUND_MBPS)] = perSec(curr.mRecvBytes, mPrev.mRecvBytes) / (1024.0f * 1024.0f);
+    value[static_cast<int>(Metric::CREDIT_WINDOW)] =
+        static_cast<float>(mCreditTotal.load(std::memory_order_relaxed) - static_cast<int64_t>(curr.mRecvFrames));
+    value[static_cast<int>(Metric::EDIT_LATENCY_MS)] = (editLatencySec >= 0.0f) ? editLatencySec * 1000.0f : 0.0f;
+    mPrev = curr;
+
+    // slots are written before the total is published, a reader only looks at published samples
+    const uint64_t sampleId = mSampleTotal.load(std::memory_order_relaxed);
+    for (int i = 0; i < METRIC_TOTAL; ++i) {
+        mRing[i][sampleId % RING_SIZE].store(value[i], std::memory_order_relaxed);
+    }
+    mSampleTotal.store(sampleId + 1, std::memory_order_release);
+}
+
+float
+PerfHud::getLast(const Metric metric) const
+{
+    const uint64_t total = getSampleTotal();
+    return total ? getSample(metric, total - 1) : 0.0f;
+}
+
+float
+PerfHud::getMax(const Metric metric) const
+{
+    const uint64_t total = getSampleTotal();
+    const uint64_t count = std::min(total, static_cast<uint64_t>(RING_SIZE));
+    float max = 0.0f;
+    for (uint64_t i = total - count; i < total; ++i) max = std::max(max, getSample(metric, i));
+    return max;
+}
+
+void
+PerfHud::render(QImage& image) const
+{
+    if (image.width() != PANEL_WIDTH || image.height() != PANEL_HEIGHT) {
+        image = QImage(PANEL_WIDTH, PANEL_HEIGHT, QImage::Format_RGB32);
+    }
+    image.fill(QColor(24, 24, 24));
+
+    const uint64_t total = getSampleTotal();
+    const uint64_t count = std::min(total, static_cast<uint64_t>(RING_SIZE));
+
+    QPainter qp(&image);
+    QFont font = qp.font();
+    font.setPixelSize(ROW_HEIGHT - 6);
+    qp.setFont(font);
+
+    QPointF points[RING_SIZE];
+    for (int i = 0; i < METRIC_TOTAL; ++i) {
+        const Metric metric = static_cast<Metric>(i);
+        const int top = PAD + i * ROW_HEIGHT;
+        const int base = top + ROW_HEIGHT - 3;
+
+        std::ostringstream ostr;
+        ostr << std::fixed << std::setprecision(1) << getLast(metric);
+        qp.setPen(QColor(160, 160, 160));
+        qp.drawText(PAD, base, METRIC_NAME[i]);
+        qp.setPen(Qt::white);
+        qp.drawText(PAD + LABEL_WIDTH, base, QString::fromStdString(ostr.str()));
+
+        if (count < 2) continue;
+        // each sparkline is scaled to its own max, oldest sample on the left
+        const float max = getMax(metric);
+        const float scale = (max > 0.0f) ? static_cast<float>(ROW_HEIGHT - 4) / max : 0.0f;
+        const int left = PAD + LABEL_WIDTH + VALUE_WIDTH + SPARK_WIDTH - static_cast<int>(count);
+        for (uint64_t j = 0; j < count; ++j) {
+            const float value = getSample(metric, total - count + j);
+            points[j] = QPointF(left + static_cast<int>(j), top + ROW_HEIGHT - 2 - value * scale);
+        }
+        qp.setPen(QColor(96, 200, 96));
+        qp.drawPolyline(points, static_cast<int>(count));
+    }
+}
+
+std::string
+PerfHud::show() const
+{
+    std::ostringstream ostr;
+    ostr << "PerfHud {\n"
+         << "  active:" << scene_rdl2::str_util::boolStr(isActive()) << '\n'
+         << "  samples:" << getSampleTotal() << " (interval:" << SAMPLE_INTERVAL_MS << "ms)\n";
+    for (int i = 0; i < METRIC_TOTAL; ++i) {
+        const Metric metric = static_cast<Metric>(i);
+        ostr << "  " << std::setw(10) << std::left << METRIC_NAME[i] << std::right
+             << std::fixed << std::setprecision(2)
+             << " last:" << std::setw(10) << getLast(metric)
+             << " max:" << std::setw(10) << getMax(metric) << '\n';
+    }
+    ostr << "}";
+    return ostr.str();
+}
+
+// static function
+std::string
+PerfHud::showMetric(const Metric metric)
+{
+    const int id = static_cast<int>(metric);
+    return (id >= 0 && id < METRIC_TOTAL) ? METRIC_NAME[id] : "?";
+}
+
+PerfHud::Snapshot
+PerfHud::takeSnapshot() const
+{
+    Snapshot snapshot;
+    snapshot.mRecvFrames = mRecvFrames.load(std::memory_order_relaxed);
+    snapshot.mRecvBytes = mRecvBytes.load(std::memory_order_relaxed);
+    snapshot.mDecodeCount = mDecodeCount.load(std::memory_order_relaxed);
+    snapshot.mDecodeUs = mDecodeUs.load(std::memory_order_relaxed);
+    snapshot.mPaintCount = mPaintCount.load(std::memory_order_relaxed);
+    snapshot.mPaintUs = mPaintUs.load(std::memory_order_relaxed);
+    snapshot.mTime = Clock::now();
+    return snapshot;
+}
+
+float
+PerfHud::getSample(const Metric metric, const uint64_t sampleId) const
+{
+    return mRing[static_cast<int>(metric)][sampleId % RING_SIZE].load(std::memory_order_relaxed);
+}
+
+void
+PerfHud::parserConfigure()
+{
+    mParser.description("performance HUD command");
+    mParser.opt("show", "", "show the last and max value of the HUD metrics",
+                [&](Arg& arg) -> bool { return arg.msg(show() + '\n'); });
+    mParser.opt("active", "<on|off>", "show/hide the HUD (same as H key)",
+                [&](Arg& arg) -> bool {
+                    setActive((arg++).as<bool>(0));
+                    return arg.fmtMsg("active %s\n", scene_rdl2::str_util::boolStr(isActive()).c_str());
+                });
+}
+
+} // namespace arras_render
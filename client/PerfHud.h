@@ -0,0 +1,118 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <scene_rdl2/common/grid_util/Arg.h>
+#include <scene_rdl2/common/grid_util/Parser.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+class QImage;
+
+namespace arras_render {
+
+class PerfHud
+//
+// Client side performance HUD (H key) : live sparklines of the received and displayed fps, decode and
+// paint time, display queue depth, inbound bandwidth, credit window and the last edit-to-first-pixel
+// latency. The frame path only bumps relaxed atomic counters. The Qt thread samples the counters at a
+// fixed interval into a ring of atomic slots (single writer, readers never lock) and renders the panel
+// into its own small image at display resolution, so the HUD never touches the frame itself and costs
+// nothing but the counters while it is hidden.
+// The credit window is the credit sent by this client minus the frames received, it is relative to the
+// initial credit of the session.
+//
+{
+public:
+    using Arg = scene_rdl2::grid_util::Arg;
+    using Parser = scene_rdl2::grid_util::Parser;
+    using Clock = std::chrono::steady_clock;
+
+    enum class Metric : int {
+        RECV_FPS = 0,
+        DISP_FPS,
+        DECODE_MS,
+        PAINT_MS,
+        QUEUE_DEPTH,
+        INBOUND_MBPS,
+        CREDIT_WINDOW,
+        EDIT_LATENCY_MS,
+        SIZE
+    };
+
+    static constexpr int METRIC_TOTAL = static_cast<int>(Metric::SIZE);
+    static constexpr unsigned RING_SIZE = 120; // 30 sec of samples
+    static constexpr int SAMPLE_INTERVAL_MS = 250;
+
+    PerfHud();
+
+    void setActive(const bool flag) { mActive.store(flag, std::memory_order_relaxed); }
+    bool isActive() const { return mActive.load(std::memory_order_relaxed); }
+
+    // producers, any thread
+    void frameReceived(const size_t bytes);
+    void frameDecoded(const float ms);
+    void displayQueued(); // a received frame is queued for the paint
+    void displayDequeued(); // the paint of a queued frame is done
+    void framePainted(const float ms); // any paint
+    void creditSent(const int amount);
+
+    int getQueueDepth() const { return mQueueDepth.load(std::memory_order_relaxed); } // live value
+
+    // sampler, a single thread (Qt timer). editLatencySec is negative if there is no edit yet
+    void sample(const float editLatencySec);
+
+    uint64_t getSampleTotal() const { return mSampleTotal.load(std::memory_order_acquire); }
+    float getLast(const Metric metric) const; // 0 before the first sample
+    float getMax(const Metric metric) const; // max of the ring
+
+    // draw the panel into image, image is (re)allocated at the panel size
+    void render(QImage& image) const;
+
+    std::string show() const;
+    static std::string showMetric(const Metric metric);
+
+    Parser& getParser() { return mParser; }
+
+private:
+    struct Snapshot {
+        uint64_t mRecvFrames {0};
+        uint64_t mRecvBytes {0};
+        uint64_t mDecodeCount {0};
+        uint64_t mDecodeUs {0};
+        uint64_t mPaintCount {0};
+        uint64_t mPaintUs {0};
+        Clock::time_point mTime;
+    };
+
+    Snapshot takeSnapshot() const;
+    float getSample(const Metric metric, const uint64_t sampleId) const;
+
+    void parserConfigure();
+
+    std::atomic<bool> mActive {false};
+
+    // counters of the producers
+    std::atomic<uint64_t> mRecvFrames {0};
+    std::atomic<uint64_t> mRecvBytes {0};
+    std::atomic<uint64_t> mDecodeCount {0};
+    std::atomic<uint64_t> mDecodeUs {0};
+    std::atomic<uint64_t> mPaintCount {0};
+    std::atomic<uint64_t> mPaintUs {0};
+    std::atomic<int> mQueueDepth {0};
+    std::atomic<int64_t> mCreditTotal {0};
+
+    Snapshot mPrev; // sampler only
+
+    // ring of samples, slot is sampleId % RING_SIZE
+    std::atomic<float> mRing[METRIC_TOTAL][RING_SIZE];
+    std::atomic<uint64_t> mSampleTotal {0};
+
+    Parser mParser;
+};
+
+} // namespace arras_render
@@ -0,0 +1,106 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#include "PixelKernels.h"
+
+#include <json/json.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+constexpr const char* ENV_DISPATCH = "ARRAS_RENDER_CPU_DISPATCH";
+
+struct Variant {
+    const arras_render::PixelKernels* mKernels;
+    bool mSupported;
+};
+
+std::vector<Variant>
+getVariants()
+//
+// compiled variants from the narrowest to the widest ISA
+//
+{
+    std::vector<Variant> variants;
+    variants.push_back({&arras_render::getPixelKernelsGeneric(), true});
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    const bool avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    const bool avx512 = (avx2 &&
+                         __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+                         __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("avx512dq"));
+    variants.push_back({&arras_render::getPixelKernelsAvx2(), avx2});
+    variants.push_back({&arras_render::getPixelKernelsAvx512(), avx512});
+#endif // __x86_64__
+    return variants;
+}
+
+const arras_render::PixelKernels&
+selectKernels()
+{
+    const std::vector<Variant> variants = getVariants();
+
+    const char* request = std::getenv(ENV_DISPATCH);
+    if (request && *request) {
+        for (const auto& itr : variants) {
+            if (std::string(itr.mKernels->mName) != request) continue;
+            if (itr.mSupported) return *itr.mKernels;
+            std::cerr << ">> PixelKernels.cc " << ENV_DISPATCH << '=' << request
+                      << " is not supported by this CPU, use automatic selection\n";
+            break;
+        }
+    }
+
+    const arras_render::PixelKernels* best = variants.front().mKernels;
+    for (const auto& itr : variants) {
+        if (itr.mSupported) best = itr.mKernels;
+    }
+    return *best;
+}
+
+} // anon namespace
+
+namespace arras_render {
+
+const PixelKernels&
+getPixelKernels()
+{
+    static const PixelKernels& kernels = selectKernels();
+    return kernels;
+}
+
+std::string
+showCpuDispatch()
+{
+    const PixelKernels& selected = getPixelKernels();
+
+    std::ostringstream ostr;
+    ostr << "CpuDispatch {\n"
+         << "  selected:" << selected.mName << '\n';
+    for (const auto& itr : getVariants()) {
+        ostr << "  " << itr.mKernels->mName << ':' << (itr.mSupported ? "supported" : "not-supported") << '\n';
+    }
+    const char* request = std::getenv(ENV_DISPATCH);
+    ostr << "  " << ENV_DISPATCH << ':' << ((request && *request) ? request : "-") << '\n'
+         << "}";
+    return ostr.str();
+}
+
+Json::Value
+cpuDispatchToJson()
+{
+    Json::Value json;
+    json["selected"] = getPixelKernels().mName;
+    Json::Value supported(Json::arrayValue);
+    for (const auto& itr : getVariants()) {
+        if (itr.mSupported) supported.append(itr.mKernels->mName);
+    }
+    json["supported"] = supported;
+    return json;
+}
+
+} // namespace arras_render
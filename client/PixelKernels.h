@@ -0,0 +1,58 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace Json { class Value; }
+
+namespace arras_render {
+
+struct PixelKernels
+//
+// Table of the pixel heavy loops of the client. The same kernel source (PixelKernelsImpl.h) is compiled
+// once per ISA variant and the best variant supported by the CPU is selected at the first call of
+// getPixelKernels(). The ARRAS_RENDER_CPU_DISPATCH environment variable forces a variant by name
+// (e.g. for benchmark comparison), an unsupported or unknown name falls back to the automatic selection.
+//
+{
+    const char* mName;
+
+    // planar float RGB (clamped to 0~1) -> interleaved RGB888
+    void (*mQuantizeRgb888)(const float* r, const float* g, const float* b, size_t pixTotal,
+                            unsigned char* rgb888);
+
+    // interleaved float RGBA (clamped to 0~1) -> interleaved RGB888, alpha is dropped
+    void (*mQuantizeRgba888)(const float* rgba, size_t pixTotal, unsigned char* rgb888);
+
+    // box filter downscale of RGB888 by an integer factor, strides in bytes
+    void (*mDownscaleRgb888)(const unsigned char* src, size_t srcStride,
+                             unsigned dstWidth, unsigned dstHeight, unsigned factor,
+                             unsigned char* dst, size_t dstStride);
+
+    // interleaved channel repack (e.g. RGB -> RGBA of the EXR beauty), missing channels are set to fill
+    void (*mPackChannels)(const float* src, unsigned srcChan, float* dst, unsigned dstChan, size_t pixTotal,
+                          float fill);
+
+    // sum of the squared error and the relative squared error of RGB over RGBA pixels
+    void (*mSumSqError)(const float* live, const float* ref, size_t pixTotal, float relEpsilon,
+                        double& sqErr, double& relSqErr);
+
+    // min(|a - b| * gain, 255) per byte
+    void (*mAbsDiffRgb888)(const unsigned char* a, const unsigned char* b, size_t byteTotal, int gain,
+                           unsigned char* dst);
+};
+
+const PixelKernels& getPixelKernels();
+
+std::string showCpuDispatch(); // compiled variants, CPU support and the selected one
+Json::Value cpuDispatchToJson();
+
+// kernel tables of each ISA variant, x86 only except the generic one
+const PixelKernels& getPixelKernelsGeneric();
+const PixelKernels& getPixelKernelsAvx2();
+const PixelKernels& getPixelKernelsAvx512();
+
+} // namespace arras_render
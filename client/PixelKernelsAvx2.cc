@@ -0,0 +1,13 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+// AVX2 + FMA variant, x86 only
+
+#if defined(__x86_64__)
+
+#define PIXEL_KERNELS_NAME "avx2"
+#define PIXEL_KERNELS_GETTER getPixelKernelsAvx2
+
+#include "PixelKernelsImpl.h"
+
+#endif // __x86_64__
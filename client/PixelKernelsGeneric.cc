@@ -0,0 +1,15 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+// Baseline variant : x86-64-v2 (SSE4.2) on x86, the target default (NEON) on ARM
+
+#if defined(__x86_64__)
+#define PIXEL_KERNELS_NAME "sse4.2"
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define PIXEL_KERNELS_NAME "neon"
+#else
+#define PIXEL_KERNELS_NAME "generic"
+#endif
+#define PIXEL_KERNELS_GETTER getPixelKernelsGeneric
+
+#include "PixelKernelsImpl.h"
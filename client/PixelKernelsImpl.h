@@ -0,0 +1,187 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+// Kernel source of PixelKernels, included by the ISA variant translation units only (PixelKernels*.cc)
+// which define PIXEL_KERNELS_NAME and PIXEL_KERNELS_GETTER and are compiled with their own -m options.
+// Everything here has internal linkage and no std template is used : an inline function emitted by a
+// wider ISA variant must never be picked by the linker for the generic variant.
+// The loops are plain and branch free so that the compiler vectorizes them for the target ISA. Float
+// reductions keep independent lane accumulators, the build does not allow reassociation (-ffast-math).
+//
+
+#include "PixelKernels.h"
+
+#include <cstdint>
+
+#if !defined(PIXEL_KERNELS_NAME) || !defined(PIXEL_KERNELS_GETTER)
+#error "PIXEL_KERNELS_NAME and PIXEL_KERNELS_GETTER have to be defined"
+#endif
+
+namespace {
+
+constexpr size_t ERROR_BLOCK_PIXELS = 1024; // float partial sums are flushed to double every block
+constexpr unsigned ERROR_LANES = 8;         // independent partial sums, one pixel each
+constexpr size_t DOWNSCALE_ACC_SIZE = 8192; // column sums of a part of a row
+
+inline float
+clamp01(const float v)
+{
+    const float lo = (v > 0.0f) ? v : 0.0f; // NaN -> 0
+    return (lo < 1.0f) ? lo : 1.0f;
+}
+
+void
+quantizeRgb888(const float* r, const float* g, const float* b, size_t pixTotal, unsigned char* rgb888)
+{
+    for (size_t i = 0; i < pixTotal; ++i) {
+        rgb888[i * 3    ] = static_cast<unsigned char>(clamp01(r[i]) * 255.0f + 0.5f);
+        rgb888[i * 3 + 1] = static_cast<unsigned char>(clamp01(g[i]) * 255.0f + 0.5f);
+        rgb888[i * 3 + 2] = static_cast<unsigned char>(clamp01(b[i]) * 255.0f + 0.5f);
+    }
+}
+
+void
+quantizeRgba888(const float* rgba, size_t pixTotal, unsigned char* rgb888)
+{
+    for (size_t i = 0; i < pixTotal; ++i) {
+        rgb888[i * 3    ] = static_cast<unsigned char>(clamp01(rgba[i * 4    ]) * 255.0f + 0.5f);
+        rgb888[i * 3 + 1] = static_cast<unsigned char>(clamp01(rgba[i * 4 + 1]) * 255.0f + 0.5f);
+        rgb888[i * 3 + 2] = static_cast<unsigned char>(clamp01(rgba[i * 4 + 2]) * 255.0f + 0.5f);
+    }
+}
+
+void
+downscaleRgb888(const unsigned char* src, size_t srcStride,
+                unsigned dstWidth, unsigned dstHeight, unsigned factor,
+                unsigned char* dst, size_t dstStride)
+{
+    if (factor <= 1) {
+        for (unsigned y = 0; y < dstHeight; ++y) {
+            const unsigned char* s = src + y * srcStride;
+            unsigned char* d = dst + y * dstStride;
+            for (size_t i = 0; i < static_cast<size_t>(dstWidth) * 3; ++i) d[i] = s[i];
+        }
+        return;
+    }
+
+    uint32_t acc[DOWNSCALE_ACC_SIZE];
+    const unsigned chunkPixels = static_cast<unsigned>(DOWNSCALE_ACC_SIZE / (static_cast<size_t>(factor) * 3));
+    const float norm = 1.0f / static_cast<float>(factor * factor);
+    for (unsigned y = 0; y < dstHeight; ++y) {
+        unsigned char* d = dst + y * dstStride;
+        for (unsigned x0 = 0; x0 < dstWidth; x0 += chunkPixels) {
+            const unsigned pixels = (dstWidth - x0 < chunkPixels) ? dstWidth - x0 : chunkPixels;
+            const size_t accTotal = static_cast<size_t>(pixels) * factor * 3;
+
+            // vertical sum : contiguous, vectorized
+            for (size_t i = 0; i < accTotal; ++i) acc[i] = 0;
+            for (unsigned sy = 0; sy < factor; ++sy) {
+                const unsigned char* s =
+                    src + (static_cast<size_t>(y) * factor + sy) * srcStride + static_cast<size_t>(x0) * factor * 3;
+                for (size_t i = 0; i < accTotal; ++i) acc[i] += s[i];
+            }
+
+            // horizontal sum
+            for (unsigned x = 0; x < pixels; ++x) {
+                const uint32_t* a = &acc[static_cast<size_t>(x) * factor * 3];
+                uint32_t sum[3] = {0, 0, 0};
+                for (unsigned sx = 0; sx < factor; ++sx) {
+                    sum[0] += a[sx * 3];
+                    sum[1] += a[sx * 3 + 1];
+                    sum[2] += a[sx * 3 + 2];
+                }
+                unsigned char* p = d + static_cast<size_t>(x0 + x) * 3;
+                p[0] = static_cast<unsigned char>(static_cast<float>(sum[0]) * norm + 0.5f);
+                p[1] = static_cast<unsigned char>(static_cast<float>(sum[1]) * norm + 0.5f);
+                p[2] = static_cast<unsigned char>(static_cast<float>(sum[2]) * norm + 0.5f);
+            }
+        }
+    }
+}
+
+void
+packChannels(const float* src, unsigned srcChan, float* dst, unsigned dstChan, size_t pixTotal, float fill)
+{
+    if (srcChan == 3 && dstChan == 4) {
+        for (size_t i = 0; i < pixTotal; ++i) {
+            dst[i * 4    ] = src[i * 3    ];
+            dst[i * 4 + 1] = src[i * 3 + 1];
+            dst[i * 4 + 2] = src[i * 3 + 2];
+            dst[i * 4 + 3] = fill;
+        }
+        return;
+    }
+    for (size_t i = 0; i < pixTotal; ++i) {
+        for (unsigned c = 0; c < dstChan; ++c) {
+            dst[i * dstChan + c] = (c < srcChan) ? src[i * srcChan + c] : fill;
+        }
+    }
+}
+
+void
+sumSqError(const float* live, const float* ref, size_t pixTotal, float relEpsilon, double& sqErr, double& relSqErr)
+{
+    sqErr = 0.0;
+    relSqErr = 0.0;
+    for (size_t blockStart = 0; blockStart < pixTotal; blockStart += ERROR_BLOCK_PIXELS) {
+        const size_t blockEnd = (blockStart + ERROR_BLOCK_PIXELS < pixTotal) ? blockStart + ERROR_BLOCK_PIXELS : pixTotal;
+        float laneSqErr[ERROR_LANES] = {};
+        float laneRelSqErr[ERROR_LANES] = {};
+        size_t pix = blockStart;
+        for (; pix + ERROR_LANES <= blockEnd; pix += ERROR_LANES) {
+            for (unsigned lane = 0; lane < ERROR_LANES; ++lane) {
+                const size_t i = (pix + lane) * 4;
+                for (unsigned c = 0; c < 3; ++c) {
+                    const float r = ref[i + c];
+                    const float d = live[i + c] - r;
+                    laneSqErr[lane] += d * d;
+                    laneRelSqErr[lane] += d * d / (r * r + relEpsilon);
+                }
+            }
+        }
+        for (; pix < blockEnd; ++pix) {
+            for (unsigned c = 0; c < 3; ++c) {
+                const float r = ref[pix * 4 + c];
+                const float d = live[pix * 4 + c] - r;
+                laneSqErr[0] += d * d;
+                laneRelSqErr[0] += d * d / (r * r + relEpsilon);
+            }
+        }
+        for (unsigned lane = 0; lane < ERROR_LANES; ++lane) {
+            sqErr += laneSqErr[lane];
+            relSqErr += laneRelSqErr[lane];
+        }
+    }
+}
+
+void
+absDiffRgb888(const unsigned char* a, const unsigned char* b, size_t byteTotal, int gain, unsigned char* dst)
+{
+    for (size_t i = 0; i < byteTotal; ++i) {
+        const int d = (a[i] > b[i]) ? a[i] - b[i] : b[i] - a[i];
+        const int v = d * gain;
+        dst[i] = static_cast<unsigned char>((v < 255) ? v : 255);
+    }
+}
+
+} // anon namespace
+
+namespace arras_render {
+
+const PixelKernels&
+PIXEL_KERNELS_GETTER()
+{
+    static const PixelKernels kernels = {
+        PIXEL_KERNELS_NAME,
+        quantizeRgb888,
+        quantizeRgba888,
+        downscaleRgb888,
+        packChannels,
+        sumSqError,
+        absDiffRgb888
+    };
+    return kernels;
+}
+
+} // namespace arras_render
@@ -0,0 +1,508 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#include "PoseCache.h"
+#include "JpegPipeline.h"
+#include "ThreadRole.h"
+#include "Trace.h"
+
+#include <scene_rdl2/render/util/StrUtil.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+
+#include <unistd.h> // getpid
+
+namespace {
+
+constexpr size_t MAX_QUEUE = 2;
+constexpr size_t MAX_INSTANCE_KEY = 64; // recent renders which can still deliver frames
+constexpr uint64_t FNV_OFFSET = 0xcbf29ce484222325ULL;
+constexpr uint64_t FNV_PRIME = 0x100000001b3ULL;
+
+uint64_t
+fnv1a(const void* data, const size_t size, uint64_t hash)
+{
+    const unsigned char* ptr = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= ptr[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+bool
+readFile(const std::string& filename, std::vector<unsigned char>& data)
+{
+    std::ifstream fin(filename, std::ios::binary);
+    if (!fin) return false;
+    data.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+    return !data.empty();
+}
+
+bool
+writeFile(const std::string& filename, const std::vector<unsigned char>& data)
+{
+    std::ofstream fout(filename, std::ios::binary | std::ios::trunc);
+    if (!fout) return false;
+    fout.write(reinterpret_cast<const char*>(data.data()), data.size());
+    return static_cast<bool>(fout);
+}
+
+} // anon namespace
+
+namespace arras_render {
+
+PoseCache::PoseCache(const Config& config)
+    : mConfig(config)
+{
+    mThread = std::thread(threadMain, this);
+    parserConfigure();
+}
+
+PoseCache::~PoseCache()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mShutdown = true;
+    }
+    mCvJob.notify_all();
+    if (mThread.joinable()) mThread.join();
+
+    clear(); // spilled files are only meaningful for this process
+}
+
+// static function
+uint64_t
+PoseCache::hashBytes(const std::string& data, const uint64_t seed)
+{
+    return fnv1a(data.data(), data.size(), seed ^ FNV_OFFSET);
+}
+
+// static function
+uint64_t
+PoseCache::makeKey(const Mat4d& camMtx, const uint64_t sceneHash)
+{
+    // compared at float precision, the matrix goes through float by FreeCam and CamPlayback
+    const double src[16] = {camMtx.vx.x, camMtx.vx.y, camMtx.vx.z, camMtx.vx.w,
+                            camMtx.vy.x, camMtx.vy.y, camMtx.vy.z, camMtx.vy.w,
+                            camMtx.vz.x, camMtx.vz.y, camMtx.vz.z, camMtx.vz.w,
+                            camMtx.vw.x, camMtx.vw.y, camMtx.vw.z, camMtx.vw.w};
+    float mtx[16];
+    for (int i = 0; i < 16; ++i) {
+        mtx[i] = static_cast<float>(src[i]);
+        if (mtx[i] == 0.0f) mtx[i] = 0.0f; // -0.0 and 0.0 are the same pose
+    }
+    uint64_t hash = fnv1a(mtx, sizeof(mtx), FNV_OFFSET);
+    return fnv1a(&sceneHash, sizeof(sceneHash), hash);
+}
+
+void
+PoseCache::bindInstance(const int instance, const uint64_t key)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mInstanceKey.emplace_back(instance, key);
+    while (mInstanceKey.size() > MAX_INSTANCE_KEY) mInstanceKey.pop_front();
+}
+
+void
+PoseCache::setDecodeCallBack(const DecodeCallBack& callBack)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mDecodeCallBack = callBack;
+}
+
+bool
+PoseCache::lookup(const uint64_t key,
+                  std::vector<unsigned char>& rgb888,
+                  unsigned& width,
+                  unsigned& height,
+                  float& progress)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mLookupTotal++;
+        auto itr = mEntry.find(key);
+        if (itr == mEntry.end()) return false;
+        Entry& entry = itr->second;
+        entry.mLastUse = ++mUseCount;
+        if (!entry.mRgb.empty()) {
+            rgb888 = entry.mRgb;
+            width = entry.mWidth;
+            height = entry.mHeight;
+            progress = entry.mProgress;
+            mDecodedHitTotal++;
+            return true;
+        }
+
+        if (!entry.mJpeg.empty()) {
+            mMemHitTotal++;
+        } else if (entry.mDiskSize > 0) {
+            mDiskHitTotal++;
+        } else {
+            return false; // being spilled
+        }
+        mDecodeKey = key; // replaces the older request, only the current pose is worth decoding
+        mDecodePending = true;
+    }
+    mCvJob.notify_one();
+    return false;
+}
+
+bool
+PoseCache::isDue(const int instance, const float progress) const
+{
+    if (progress < mConfig.mMinProgress) return false;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    uint64_t key;
+    if (!findKeyMain(instance, key)) return false; // not a render started by ImageView
+
+    float best = -1.0f;
+    auto itr = mEntry.find(key);
+    if (itr != mEntry.end()) best = itr->second.mProgress;
+    auto queued = mQueuedProgress.find(key);
+    if (queued != mQueuedProgress.end()) best = std::max(best, queued->second);
+
+    if (best < 0.0f) return true;
+    if (progress >= 1.0f) return best < 1.0f;
+    return progress >= best + mConfig.mStepProgress;
+}
+
+void
+PoseCache::push(const int instance,
+                const float progress,
+                const std::vector<unsigned char>& rgb888,
+                const unsigned width,
+                const unsigned height)
+{
+    const size_t size = static_cast<size_t>(width) * height * 3;
+    if (rgb888.size() < size) return;
+
+    TraceSpan span("poseCachePush", size);
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        uint64_t key;
+        if (!findKeyMain(instance, key)) return;
+        if (progress < 1.0f && mQueue.size() >= MAX_QUEUE) return; // retried by the next frame
+
+        mQueuedProgress[key] = progress;
+
+        mQueue.emplace_back();
+        Job& job = mQueue.back();
+        job.mKey = key;
+        job.mProgress = progress;
+        job.mWidth = width;
+        job.mHeight = height;
+        job.mRgb.assign(rgb888.begin(), rgb888.begin() + size);
+    }
+    mCvJob.notify_one();
+}
+
+void
+PoseCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (const auto& itr : mEntry) {
+        if (itr.second.mDiskSize > 0) std::remove(getSpillFilename(itr.first).c_str());
+    }
+    mEntry.clear();
+    mQueuedProgress.clear();
+    mDecodePending = false;
+    mLookupTotal = 0;
+    mDecodedHitTotal = 0;
+    mMemHitTotal = 0;
+    mDiskHitTotal = 0;
+    mStoreTotal = 0;
+    mSpillTotal = 0;
+    mDropTotal = 0;
+}
+
+std::string
+PoseCache::show() const
+{
+    namespace str_util = scene_rdl2::str_util;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    size_t memEntry = 0, diskEntry = 0, decodedEntry = 0, decodedBytes = 0;
+    for (const auto& itr : mEntry) {
+        if (!itr.second.mJpeg.empty()) memEntry++;
+        if (itr.second.mDiskSize > 0) diskEntry++;
+        if (!itr.second.mRgb.empty()) {
+            decodedEntry++;
+            decodedBytes += itr.second.mRgb.size();
+        }
+    }
+    const uint64_t hitTotal = mDecodedHitTotal + mMemHitTotal + mDiskHitTotal;
+    const float hitRate = mLookupTotal ? static_cast<float>(hitTotal) / static_cast<float>(mLookupTotal) : 0.0f;
+
+    std::ostringstream ostr;
+    ostr << "PoseCache {\n"
+         << "  memory:" << str_util::byteStr(getMemBytesMain()) << " / " << str_util::byteStr(mConfig.mMemBytes)
+         << " (entries:" << memEntry << ")\n"
+         << "  disk:" << str_util::byteStr(getDiskBytesMain()) << " / " << str_util::byteStr(mConfig.mDiskBytes)
+         << " (entries:" << diskEntry << ")\n"
+         << "  decoded:" << str_util::byteStr(decodedBytes) << " (entries:" << decodedEntry << " / "
+         << mConfig.mDecodedEntries << ")\n"
+         << "  spillDir:" << (mConfig.mSpillDir.empty() ? "-" : mConfig.mSpillDir) << '\n'
+         << "  minProgress:" << mConfig.mMinProgress * 100.0f << "%\n"
+         << "  lookup:" << mLookupTotal << '\n'
+         << "  hit:" << hitTotal << " (decoded:" << mDecodedHitTotal
+         << " memory:" << mMemHitTotal << " disk:" << mDiskHitTotal << ")\n"
+         << "  hitRate:" << std::fixed << std::setprecision(1) << hitRate * 100.0f << "%\n"
+         << "  store:" << mStoreTotal << '\n'
+         << "  spill:" << mSpillTotal << '\n'
+         << "  drop:" << mDropTotal << '\n'
+         << "}";
+    return ostr.str();
+}
+
+// static function
+void
+PoseCache::threadMain(PoseCache* cache)
+{
+    ThreadRoleScope threadRole(ThreadRole::POSE_CACHE);
+
+    while (true) {
+        Job job;
+        bool decode = false;
+        uint64_t decodeKey = 0;
+        {
+            std::unique_lock<std::mutex> lock(cache->mMutex);
+            cache->mCvJob.wait(lock, [&] {
+                return cache->mShutdown || cache->mDecodePending || !cache->mQueue.empty();
+            });
+            if (cache->mShutdown) break;
+            if (cache->mDecodePending) { // the user is waiting for it, ahead of the encode
+                decode = true;
+                decodeKey = cache->mDecodeKey;
+                cache->mDecodePending = false;
+            } else {
+                job = std::move(cache->mQueue.front());
+                cache->mQueue.pop_front();
+            }
+        }
+        if (decode) cache->decodeJob(decodeKey);
+        else        cache->processJob(job);
+    }
+}
+
+void
+PoseCache::processJob(Job& job)
+{
+    std::vector<unsigned char> jpeg;
+    std::string error;
+    {
+        TraceSpan span("poseCacheEncode", job.mRgb.size());
+        if (!JpegPipeline::encode(job.mRgb.data(), job.mWidth, job.mHeight, mConfig.mQuality, jpeg, error)) {
+            std::cerr << ">> PoseCache.cc " << error << '\n';
+            return;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto queued = mQueuedProgress.find(job.mKey);
+        if (queued != mQueuedProgress.end() && queued->second <= job.mProgress) mQueuedProgress.erase(queued);
+
+        Entry& entry = mEntry[job.mKey];
+        if (!entry.mJpeg.empty() || entry.mDiskSize > 0) {
+            if (job.mProgress <= entry.mProgress) return; // keeps the best one
+        }
+        if (entry.mDiskSize > 0) {
+            std::remove(getSpillFilename(job.mKey).c_str());
+            entry.mDiskSize = 0;
+        }
+        entry.mJpeg.swap(jpeg);
+        entry.mRgb.swap(job.mRgb); // the latest renders are the most likely to be revisited
+        entry.mWidth = job.mWidth;
+        entry.mHeight = job.mHeight;
+        entry.mProgress = job.mProgress;
+        entry.mLastUse = ++mUseCount;
+        mStoreTotal++;
+        trimDecodedMain();
+    }
+    evict();
+}
+
+void
+PoseCache::decodeJob(const uint64_t key)
+{
+    std::vector<unsigned char> jpeg;
+    bool onDisk = false;
+    float progress = 0.0f;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto itr = mEntry.find(key);
+        if (itr == mEntry.end() || !itr->second.mRgb.empty()) return; // cleared or stored again
+        if (!itr->second.mJpeg.empty()) jpeg = itr->second.mJpeg;
+        else if (itr->second.mDiskSize > 0) onDisk = true;
+        else return; // being spilled
+        progress = itr->second.mProgress;
+    }
+
+    if (onDisk && !readFile(getSpillFilename(key), jpeg)) {
+        std::cerr << ">> PoseCache.cc decodeJob() Can not read file. filename:" << getSpillFilename(key) << '\n';
+        return;
+    }
+
+    std::vector<unsigned char> rgb888;
+    unsigned width = 0, height = 0;
+    {
+        TraceSpan span("poseCacheDecode", jpeg.size());
+        std::string error;
+        if (!JpegPipeline::decode(jpeg, rgb888, width, height, error)) {
+            std::cerr << ">> PoseCache.cc decodeJob() " << error << '\n';
+            return;
+        }
+    }
+
+    DecodeCallBack callBack;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto itr = mEntry.find(key);
+        if (itr == mEntry.end() || itr->second.mProgress != progress) return; // replaced during the decode
+        itr->second.mRgb = rgb888;
+        trimDecodedMain();
+        callBack = mDecodeCallBack;
+    }
+    if (callBack) callBack(key, rgb888, width, height, progress);
+}
+
+void
+PoseCache::trimDecodedMain()
+{
+    while (true) {
+        size_t total = 0;
+        auto lru = mEntry.end();
+        for (auto itr = mEntry.begin(); itr != mEntry.end(); ++itr) {
+            if (itr->second.mRgb.empty()) continue;
+            total++;
+            if (lru == mEntry.end() || itr->second.mLastUse < lru->second.mLastUse) lru = itr;
+        }
+        if (total <= mConfig.mDecodedEntries) break;
+        std::vector<unsigned char>().swap(lru->second.mRgb);
+    }
+}
+
+void
+PoseCache::evict()
+{
+    // memory budget : spill the least recently used entries
+    while (true) {
+        uint64_t key = 0;
+        std::vector<unsigned char> jpeg;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (getMemBytesMain() <= mConfig.mMemBytes) break;
+
+            auto lru = mEntry.end();
+            for (auto itr = mEntry.begin(); itr != mEntry.end(); ++itr) {
+                if (itr->second.mJpeg.empty()) continue;
+                if (lru == mEntry.end() || itr->second.mLastUse < lru->second.mLastUse) lru = itr;
+            }
+            if (lru == mEntry.end()) break;
+
+            key = lru->first;
+            if (mConfig.mSpillDir.empty() || lru->second.mJpeg.size() > mConfig.mDiskBytes) {
+                mEntry.erase(lru);
+                mDropTotal++;
+                continue;
+            }
+            jpeg.swap(lru->second.mJpeg);
+        }
+
+        // file I/O outside of the lock, a lookup during the write is a miss
+        TraceSpan span("poseCacheSpill", jpeg.size());
+        const bool written = writeFile(getSpillFilename(key), jpeg);
+        if (!written) {
+            std::cerr << ">> PoseCache.cc Can not create file. filename:" << getSpillFilename(key) << '\n';
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto itr = mEntry.find(key);
+        if (itr == mEntry.end() || !itr->second.mJpeg.empty() || !written) {
+            // cleared or stored again during the write
+            if (written) std::remove(getSpillFilename(key).c_str());
+            if (!written && itr != mEntry.end() && itr->second.mJpeg.empty()) {
+                mEntry.erase(itr);
+                mDropTotal++;
+            }
+            continue;
+        }
+        itr->second.mDiskSize = jpeg.size();
+        mSpillTotal++;
+    }
+
+    // disk budget : delete the least recently used spilled entries
+    std::lock_guard<std::mutex> lock(mMutex);
+    while (getDiskBytesMain() > mConfig.mDiskBytes) {
+        auto lru = mEntry.end();
+        for (auto itr = mEntry.begin(); itr != mEntry.end(); ++itr) {
+            if (itr->second.mDiskSize == 0) continue;
+            if (lru == mEntry.end() || itr->second.mLastUse < lru->second.mLastUse) lru = itr;
+        }
+        if (lru == mEntry.end()) break;
+        std::remove(getSpillFilename(lru->first).c_str());
+        mEntry.erase(lru);
+        mDropTotal++;
+    }
+}
+
+std::string
+PoseCache::getSpillFilename(const uint64_t key) const
+{
+    std::ostringstream ostr;
+    ostr << mConfig.mSpillDir << "/poseCache_" << getpid() << '_' << std::hex << std::setw(16) << std::setfill('0') << key << ".jpg";
+    return ostr.str();
+}
+
+bool
+PoseCache::findKeyMain(const int instance, uint64_t& key) const
+{
+    for (auto itr = mInstanceKey.rbegin(); itr != mInstanceKey.rend(); ++itr) {
+        if (itr->first == instance) {
+            key = itr->second;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t
+PoseCache::getMemBytesMain() const
+{
+    size_t total = 0;
+    for (const auto& itr : mEntry) total += itr.second.mJpeg.size();
+    return total;
+}
+
+size_t
+PoseCache::getDiskBytesMain() const
+{
+    size_t total = 0;
+    for (const auto& itr : mEntry) total += itr.second.mDiskSize;
+    return total;
+}
+
+void
+PoseCache::parserConfigure()
+{
+    mParser.description("camera pose cache command");
+    mParser.opt("show", "", "show cache usage and hit rate",
+                [&](Arg& arg) -> bool { return arg.msg(show() + '\n'); });
+    mParser.opt("clear", "", "clear all the cached images and statistics",
+                [&](Arg& arg) -> bool {
+                    clear();
+                    return arg.msg("clear\n");
+                });
+}
+
+} // namespace arras_render
@@ -0,0 +1,154 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <scene_rdl2/common/grid_util/Arg.h>
+#include <scene_rdl2/common/grid_util/Parser.h>
+#include <scene_rdl2/common/math/Mat4.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace arras_render {
+
+class PoseCache
+//
+// Client side cache of the best received beauty image for each camera pose. The key is the camera
+// matrix (compared at float precision, playback and bookmarks reproduce the exact same matrix) combined
+// with a hash of all the non-camera scene deltas sent so far, so any other scene edit makes the
+// previous poses unreachable. When a pose is revisited, the cached image is displayed until the fresh
+// render streams in with more progress.
+// Images are kept as JPEG. The least recently used entries are spilled to the spill directory when the
+// memory budget is exceeded and deleted when the disk budget is exceeded (or dropped if no spill
+// directory is given). Spill files carry the process id, several clients can share the spill directory.
+// The few most recently used poses are also kept decoded so that a revisit costs a copy. Encoding and
+// decoding run on a worker thread, the caller never waits for the JPEG codec or the disk. All APIs are
+// MT-safe.
+//
+{
+public:
+    using Arg = scene_rdl2::grid_util::Arg;
+    using Parser = scene_rdl2::grid_util::Parser;
+    using Mat4d = scene_rdl2::math::Mat4d;
+    using DecodeCallBack = std::function<void(const uint64_t key,
+                                              std::vector<unsigned char>& rgb888,
+                                              const unsigned width,
+                                              const unsigned height,
+                                              const float progress)>;
+
+    struct Config {
+        size_t mMemBytes {64 * 1024 * 1024};
+        size_t mDiskBytes {1024 * 1024 * 1024};
+        std::string mSpillDir; // empty : no spill, evicted entries are dropped
+        float mMinProgress {0.25f}; // progress 0.0 ~ 1.0 at which a render is worth caching
+        float mStepProgress {0.1f}; // cached image is updated when the progress improves this much
+        unsigned mQuality {95};
+        unsigned mDecodedEntries {4}; // most recently used poses kept decoded
+    };
+
+    explicit PoseCache(const Config& config);
+    ~PoseCache();
+
+    static uint64_t hashBytes(const std::string& data, const uint64_t seed);
+    static uint64_t makeKey(const Mat4d& camMtx, const uint64_t sceneHash);
+
+    // the render instance (syncId) renders the pose of the key
+    void bindInstance(const int instance, const uint64_t key);
+
+    // called by the worker thread (without any lock held) when the image requested by lookup() is decoded
+    void setDecodeCallBack(const DecodeCallBack& callBack);
+
+    // Decoded image of the pose, updates the hit statistics. progress : 0.0 ~ 1.0
+    // Returns false for a pose which is only kept as JPEG, its decode is queued to the worker thread and
+    // the result is delivered by the decode callback.
+    bool lookup(const uint64_t key,
+                std::vector<unsigned char>& rgb888,
+                unsigned& width,
+                unsigned& height,
+                float& progress);
+
+    // Cheap check done before copying the RGB buffer. progress : 0.0 ~ 1.0
+    bool isDue(const int instance, const float progress) const;
+    // rgb888 : top to bottom scanline
+    void push(const int instance,
+              const float progress,
+              const std::vector<unsigned char>& rgb888,
+              const unsigned width,
+              const unsigned height);
+
+    void clear();
+
+    std::string show() const;
+
+    Parser& getParser() { return mParser; }
+
+private:
+    struct Entry {
+        std::vector<unsigned char> mJpeg; // empty if spilled
+        std::vector<unsigned char> mRgb;  // decoded, empty unless one of the recently used poses
+        size_t mDiskSize {0};             // 0 if not spilled
+        unsigned mWidth {0};
+        unsigned mHeight {0};
+        float mProgress {0.0f};
+        uint64_t mLastUse {0};
+    };
+
+    struct Job {
+        uint64_t mKey {0};
+        float mProgress {0.0f};
+        unsigned mWidth {0};
+        unsigned mHeight {0};
+        std::vector<unsigned char> mRgb;
+    };
+
+    static void threadMain(PoseCache* cache);
+
+    void processJob(Job& job);
+    void decodeJob(const uint64_t key);
+    void trimDecodedMain(); // mMutex locked by the caller
+    void evict(); // worker thread only
+    std::string getSpillFilename(const uint64_t key) const;
+    bool findKeyMain(const int instance, uint64_t& key) const; // mMutex locked by the caller
+    size_t getMemBytesMain() const; // mMutex locked by the caller
+    size_t getDiskBytesMain() const; // mMutex locked by the caller
+
+    void parserConfigure();
+
+    const Config mConfig;
+
+    mutable std::mutex mMutex;
+    std::map<uint64_t, Entry> mEntry; // key is pose key
+    std::deque<std::pair<int, uint64_t>> mInstanceKey; // (instance, pose key) of the recent renders
+    std::map<uint64_t, float> mQueuedProgress; // best progress queued for encoding by pose key
+    uint64_t mUseCount {0};
+
+    // statistics
+    uint64_t mLookupTotal {0};
+    uint64_t mDecodedHitTotal {0};
+    uint64_t mMemHitTotal {0};
+    uint64_t mDiskHitTotal {0};
+    uint64_t mStoreTotal {0};
+    uint64_t mSpillTotal {0};
+    uint64_t mDropTotal {0};
+
+    // encode and decode worker
+    std::condition_variable mCvJob;
+    std::deque<Job> mQueue;
+    bool mDecodePending {false}; // only the last requested pose is decoded
+    uint64_t mDecodeKey {0};
+    DecodeCallBack mDecodeCallBack;
+    bool mShutdown {false};
+    std::thread mThread;
+
+    Parser mParser;
+};
+
+} // namespace arras_render
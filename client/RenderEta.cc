@@ -0,0 +1,239 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#include "RenderEta.h"
+
+#include <scene_rdl2/render/util/StrUtil.h>
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace {
+
+const float PREDICTION_POINT[] = {0.10f, 0.25f, 0.50f, 0.75f};
+constexpr size_t PREDICTION_POINT_TOTAL = sizeof(PREDICTION_POINT) / sizeof(PREDICTION_POINT[0]);
+constexpr size_t MIN_SAMPLES = 3;
+constexpr float PROGRESS_DROP_EPS = 1.0e-4f;
+
+} // anon namespace
+
+namespace arras_render {
+
+RenderEta::RenderEta(const size_t windowSize)
+    : mWindowSize(std::max(windowSize, MIN_SAMPLES))
+{
+    parserConfigure();
+}
+
+void
+RenderEta::reset()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    resetMain();
+}
+
+void
+RenderEta::update(const float progress)
+{
+    update(progress, Clock::now());
+}
+
+void
+RenderEta::update(const float progress, const Clock::time_point& time)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (progress < 0.0f) return; // no image data yet
+
+    if (mStarted && progress < mLastProgress - PROGRESS_DROP_EPS) {
+        resetMain(); // frames of a new render
+    }
+    if (!mStarted) {
+        mStarted = true;
+        mOrigin = time;
+    }
+    mLastProgress = progress;
+
+    const float sec = std::chrono::duration<float>(time - mOrigin).count();
+    mSamples.emplace_back(sec, progress);
+    while (mSamples.size() > mWindowSize) mSamples.pop_front();
+
+    if (progress >= 1.0f) {
+        if (mActualSec < 0.0f) mActualSec = sec;
+        return;
+    }
+
+    while (mNextPrediction < PREDICTION_POINT_TOTAL && progress >= PREDICTION_POINT[mNextPrediction]) {
+        const Estimate est = estimate();
+        if (est.mValid) {
+            Prediction prediction;
+            prediction.mProgress = PREDICTION_POINT[mNextPrediction];
+            prediction.mElapsedSec = sec;
+            prediction.mTotalSec = sec + est.mRemainSec;
+            prediction.mTotalLowSec = sec + est.mRemainLowSec;
+            prediction.mTotalHighSec = (est.mRemainHighSec < 0.0f) ? -1.0f : sec + est.mRemainHighSec;
+            mPrediction.push_back(prediction);
+        }
+        ++mNextPrediction;
+    }
+}
+
+RenderEta::Estimate
+RenderEta::getEstimate() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return estimate();
+}
+
+bool
+RenderEta::isFinished() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mActualSec >= 0.0f;
+}
+
+std::string
+RenderEta::show() const
+{
+    namespace str_util = scene_rdl2::str_util;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    const Estimate est = estimate();
+
+    std::ostringstream ostr;
+    ostr << "RenderEta {\n"
+         << "  windowSize:" << mWindowSize << '\n'
+         << "  samples:" << mSamples.size() << '\n'
+         << "  progress:" << mLastProgress * 100.0f << "%\n"
+         << "  eta:" << (est.mValid ? showEtaMain(est) : "-") << '\n';
+    if (mActualSec >= 0.0f) ostr << "  actual:" << str_util::secStr(mActualSec) << '\n';
+    ostr << "  predictions {\n";
+    for (const auto& itr : mPrediction) {
+        ostr << "    " << itr.mProgress * 100.0f << "% at " << str_util::secStr(itr.mElapsedSec)
+             << " total:" << str_util::secStr(itr.mTotalSec)
+             << " (" << str_util::secStr(itr.mTotalLowSec) << " ~ "
+             << (itr.mTotalHighSec < 0.0f ? "?" : str_util::secStr(itr.mTotalHighSec)) << ")\n";
+    }
+    ostr << "  }\n"
+         << "}";
+    return ostr.str();
+}
+
+std::string
+RenderEta::showEta() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    const Estimate est = estimate();
+    return est.mValid ? showEtaMain(est) : std::string();
+}
+
+std::string
+RenderEta::showOverlay() const
+{
+    const std::string eta = showEta();
+    return eta.empty() ? eta : "ETA " + eta;
+}
+
+Json::Value
+RenderEta::toJson() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    Json::Value root;
+    root["actualSec"] = mActualSec;
+    root["predictions"] = Json::Value(Json::arrayValue);
+    for (const auto& itr : mPrediction) {
+        Json::Value item;
+        item["progress"] = itr.mProgress;
+        item["elapsedSec"] = itr.mElapsedSec;
+        item["totalSec"] = itr.mTotalSec;
+        item["totalLowSec"] = itr.mTotalLowSec;
+        item["totalHighSec"] = itr.mTotalHighSec;
+        if (mActualSec >= 0.0f) item["errorSec"] = itr.mTotalSec - mActualSec;
+        root["predictions"].append(item);
+    }
+    return root;
+}
+
+void
+RenderEta::resetMain()
+{
+    mStarted = false;
+    mLastProgress = 0.0f;
+    mSamples.clear();
+    mNextPrediction = 0;
+    mPrediction.clear();
+    mActualSec = -1.0f;
+}
+
+RenderEta::Estimate
+RenderEta::estimate() const
+//
+// least squares fit of progress = a + b * sec over the sample window
+//
+{
+    Estimate est;
+    const size_t n = mSamples.size();
+    if (n < MIN_SAMPLES || mActualSec >= 0.0f) return est;
+
+    double meanT = 0.0, meanP = 0.0;
+    for (const auto& itr : mSamples) {
+        meanT += itr.first;
+        meanP += itr.second;
+    }
+    meanT /= n;
+    meanP /= n;
+
+    double sxx = 0.0, sxy = 0.0;
+    for (const auto& itr : mSamples) {
+        sxx += (itr.first - meanT) * (itr.first - meanT);
+        sxy += (itr.first - meanT) * (itr.second - meanP);
+    }
+    if (sxx <= 0.0) return est;
+
+    const double b = sxy / sxx;
+    if (b <= 0.0) return est; // no progress in the window
+    const double a = meanP - b * meanT;
+
+    double sse = 0.0;
+    for (const auto& itr : mSamples) {
+        const double r = itr.second - (a + b * itr.first);
+        sse += r * r;
+    }
+    const double se = std::sqrt(sse / static_cast<double>(n - 2) / sxx);
+
+    const double lastSec = mSamples.back().first;
+    // the line of each slope pivots at the centroid (meanT, meanP), the band stays around the estimate
+    auto remain = [&](const double slope) { return std::max(meanT + (1.0 - meanP) / slope - lastSec, 0.0); };
+
+    est.mValid = true;
+    est.mElapsedSec = static_cast<float>(lastSec);
+    est.mRate = static_cast<float>(b);
+    est.mRemainSec = static_cast<float>(remain(b));
+    est.mRemainLowSec = static_cast<float>(remain(b + 2.0 * se));
+    est.mRemainHighSec = (b - 2.0 * se > 0.0) ? static_cast<float>(remain(b - 2.0 * se)) : -1.0f;
+    return est;
+}
+
+// static function
+std::string
+RenderEta::showEtaMain(const Estimate& est)
+{
+    namespace str_util = scene_rdl2::str_util;
+
+    std::ostringstream ostr;
+    ostr << str_util::secStr(est.mRemainSec)
+         << " (" << str_util::secStr(est.mRemainLowSec) << " ~ "
+         << (est.mRemainHighSec < 0.0f ? "?" : str_util::secStr(est.mRemainHighSec)) << ")";
+    return ostr.str();
+}
+
+void
+RenderEta::parserConfigure()
+{
+    mParser.description("render completion ETA command");
+    mParser.opt("show", "", "show ETA estimator status",
+                [&](Arg& arg) -> bool { return arg.msg(show() + '\n'); });
+}
+
+} // namespace arras_render
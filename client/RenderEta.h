@@ -0,0 +1,89 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <scene_rdl2/common/grid_util/Arg.h>
+#include <scene_rdl2/common/grid_util/Parser.h>
+
+#include <json/json.h>
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace arras_render {
+
+class RenderEta
+//
+// Estimates the completion time of the current render from the progress of the incoming
+// ProgressiveFrames. A line is fitted by least squares to the most recent progress-vs-time samples
+// and the finish time is where it reaches 100%. The band comes from the standard error of the
+// slope (about 95%, +-2 sigma). A new render is detected by a STARTED frame (reset()) or by the
+// progress going backwards. The prediction at 10/25/50/75% progress is kept with the actual finish
+// time so the accuracy can be reported by the benchmark. All APIs are MT-safe.
+//
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using Arg = scene_rdl2::grid_util::Arg;
+    using Parser = scene_rdl2::grid_util::Parser;
+
+    struct Estimate {
+        bool mValid {false};
+        float mElapsedSec {0.0f};  // since the first frame of the render
+        float mRemainSec {0.0f};   // from the last frame
+        float mRemainLowSec {0.0f};
+        float mRemainHighSec {-1.0f}; // negative : unbounded
+        float mRate {0.0f};        // progress fraction per sec
+    };
+
+    explicit RenderEta(const size_t windowSize = 32);
+
+    void reset();
+    void update(const float progress); // progress : 0.0 ~ 1.0
+    void update(const float progress, const Clock::time_point& time);
+
+    Estimate getEstimate() const;
+    bool isFinished() const;
+
+    std::string show() const;
+    std::string showEta() const;     // single line, empty if no estimate yet
+    std::string showOverlay() const; // single line for the overlay text
+    Json::Value toJson() const;      // predictions and the actual finish time of the last render
+
+    Parser& getParser() { return mParser; }
+
+private:
+    struct Prediction {
+        float mProgress {0.0f};
+        float mElapsedSec {0.0f};
+        float mTotalSec {0.0f};     // predicted finish time since the first frame
+        float mTotalLowSec {0.0f};
+        float mTotalHighSec {-1.0f};
+    };
+
+    void resetMain();
+    Estimate estimate() const; // mMutex locked by the caller
+    static std::string showEtaMain(const Estimate& est);
+    void parserConfigure();
+
+    const size_t mWindowSize;
+
+    mutable std::mutex mMutex;
+    bool mStarted {false};
+    Clock::time_point mOrigin;
+    float mLastProgress {0.0f};
+    std::deque<std::pair<float, float>> mSamples; // (sec since mOrigin, progress)
+
+    size_t mNextPrediction {0};
+    std::vector<Prediction> mPrediction;
+    float mActualSec {-1.0f}; // negative : not finished
+
+    Parser mParser;
+};
+
+} // namespace arras_render
@@ -0,0 +1,73 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <client/api/SessionDefinition.h>
+#include <client/api/SessionOptions.h>
+#include <message_api/Message.h>
+
+#include <exception>
+#include <functional>
+#include <string>
+
+namespace arras_render {
+
+class RenderSession
+//
+// The part of the arras4 SDK interface which arras_render uses to talk to the render engine.
+//   SdkSession  : arras4::sdk::SDK, coordinator and pool (default)
+//   MockSession : in-process synthetic render engine for cluster-free testing (--mock)
+// Messages are delivered to the message handler on the session's own thread in both cases.
+// OutboundSession wraps either of them and sends the messages by class priority from its own thread.
+//
+{
+public:
+    using MessageHandler = std::function<void(const arras4::api::Message&)>;
+    using StatusHandler = std::function<void(const std::string&)>;
+    using ExceptionCallback = std::function<void(const std::exception&)>;
+
+    // outbound message class in the send priority order, AUTO : classified by the message type
+    enum class SendClass : int {
+        CONTROL = 0, // render control, OutputRates, pick and console messages
+        CREDIT,      // CreditUpdate
+        CAMERA,      // camera only RDLMessage delta
+        BULK,        // scene RDLMessage
+        AUTO
+    };
+
+    virtual ~RenderSession() = default;
+
+    virtual void setAsyncSend() = 0;
+    virtual void setMessageHandler(const MessageHandler& handler) = 0;
+    virtual void setStatusHandler(const StatusHandler& handler) = 0;
+    virtual void setExceptionCallback(const ExceptionCallback& callback) = 0;
+    virtual void setProgressChannel(const std::string& channel) = 0;
+
+    virtual std::string requestArrasUrl(const std::string& datacenter, const std::string& environment) = 0;
+    virtual bool resolveRez(arras4::client::SessionDefinition& def, std::string& error) = 0;
+    // returns the session id, empty on failure
+    virtual std::string createSession(arras4::client::SessionDefinition& def,
+                                      const std::string& url,
+                                      const arras4::client::SessionOptions& options) = 0;
+    virtual bool waitForEngineReady(const unsigned timeoutSec) = 0;
+    virtual bool isEngineReady() = 0;
+    virtual bool isConnected() = 0;
+    virtual void disconnect() = 0;
+    virtual std::string sessionId() = 0;
+
+    virtual void sendMessage(const arras4::api::MessageContentConstPtr& content) = 0;
+    // sendClass is only used by OutboundSession, the other sessions send in the call order
+    virtual void sendMessage(const arras4::api::MessageContentConstPtr& content, const SendClass /*sendClass*/)
+    {
+        sendMessage(content);
+    }
+
+    // progress report to the progress channel
+    virtual void progress(const std::string& stage) = 0;
+    virtual void progress(const std::string& stage, const float percentage) = 0;
+    virtual void progress(const std::string& stage, const std::string& status) = 0;
+    virtual void progressInfo(const std::string& key, const std::string& value) = 0;
+};
+
+} // namespace arras_render
@@ -0,0 +1,344 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#include "ScenarioBench.h"
+#include "outputRate.h"
+#include "Trace.h"
+
+#include <scene_rdl2/common/math/Color.h>
+#include <scene_rdl2/common/math/Mat4.h>
+#include <scene_rdl2/render/util/StrUtil.h>
+#include <scene_rdl2/scene/rdl2/BinaryWriter.h>
+#include <scene_rdl2/scene/rdl2/Camera.h>
+#include <scene_rdl2/scene/rdl2/Light.h>
+#include <scene_rdl2/scene/rdl2/Types.h>
+
+#include <mcrt_messages/RDLMessage.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include <unistd.h> // usleep
+
+namespace {
+
+constexpr unsigned ORBIT_STEPS = 12;       // 30 degree each
+constexpr unsigned LIGHT_COLOR_STEPS = 8;
+constexpr unsigned ROI_STEPS = 4;          // on, off, on, off
+constexpr float AOV_SETTLE_SEC = 0.5f;     // wait before the next AOV switch
+
+const std::vector<std::string> SCENARIO_NAMES = {"orbit", "lightColor", "aov", "roi"};
+
+scene_rdl2::math::Color
+hueToColor(const float hue) // hue : 0.0 ~ 1.0, full saturation and value
+{
+    const float h = hue * 6.0f;
+    const float x = 1.0f - std::abs(std::fmod(h, 2.0f) - 1.0f);
+    switch (static_cast<int>(h) % 6) {
+    case 0 : return scene_rdl2::math::Color(1.0f, x, 0.0f);
+    case 1 : return scene_rdl2::math::Color(x, 1.0f, 0.0f);
+    case 2 : return scene_rdl2::math::Color(0.0f, 1.0f, x);
+    case 3 : return scene_rdl2::math::Color(0.0f, x, 1.0f);
+    case 4 : return scene_rdl2::math::Color(x, 0.0f, 1.0f);
+    default : return scene_rdl2::math::Color(1.0f, 0.0f, x);
+    }
+}
+
+} // anon namespace
+
+namespace arras_render {
+
+ScenarioBench::ScenarioBench(RenderSession& sdk,
+                             scene_rdl2::rdl2::SceneContext& sceneCtx,
+                             mcrt_dataio::ClientReceiverFb& fbReceiver,
+                             EditLatency& editLatency,
+                             const unsigned aovInterval,
+                             const uint32_t nextSyncId)
+    : mSdk(sdk)
+    , mSceneCtx(sceneCtx)
+    , mFbReceiver(fbReceiver)
+    , mEditLatency(editLatency)
+    , mAovInterval(aovInterval)
+    , mNextSyncId(nextSyncId)
+{
+}
+
+// static function
+const std::vector<std::string>&
+ScenarioBench::getScenarioNames()
+{
+    return SCENARIO_NAMES;
+}
+
+// static function
+bool
+ScenarioBench::isScenario(const std::string& name)
+{
+    return (name == "all" ||
+            std::find(SCENARIO_NAMES.begin(), SCENARIO_NAMES.end(), name) != SCENARIO_NAMES.end());
+}
+
+bool
+ScenarioBench::run(const std::vector<std::string>& names)
+{
+    std::vector<std::string> list;
+    for (const auto& name : names) {
+        if (!isScenario(name)) {
+            std::cerr << "Unknown scenario:" << name << '\n';
+            return false;
+        }
+        if (name == "all") {
+            list.insert(list.end(), SCENARIO_NAMES.begin(), SCENARIO_NAMES.end());
+        } else {
+            list.push_back(name);
+        }
+    }
+
+    for (const auto& name : list) {
+        if (name == "orbit") runOrbit();
+        else if (name == "lightColor") runLightColor();
+        else if (name == "aov") runAov();
+        else if (name == "roi") runRoi();
+    }
+    return true;
+}
+
+std::string
+ScenarioBench::showResult() const
+{
+    namespace str_util = scene_rdl2::str_util;
+
+    auto showHist = [](const LatencyHistogram& hist) -> std::string {
+        if (!hist.size()) return "n:0";
+        std::ostringstream ostr;
+        ostr << "n:" << hist.size()
+             << " p50:" << str_util::secStr(hist.getPercentile(50.0f))
+             << " p90:" << str_util::secStr(hist.getPercentile(90.0f))
+             << " p99:" << str_util::secStr(hist.getPercentile(99.0f))
+             << " mean:" << str_util::secStr(hist.getMean())
+             << " max:" << str_util::secStr(hist.getMax());
+        return ostr.str();
+    };
+
+    std::ostringstream ostr;
+    ostr << "ScenarioBench (repeat:" << mRepeat
+         << " targetProgress:" << mTargetProgress * 100.0f << "%) {\n";
+    for (const auto& itr : mResult) {
+        ostr << "  " << itr.mName << " {\n"
+             << "    edit-to-first-pixel " << showHist(itr.mFirstPixel) << '\n'
+             << "    edit-to-" << mTargetProgress * 100.0f << "% " << showHist(itr.mTargetProgress) << '\n'
+             << "    timeout:" << itr.mTimeout << " skipped:" << itr.mSkipped << '\n'
+             << "  }\n";
+    }
+    ostr << "}";
+    return ostr.str();
+}
+
+//------------------------------------------------------------------------------------------
+
+void
+ScenarioBench::runScenario(const std::string& name,
+                           const unsigned stepTotal,
+                           const bool sceneEdit,
+                           const EditFunc& editFunc)
+{
+    mResult.emplace_back();
+    Result& result = mResult.back();
+    result.mName = name;
+
+    std::cout << "BENCHMARK scenario " << name << " start (repeat:" << mRepeat
+              << " step:" << stepTotal << ")" << std::endl;
+
+    for (unsigned repeatId = 0; repeatId < mRepeat; ++repeatId) {
+        for (unsigned stepId = 0; stepId < stepTotal; ++stepId) {
+            if (!mSdk.isConnected()) return;
+
+            uint32_t syncId = 0;
+            if (!editFunc(stepId, syncId)) {
+                result.mSkipped++;
+                continue;
+            }
+
+            float latency = 0.0f;
+            if (!sceneEdit) {
+                float fractionLatency = 0.0f;
+                if (!mEditLatency.waitOutput(mTimeoutSec, latency, fractionLatency)) {
+                    result.mTimeout++;
+                    continue;
+                }
+                result.mFirstPixel.add(latency);
+                if (fractionLatency >= 0.0f) result.mTargetProgress.add(fractionLatency);
+                else result.mTimeout++;
+                continue;
+            }
+
+            if (!mEditLatency.waitMilestone(syncId, EditLatency::Milestone::FIRST_PIXEL, mTimeoutSec, latency)) {
+                result.mTimeout++;
+                continue;
+            }
+            result.mFirstPixel.add(latency);
+
+            if (mEditLatency.waitProgress(syncId, mTargetProgress, mTimeoutSec, latency)) {
+                result.mTargetProgress.add(latency);
+            } else {
+                result.mTimeout++;
+            }
+        }
+    }
+
+    std::cout << "BENCHMARK scenario " << name << " done" << std::endl;
+}
+
+void
+ScenarioBench::runOrbit()
+{
+    using namespace scene_rdl2::math;
+
+    const scene_rdl2::rdl2::Camera* constCam = mSceneCtx.getPrimaryCamera();
+    scene_rdl2::rdl2::Camera* cam =
+        mSceneCtx.getSceneObject(constCam->getName())->asA<scene_rdl2::rdl2::Camera>();
+    const Mat4d orgXform = cam->get(scene_rdl2::rdl2::Node::sNodeXformKey);
+
+    // Orbit around a pivot in front of the camera. The pivot distance is the distance to the
+    // world origin along the view direction, which is a reasonable guess for most of the scenes.
+    const Vec3d camPos(orgXform.vw.x, orgXform.vw.y, orgXform.vw.z);
+    const Vec3d viewDir = -normalize(Vec3d(orgXform.vz.x, orgXform.vz.y, orgXform.vz.z));
+    const double pivotDist = std::max(dot(-camPos, viewDir), 1.0);
+    const Vec3d pivot = camPos + viewDir * pivotDist;
+
+    runScenario("orbit", ORBIT_STEPS, true, [&](const unsigned stepId, uint32_t& syncId) -> bool {
+            const double angle = sTwoPi * static_cast<double>(stepId + 1) / static_cast<double>(ORBIT_STEPS);
+            Mat4d rot;
+            rot.setToRotation(Vec4d(0.0, 1.0, 0.0, 0.0), angle);
+            const Mat4d xform = (orgXform *
+                                 Mat4d::translate(Vec4d(-pivot.x, -pivot.y, -pivot.z, 1.0)) *
+                                 rot *
+                                 Mat4d::translate(Vec4d(pivot.x, pivot.y, pivot.z, 1.0)));
+            cam->beginUpdate();
+            cam->set(scene_rdl2::rdl2::Node::sNodeXformKey, xform);
+            cam->endUpdate();
+            syncId = sendDelta();
+            return true;
+        });
+
+    // restore the original camera for the following scenarios
+    cam->beginUpdate();
+    cam->set(scene_rdl2::rdl2::Node::sNodeXformKey, orgXform);
+    cam->endUpdate();
+    sendDelta();
+}
+
+void
+ScenarioBench::runLightColor()
+{
+    scene_rdl2::rdl2::Light* light = nullptr;
+    for (auto itr = mSceneCtx.beginSceneObject(); itr != mSceneCtx.endSceneObject(); ++itr) {
+        if (itr->second->getType() & scene_rdl2::rdl2::INTERFACE_LIGHT) {
+            scene_rdl2::rdl2::Light* lgt = itr->second->asA<scene_rdl2::rdl2::Light>();
+            if (lgt->get(scene_rdl2::rdl2::Light::sOnKey)) {
+                light = lgt;
+                break;
+            }
+        }
+    }
+    if (!light) {
+        std::cerr << "ScenarioBench lightColor : no active light, skipped\n";
+        return;
+    }
+
+    const scene_rdl2::math::Color orgColor = light->get(scene_rdl2::rdl2::Light::sColorKey);
+
+    runScenario("lightColor", LIGHT_COLOR_STEPS, true, [&](const unsigned stepId, uint32_t& syncId) -> bool {
+            // same scene update as ImageView::handleNewColor()
+            light->beginUpdate();
+            light->set(scene_rdl2::rdl2::Light::sColorKey,
+                       hueToColor(static_cast<float>(stepId) / static_cast<float>(LIGHT_COLOR_STEPS)));
+            light->endUpdate();
+            syncId = sendDelta();
+            return true;
+        });
+
+    light->beginUpdate();
+    light->set(scene_rdl2::rdl2::Light::sColorKey, orgColor);
+    light->endUpdate();
+    sendDelta();
+}
+
+void
+ScenarioBench::runAov()
+{
+    if (mAovInterval == 0) {
+        std::cerr << "ScenarioBench aov : aov-interval is 0, skipped\n";
+        return;
+    }
+
+    const unsigned total = mFbReceiver.getTotalRenderOutput();
+    std::vector<std::string> aovNames;
+    for (unsigned i = 0; i < total; ++i) {
+        aovNames.push_back(mFbReceiver.getRenderOutputName(i));
+    }
+    aovNames.push_back(std::string()); // back to beauty
+
+    // AOV switch does not start a new render and the next received frame may still be sent with the
+    // previous output rates, so we measure the time to the frames which carry the new priority AOV.
+    runScenario("aov", static_cast<unsigned>(aovNames.size()), false,
+                [&](const unsigned stepId, uint32_t&) -> bool {
+                    usleep(static_cast<unsigned>(AOV_SETTLE_SEC * 1000000.0f));
+                    mEditLatency.watchOutput(aovNames[stepId], mTargetProgress);
+                    setOutputRate(mSdk, mAovInterval, 1, aovNames[stepId], 1);
+                    return true;
+                });
+}
+
+void
+ScenarioBench::runRoi()
+{
+    scene_rdl2::rdl2::SceneVariables& sceneVars = mSceneCtx.getSceneVariables();
+    const int width = static_cast<int>(sceneVars.getRezedWidth());
+    const int height = static_cast<int>(sceneVars.getRezedHeight());
+
+    runScenario("roi", ROI_STEPS, true, [&](const unsigned stepId, uint32_t& syncId) -> bool {
+            if (stepId % 2 == 0) {
+                // same update as ImageView::changeROI() : center quarter of the image
+                scene_rdl2::rdl2::SceneVariables::UpdateGuard guard(&sceneVars);
+                std::vector<int> subViewport = {width / 4, height / 4, width * 3 / 4, height * 3 / 4};
+                sceneVars.set(scene_rdl2::rdl2::SceneVariables::sSubViewport, subViewport);
+            } else {
+                sceneVars.disableSubViewport();
+            }
+            syncId = sendDelta();
+            return true;
+        });
+
+    sceneVars.disableSubViewport();
+    sendDelta();
+}
+
+uint32_t
+ScenarioBench::sendDelta()
+{
+    TraceSpan serializeSpan("serializeScene");
+    scene_rdl2::rdl2::BinaryWriter w(mSceneCtx);
+    w.setDeltaEncoding(true);
+
+    mcrt::RDLMessage::Ptr rdlMsg = std::make_shared<mcrt::RDLMessage>();
+    w.toBytes(rdlMsg->mManifest, rdlMsg->mPayload);
+    rdlMsg->mForceReload = false;
+    const size_t msgSize = rdlMsg->mManifest.size() + rdlMsg->mPayload.size();
+    serializeSpan.setSize(msgSize);
+    serializeSpan.end();
+
+    const uint32_t syncId = mNextSyncId++;
+    rdlMsg->mSyncId = static_cast<int>(syncId);
+
+    mSceneCtx.commitAllChanges();
+    mEditLatency.sendRecord(syncId);
+    TraceSpan sendSpan("sendMessage", msgSize, syncId);
+    mSdk.sendMessage(rdlMsg);
+    return syncId;
+}
+
+} // namespace arras_render
@@ -0,0 +1,91 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "EditLatency.h"
+#include "RenderSession.h"
+
+#include <mcrt_dataio/client/receiver/ClientReceiverFb.h>
+#include <scene_rdl2/scene/rdl2/SceneContext.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace arras_render {
+
+class ScenarioBench
+//
+// Headless benchmark of interactive edits. Each built-in scenario issues a sequence of edits the
+// same way the GUI does (RDLMessage delta or OutputRates) and measures edit-to-first-pixel and
+// edit-to-N% latency for each of them by EditLatency. Every scenario is repeated N times.
+//
+//   orbit      : orbit the primary camera around a pivot in front of it
+//   lightColor : sweep the color of the first active light (same update as ImageView::handleNewColor)
+//   aov        : switch the priority AOV by setOutputRate() through all the received render outputs,
+//                measured up to the frames which carry the new priority AOV
+//   roi        : toggle the sub-viewport (ROI) on and off
+//
+{
+public:
+    struct Result {
+        std::string mName;
+        LatencyHistogram mFirstPixel {4096};
+        LatencyHistogram mTargetProgress {4096};
+        unsigned mTimeout {0};
+        unsigned mSkipped {0};
+    };
+
+    ScenarioBench(RenderSession& sdk,
+                  scene_rdl2::rdl2::SceneContext& sceneCtx,
+                  mcrt_dataio::ClientReceiverFb& fbReceiver,
+                  EditLatency& editLatency,
+                  const unsigned aovInterval,
+                  const uint32_t nextSyncId);
+
+    void setRepeat(const unsigned repeat) { mRepeat = repeat; }
+    void setTargetProgress(const float percent) { mTargetProgress = percent / 100.0f; }
+    void setTimeoutSec(const float sec) { mTimeoutSec = sec; }
+
+    static const std::vector<std::string>& getScenarioNames();
+    static bool isScenario(const std::string& name);
+
+    // Run scenarios. "all" runs every built-in scenario. Returns false if some scenario is unknown.
+    bool run(const std::vector<std::string>& names);
+
+    const std::vector<Result>& getResult() const { return mResult; }
+    std::string showResult() const;
+
+private:
+    // Issues one edit. Returns false when the step is skipped. syncId is only used when the
+    // scenario measures a scene edit (sceneEdit = true), otherwise the edit func starts
+    // EditLatency::watchOutput() and the frames which carry the watched render output are measured.
+    using EditFunc = std::function<bool(const unsigned stepId, uint32_t& syncId)>;
+
+    void runScenario(const std::string& name, const unsigned stepTotal, const bool sceneEdit,
+                     const EditFunc& editFunc);
+
+    void runOrbit();
+    void runLightColor();
+    void runAov();
+    void runRoi();
+
+    uint32_t sendDelta(); // sends the current scene delta and returns the syncId used
+
+    RenderSession& mSdk;
+    scene_rdl2::rdl2::SceneContext& mSceneCtx;
+    mcrt_dataio::ClientReceiverFb& mFbReceiver;
+    EditLatency& mEditLatency;
+    const unsigned mAovInterval;
+    uint32_t mNextSyncId;
+
+    unsigned mRepeat {5};
+    float mTargetProgress {0.1f}; // fraction
+    float mTimeoutSec {60.0f};
+
+    std::vector<Result> mResult;
+};
+
+} // namespace arras_render
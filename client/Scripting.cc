@@ -4,6 +4,7 @@
 #include "ImageView.h"
 #include "NotifiedValue.h"
 #include "Scripting.h"
+#include "ThreadRole.h"
 
 #include <atomic>
 #include <cerrno>
@@ -144,6 +145,7 @@ get_file_contents(const std::string& filename)
 void
 Scripting::runScriptThread()
 {
+    ThreadRoleScope threadRole(ThreadRole::SCRIPT);
 
     scriptRunning = true;
 
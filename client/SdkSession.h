@@ -0,0 +1,56 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "RenderSession.h"
+
+#include <sdk/sdk.h>
+
+namespace arras_render {
+
+class SdkSession : public RenderSession
+//
+// RenderSession on top of arras4::sdk::SDK. Every call is forwarded as is.
+//
+{
+public:
+    void setAsyncSend() override { mSdk.setAsyncSend(); }
+    void setMessageHandler(const MessageHandler& handler) override { mSdk.setMessageHandler(handler); }
+    void setStatusHandler(const StatusHandler& handler) override { mSdk.setStatusHandler(handler); }
+    void setExceptionCallback(const ExceptionCallback& callback) override { mSdk.setExceptionCallback(callback); }
+    void setProgressChannel(const std::string& channel) override { mSdk.setProgressChannel(channel); }
+
+    std::string requestArrasUrl(const std::string& datacenter, const std::string& environment) override
+    {
+        return mSdk.requestArrasUrl(datacenter, environment);
+    }
+    bool resolveRez(arras4::client::SessionDefinition& def, std::string& error) override
+    {
+        return mSdk.resolveRez(def, error);
+    }
+    std::string createSession(arras4::client::SessionDefinition& def,
+                              const std::string& url,
+                              const arras4::client::SessionOptions& options) override
+    {
+        return mSdk.createSession(def, url, options);
+    }
+    bool waitForEngineReady(const unsigned timeoutSec) override { return mSdk.waitForEngineReady(timeoutSec); }
+    bool isEngineReady() override { return mSdk.isEngineReady(); }
+    bool isConnected() override { return mSdk.isConnected(); }
+    void disconnect() override { mSdk.disconnect(); }
+    std::string sessionId() override { return mSdk.sessionId(); }
+
+    using RenderSession::sendMessage;
+    void sendMessage(const arras4::api::MessageContentConstPtr& content) override { mSdk.sendMessage(content); }
+
+    void progress(const std::string& stage) override { mSdk.progress(stage); }
+    void progress(const std::string& stage, const float percentage) override { mSdk.progress(stage, percentage); }
+    void progress(const std::string& stage, const std::string& status) override { mSdk.progress(stage, status); }
+    void progressInfo(const std::string& key, const std::string& value) override { mSdk.progressInfo(key, value); }
+
+private:
+    arras4::sdk::SDK mSdk;
+};
+
+} // namespace arras_render
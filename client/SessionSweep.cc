@@ -0,0 +1,223 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#include "SessionSweep.h"
+
+#include <boost/algorithm/string.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <set>
+#include <sstream>
+
+namespace {
+
+const std::vector<std::string> ALL_COMPUTATIONS = {"dispatch", "mcrt", "merge"};
+
+} // anon namespace
+
+namespace arras_render {
+
+bool
+SessionSweep::addParam(const std::string& spec, std::string& error)
+{
+    const size_t eq = spec.find('=');
+    if (eq == std::string::npos || eq == 0 || eq + 1 == spec.size()) {
+        error = "sweep parameter needs <computation>.<key>=<value>[,<value>...] : " + spec;
+        return false;
+    }
+
+    Param param;
+    param.mName = spec.substr(0, eq);
+    std::vector<std::string> keys;
+    boost::split(keys, param.mName, boost::is_any_of("."));
+    if (keys.size() < 2 || std::any_of(keys.begin(), keys.end(), [](const std::string& k) { return k.empty(); })) {
+        error = "sweep parameter needs <computation>.<key> : " + param.mName;
+        return false;
+    }
+    param.mComputation = keys.front();
+    param.mPath.assign(keys.begin() + 1, keys.end());
+
+    const std::string valueList = spec.substr(eq + 1);
+    std::vector<std::string> values;
+    boost::split(values, valueList, boost::is_any_of(","));
+    for (const auto& itr : values) {
+        if (itr.empty()) {
+            error = "empty sweep value : " + spec;
+            return false;
+        }
+        param.mValues.push_back(parseValue(itr));
+    }
+
+    mParams.push_back(std::move(param));
+    return true;
+}
+
+size_t
+SessionSweep::getPointTotal() const
+{
+    if (mParams.empty()) return 0;
+    size_t total = 1;
+    for (const auto& itr : mParams) total *= itr.mValues.size();
+    return total;
+}
+
+SessionSweep::Point
+SessionSweep::getPoint(const size_t pointId) const
+{
+    Point point(mParams.size());
+    size_t id = pointId;
+    for (size_t i = mParams.size(); i-- > 0;) { // last parameter changes fastest
+        const Param& param = mParams[i];
+        point[i].mComputation = param.mComputation;
+        point[i].mPath = param.mPath;
+        point[i].mValue = param.mValues[id % param.mValues.size()];
+        id /= param.mValues.size();
+    }
+    return point;
+}
+
+std::string
+SessionSweep::getPointLabel(const size_t pointId) const
+{
+    const Point point = getPoint(pointId);
+    std::ostringstream ostr;
+    for (size_t i = 0; i < point.size(); ++i) {
+        if (i) ostr << ' ';
+        ostr << mParams[i].mName << '=' << valueStr(point[i].mValue);
+    }
+    return ostr.str();
+}
+
+// static function
+void
+SessionSweep::apply(const Point& point, arras4::client::SessionDefinition& def)
+{
+    for (const auto& itr : point) {
+        std::vector<std::string> computations;
+        if (itr.mComputation == "*") {
+            for (const auto& name : ALL_COMPUTATIONS) {
+                if (def.has(name)) computations.push_back(name);
+            }
+        } else {
+            computations.push_back(itr.mComputation);
+        }
+
+        for (const auto& name : computations) {
+            Json::Value* value = &def[name];
+            for (const auto& key : itr.mPath) {
+                value = &(*value)[key];
+            }
+            *value = itr.mValue;
+        }
+    }
+}
+
+std::string
+SessionSweep::showTable() const
+{
+    // milestone columns in the order of the first appearance
+    std::vector<std::string> columns;
+    std::set<std::string> known;
+    for (const auto& result : mResult) {
+        for (const auto& name : result.second["milestones"].getMemberNames()) {
+            if (known.insert(name).second) columns.push_back(name);
+        }
+    }
+
+    std::vector<size_t> width;
+    for (const auto& name : columns) width.push_back(std::max<size_t>(name.size(), 17));
+
+    std::ostringstream ostr;
+    ostr << "Sweep (points:" << getPointTotal() << ") {\n"
+         << "  " << std::setw(5) << "point" << ' ' << std::setw(6) << "trials";
+    for (size_t i = 0; i < columns.size(); ++i) {
+        ostr << ' ' << std::setw(static_cast<int>(width[i])) << columns[i];
+    }
+    ostr << '\n';
+
+    for (const auto& result : mResult) {
+        ostr << "  " << std::setw(5) << result.first << ' '
+             << std::setw(6) << result.second["trials"].asUInt();
+        for (size_t i = 0; i < columns.size(); ++i) {
+            const Json::Value& milestone = result.second["milestones"][columns[i]];
+            std::ostringstream cell;
+            if (milestone.isNull()) {
+                cell << '-';
+            } else {
+                cell << std::fixed << std::setprecision(3) << milestone["mean"].asDouble()
+                     << " +- " << milestone["stddev"].asDouble();
+            }
+            ostr << ' ' << std::setw(static_cast<int>(width[i])) << cell.str();
+        }
+        ostr << '\n';
+    }
+
+    ostr << "  points {\n";
+    for (size_t pointId = 0; pointId < getPointTotal(); ++pointId) {
+        ostr << "    " << std::setw(5) << pointId << " : " << getPointLabel(pointId) << '\n';
+    }
+    ostr << "  }\n"
+         << "}";
+    return ostr.str();
+}
+
+Json::Value
+SessionSweep::toJson() const
+{
+    Json::Value root(Json::arrayValue);
+    for (size_t pointId = 0; pointId < getPointTotal(); ++pointId) {
+        Json::Value item;
+        item["point"] = static_cast<Json::UInt64>(pointId);
+        item["label"] = getPointLabel(pointId);
+
+        const Point point = getPoint(pointId);
+        for (size_t i = 0; i < point.size(); ++i) {
+            item["params"][mParams[i].mName] = point[i].mValue;
+        }
+
+        auto result = mResult.find(pointId);
+        if (result != mResult.end()) item["result"] = result->second;
+        root.append(item);
+    }
+    return root;
+}
+
+bool
+SessionSweep::save(const std::string& filename, std::string& error) const
+{
+    std::ofstream fout(filename, std::ios::trunc);
+    if (!fout) {
+        error = "Can not create file. filename:" + filename;
+        return false;
+    }
+    Json::StyledWriter writer;
+    fout << writer.write(toJson());
+    return true;
+}
+
+// static function
+Json::Value
+SessionSweep::parseValue(const std::string& str)
+{
+    Json::Value value;
+    Json::Reader reader;
+    if (reader.parse(str, value, false) && !value.isObject() && !value.isArray() && !value.isNull()) {
+        return value;
+    }
+    return Json::Value(str);
+}
+
+// static function
+std::string
+SessionSweep::valueStr(const Json::Value& value)
+{
+    if (value.isString()) return value.asString();
+    Json::FastWriter writer;
+    std::string str = writer.write(value);
+    boost::trim(str);
+    return str;
+}
+
+} // namespace arras_render
@@ -0,0 +1,70 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <client/api/SessionDefinition.h>
+
+#include <json/json.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace arras_render {
+
+class SessionSweep
+//
+// Parameter grid of in-memory session definition overrides, used to benchmark session variants
+// without cloning a sessiondef file for every experiment. Every parameter is given as
+//   <computation>.<key>[.<key>...]=<value>[,<value>...]
+// e.g.
+//   mcrt.packTilePrecision=auto16,auto32
+//   mcrt.exec_mode=scalar,vector
+//   mcrt.requirements.resources.minCores=32,64
+//   *.fps=1,4
+// "*" applies the value to every computation (dispatch, mcrt, merge) of the definition. Values are
+// parsed as JSON scalars (number, bool, "quoted string") and fall back to a string otherwise.
+// Grid points are the cartesian product of all the parameter values, the last parameter changes
+// fastest.
+//
+{
+public:
+    struct Override {
+        std::string mComputation; // "*" : all computations
+        std::vector<std::string> mPath;
+        Json::Value mValue;
+    };
+    using Point = std::vector<Override>;
+
+    bool addParam(const std::string& spec, std::string& error);
+
+    size_t getPointTotal() const;
+    Point getPoint(const size_t pointId) const;
+    std::string getPointLabel(const size_t pointId) const; // "mcrt.exec_mode=scalar *.fps=4"
+
+    static void apply(const Point& point, arras4::client::SessionDefinition& def);
+
+    // stats : BenchmarkStats::toJson() of the grid point
+    void setResult(const size_t pointId, const Json::Value& stats) { mResult[pointId] = stats; }
+
+    std::string showTable() const;
+    Json::Value toJson() const;
+    bool save(const std::string& filename, std::string& error) const;
+
+private:
+    struct Param {
+        std::string mName; // <computation>.<key>...
+        std::string mComputation;
+        std::vector<std::string> mPath;
+        std::vector<Json::Value> mValues;
+    };
+
+    static Json::Value parseValue(const std::string& str);
+    static std::string valueStr(const Json::Value& value);
+
+    std::vector<Param> mParams;
+    std::map<size_t, Json::Value> mResult;
+};
+
+} // namespace arras_render
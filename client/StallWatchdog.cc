@@ -0,0 +1,344 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#include "StallWatchdog.h"
+#include "ThreadRole.h"
+#include "Trace.h"
+
+#include <scene_rdl2/render/util/StrUtil.h>
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr const char* WATCH_NAME[] = {"gui", "message", "messageB"};
+static_assert(sizeof(WATCH_NAME) / sizeof(WATCH_NAME[0]) == arras_render::StallWatchdog::WATCH_TOTAL,
+              "WATCH_NAME has to match StallWatchdog::Watch");
+
+constexpr const char* LOCK_NAME[] = {"frameMux", "sceneMux"};
+static_assert(sizeof(LOCK_NAME) / sizeof(LOCK_NAME[0]) == arras_render::StallWatchdog::LOCK_TOTAL,
+              "LOCK_NAME has to match StallWatchdog::Lock");
+
+constexpr int64_t MIN_CHECK_INTERVAL_NS = 10 * 1000 * 1000;
+constexpr int64_t GUI_BEAT_INTERVAL_NS =
+    static_cast<int64_t>(arras_render::StallWatchdog::GUI_BEAT_INTERVAL_MS) * 1000 * 1000;
+
+float
+nsToSec(const int64_t ns)
+{
+    return static_cast<float>(ns) * 1.0e-9f;
+}
+
+} // anon namespace
+
+namespace arras_render {
+
+// static function
+StallWatchdog&
+StallWatchdog::get()
+{
+    static StallWatchdog sStallWatchdog;
+    return sStallWatchdog;
+}
+
+StallWatchdog::StallWatchdog()
+{
+    parserConfigure();
+}
+
+StallWatchdog::~StallWatchdog()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mShutdown = true;
+    }
+    mCvShutdown.notify_all();
+    if (mThread.joinable()) mThread.join();
+}
+
+void
+StallWatchdog::start(const float thresholdSec)
+{
+    if (thresholdSec <= 0.0f || mThread.joinable()) return;
+    mThresholdNs = static_cast<int64_t>(thresholdSec * 1.0e9f);
+    mEnabled = true;
+    mThread = std::thread(threadMain, this);
+}
+
+void
+StallWatchdog::attachGui()
+{
+    if (!isEnabled()) return;
+    Monitor& monitor = mMonitor[static_cast<int>(Watch::GUI)];
+    monitor.mTid = getTid();
+    Trace::stageSlot() = &monitor.mStage;
+}
+
+void
+StallWatchdog::detachGui()
+{
+    Monitor& monitor = mMonitor[static_cast<int>(Watch::GUI)];
+    monitor.mLastBeatNs = 0; // no beat is expected any more
+}
+
+void
+StallWatchdog::beat()
+{
+    if (!isEnabled()) return;
+    Monitor& monitor = mMonitor[static_cast<int>(Watch::GUI)];
+    const int64_t now = nowNs();
+    const int64_t last = monitor.mLastBeatNs.exchange(now, std::memory_order_relaxed);
+    if (last == 0) return;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mEventLoopLatency.add(nsToSec(std::max(now - last - GUI_BEAT_INTERVAL_NS, int64_t(0))));
+}
+
+void
+StallWatchdog::beginBusy(const Watch watch)
+{
+    if (!isEnabled()) return;
+    Monitor& monitor = mMonitor[static_cast<int>(watch)];
+    std::atomic<const char*>*& slot = Trace::stageSlot();
+    if (slot != &monitor.mStage) {
+        // the first message of this thread (SDK thread or MockSession thread)
+        slot = &monitor.mStage;
+        monitor.mTid = getTid();
+    }
+    const int64_t now = nowNs();
+    monitor.mBusySinceNs.store(now, std::memory_order_relaxed);
+
+    const int64_t last = monitor.mLastBeatNs.load(std::memory_order_relaxed);
+    if (last > 0) {
+        const float gapSec = nsToSec(now - last);
+        std::lock_guard<std::mutex> lock(mMutex);
+        float& gapMaxSec = mMessageGapMaxSec[static_cast<int>(watch)];
+        gapMaxSec = std::max(gapMaxSec, gapSec);
+    }
+}
+
+void
+StallWatchdog::endBusy(const Watch watch)
+{
+    if (!isEnabled()) return;
+    Monitor& monitor = mMonitor[static_cast<int>(watch)];
+    monitor.mLastBeatNs.store(nowNs(), std::memory_order_relaxed);
+    monitor.mBusySinceNs.store(0, std::memory_order_relaxed);
+}
+
+void
+StallWatchdog::noteLocked(const Lock lock)
+{
+    if (!isEnabled()) return;
+    Owner& owner = mOwner[static_cast<int>(lock)];
+    owner.mSinceNs.store(nowNs(), std::memory_order_relaxed);
+    owner.mTid.store(getTid(), std::memory_order_relaxed);
+}
+
+void
+StallWatchdog::noteUnlocked(const Lock lock)
+{
+    if (!isEnabled()) return;
+    mOwner[static_cast<int>(lock)].mTid.store(0, std::memory_order_relaxed);
+}
+
+void
+StallWatchdog::setProbe(const std::string& name, const Probe& probe)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto& itr : mProbes) {
+        if (itr.first == name) {
+            itr.second = probe;
+            return;
+        }
+    }
+    mProbes.emplace_back(name, probe);
+}
+
+std::string
+StallWatchdog::show() const
+{
+    namespace str_util = scene_rdl2::str_util;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::ostringstream ostr;
+    ostr << "StallWatchdog {\n"
+         << "  enabled:" << str_util::boolStr(isEnabled())
+         << " threshold:" << str_util::secStr(nsToSec(mThresholdNs)) << '\n'
+         << "  " << mEventLoopLatency.showSummary("guiEventLoopLatency") << '\n';
+    for (int i = static_cast<int>(Watch::MESSAGE); i < WATCH_TOTAL; ++i) {
+        ostr << "  " << WATCH_NAME[i] << "GapMax:" << str_util::secStr(mMessageGapMaxSec[i]) << '\n';
+    }
+    for (int i = 0; i < WATCH_TOTAL; ++i) {
+        ostr << str_util::addIndent(mStall[i].mDuration.show(std::string(WATCH_NAME[i]) + " stall duration"), 1)
+             << '\n';
+    }
+    ostr << "}";
+    return ostr.str();
+}
+
+Json::Value
+StallWatchdog::toJson() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    Json::Value json;
+    json["thresholdSec"] = nsToSec(mThresholdNs);
+    json["guiEventLoopLatencyP99"] = mEventLoopLatency.getPercentile(99.0f);
+    json["guiEventLoopLatencyMax"] = mEventLoopLatency.getMax();
+    json["messageGapMaxSec"] = mMessageGapMaxSec[static_cast<int>(Watch::MESSAGE)];
+    for (int i = 0; i < WATCH_TOTAL; ++i) {
+        const Stall& stall = mStall[i];
+        Json::Value item;
+        if (i != static_cast<int>(Watch::GUI)) item["gapMaxSec"] = mMessageGapMaxSec[i];
+        item["count"] = static_cast<Json::UInt64>(stall.mTotal);
+        item["durationMeanSec"] = stall.mDuration.getMean();
+        item["durationMaxSec"] = stall.mDuration.getMax();
+        json[WATCH_NAME[i]] = item;
+    }
+    return json;
+}
+
+// static function
+std::string
+StallWatchdog::showWatch(const Watch watch)
+{
+    const int id = static_cast<int>(watch);
+    return (id >= 0 && id < WATCH_TOTAL) ? WATCH_NAME[id] : "?";
+}
+
+// static function
+void
+StallWatchdog::threadMain(StallWatchdog* watchdog)
+{
+    ThreadRoleScope threadRole(ThreadRole::WATCHDOG);
+
+    const auto interval =
+        std::chrono::nanoseconds(std::max(watchdog->mThresholdNs / 4, MIN_CHECK_INTERVAL_NS));
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(watchdog->mMutex);
+            if (watchdog->mCvShutdown.wait_for(lock, interval, [&] { return watchdog->mShutdown; })) break;
+        }
+        watchdog->check();
+    }
+}
+
+// static function
+int64_t
+StallWatchdog::nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+// static function
+int
+StallWatchdog::getTid()
+{
+    thread_local const int sTid = static_cast<int>(syscall(SYS_gettid));
+    return sTid;
+}
+
+void
+StallWatchdog::check()
+{
+    const int64_t now = nowNs();
+    for (int i = 0; i < WATCH_TOTAL; ++i) {
+        Stall& stall = mStall[i];
+        const int64_t beginNs = getStallBeginNs(i, now);
+        if (beginNs && !stall.mActive) {
+            // report while the thread is still stalled, so the stage and the lock owners are the live ones
+            std::cerr << ">> StallWatchdog.cc " << report(i, now) << '\n';
+            stall.mActive = true;
+            stall.mBeginNs = beginNs;
+
+        } else if (!beginNs && stall.mActive) {
+            const int64_t last = mMonitor[i].mLastBeatNs.load(std::memory_order_relaxed);
+            const float sec = nsToSec(((last > stall.mBeginNs) ? last : now) - stall.mBeginNs);
+            std::cerr << ">> StallWatchdog.cc " << WATCH_NAME[i] << " recovered after "
+                      << scene_rdl2::str_util::secStr(sec) << '\n';
+            stall.mActive = false;
+            std::lock_guard<std::mutex> lock(mMutex);
+            stall.mTotal++;
+            stall.mDuration.add(sec);
+        }
+    }
+}
+
+int64_t
+StallWatchdog::getStallBeginNs(const int watchId, const int64_t now) const
+//
+// Returns the time the watched thread stopped responding, 0 if it is not stalled
+//
+{
+    const Monitor& monitor = mMonitor[watchId];
+    int64_t beginNs = 0;
+    if (static_cast<Watch>(watchId) == Watch::GUI) {
+        const int64_t last = monitor.mLastBeatNs.load(std::memory_order_relaxed);
+        if (last > 0) beginNs = last + GUI_BEAT_INTERVAL_NS; // the beat which did not come
+    } else {
+        beginNs = monitor.mBusySinceNs.load(std::memory_order_relaxed);
+    }
+    return (beginNs > 0 && now - beginNs > mThresholdNs) ? beginNs : 0;
+}
+
+std::string
+StallWatchdog::report(const int watchId, const int64_t now) const
+//
+// single line : stalled thread | every watched thread | lock owners | probes
+//
+{
+    namespace str_util = scene_rdl2::str_util;
+
+    const std::vector<std::pair<int, std::string>> threadNames = ThreadRoles::get().getThreadNames();
+    auto showTid = [&](const int tid) -> std::string {
+        for (const auto& itr : threadNames) {
+            if (itr.first == tid) return itr.second;
+        }
+        return "tid:" + std::to_string(tid);
+    };
+
+    std::ostringstream ostr;
+    ostr << WATCH_NAME[watchId] << " stall " << str_util::secStr(nsToSec(now - getStallBeginNs(watchId, now)));
+    for (int i = 0; i < WATCH_TOTAL; ++i) {
+        const Monitor& monitor = mMonitor[i];
+        const char* stage = monitor.mStage.load(std::memory_order_relaxed);
+        ostr << " | " << WATCH_NAME[i] << " stage:" << (stage ? stage : "-");
+        const int64_t busy = monitor.mBusySinceNs.load(std::memory_order_relaxed);
+        if (busy > 0) ostr << " busy:" << str_util::secStr(nsToSec(now - busy));
+        const int64_t last = monitor.mLastBeatNs.load(std::memory_order_relaxed);
+        if (last > 0) ostr << " beat:" << str_util::secStr(nsToSec(now - last)) << " ago";
+    }
+    for (int i = 0; i < LOCK_TOTAL; ++i) {
+        const Owner& owner = mOwner[i];
+        const int tid = owner.mTid.load(std::memory_order_relaxed);
+        ostr << " | " << LOCK_NAME[i] << ':';
+        if (!tid) ostr << "free";
+        else ostr << showTid(tid) << ' ' << str_util::secStr(nsToSec(now - owner.mSinceNs.load(std::memory_order_relaxed)));
+    }
+
+    std::vector<std::pair<std::string, Probe>> probes;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        probes = mProbes;
+    }
+    if (!probes.empty()) {
+        ostr << " |";
+        for (const auto& itr : probes) ostr << ' ' << itr.first << ':' << itr.second();
+    }
+    return ostr.str();
+}
+
+void
+StallWatchdog::parserConfigure()
+{
+    mParser.description("GUI/message threads stall watchdog command");
+    mParser.opt("show", "", "show stall count and duration histogram by thread and GUI event loop latency",
+                [&](Arg& arg) -> bool { return arg.msg(show() + '\n'); });
+}
+
+} // namespace arras_render
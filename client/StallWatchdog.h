@@ -0,0 +1,184 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "EditLatency.h" // LatencyHistogram
+
+#include <scene_rdl2/common/grid_util/Arg.h>
+#include <scene_rdl2/common/grid_util/Parser.h>
+
+#include <json/json.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace arras_render {
+
+class StallWatchdog
+//
+// Stall detector of the Qt event loop (GUI) and of the message handler threads, one per session
+// (MESSAGE, and MESSAGE_B of the A/B comparison). The GUI thread beats from a Qt timer : a beat which
+// is late by more than the threshold is a stall and the lateness of every beat is kept as the event
+// loop latency. A message thread is busy during a message handler call and stalls when a single call
+// takes longer than the threshold, the gap between messages is kept as the heartbeat gap. A watchdog thread checks both at a quarter of the threshold
+// and logs a compact report to cerr while the thread is still stalled : the stage of each watched
+// thread (its innermost open TraceSpan), the owner of mFrameMux/mSceneMux and the registered queue
+// sizes. The stall duration is added to a histogram of the thread when it recovers.
+// A threshold of 0 disables it and every call is a no-op.
+//
+{
+public:
+    using Arg = scene_rdl2::grid_util::Arg;
+    using Parser = scene_rdl2::grid_util::Parser;
+    using Clock = std::chrono::steady_clock;
+    using Probe = std::function<int64_t()>; // called by the watchdog thread, has to be lock free
+
+    enum class Watch : int {
+        GUI = 0,
+        MESSAGE,   // message handler of the session
+        MESSAGE_B, // message handler of the B session (A/B comparison)
+        SIZE
+    };
+
+    enum class Lock : int {
+        FRAME_MUX = 0,
+        SCENE_MUX,
+        SIZE
+    };
+
+    static constexpr int WATCH_TOTAL = static_cast<int>(Watch::SIZE);
+    static constexpr int LOCK_TOTAL = static_cast<int>(Lock::SIZE);
+    static constexpr int GUI_BEAT_INTERVAL_MS = 100;
+
+    static StallWatchdog& get(); // process wide singleton
+
+    void start(const float thresholdSec); // 0 : disabled
+    bool isEnabled() const { return mEnabled.load(std::memory_order_relaxed); }
+
+    // GUI : the calling thread is the Qt thread, beat() is called by a Qt timer of GUI_BEAT_INTERVAL_MS
+    void attachGui();
+    void detachGui(); // the event loop is done, no more beats
+    void beat();
+
+    // MESSAGE, MESSAGE_B : the calling thread is the message handler thread of the session
+    void beginBusy(const Watch watch);
+    void endBusy(const Watch watch);
+
+    void noteLocked(const Lock lock);
+    void noteUnlocked(const Lock lock);
+
+    void setProbe(const std::string& name, const Probe& probe); // replaces the probe of the same name
+
+    std::string show() const;
+    Json::Value toJson() const; // stall count and duration by thread
+
+    static std::string showWatch(const Watch watch);
+
+    Parser& getParser() { return mParser; }
+
+private:
+    struct Monitor {
+        std::atomic<const char*> mStage {nullptr}; // published by TraceSpan
+        std::atomic<int> mTid {0};
+        std::atomic<int64_t> mLastBeatNs {0};  // GUI : last beat, MESSAGE* : end of the last message
+        std::atomic<int64_t> mBusySinceNs {0}; // MESSAGE* : start of the current message, 0 : idle
+    };
+
+    struct Owner {
+        std::atomic<int> mTid {0}; // 0 : free
+        std::atomic<int64_t> mSinceNs {0};
+    };
+
+    struct Stall {
+        bool mActive {false}; // watchdog thread only
+        int64_t mBeginNs {0};
+        uint64_t mTotal {0};
+        LatencyHistogram mDuration {4096};
+    };
+
+    StallWatchdog();
+    ~StallWatchdog();
+
+    static void threadMain(StallWatchdog* watchdog);
+    static int64_t nowNs();
+    static int getTid();
+
+    void check(); // watchdog thread
+    int64_t getStallBeginNs(const int watchId, const int64_t now) const;
+    std::string report(const int watchId, const int64_t now) const;
+
+    void parserConfigure();
+
+    std::atomic<bool> mEnabled {false};
+    int64_t mThresholdNs {0};
+
+    Monitor mMonitor[WATCH_TOTAL];
+    Owner mOwner[LOCK_TOTAL];
+
+    mutable std::mutex mMutex;
+    std::condition_variable mCvShutdown;
+    bool mShutdown {false};
+    std::vector<std::pair<std::string, Probe>> mProbes;
+    Stall mStall[WATCH_TOTAL];
+    LatencyHistogram mEventLoopLatency {4096};
+    float mMessageGapMaxSec[WATCH_TOTAL] {}; // MESSAGE* only
+
+    std::thread mThread;
+
+    Parser mParser;
+};
+
+class StallBusyScope
+//
+// Marks the message handler thread busy for the stall watchdog, placed at the top of the handler
+//
+{
+public:
+    explicit StallBusyScope(const StallWatchdog::Watch watch = StallWatchdog::Watch::MESSAGE)
+        : mWatch(watch)
+    {
+        StallWatchdog::get().beginBusy(mWatch);
+    }
+    ~StallBusyScope() { StallWatchdog::get().endBusy(mWatch); }
+
+private:
+    const StallWatchdog::Watch mWatch;
+};
+
+class StallLockGuard
+//
+// std::lock_guard which records the owner of the lock for the stall report
+//
+{
+public:
+    StallLockGuard(std::mutex& mutex, const StallWatchdog::Lock lock)
+        : mMutex(mutex)
+        , mLock(lock)
+    {
+        mMutex.lock();
+        StallWatchdog::get().noteLocked(mLock);
+    }
+    ~StallLockGuard()
+    {
+        StallWatchdog::get().noteUnlocked(mLock);
+        mMutex.unlock();
+    }
+
+    StallLockGuard(const StallLockGuard&) = delete;
+    StallLockGuard& operator=(const StallLockGuard&) = delete;
+
+private:
+    std::mutex& mMutex;
+    const StallWatchdog::Lock mLock;
+};
+
+} // namespace arras_render
@@ -0,0 +1,246 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#include "StartupReport.h"
+
+#include <scene_rdl2/render/util/StrUtil.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+namespace arras_render {
+
+// static function
+StartupReport&
+StartupReport::get()
+{
+    static StartupReport sStartupReport;
+    return sStartupReport;
+}
+
+StartupReport::StartupReport()
+    : mOrigin(Clock::now())
+{
+    parserConfigure();
+}
+
+void
+StartupReport::reset(const Clock::time_point& origin)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mOrigin = origin;
+    for (auto& itr : mInterval) itr = Interval();
+}
+
+void
+StartupReport::begin(const Phase phase)
+{
+    const Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(mMutex);
+    Interval& interval = mInterval[static_cast<int>(phase)];
+    if (interval.mBegun) return; // first occurrence only
+    interval.mBegun = true;
+    interval.mBegin = now;
+}
+
+void
+StartupReport::end(const Phase phase)
+{
+    const Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(mMutex);
+    Interval& interval = mInterval[static_cast<int>(phase)];
+    if (!interval.mBegun || interval.mDone) return;
+    interval.mDone = true;
+    interval.mEnd = now;
+}
+
+void
+StartupReport::mark(const Phase phase, const Clock::time_point& begin, const Clock::time_point& end)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    Interval& interval = mInterval[static_cast<int>(phase)];
+    if (interval.mBegun) return;
+    interval.mBegun = interval.mDone = true;
+    interval.mBegin = begin;
+    interval.mEnd = end;
+}
+
+void
+StartupReport::endAfter(const Phase phase, const Phase prev)
+{
+    const Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(mMutex);
+    const Interval& prevInterval = mInterval[static_cast<int>(prev)];
+    Interval& interval = mInterval[static_cast<int>(phase)];
+    if (!prevInterval.mDone || interval.mBegun) return;
+    interval.mBegun = interval.mDone = true;
+    interval.mBegin = prevInterval.mEnd;
+    interval.mEnd = now;
+}
+
+bool
+StartupReport::isDone(const Phase phase) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mInterval[static_cast<int>(phase)].mDone;
+}
+
+bool
+StartupReport::getTimeToFirstPixel(float& sec) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return getTimeToFirstPixelMain(sec);
+}
+
+bool
+StartupReport::getTimeToFirstPixelMain(float& sec) const
+{
+    const Interval& paint = mInterval[static_cast<int>(Phase::FIRST_PAINT)];
+    const Interval& decode = mInterval[static_cast<int>(Phase::FIRST_DECODE)];
+    if (paint.mDone) {
+        sec = toSec(paint.mEnd);
+    } else if (decode.mDone) {
+        sec = toSec(decode.mEnd);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::string
+StartupReport::show() const
+{
+    namespace str_util = scene_rdl2::str_util;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    float firstPixel = 0.0f;
+    const bool reached = getTimeToFirstPixelMain(firstPixel);
+
+    std::ostringstream ostr;
+    ostr << "Startup critical path (process start -> first pixel "
+         << (reached ? str_util::secStr(firstPixel) : std::string("not reached")) << ") {\n";
+
+    // phases in the order of the begin time
+    std::vector<int> order;
+    for (int i = 0; i < PHASE_TOTAL; ++i) {
+        if (mInterval[i].mDone) order.push_back(i);
+    }
+    std::sort(order.begin(), order.end(),
+              [&](int a, int b) { return mInterval[a].mBegin < mInterval[b].mBegin; });
+
+    for (int i : order) {
+        const Interval& interval = mInterval[i];
+        const float begin = toSec(interval.mBegin);
+        const float end = toSec(interval.mEnd);
+        ostr << "  " << std::setw(18) << std::left << showPhase(static_cast<Phase>(i)) << std::right
+             << " start:" << std::setw(10) << str_util::secStr(begin)
+             << " end:" << std::setw(10) << str_util::secStr(end)
+             << " duration:" << std::setw(10) << str_util::secStr(end - begin);
+        if (reached && firstPixel > 0.0f) {
+            ostr << " (" << std::fixed << std::setprecision(1) << (end - begin) / firstPixel * 100.0f << "%)";
+            ostr.unsetf(std::ios::floatfield);
+        }
+        ostr << '\n';
+    }
+    for (int i = 0; i < PHASE_TOTAL; ++i) {
+        if (!mInterval[i].mDone) {
+            ostr << "  " << std::setw(18) << std::left << showPhase(static_cast<Phase>(i)) << std::right
+                 << " not recorded\n";
+        }
+    }
+
+    // overlapped phases
+    std::ostringstream ostrOverlap;
+    for (size_t a = 0; a < order.size(); ++a) {
+        for (size_t b = a + 1; b < order.size(); ++b) {
+            const Interval& ia = mInterval[order[a]];
+            const Interval& ib = mInterval[order[b]];
+            const Clock::time_point begin = std::max(ia.mBegin, ib.mBegin);
+            const Clock::time_point end = std::min(ia.mEnd, ib.mEnd);
+            if (begin < end) {
+                ostrOverlap << "    " << showPhase(static_cast<Phase>(order[a])) << " / "
+                            << showPhase(static_cast<Phase>(order[b])) << " : "
+                            << str_util::secStr(std::chrono::duration<float>(end - begin).count()) << '\n';
+            }
+        }
+    }
+    ostr << "  overlap {\n" << ostrOverlap.str() << "  }\n";
+
+    // time not covered by any phase until the first pixel
+    if (reached) {
+        std::vector<std::pair<float, float>> covered;
+        for (int i : order) {
+            covered.emplace_back(std::max(0.0f, toSec(mInterval[i].mBegin)),
+                                 std::min(firstPixel, toSec(mInterval[i].mEnd)));
+        }
+        std::sort(covered.begin(), covered.end());
+        float coveredTotal = 0.0f;
+        float tail = 0.0f;
+        for (const auto& itr : covered) {
+            if (itr.second <= tail) continue;
+            coveredTotal += itr.second - std::max(itr.first, tail);
+            tail = itr.second;
+        }
+        ostr << "  notInAnyPhase:" << str_util::secStr(firstPixel - coveredTotal) << '\n';
+    }
+    ostr << "}";
+    return ostr.str();
+}
+
+Json::Value
+StartupReport::toJson() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    Json::Value root;
+    float firstPixel = 0.0f;
+    if (getTimeToFirstPixelMain(firstPixel)) {
+        root["firstPixel"] = firstPixel;
+    }
+    Json::Value phases(Json::objectValue);
+    for (int i = 0; i < PHASE_TOTAL; ++i) {
+        const Interval& interval = mInterval[i];
+        if (!interval.mDone) continue;
+        Json::Value item;
+        item["start"] = toSec(interval.mBegin);
+        item["end"] = toSec(interval.mEnd);
+        phases[showPhase(static_cast<Phase>(i))] = item;
+    }
+    root["phases"] = phases;
+    return root;
+}
+
+// static function
+std::string
+StartupReport::showPhase(const Phase phase)
+{
+    switch (phase) {
+    case Phase::ARG_PARSE : return "argParse";
+    case Phase::RDL_PARSE : return "rdlParse";
+    case Phase::SCENE_SERIALIZE : return "sceneSerialize";
+    case Phase::REZ_RESOLVE : return "rezResolve";
+    case Phase::URL_LOOKUP : return "urlLookup";
+    case Phase::CREATE_SESSION : return "createSession";
+    case Phase::ENGINE_READY_WAIT : return "engineReadyWait";
+    case Phase::OUTPUT_RATES_SEND : return "outputRatesSend";
+    case Phase::RDL_SEND : return "rdlSend";
+    case Phase::FIRST_FRAME_RECEIPT : return "firstFrameReceipt";
+    case Phase::FIRST_DECODE : return "firstDecode";
+    case Phase::FIRST_PAINT : return "firstPaint";
+    default : return "?";
+    }
+}
+
+void
+StartupReport::parserConfigure()
+{
+    mParser.description("startup critical path command");
+    mParser.opt("show", "", "show startup phase breakdown",
+                [&](Arg& arg) -> bool { return arg.msg(show() + '\n'); });
+}
+
+} // namespace arras_render
@@ -0,0 +1,108 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <scene_rdl2/common/grid_util/Arg.h>
+#include <scene_rdl2/common/grid_util/Parser.h>
+
+#include <json/json.h>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+
+namespace arras_render {
+
+class StartupReport
+//
+// Breakdown of the time from process start to the first pixel into startup phases.
+// Only the first occurrence of each phase is recorded. show() reports every phase relative to the
+// process start, the phases which overlapped each other and the time not covered by any phase,
+// so that we can see where the time-to-first-pixel goes.
+//
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using Arg = scene_rdl2::grid_util::Arg;
+    using Parser = scene_rdl2::grid_util::Parser;
+
+    enum class Phase : int {
+        ARG_PARSE = 0,
+        RDL_PARSE,
+        SCENE_SERIALIZE,
+        REZ_RESOLVE,
+        URL_LOOKUP,
+        CREATE_SESSION,
+        ENGINE_READY_WAIT,
+        OUTPUT_RATES_SEND,
+        RDL_SEND,
+        FIRST_FRAME_RECEIPT, // end of RDL send -> first ProgressiveFrame arrives
+        FIRST_DECODE,        // decode of the first frame which has image data
+        FIRST_PAINT,         // first display of the decoded image (gui mode only)
+        SIZE
+    };
+    static constexpr int PHASE_TOTAL = static_cast<int>(Phase::SIZE);
+
+    static StartupReport& get(); // process wide singleton
+
+    // Restarts the report with a new origin (i.e. the next benchmark trial)
+    void reset(const Clock::time_point& origin);
+
+    void begin(const Phase phase);
+    void end(const Phase phase);
+    void mark(const Phase phase, const Clock::time_point& begin, const Clock::time_point& end);
+    // Records phase from the end of the prev phase until now
+    void endAfter(const Phase phase, const Phase prev);
+
+    bool isDone(const Phase phase) const;
+
+    // time from the origin to the first pixel (first paint, or first decode in headless mode)
+    bool getTimeToFirstPixel(float& sec) const;
+
+    std::string show() const;
+    Json::Value toJson() const;
+
+    static std::string showPhase(const Phase phase);
+
+    Parser& getParser() { return mParser; }
+
+private:
+    struct Interval {
+        bool mBegun {false};
+        bool mDone {false};
+        Clock::time_point mBegin;
+        Clock::time_point mEnd;
+    };
+
+    StartupReport();
+
+    float toSec(const Clock::time_point& tp) const
+    {
+        return std::chrono::duration<float>(tp - mOrigin).count();
+    }
+    bool getTimeToFirstPixelMain(float& sec) const;
+
+    void parserConfigure();
+
+    mutable std::mutex mMutex;
+    Clock::time_point mOrigin;
+    Interval mInterval[PHASE_TOTAL];
+
+    Parser mParser;
+};
+
+class StartupPhase
+//
+// Scoped StartupReport phase
+//
+{
+public:
+    explicit StartupPhase(const StartupReport::Phase phase) : mPhase(phase) { StartupReport::get().begin(mPhase); }
+    ~StartupPhase() { StartupReport::get().end(mPhase); }
+
+private:
+    const StartupReport::Phase mPhase;
+};
+
+} // namespace arras_render
@@ -0,0 +1,389 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#include "ThreadRole.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <pthread.h>
+#include <sys/resource.h> // setpriority
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr const char* ROLE_NAME[] = {
+    "main", "message", "setup", "script", "camPlayback", "denoise", "jpeg",
+    "history", "poseCache", "publish", "send", "watchdog", "mock"
+};
+static_assert(sizeof(ROLE_NAME) / sizeof(ROLE_NAME[0]) == arras_render::ThreadRoles::ROLE_TOTAL,
+              "ROLE_NAME has to match ThreadRole");
+
+constexpr size_t THREAD_NAME_MAX = 15; // pthread_setname_np() limit without the terminator
+
+thread_local bool tlsEntered = false; // the calling thread is in a role
+
+double
+readCpuSec(const clockid_t clock, bool& ok)
+{
+    timespec ts;
+    ok = (clock_gettime(clock, &ts) == 0);
+    return ok ? static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) * 1.0e-9 : 0.0;
+}
+
+} // anon namespace
+
+namespace arras_render {
+
+// static function
+ThreadRoles&
+ThreadRoles::get()
+{
+    static ThreadRoles sThreadRoles;
+    return sThreadRoles;
+}
+
+ThreadRoles::ThreadRoles()
+{
+    // constructed by the first get() of the main thread, before the main role is applied
+    for (auto& itr : mConfig) CPU_ZERO(&itr.mCpuSet);
+    CPU_ZERO(&mOriginCpuSet);
+    mOriginAffinity = (sched_getaffinity(0, sizeof(cpu_set_t), &mOriginCpuSet) == 0);
+    errno = 0;
+    const int nice = getpriority(PRIO_PROCESS, 0);
+    if (errno == 0) mOriginNice = nice;
+    parserConfigure();
+}
+
+bool
+ThreadRoles::setAffinity(const std::string& spec, std::string& error)
+{
+    ThreadRole role;
+    std::string value;
+    if (!parseSpec(spec, role, value, error)) return false;
+
+    std::string cpuList = value;
+    if (value.compare(0, 4, "node") == 0) {
+        const std::string filename = "/sys/devices/system/node/" + value + "/cpulist";
+        std::ifstream fin(filename);
+        if (!fin || !std::getline(fin, cpuList)) {
+            error = "Could not read NUMA node CPU list. filename:" + filename;
+            return false;
+        }
+    }
+
+    cpu_set_t cpuSet;
+    if (!parseCpuList(cpuList, cpuSet, error)) return false;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mConfigured = true;
+    Config& config = mConfig[static_cast<int>(role)];
+    config.mAffinity = true;
+    config.mAffinitySpec = value;
+    config.mCpuSet = cpuSet;
+    return true;
+}
+
+bool
+ThreadRoles::setPriority(const std::string& spec, std::string& error)
+{
+    ThreadRole role;
+    std::string value;
+    if (!parseSpec(spec, role, value, error)) return false;
+
+    int nice = 0;
+    try {
+        size_t pos = 0;
+        nice = std::stoi(value, &pos);
+        if (pos != value.size()) throw std::invalid_argument(value);
+    } catch (const std::exception&) {
+        error = "Invalid nice value:" + value;
+        return false;
+    }
+    if (nice < -20 || nice > 19) {
+        error = "Nice value is out of range (-20 ~ 19):" + value;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mConfigured = true;
+    Config& config = mConfig[static_cast<int>(role)];
+    config.mPriority = true;
+    config.mNice = nice;
+    return true;
+}
+
+void
+ThreadRoles::enter(const ThreadRole role)
+{
+    tlsEntered = true;
+    const int tid = getTid();
+    if (role != ThreadRole::MAIN) {
+        pthread_setname_np(pthread_self(), threadName(role).c_str());
+    }
+
+    clockid_t clock {};
+    const bool hasClock = (pthread_getcpuclockid(pthread_self(), &clock) == 0);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    Config& config = mConfig[static_cast<int>(role)];
+    std::string failure;
+    if (config.mAffinity && sched_setaffinity(0, sizeof(cpu_set_t), &config.mCpuSet) != 0) {
+        failure = "affinity " + config.mAffinitySpec + " : " + std::strerror(errno);
+    }
+    if (config.mPriority && setpriority(PRIO_PROCESS, static_cast<id_t>(tid), config.mNice) != 0) {
+        failure = "nice " + std::to_string(config.mNice) + " : " + std::strerror(errno);
+    }
+    if (mConfigured && (!config.mAffinity || !config.mPriority)) {
+        const std::string restoreFailure = restoreOriginMain(tid, config); // the creator's role is inherited
+        if (failure.empty()) failure = restoreFailure;
+    }
+    if (!failure.empty() && !config.mWarned) {
+        config.mWarned = true;
+        std::cerr << ">> ThreadRole.cc could not apply " << showRole(role) << " thread " << failure << '\n';
+    }
+
+    Usage& usage = mUsage[static_cast<int>(role)];
+    usage.mThreadTotal++;
+
+    auto itr = mThread.find(tid);
+    if (itr != mThread.end()) {
+        // tid of a thread which ended without leave() is reused
+        mUsage[static_cast<int>(itr->second.mRole)].mDoneCpuSec += itr->second.mLastCpuSec;
+        mThread.erase(itr);
+    }
+    if (hasClock) {
+        Thread& thread = mThread[tid];
+        thread.mRole = role;
+        thread.mClock = clock;
+    }
+}
+
+void
+ThreadRoles::enterOnce(const ThreadRole role)
+{
+    if (tlsEntered) return; // i.e. MockSession thread delivers the messages
+    enter(role);
+}
+
+void
+ThreadRoles::leave()
+{
+    tlsEntered = false;
+    const int tid = getTid();
+    bool ok = false;
+    const double cpuSec = readCpuSec(CLOCK_THREAD_CPUTIME_ID, ok);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto itr = mThread.find(tid);
+    if (itr == mThread.end()) return;
+    mUsage[static_cast<int>(itr->second.mRole)].mDoneCpuSec += ok ? cpuSec : itr->second.mLastCpuSec;
+    mThread.erase(itr);
+}
+
+std::vector<std::pair<int, std::string>>
+ThreadRoles::getThreadNames() const
+{
+    std::vector<std::pair<int, std::string>> names;
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (const auto& itr : mThread) {
+        names.emplace_back(itr.first, (itr.second.mRole == ThreadRole::MAIN) ? std::string("main") :
+                           threadName(itr.second.mRole));
+    }
+    return names;
+}
+
+std::string
+ThreadRoles::show() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    double cpuSec[ROLE_TOTAL];
+    collectMain(cpuSec);
+
+    std::ostringstream ostr;
+    ostr << "ThreadRoles {\n";
+    for (int i = 0; i < ROLE_TOTAL; ++i) {
+        const Config& config = mConfig[i];
+        const Usage& usage = mUsage[i];
+        if (!usage.mThreadTotal && !config.mAffinity && !config.mPriority) continue;
+        ostr << "  " << std::setw(12) << std::left << ROLE_NAME[i] << std::right
+             << " threads:" << usage.mThreadTotal
+             << " cpu:" << std::fixed << std::setprecision(3) << cpuSec[i] << " sec"
+             << " affinity:" << (config.mAffinity ? config.mAffinitySpec : "-")
+             << " nice:" << (config.mPriority ? std::to_string(config.mNice) : "-") << '\n';
+    }
+    ostr << "}";
+    return ostr.str();
+}
+
+Json::Value
+ThreadRoles::toJson() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    double cpuSec[ROLE_TOTAL];
+    collectMain(cpuSec);
+
+    Json::Value json;
+    for (int i = 0; i < ROLE_TOTAL; ++i) {
+        const Config& config = mConfig[i];
+        const Usage& usage = mUsage[i];
+        if (!usage.mThreadTotal) continue;
+        Json::Value item;
+        item["threads"] = usage.mThreadTotal;
+        item["cpuSec"] = cpuSec[i];
+        if (config.mAffinity) item["affinity"] = config.mAffinitySpec;
+        if (config.mPriority) item["nice"] = config.mNice;
+        json[ROLE_NAME[i]] = item;
+    }
+    return json;
+}
+
+// static function
+std::string
+ThreadRoles::showRole(const ThreadRole role)
+{
+    const int id = static_cast<int>(role);
+    return (id >= 0 && id < ROLE_TOTAL) ? ROLE_NAME[id] : "?";
+}
+
+// static function
+bool
+ThreadRoles::parseRole(const std::string& name, ThreadRole& role)
+{
+    for (int i = 0; i < ROLE_TOTAL; ++i) {
+        if (name == ROLE_NAME[i]) {
+            role = static_cast<ThreadRole>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// static function
+bool
+ThreadRoles::parseSpec(const std::string& spec, ThreadRole& role, std::string& value, std::string& error)
+{
+    const size_t pos = spec.find(':');
+    if (pos == std::string::npos || pos + 1 == spec.size()) {
+        error = "Invalid thread role spec, <role>:<value> is expected:" + spec;
+        return false;
+    }
+    if (!parseRole(spec.substr(0, pos), role)) {
+        std::ostringstream ostr;
+        ostr << "Unknown thread role:" << spec.substr(0, pos) << " (";
+        for (int i = 0; i < ROLE_TOTAL; ++i) ostr << ((i > 0) ? " " : "") << ROLE_NAME[i];
+        ostr << ")";
+        error = ostr.str();
+        return false;
+    }
+    value = spec.substr(pos + 1);
+    return true;
+}
+
+// static function
+bool
+ThreadRoles::parseCpuList(const std::string& list, cpu_set_t& cpuSet, std::string& error)
+//
+// "0-3,8,10-11" format of the kernel cpulist
+//
+{
+    CPU_ZERO(&cpuSet);
+    std::istringstream istr(list);
+    std::string range;
+    while (std::getline(istr, range, ',')) {
+        if (range.empty()) continue;
+        unsigned first = 0, last = 0;
+        char dash = 0;
+        std::istringstream rstr(range);
+        if (!(rstr >> first)) {
+            error = "Invalid CPU list:" + list;
+            return false;
+        }
+        last = first;
+        if (rstr >> dash) {
+            if (dash != '-' || !(rstr >> last) || last < first) {
+                error = "Invalid CPU list:" + list;
+                return false;
+            }
+        }
+        if (last >= CPU_SETSIZE) {
+            error = "CPU id is out of range:" + list;
+            return false;
+        }
+        for (unsigned cpu = first; cpu <= last; ++cpu) CPU_SET(cpu, &cpuSet);
+    }
+    if (CPU_COUNT(&cpuSet) == 0) {
+        error = "Empty CPU list:" + list;
+        return false;
+    }
+    return true;
+}
+
+// static function
+std::string
+ThreadRoles::threadName(const ThreadRole role)
+{
+    return ("ar:" + showRole(role)).substr(0, THREAD_NAME_MAX);
+}
+
+// static function
+int
+ThreadRoles::getTid()
+{
+    thread_local const int sTid = static_cast<int>(syscall(SYS_gettid));
+    return sTid;
+}
+
+void
+ThreadRoles::collectMain(double cpuSec[ROLE_TOTAL]) const
+{
+    for (int i = 0; i < ROLE_TOTAL; ++i) cpuSec[i] = mUsage[i].mDoneCpuSec;
+    for (auto& itr : mThread) {
+        bool ok = false;
+        const double sec = readCpuSec(itr.second.mClock, ok);
+        if (ok) itr.second.mLastCpuSec = sec; // otherwise the thread ended without leave()
+        cpuSec[static_cast<int>(itr.second.mRole)] += itr.second.mLastCpuSec;
+    }
+}
+
+std::string
+ThreadRoles::restoreOriginMain(const int tid, const Config& config) const
+//
+// Sets back the startup affinity and nice value which the role does not configure. Only changed
+// values are set, raising the priority back (i.e. from a positive main nice) needs CAP_SYS_NICE.
+//
+{
+    std::string failure;
+    if (!config.mAffinity && mOriginAffinity) {
+        cpu_set_t cpuSet;
+        if (sched_getaffinity(0, sizeof(cpu_set_t), &cpuSet) == 0 && !CPU_EQUAL(&cpuSet, &mOriginCpuSet) &&
+            sched_setaffinity(0, sizeof(cpu_set_t), &mOriginCpuSet) != 0) {
+            failure = std::string("restore affinity : ") + std::strerror(errno);
+        }
+    }
+    if (!config.mPriority) {
+        errno = 0;
+        const int nice = getpriority(PRIO_PROCESS, static_cast<id_t>(tid));
+        if (errno == 0 && nice != mOriginNice &&
+            setpriority(PRIO_PROCESS, static_cast<id_t>(tid), mOriginNice) != 0) {
+            failure = "restore nice " + std::to_string(mOriginNice) + " : " + std::strerror(errno);
+        }
+    }
+    return failure;
+}
+
+void
+ThreadRoles::parserConfigure()
+{
+    mParser.description("thread role command");
+    mParser.opt("show", "", "show per role thread count, CPU time, affinity and priority",
+                [&](Arg& arg) -> bool { return arg.msg(show() + '\n'); });
+}
+
+} // namespace arras_render
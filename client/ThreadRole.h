@@ -0,0 +1,137 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <scene_rdl2/common/grid_util/Arg.h>
+#include <scene_rdl2/common/grid_util/Parser.h>
+
+#include <json/json.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sched.h> // cpu_set_t
+#include <time.h>  // clockid_t
+
+namespace arras_render {
+
+enum class ThreadRole : int {
+    MAIN = 0,     // main thread, runs the Qt event loop in gui mode
+    MESSAGE,      // SDK message handler thread (frame decode)
+    SETUP,        // setupSession thread
+    SCRIPT,       // Scripting::runScriptThread
+    CAM_PLAYBACK, // CamPlayback polling thread
+    DENOISE,      // DenoiseStage
+    JPEG,         // JpegPipeline encoders
+    HISTORY,      // FrameHistory encoder
+    POSE_CACHE,   // PoseCache encoder
+    PUBLISH,      // FramePublisher
+    SEND,         // OutboundSession
+    WATCHDOG,     // StallWatchdog
+    MOCK,         // MockSession render thread
+    SIZE
+};
+
+class ThreadRoles
+//
+// Names the client threads by role and applies the CPU affinity and the priority configured for the
+// role when a thread enters it, so that the decode thread can be kept away from the other heavy
+// applications of a shared workstation. Affinity is a CPU list ("0-3,8") or a NUMA node ("node1" :
+// the CPUs of /sys/devices/system/node/node1), priority is the nice value of the thread (a negative
+// value needs CAP_SYS_NICE). The configuration has to be done before the threads are started.
+// A new thread inherits the affinity and the nice value of the thread which created it (i.e. the
+// configured main thread), so a role without configuration gets back the values the process started
+// with when it enters. Threads which never enter a role (Qt, SDK internals, parallelFor() bands) keep
+// the inherited values.
+// CPU time is accumulated by role : a live thread is read by its CPU clock and a thread which left
+// adds its total. A thread which ends without leave() (SDK message thread) counts up to the last report.
+// The main thread is never renamed because its name is the process name of ps and top.
+//
+{
+public:
+    using Arg = scene_rdl2::grid_util::Arg;
+    using Parser = scene_rdl2::grid_util::Parser;
+
+    static constexpr int ROLE_TOTAL = static_cast<int>(ThreadRole::SIZE);
+
+    static ThreadRoles& get(); // process wide singleton
+
+    bool setAffinity(const std::string& spec, std::string& error); // "<role>:<cpuList|nodeN>"
+    bool setPriority(const std::string& spec, std::string& error); // "<role>:<nice>"
+
+    void enter(const ThreadRole role); // calling thread
+    void enterOnce(const ThreadRole role); // calling thread, for threads not started by the client (SDK)
+    void leave(); // calling thread, before the thread ends
+
+    // tid and name of the threads which entered a role
+    std::vector<std::pair<int, std::string>> getThreadNames() const;
+
+    std::string show() const;
+    Json::Value toJson() const; // per role CPU time
+
+    static std::string showRole(const ThreadRole role);
+    static bool parseRole(const std::string& name, ThreadRole& role);
+
+    Parser& getParser() { return mParser; }
+
+private:
+    struct Config {
+        bool mAffinity {false};
+        std::string mAffinitySpec;
+        cpu_set_t mCpuSet;
+        bool mPriority {false};
+        int mNice {0};
+        bool mWarned {false}; // apply failure is reported once per role
+    };
+
+    struct Thread {
+        ThreadRole mRole {ThreadRole::MAIN};
+        clockid_t mClock {};
+        double mLastCpuSec {0.0};
+    };
+
+    struct Usage {
+        unsigned mThreadTotal {0}; // number of enter()
+        double mDoneCpuSec {0.0}; // threads which left
+    };
+
+    ThreadRoles();
+
+    static bool parseSpec(const std::string& spec, ThreadRole& role, std::string& value, std::string& error);
+    static bool parseCpuList(const std::string& list, cpu_set_t& cpuSet, std::string& error);
+    static std::string threadName(const ThreadRole role);
+    static int getTid();
+
+    void collectMain(double cpuSec[ROLE_TOTAL]) const; // mMutex locked by the caller
+    // mMutex locked by the caller, returns the failure
+    std::string restoreOriginMain(const int tid, const Config& config) const;
+
+    void parserConfigure();
+
+    mutable std::mutex mMutex;
+    bool mConfigured {false}; // any role has the affinity or the priority
+    bool mOriginAffinity {false};
+    cpu_set_t mOriginCpuSet; // affinity of the process at startup
+    int mOriginNice {0};
+    Config mConfig[ROLE_TOTAL];
+    Usage mUsage[ROLE_TOTAL];
+    mutable std::map<int, Thread> mThread; // live threads by tid
+
+    Parser mParser;
+};
+
+class ThreadRoleScope
+//
+// Enters the role at construction and leaves at destruction, placed at the top of a thread main
+//
+{
+public:
+    explicit ThreadRoleScope(const ThreadRole role) { ThreadRoles::get().enter(role); }
+    ~ThreadRoleScope() { ThreadRoles::get().leave(); }
+};
+
+} // namespace arras_render
@@ -0,0 +1,166 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#include "Trace.h"
+#include "ThreadRole.h"
+
+#include <scene_rdl2/render/util/StrUtil.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace arras_render {
+
+// static function
+Trace&
+Trace::get()
+{
+    static Trace sTrace;
+    return sTrace;
+}
+
+Trace::Trace()
+    : mOrigin(Clock::now())
+    , mRing(DEFAULT_CAPACITY)
+{
+    parserConfigure();
+}
+
+void
+Trace::start()
+{
+    mActive = true;
+}
+
+void
+Trace::stop()
+{
+    mActive = false;
+}
+
+void
+Trace::record(const char* name,
+              const Clock::time_point& begin,
+              const Clock::time_point& end,
+              const uint64_t size,
+              const int64_t syncId)
+{
+    // seq_cst on both sides : either clear()/dump() sees this writer or this writer sees mActive false.
+    // acquire/relaxed here does not order the mWriter increment before the mActive load.
+    mWriter.fetch_add(1, std::memory_order_seq_cst);
+    if (mActive.load(std::memory_order_seq_cst)) {
+        Event& event = mRing[mNext.fetch_add(1, std::memory_order_relaxed) % mRing.size()];
+        event.mName = name;
+        event.mBeginUs = std::chrono::duration_cast<std::chrono::microseconds>(begin - mOrigin).count();
+        event.mDurUs = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+        event.mSize = size;
+        event.mSyncId = syncId;
+        event.mTid = getTid();
+    }
+    mWriter.fetch_sub(1, std::memory_order_release);
+}
+
+void
+Trace::clear()
+{
+    const bool active = mActive.exchange(false, std::memory_order_seq_cst);
+    while (mWriter.load(std::memory_order_seq_cst)) std::this_thread::yield();
+    mNext = 0;
+    mActive = active;
+}
+
+bool
+Trace::dump(const std::string& filename, std::string& error)
+{
+    error.clear();
+
+    std::ofstream fout(filename, std::ios::trunc);
+    if (!fout) {
+        std::ostringstream ostr;
+        ostr << "Can not create file. filename:" << filename;
+        error = ostr.str();
+        return false;
+    }
+
+    // Recording is paused during the dump so that no slot is rewritten while we read it.
+    const bool active = mActive.exchange(false, std::memory_order_seq_cst);
+    while (mWriter.load(std::memory_order_seq_cst)) std::this_thread::yield();
+
+    const uint64_t next = mNext.load();
+    const uint64_t total = std::min(next, static_cast<uint64_t>(mRing.size()));
+    const pid_t pid = getpid();
+
+    fout << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    const auto threadNames = ThreadRoles::get().getThreadNames();
+    for (size_t i = 0; i < threadNames.size(); ++i) {
+        fout << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << threadNames[i].first
+             << ",\"args\":{\"name\":\"" << threadNames[i].second << "\"}}"
+             << ((i + 1 < threadNames.size() || total > 0) ? ",\n" : "\n");
+    }
+    for (uint64_t i = 0; i < total; ++i) {
+        const Event& event = mRing[(next - total + i) % mRing.size()];
+        fout << "{\"name\":\"" << event.mName << "\",\"cat\":\"arras_render\",\"ph\":\"X\""
+             << ",\"ts\":" << event.mBeginUs
+             << ",\"dur\":" << event.mDurUs
+             << ",\"pid\":" << pid
+             << ",\"tid\":" << event.mTid
+             << ",\"args\":{\"size\":" << event.mSize;
+        if (event.mSyncId >= 0) fout << ",\"syncId\":" << event.mSyncId;
+        fout << "}}" << ((i + 1 < total) ? ",\n" : "\n");
+    }
+    fout << "]}\n";
+    fout.close();
+
+    mActive = active;
+    return true;
+}
+
+std::string
+Trace::show() const
+{
+    const uint64_t next = mNext.load();
+    std::ostringstream ostr;
+    ostr << "Trace {\n"
+         << "  active:" << scene_rdl2::str_util::boolStr(isActive()) << '\n'
+         << "  capacity:" << mRing.size() << '\n'
+         << "  recorded:" << next << '\n'
+         << "  overwritten:" << ((next > mRing.size()) ? next - mRing.size() : 0) << '\n'
+         << "}";
+    return ostr.str();
+}
+
+// static function
+int
+Trace::getTid()
+{
+    thread_local const int sTid = static_cast<int>(syscall(SYS_gettid));
+    return sTid;
+}
+
+void
+Trace::parserConfigure()
+{
+    mParser.description("client pipeline trace command");
+    mParser.opt("start", "", "start recording trace spans",
+                [&](Arg& arg) -> bool { start(); return arg.msg("trace started\n"); });
+    mParser.opt("stop", "", "stop recording trace spans",
+                [&](Arg& arg) -> bool { stop(); return arg.msg("trace stopped\n"); });
+    mParser.opt("dump", "<file>", "write recorded spans as Chrome trace JSON",
+                [&](Arg& arg) -> bool {
+                    std::string filename = (arg++)();
+                    std::string error;
+                    if (!dump(filename, error)) return arg.msg(error + '\n');
+                    return arg.msg("dump " + filename + '\n');
+                });
+    mParser.opt("clear", "", "discard recorded spans",
+                [&](Arg& arg) -> bool { clear(); return arg.msg("CLEAR\n"); });
+    mParser.opt("show", "", "show trace status",
+                [&](Arg& arg) -> bool { return arg.msg(show() + '\n'); });
+}
+
+} // namespace arras_render
@@ -0,0 +1,159 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <scene_rdl2/common/grid_util/Arg.h>
+#include <scene_rdl2/common/grid_util/Parser.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace arras_render {
+
+class Trace
+//
+// Ring-buffered span recorder of the client pipeline (message receive, decode, RGB conversion,
+// paint, EXR write, credit, scene serialization, sendMessage ...). Recording is a couple of atomic
+// operations plus a slot write, and nothing is recorded while tracing is stopped. When the ring is
+// full, the oldest spans are overwritten. dump() writes the Chrome trace event JSON format which
+// can be opened by chrome://tracing or https://ui.perfetto.dev.
+//
+// Controlled by the debug console : trace start | stop | dump <file> | show
+//
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using Arg = scene_rdl2::grid_util::Arg;
+    using Parser = scene_rdl2::grid_util::Parser;
+
+    static constexpr size_t DEFAULT_CAPACITY = 1 << 16;
+
+    static Trace& get(); // process wide singleton
+
+    void start();
+    void stop();
+    bool isActive() const { return mActive.load(std::memory_order_relaxed); }
+
+    // name should be a string literal, only the pointer is kept.
+    // syncId < 0 means no syncId.
+    void record(const char* name,
+                const Clock::time_point& begin,
+                const Clock::time_point& end,
+                const uint64_t size,
+                const int64_t syncId);
+
+    void clear();
+    bool dump(const std::string& filename, std::string& error);
+
+    std::string show() const;
+
+    // The innermost open TraceSpan name of the calling thread is published to this slot whether
+    // tracing is active or not (StallWatchdog), nullptr : not published.
+    static std::atomic<const char*>*& stageSlot()
+    {
+        thread_local std::atomic<const char*>* sSlot = nullptr;
+        return sSlot;
+    }
+
+    Parser& getParser() { return mParser; }
+
+private:
+    struct Event {
+        const char* mName {nullptr};
+        int64_t mBeginUs {0};
+        int64_t mDurUs {0};
+        uint64_t mSize {0};
+        int64_t mSyncId {-1};
+        int mTid {0};
+    };
+
+    Trace();
+
+    static int getTid();
+
+    void parserConfigure();
+
+    const Clock::time_point mOrigin;
+
+    std::atomic<bool> mActive {false};
+    std::atomic<int> mWriter {0}; // number of record() in flight
+    std::atomic<uint64_t> mNext {0};
+    std::vector<Event> mRing;
+
+    Parser mParser;
+};
+
+class TraceSpan
+//
+// Scoped span. Records from construction to destruction (or end()) when tracing is active.
+// The open spans of a thread are linked from the innermost one, the stage slot is only set back by the
+// end of the innermost span. An outer span ended first is popped together with it.
+//
+{
+public:
+    explicit TraceSpan(const char* name, const uint64_t size = 0, const int64_t syncId = -1)
+        : mName(name)
+        , mSize(size)
+        , mSyncId(syncId)
+        , mActive(Trace::get().isActive())
+        , mStageSlot(Trace::stageSlot())
+    {
+        if (mStageSlot) {
+            mPrevStage = mStageSlot->exchange(name, std::memory_order_relaxed);
+            mOuter = innermost();
+            innermost() = this;
+        }
+        if (mActive) mBegin = Trace::Clock::now();
+    }
+    ~TraceSpan() { end(); }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    void setSize(const uint64_t size) { mSize = size; }
+    void setSyncId(const int64_t syncId) { mSyncId = syncId; }
+
+    void end()
+    {
+        if (mStageSlot) {
+            mStageOpen = false;
+            if (innermost() == this) {
+                const char* stage = mPrevStage;
+                TraceSpan* outer = mOuter;
+                while (outer && !outer->mStageOpen) { // ended out of order
+                    stage = outer->mPrevStage;
+                    outer = outer->mOuter;
+                }
+                innermost() = outer;
+                mStageSlot->store(stage, std::memory_order_relaxed);
+            } // otherwise an inner span is still open and keeps its stage
+            mStageSlot = nullptr;
+        }
+        if (!mActive) return;
+        mActive = false;
+        Trace::get().record(mName, mBegin, Trace::Clock::now(), mSize, mSyncId);
+    }
+
+private:
+    static TraceSpan*& innermost()
+    {
+        thread_local TraceSpan* sInnermost = nullptr;
+        return sInnermost;
+    }
+
+    const char* mName;
+    uint64_t mSize;
+    int64_t mSyncId;
+    bool mActive;
+    Trace::Clock::time_point mBegin;
+    std::atomic<const char*>* mStageSlot;
+    const char* mPrevStage {nullptr};
+    TraceSpan* mOuter {nullptr}; // next open span of the thread
+    bool mStageOpen {true};
+};
+
+} // namespace arras_render
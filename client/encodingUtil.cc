@@ -2,6 +2,8 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "encodingUtil.h"
+#include "PixelKernels.h"
+#include "Trace.h"
 
 #include <cassert>
 #include <iostream>
@@ -53,6 +55,8 @@ writeBuffersToExr(const std::string& exrFileName,
 void
 writeExrFile(const std::string& exrFileName, mcrt_dataio::ClientReceiverFb& fbReceiver)
 {
+    TraceSpan span("writeExr");
+
     const unsigned int width = fbReceiver.getWidth();
     const unsigned int height = fbReceiver.getHeight();
 
@@ -65,6 +69,7 @@ writeExrFile(const std::string& exrFileName, mcrt_dataio::ClientReceiverFb& fbRe
     spec.attribute("subimagename", "beauty");
     spec.attribute("name", "beauty");
 
+    // the receiver fills the EXR layout directly, there is no client side pixel loop to dispatch
     buffers.emplace_back(width * height * NUM_BTY_CHANNELS);
     fbReceiver.getBeauty(buffers.back(), true);
 
@@ -88,4 +93,73 @@ writeExrFile(const std::string& exrFileName, mcrt_dataio::ClientReceiverFb& fbRe
     writeBuffersToExr(exrFileName, specs, buffers);
 }
 
+bool
+writeExrImage(const std::string& exrFileName,
+              const std::string& name,
+              const std::vector<float>& data,
+              unsigned width,
+              unsigned height,
+              unsigned numChannels,
+              std::string& error)
+{
+    TraceSpan span("writeExr");
+
+    if (data.size() != static_cast<size_t>(width) * height * numChannels) {
+        error = "image size mismatch. name:" + name;
+        return false;
+    }
+
+    std::unique_ptr<OIIO::ImageOutput> out(OIIO::ImageOutput::create(exrFileName));
+    if (!out) {
+        error = "Can not create file. filename:" + exrFileName + ' ' + OIIO::geterror();
+        return false;
+    }
+
+    OIIO::ImageSpec spec(width, height, numChannels, OIIO::TypeDesc::FLOAT);
+    spec.attribute("subimagename", name);
+    spec.attribute("name", name);
+    if (!out->open(exrFileName, spec) ||
+        !out->write_image(OIIO::TypeDesc::FLOAT, data.data()) ||
+        !out->close()) {
+        error = "Could not write image. filename:" + exrFileName + ' ' + out->geterror();
+        return false;
+    }
+    return true;
+}
+
+bool
+readExrBeauty(const std::string& exrFileName,
+              std::vector<float>& rgba,
+              unsigned& width,
+              unsigned& height,
+              std::string& error)
+{
+    std::unique_ptr<OIIO::ImageInput> in(OIIO::ImageInput::open(exrFileName));
+    if (!in) {
+        error = "Could not open file. filename:" + exrFileName + ' ' + OIIO::geterror();
+        return false;
+    }
+
+    // The first subimage is the beauty when the file is written by writeExrFile()
+    const OIIO::ImageSpec& spec = in->spec();
+    if (spec.nchannels < 3) {
+        error = "beauty needs at least RGB channels. filename:" + exrFileName;
+        return false;
+    }
+    width = static_cast<unsigned>(spec.width);
+    height = static_cast<unsigned>(spec.height);
+
+    // RGB is packed into the RGBA layout of ClientReceiverFb::getBeauty(), alpha is set to 1.0
+    const size_t pixTotal = static_cast<size_t>(width) * height;
+    std::vector<float> rgb(pixTotal * 3);
+    if (!in->read_image(0, 3, OIIO::TypeDesc::FLOAT, rgb.data())) {
+        error = "Could not read image. filename:" + exrFileName + ' ' + in->geterror();
+        return false;
+    }
+    in->close();
+    rgba.resize(pixTotal * NUM_BTY_CHANNELS);
+    getPixelKernels().mPackChannels(rgb.data(), 3, rgba.data(), NUM_BTY_CHANNELS, pixTotal, 1.0f);
+    return true;
+}
+
 } // end namespace
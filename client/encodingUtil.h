@@ -5,14 +5,44 @@
 #define ENCODING_UTIL_H
 
 #include <string>
+#include <vector>
 
 #include <mcrt_dataio/client/receiver/ClientReceiverFb.h>
+#include <OpenImageIO/oiioversion.h>
+
+OIIO_NAMESPACE_BEGIN
+class ImageSpec;
+OIIO_NAMESPACE_END
 
 namespace arras_render {
 
+// Writes one subimage per spec, buffers[i] holds the pixels of specs[i]
+void
+writeBuffersToExr(const std::string& exrFileName,
+                  const std::vector<OIIO::ImageSpec>& specs,
+                  const std::vector<std::vector<float>>& buffers);
+
 void
 writeExrFile(const std::string& exrFileName, mcrt_dataio::ClientReceiverFb& fbReceiver);
 
+// Writes a single subimage float EXR, interleaved channels, top to bottom scanline
+bool
+writeExrImage(const std::string& exrFileName,
+              const std::string& name,
+              const std::vector<float>& data,
+              unsigned width,
+              unsigned height,
+              unsigned numChannels,
+              std::string& error);
+
+// Reads the beauty (first subimage) as RGBA float, top to bottom scanline
+bool
+readExrBeauty(const std::string& exrFileName,
+              std::vector<float>& rgba,
+              unsigned& width,
+              unsigned& height,
+              std::string& error);
+
 }
 
 #endif /* ENCODING_UTIL_H */
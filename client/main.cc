@@ -3,6 +3,7 @@
 
 #include "DebugConsoleSetup.h"
 
+#include <algorithm> // max
 #include <atomic>
 #include <chrono>
 #include <cmath> // round
@@ -12,6 +13,7 @@
 #include <iostream>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
 #include <streambuf>
@@ -57,9 +59,33 @@
 
 #include <sdk/sdk.h>
 
+#include "BenchmarkStats.h"
+#include "ConvergenceBench.h"
+#include "DenoiseStage.h"
+#include "DepthReprojector.h"
+#include "DisplayTransform.h"
+#include "EditLatency.h"
 #include "encodingUtil.h"
+#include "FrameHistory.h"
+#include "FramePublisher.h"
+#include "HeatMapAccum.h"
 #include "ImageView.h"
+#include "JpegPipeline.h"
+#include "MockSession.h"
+#include "NodeStats.h"
+#include "OutboundSession.h"
+#include "PerfHud.h"
+#include "PixelKernels.h"
+#include "PoseCache.h"
+#include "RenderEta.h"
 #include "outputRate.h"
+#include "ScenarioBench.h"
+#include "SdkSession.h"
+#include "SessionSweep.h"
+#include "StallWatchdog.h"
+#include "StartupReport.h"
+#include "ThreadRole.h"
+#include "Trace.h"
 
 using namespace arras_render;
 using namespace std::literals::string_literals;
@@ -69,6 +95,13 @@ unsigned short constexpr DEFAULT_CON_WAIT_SECS = 30;
 unsigned short constexpr DEFAULT_LOG_LEVEL = 2;
 unsigned short constexpr DEFAULT_ACAP_PORT = 8087;
 constexpr float ONE_MB_IN_BYTES = 1024.0f * 1024.0f;
+constexpr int BENCHMARK_REGRESSION_EXIT_STATUS = 2;
+constexpr float HOTSPOT_PICK_TIMEOUT_SEC = 10.0f;
+// "Rendering ETA" progress message : at most every interval unless the remaining time moves by the
+// fraction (and at least the sec) of the last sent estimate
+constexpr float ETA_PROGRESS_INTERVAL_SEC = 5.0f;
+constexpr float ETA_PROGRESS_CHANGE = 0.1f;
+constexpr float ETA_PROGRESS_CHANGE_MIN_SEC = 1.0f;
 
 const std::string DEFAULT_PROG_SESSION_NAME = "mcrt_progressive"s;
 const std::string MULTI_PROG_SESSION_NAME = "mcrt_progressive_n"s;
@@ -84,6 +117,7 @@ std::atomic<bool> frameWritten(false);
 std::atomic<bool> arrasStopped(false);
 std::atomic<bool> arrasExceptionThrown(false);
 std::atomic<ImageView*> pImageView(nullptr);
+std::mutex headlessFrameMux; // guards ClientReceiverFb decode when there is no ImageView
 
 std::atomic<bool> receivedFirstPixels(false);
 std::atomic<bool> reachedOnePercent(false);
@@ -93,6 +127,11 @@ std::chrono::time_point<std::chrono::steady_clock> beforeCreateSession;
 NotifiedValue<float> progressPercent(0.0);
 std::atomic<bool> benchmarkMode(false);
 std::atomic<bool> showStats(false); // show ClientReceiverFb's statistical info
+SessionSweep::Point sessionOverrides; // sweep grid point applied by getSessionDefinition()
+std::shared_ptr<RenderEta> renderEta = std::make_shared<RenderEta>(); // completion ETA of the current render
+std::chrono::time_point<std::chrono::steady_clock> etaProgressTime; // last "Rendering ETA" progress message
+float etaProgressRemainSec = -1.0f; // remaining sec of the last sent ETA, negative : not sent in this render
+std::shared_ptr<NodeStats> nodeStats = std::make_shared<NodeStats>(); // per MCRT node throughput
 
 bool clientReceiverHeadlessMode = false;
 
@@ -182,10 +221,64 @@ parseCmdLine(int argc, char* argv[],
         ("exit-after-script", bpo::bool_switch(), "Exit after script is done")
         ("auto-credit-off","disable sending out credit after each frame is received")
         ("lag-ms",bpo::value<unsigned>()->default_value(0),"Simulate network delay by sleeping for n milliseconds")
+        ("stall-ms", bpo::value<unsigned>()->default_value(500), "Report a GUI event loop or message thread stall longer than this with the stage, lock owners and queue sizes (0 : disabled)")
+        ("send-direct", bpo::bool_switch()->default_value(false), "Send messages on the producing thread instead of the prioritized outbound queue")
         ("athena-env",bpo::value<std::string>()->default_value("prod"s),"Environment for Athena logging")
         ("trace-level",bpo::value<int>()->default_value(0),"trace threshold level (-1=none,5=max)")
         ("min-update-ms",bpo::value<unsigned>()->default_value(0), "minimum camera update interval (milliseconds)")
         ("benchmark", bpo::bool_switch()->default_value(false), "When used with --no-gui, enable benchmark mode")
+        ("benchmark-repeat", bpo::value<unsigned>()->default_value(1), "Number of benchmark trials, each on a new session")
+        ("benchmark-out", bpo::value<std::string>(), "Save benchmark milestone statistics to a JSON file (usable as --benchmark-baseline)")
+        ("benchmark-baseline", bpo::value<std::string>(), "Compare benchmark milestones against a baseline JSON file and exit non-zero on a significant regression")
+        ("benchmark-threshold", bpo::value<float>()->default_value(5.0f), "Minimum slowdown percentage against the baseline reported as a regression")
+        ("scenario", bpo::value<std::vector<std::string>>()->multitoken(), "With --benchmark, run interactive scenarios instead of the delta re-render (orbit lightColor aov roi all)")
+        ("scenario-repeat", bpo::value<unsigned>()->default_value(5), "Number of repeats of each scenario")
+        ("scenario-progress", bpo::value<float>()->default_value(10.0f), "Progress percentage measured as edit-to-N% by the scenarios")
+        ("scenario-timeout", bpo::value<float>()->default_value(60.0f), "Timeout in seconds of each scenario edit")
+        ("convergence-ref", bpo::value<std::string>(), "With --benchmark, measure the convergence of the initial render against a converged reference EXR")
+        ("convergence-interval", bpo::value<float>()->default_value(1.0f), "Convergence sampling interval in seconds")
+        ("convergence-threshold", bpo::value<std::vector<float>>()->multitoken(), "Relative MSE thresholds timed by the convergence benchmark (default 0.1 0.01 0.001)")
+        ("convergence-csv", bpo::value<std::string>(), "Save the error-over-time curve of the convergence benchmark to a CSV file")
+        ("sweep", bpo::value<std::vector<std::string>>()->multitoken(), "With --benchmark, run the benchmark for every point of a session definition parameter grid (<computation>.<key>=<value>,<value>... '*' as computation applies to all)")
+        ("sweep-out", bpo::value<std::string>(), "Save the sweep results table to a JSON file")
+        ("ab-session", bpo::value<std::string>(), "Compare against a second session (B) of this session definition driven by the same scene updates, requires gui mode")
+        ("ab-num-mcrt", bpo::value<std::string>(), "Number of MCRT computations of the B session (default --num-mcrt)")
+        ("ab-override", bpo::value<std::vector<std::string>>()->multitoken(), "Session definition overrides of the B session (<computation>.<key>=<value> '*' as computation applies to all)")
+        ("ab-view", bpo::value<std::string>()->default_value("side"s), "A/B comparison view (side diff)")
+        ("ab-log", bpo::value<std::string>(), "Save the progress of both A/B sessions per displayed frame to a CSV file")
+        ("mock", bpo::bool_switch()->default_value(false), "Use the in-process mock render engine instead of an Arras session (no coordinator or pool)")
+        ("mock-fps", bpo::value<float>()->default_value(0.0f), "Mock engine frame rate, 0 uses the fps of the session definition")
+        ("mock-duration", bpo::value<float>()->default_value(10.0f), "Mock engine render time in seconds to 100%")
+        ("mock-tiles", bpo::value<std::string>()->default_value("random"s), "Mock engine tile arrival pattern (all scanline random)")
+        ("mock-aov", bpo::value<std::vector<std::string>>()->multitoken(), "Mock engine AOV names")
+        ("heatmap-exr", bpo::value<std::string>(), "Accumulate the *heatMap* pass over all renders and save the total per pixel cost to a float EXR at exit")
+        ("heatmap-report", bpo::value<std::string>(), "Accumulate the *heatMap* pass and save the hotspot tile ranking to a JSON file at exit")
+        ("heatmap-top", bpo::value<unsigned>()->default_value(10), "Number of hotspot tiles in the heat map report")
+        ("heatmap-tile", bpo::value<unsigned>()->default_value(32), "Hotspot tile size in pixels")
+        ("heatmap-pick", bpo::bool_switch()->default_value(false), "Request geometry and material pick data for the center of each hotspot tile before exit")
+        ("shm-publish", bpo::value<std::string>(), "Publish the latest decoded frame buffers to a POSIX shared memory ring of this name for local readers")
+        ("shm-slots", bpo::value<unsigned>()->default_value(3), "Number of frames in the shared memory ring")
+        ("jpeg-snapshot", bpo::value<std::string>(), "Write JPEG snapshots of the displayed image as <prefix>_<seq>.jpg")
+        ("jpeg-interval", bpo::value<float>()->default_value(0.0f), "JPEG snapshot interval in seconds (0 disables)")
+        ("jpeg-percent", bpo::value<float>()->default_value(10.0f), "JPEG snapshot interval in progress percentage (0 disables)")
+        ("jpeg-stream", bpo::value<std::string>(), "Append every displayed frame to a continuous MJPEG file or FIFO")
+        ("jpeg-quality", bpo::value<unsigned>()->default_value(85), "JPEG quality [1-100]")
+        ("jpeg-threads", bpo::value<unsigned>()->default_value(2), "Number of JPEG encoding threads")
+        ("history-mb", bpo::value<unsigned>()->default_value(0), "GUI frame history memory budget in MB for before/after flipping (0 : disabled, e.g. 128)")
+        ("history-progress", bpo::value<float>()->default_value(0.9f), "Progress fraction [0-1] at which a render is stored in the frame history")
+        ("pose-cache-mb", bpo::value<unsigned>()->default_value(0), "GUI camera pose cache memory budget in MB, revisited poses show the cached image (0 : disabled, e.g. 64)")
+        ("pose-cache-dir", bpo::value<std::string>(), "Spill directory of the camera pose cache, least recently used images are moved here")
+        ("pose-cache-disk-mb", bpo::value<unsigned>()->default_value(1024), "Camera pose cache spill directory budget in MB")
+        ("reproject", bpo::bool_switch()->default_value(false), "GUI camera moves show the last frame reprojected by the depth AOV until pixels of the new pose arrive")
+        ("reproject-aov", bpo::value<std::string>()->default_value("depth"s), "Name of the depth AOV (camera space z) used by --reproject")
+        ("reproject-threads", bpo::value<unsigned>()->default_value(0), "Number of reprojection threads (0 : auto)")
+        ("denoise-async", bpo::bool_switch()->default_value(false), "GUI denoise (N key) runs as a background stage, the display shows the latest denoised frame or the raw one while denoise lags")
+        ("exposure", bpo::value<float>()->default_value(0.0f), "GUI display exposure in stops ('-' '=' keys change it by half a stop, '0' resets)")
+        ("gamma", bpo::value<float>()->default_value(1.0f), "GUI display gamma (1.0 : same as the receiver conversion)")
+        ("view-lut", bpo::value<std::string>(), "3D view LUT (.cube) applied to the GUI display after exposure and gamma")
+        ("display-threads", bpo::value<unsigned>()->default_value(0), "Number of display transform threads (0 : auto)")
+        ("perf-hud", bpo::bool_switch()->default_value(false), "GUI starts with the client performance HUD shown (H key toggles it)")
+        ("denoise-duty", bpo::value<float>()->default_value(0.5f), "Fraction of the background denoise thread time spent for denoising, sets the adaptive denoise interval")
         ("progress-channel", bpo::value<std::string>()->default_value(std::string("default"s)), "Channel to send progress/status")
         ("no-scale", bpo::bool_switch(), "Don't scale the image on startup.")
         ("infoRec",bpo::value<float>()->default_value(0.0f),"infoRec interval (sec). disable if set 0.0")
@@ -194,6 +287,9 @@ parseCmdLine(int argc, char* argv[],
         ("showStats",bpo::bool_switch()->default_value(false), "Display clientReceiverFb's statistical info to the cerr")
         ("debug-console",bpo::value<int>()->default_value(-1),"specify debug console port.")
         ("current-env",bpo::bool_switch()->default_value(false), "Use current environment as computation environment")
+        ("thread-affinity", bpo::value<std::vector<std::string>>()->multitoken(), "Pin client thread roles to CPUs, <role>:<cpuList|nodeN> e.g. message:0-3 main:node1 (roles : main message setup script camPlayback denoise jpeg history poseCache publish send watchdog mock)")
+        ("thread-priority", bpo::value<std::vector<std::string>>()->multitoken(), "Nice value of client thread roles, <role>:<nice> e.g. message:-5 denoise:10 (a negative value needs CAP_SYS_NICE)")
+        ("show-cpu-dispatch",bpo::bool_switch()->default_value(false), "Show the pixel kernel variants supported by this CPU and the selected one (ARRAS_RENDER_CPU_DISPATCH overrides), then exit")
     ;
 
     bpo::positional_options_description positionals;
@@ -206,7 +302,7 @@ parseCmdLine(int argc, char* argv[],
 
 
 std::string
-getArrasUrl(arras4::sdk::SDK& sdk, const bpo::variables_map& cmdOpts)
+getArrasUrl(RenderSession& sdk, const bpo::variables_map& cmdOpts)
 {
     std::string url;
     if (cmdOpts.count("host")) {
@@ -227,9 +323,10 @@ getArrasUrl(arras4::sdk::SDK& sdk, const bpo::variables_map& cmdOpts)
 }
 
 void
-parseNumMCRT(const bpo::variables_map& cmdOpts, unsigned short& numMcrtMin, unsigned short& numMcrtMax)
+parseNumMCRT(const bpo::variables_map& cmdOpts, unsigned short& numMcrtMin, unsigned short& numMcrtMax,
+             const std::string& optionName = "num-mcrt"s)
 {
-    const std::string& numMcrt = cmdOpts["num-mcrt"].as<std::string>();
+    const std::string& numMcrt = cmdOpts[optionName].as<std::string>();
     std::list<std::string> tmpList;
     boost::split(tmpList, numMcrt, boost::is_any_of("-"));
     if (tmpList.size() == 1) {
@@ -317,6 +414,9 @@ getSessionDefinition(const std::string& sessionName,
         if (def.has("merge")) def["merge"]["fps"] = fps;
     }
 
+    // sweep overrides are applied last
+    SessionSweep::apply(sessionOverrides, def);
+
     // rez context
     //   try to attach a context defined in our environment
     bool attached = false;
@@ -352,8 +452,8 @@ getSessionDefinition(const std::string& sessionName,
                             std::istreambuf_iterator<char>());
             envCtx["packaging_system"] = "bash"s;
             envCtx["script"] = content;
-        } else if (cmdOpts["current-env"].as<bool>()) {
-            // use the current environment of the launching process
+        } else if (cmdOpts["current-env"].as<bool>() || cmdOpts["mock"].as<bool>()) {
+            // use the current environment of the launching process (the mock engine does not use it)
             envCtx["packaging_system"] = "current-environment";
         } else {
             // build a new rez environment from our current rez environment
@@ -386,7 +486,7 @@ getSessionDefinition(const std::string& sessionName,
 }
 
 bool
-connect(arras4::sdk::SDK& sdk,
+connect(RenderSession& sdk,
         const std::string& sessionName,
         unsigned short numMcrtMin,
         unsigned short numMcrtMax,
@@ -411,9 +511,11 @@ connect(arras4::sdk::SDK& sdk,
         if (cmdOpts["rez-context"].as<bool>()) {
             bool hasClientReq = def["(client)"].isMember("requirements");
             ARRAS_LOG_INFO("Resolving context...");
+            StartupReport::get().begin(StartupReport::Phase::REZ_RESOLVE);
             if (!sdk.resolveRez(def, errString)) {
                 ARRAS_LOG_ERROR("Couldn't resolve context. Got error %s", errString.c_str());
             }
+            StartupReport::get().end(StartupReport::Phase::REZ_RESOLVE);
 
             beforeCreateSession = std::chrono::steady_clock::now();
             resolveTime = getElapsedString(std::chrono::duration_cast<std::chrono::seconds>(beforeCreateSession - beforeResolve));
@@ -427,9 +529,13 @@ connect(arras4::sdk::SDK& sdk,
             }
         }
 
+        StartupReport::get().begin(StartupReport::Phase::URL_LOOKUP);
         const std::string& arrasUrl = getArrasUrl(sdk, cmdOpts);
+        StartupReport::get().end(StartupReport::Phase::URL_LOOKUP);
         ARRAS_LOG_INFO("Finished getting service url. Creating session");
+        StartupReport::get().begin(StartupReport::Phase::CREATE_SESSION);
         const std::string& response = sdk.createSession(def, arrasUrl, so);
+        StartupReport::get().end(StartupReport::Phase::CREATE_SESSION);
         if (response.empty()) {
             ARRAS_LOG_ERROR("Failed to connect to Arras service: %s", arrasUrl.c_str());
             return false;
@@ -459,6 +565,11 @@ connect(arras4::sdk::SDK& sdk,
     return true;
 }
 
+std::mutex&
+getFrameMux()
+{
+    return pImageView ? pImageView.load()->getFrameMux() : headlessFrameMux;
+}
 
 bool
 isFinal(const mcrt::ProgressiveFrame& frame)
@@ -467,7 +578,7 @@ isFinal(const mcrt::ProgressiveFrame& frame)
 }
 
 void
-printFrameStats(std::shared_ptr<arras4::sdk::SDK> pSdk, const mcrt::ProgressiveFrame& frame)
+printFrameStats(std::shared_ptr<RenderSession> pSdk, const mcrt::ProgressiveFrame& frame)
 {
     const auto statusId = frame.getStatus();
     float progress = frame.getProgress() * 100.0f;
@@ -480,14 +591,18 @@ printFrameStats(std::shared_ptr<arras4::sdk::SDK> pSdk, const mcrt::ProgressiveF
         case mcrt::ProgressiveFrame::STARTED:
             status = "started"s;
             pSdk->progress("Render started"s);
+            renderEta->reset();
+            etaProgressRemainSec = -1.0f;
             break;
         case mcrt::ProgressiveFrame::RENDERING:
             status = "rendering"s;
             pSdk->progress("Rendering", roundedProgress);
+            renderEta->update(frame.getProgress());
             break;
         case mcrt::ProgressiveFrame::FINISHED:
             status = "finished"s;
             pSdk->progress("Render finished"s);
+            renderEta->update(frame.getProgress());
             finalFrame = true;
             break;
         case mcrt::ProgressiveFrame::CANCELLED:
@@ -520,25 +635,48 @@ printFrameStats(std::shared_ptr<arras4::sdk::SDK> pSdk, const mcrt::ProgressiveF
         << "\tFinal: " << finalFrame
         << "\tFirst: " << !receivedFirstPixels;
 
+    const std::string eta = renderEta->showEta();
+    if (!eta.empty()) {
+        msg << "\tETA: " << eta;
+
+        // not per frame, the progress channel would be flooded at the frame rate
+        const float remainSec = renderEta->getEstimate().mRemainSec;
+        const float sinceSec = std::chrono::duration<float>(now - etaProgressTime).count();
+        const float changeSec = std::max(etaProgressRemainSec * ETA_PROGRESS_CHANGE, ETA_PROGRESS_CHANGE_MIN_SEC);
+        if (finalFrame || etaProgressRemainSec < 0.0f || sinceSec >= ETA_PROGRESS_INTERVAL_SEC ||
+            std::abs(remainSec - etaProgressRemainSec) >= changeSec) {
+            pSdk->progress("Rendering ETA"s, eta);
+            etaProgressTime = now;
+            etaProgressRemainSec = remainSec;
+        }
+    }
+
     ARRAS_LOG_INFO(msg.str());
     if (benchmarkMode) {
         std::cout << "Progress " << progress << " ( " <<
                       std::setw(2) <<
-                      frameSizeMB << " MB)" <<
-                      std::endl;
+                      frameSizeMB << " MB)";
+        if (!eta.empty()) std::cout << " ETA " << eta;
+        std::cout << std::endl;
     }
 
     receivedFirstPixels = true;
 }
 
 void
-messageHandler(std::shared_ptr<arras4::sdk::SDK> pSdk,
+messageHandler(std::shared_ptr<RenderSession> pSdk,
                bool autoCredit,
                unsigned lag,
                std::shared_ptr<mcrt_dataio::ClientReceiverFb> pFbReceiver,
+               std::shared_ptr<EditLatency> pEditLatency,
+               std::shared_ptr<FramePublisher> pFramePublisher,
+               std::shared_ptr<JpegPipeline> pJpegPipeline,
+               std::shared_ptr<HeatMapAccum> pHeatMapAccum,
                const std::string& exrFileName,
                const arras4::api::Message& msg)
 {
+    ThreadRoles::get().enterOnce(ThreadRole::MESSAGE); // SDK thread
+    StallBusyScope stallBusy;
     pFbReceiver->updateStatsMsgInterval(); // update message interval statistical info
 
     if (msg.classId() == mcrt::GenericMessage::ID) {
@@ -555,6 +693,7 @@ messageHandler(std::shared_ptr<arras4::sdk::SDK> pSdk,
             ostr << "PICK_DATA_MESSAGE " << jw.write(jm->messagePayload());
             std::cerr << ostr.str();
             pFbReceiver->consoleDriver().showString(ostr.str() + '\n');
+            if (pHeatMapAccum) pHeatMapAccum->addPickData(jm->messagePayload());
             
         } else {
             auto& payload = jm->messagePayload();
@@ -568,42 +707,99 @@ messageHandler(std::shared_ptr<arras4::sdk::SDK> pSdk,
             std::this_thread::sleep_for(std::chrono::milliseconds(lag));
         }
 
+        TraceSpan recvSpan("recvProgressiveFrame");
+        std::shared_ptr<PerfHud> perfHud = pImageView ? pImageView.load()->getPerfHud() : nullptr;
+
         if (autoCredit) {
+            TraceSpan creditSpan("sendCredit");
             mcrt::CreditUpdate::Ptr creditMsg = std::make_shared<mcrt::CreditUpdate>();
             creditMsg->value() = 1;
             pSdk->sendMessage(creditMsg);
+            if (perfHud) perfHud->creditSent(1);
         }
 
         mcrt::ProgressiveFrame::ConstPtr frameMsg =  msg.contentAs<mcrt::ProgressiveFrame>();
+        StartupReport::get().endAfter(StartupReport::Phase::FIRST_FRAME_RECEIPT, StartupReport::Phase::RDL_SEND);
 
         printFrameStats(pSdk, *frameMsg);
 
         size_t totalSize = sizeof(mcrt::ProgressiveFrame);
         {
-            if (pImageView) {
-                pImageView.load()->getFrameMux().lock();
+            std::mutex& frameMux = getFrameMux();
+            {
+                TraceSpan waitSpan("frameMuxWait");
+                frameMux.lock();
+                StallWatchdog::get().noteLocked(StallWatchdog::Lock::FRAME_MUX);
             }
+            TraceSpan decodeSpan("decode");
+            const StartupReport::Clock::time_point decodeStart = StartupReport::Clock::now();
             pFbReceiver->decodeProgressiveFrame(*frameMsg, true,
                                                 [&]() {} /*no-op callback for started condition */,
                                                 [&](const std::string &comment) { // genericComment callBack func
                                                     std::cerr << ">> main.cc " << comment << '\n';
                                                 },
                                                 clientReceiverHeadlessMode);
-            if (pImageView) {
-                pImageView.load()->getFrameMux().unlock();
+            decodeSpan.setSyncId(pFbReceiver->getFrameId());
+            decodeSpan.end();
+            if (perfHud) {
+                perfHud->frameDecoded(std::chrono::duration<float, std::milli>(StartupReport::Clock::now() -
+                                                                               decodeStart).count());
+            }
+            if (pFbReceiver->getProgress() >= 0.0f) {
+                // the first frame which has image data
+                StartupReport::get().mark(StartupReport::Phase::FIRST_DECODE,
+                                          decodeStart, StartupReport::Clock::now());
             }
+            StallWatchdog::get().noteUnlocked(StallWatchdog::Lock::FRAME_MUX);
+            frameMux.unlock();
+        }
+        if (pImageView != nullptr) {
+            // background denoise decodes the same message on its own thread
+            std::shared_ptr<DenoiseStage> denoiseStage = pImageView.load()->getDenoiseStage();
+            if (denoiseStage) denoiseStage->push(frameMsg);
         }
         for (size_t i=0; i < frameMsg->mBuffers.size(); i++) {
             totalSize += sizeof(mcrt::BaseFrame::DataBuffer);
             totalSize += frameMsg->mBuffers[i].mDataLength;
         }
+        recvSpan.setSize(totalSize);
+        if (perfHud) perfHud->frameReceived(totalSize);
 
         if (pFbReceiver->getProgress() >= 0.0f) {
             // If getProgress() returns a negative value, image data is not received yet.
+            auto hasOutput = [&](const std::string& name) -> bool { // ScenarioBench aov and reprojection depth
+                for (const auto& buffer : frameMsg->mBuffers) {
+                    if (buffer.mName && name == buffer.mName) return true;
+                }
+                return false;
+            };
+            pEditLatency->frameRecord(pFbReceiver->getFrameId(), pFbReceiver->getProgress(), hasOutput);
+            if (pFramePublisher) {
+                std::vector<std::string> carried;
+                carried.reserve(frameMsg->mBuffers.size());
+                for (const auto& buffer : frameMsg->mBuffers) {
+                    if (buffer.mName) carried.emplace_back(buffer.mName);
+                }
+                pFramePublisher->notifyFrame(carried);
+            }
+            if (pHeatMapAccum) pHeatMapAccum->update(*pFbReceiver);
+            nodeStats->update(*pFbReceiver);
+
             if (pImageView != nullptr) {
+                pImageView.load()->noteFrameOutputs(pFbReceiver->getFrameId(), hasOutput);
                 pImageView.load()->displayFrame();
             } else {
                 // std::cerr << ">> main.cc pImageView is nullptr!!!\n"; // useful debug message
+                if (pJpegPipeline && pJpegPipeline->isDue(pFbReceiver->getProgress(), isFinal(*frameMsg))) {
+                    // no displayed image in headless mode, convert the beauty here only when needed
+                    static std::vector<unsigned char> rgbFrame;
+                    {
+                        TraceSpan span("rgbConvert");
+                        pFbReceiver->getBeautyRgb888(rgbFrame, true, false);
+                    }
+                    pJpegPipeline->push(rgbFrame, pFbReceiver->getWidth(), pFbReceiver->getHeight(),
+                                        pFbReceiver->getProgress(), isFinal(*frameMsg));
+                }
             }
 
             if (isFinal(*frameMsg) && !exrFileName.empty()) {
@@ -628,8 +824,56 @@ messageHandler(std::shared_ptr<arras4::sdk::SDK> pSdk,
     }
 }
 
+void
+abMessageHandler(std::shared_ptr<RenderSession> pSdk,
+                 bool autoCredit,
+                 unsigned lag,
+                 std::shared_ptr<mcrt_dataio::ClientReceiverFb> pFbReceiver,
+                 std::shared_ptr<EditLatency> pEditLatency,
+                 const arras4::api::Message& msg)
+//
+// Message handler of the B session of the A/B comparison. Only frames are used, they are decoded
+// under the same frame mutex as the A session and displayed by the same ImageView.
+//
+{
+    ThreadRoles::get().enterOnce(ThreadRole::MESSAGE); // SDK thread of the B session
+    StallBusyScope stallBusy(StallWatchdog::Watch::MESSAGE_B);
+    if (msg.classId() != mcrt::ProgressiveFrame::ID) return;
+
+    if (lag > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(lag));
+    }
+
+    if (autoCredit) {
+        mcrt::CreditUpdate::Ptr creditMsg = std::make_shared<mcrt::CreditUpdate>();
+        creditMsg->value() = 1;
+        pSdk->sendMessage(creditMsg);
+    }
+
+    mcrt::ProgressiveFrame::ConstPtr frameMsg = msg.contentAs<mcrt::ProgressiveFrame>();
+    {
+        StallLockGuard lock(getFrameMux(), StallWatchdog::Lock::FRAME_MUX);
+        TraceSpan decodeSpan("decodeB");
+        pFbReceiver->decodeProgressiveFrame(*frameMsg, true,
+                                            [&]() {} /*no-op callback for started condition */,
+                                            [&](const std::string &comment) { // genericComment callBack func
+                                                std::cerr << ">> main.cc B session " << comment << '\n';
+                                            },
+                                            clientReceiverHeadlessMode);
+        decodeSpan.setSyncId(pFbReceiver->getFrameId());
+    }
+
+    if (pFbReceiver->getProgress() >= 0.0f) {
+        pEditLatency->frameRecord(pFbReceiver->getFrameId(), pFbReceiver->getProgress());
+        if (pImageView != nullptr) {
+            pImageView.load()->displayFrameB();
+        }
+    }
+}
+
 std::unique_ptr<scene_rdl2::rdl2::SceneContext>
 sceneFromRDLFiles(const std::vector<std::string>& rdlFiles) {
+    StartupPhase phase(StartupReport::Phase::RDL_PARSE);
     auto sc = std::make_unique<scene_rdl2::rdl2::SceneContext>();
     sc->setProxyModeEnabled(true);
 
@@ -644,27 +888,38 @@ sceneFromRDLFiles(const std::vector<std::string>& rdlFiles) {
 }
 
 void
-sendRDL(arras4::sdk::SDK& sdk, scene_rdl2::rdl2::SceneContext& sc)
+sendRDL(RenderSession& sdk, scene_rdl2::rdl2::SceneContext& sc, EditLatency& editLatency)
 {
     receivedFirstPixels = false;
     ARRAS_LOG_DEBUG("Creating RDL Message");
     mcrt::RDLMessage::Ptr rdlMsg = std::make_shared<mcrt::RDLMessage>();
 
-    scene_rdl2::rdl2::BinaryWriter w(sc);
-    w.toBytes(rdlMsg->mManifest, rdlMsg->mPayload);
+    {
+        TraceSpan span("serializeScene");
+        StartupPhase phase(StartupReport::Phase::SCENE_SERIALIZE);
+        scene_rdl2::rdl2::BinaryWriter w(sc);
+        w.toBytes(rdlMsg->mManifest, rdlMsg->mPayload);
+        span.setSize(rdlMsg->mManifest.size() + rdlMsg->mPayload.size());
+    }
     
     rdlMsg->mSyncId = 0; // initial syncId
 
     ARRAS_LOG_DEBUG("Sending RDLMessage");
-    sdk.sendMessage(rdlMsg);
+    editLatency.sendRecord(static_cast<uint32_t>(rdlMsg->mSyncId));
+    {
+        TraceSpan span("sendMessage", rdlMsg->mManifest.size() + rdlMsg->mPayload.size(), rdlMsg->mSyncId);
+        StartupPhase phase(StartupReport::Phase::RDL_SEND);
+        sdk.sendMessage(rdlMsg);
+    }
 
     if (delayedRender) {
-        sdk.sendMessage(mcrt::RenderMessages::createControlMessage(true));
+        // in order behind the scene, a control message would go out before the queued scene
+        sdk.sendMessage(mcrt::RenderMessages::createControlMessage(true), RenderSession::SendClass::BULK);
     }
 }
 
 void
-statusHandler(std::shared_ptr<arras4::sdk::SDK> pSdk,
+statusHandler(std::shared_ptr<RenderSession> pSdk,
               const std::string& status)
 {
     // Check to see if the new status is a json doc
@@ -726,12 +981,13 @@ exceptionCallback(const std::exception& e)
 }
 
 bool
-createNewSession(arras4::sdk::SDK& sdk,
+createNewSession(RenderSession& sdk,
                  scene_rdl2::rdl2::SceneContext& sceneCtx,
                  const std::string& sessionName,
                  const unsigned short numMcrtMin,
                  const unsigned short numMcrtMax,
                  const unsigned aovInterval,
+                 EditLatency& editLatency,
                  const bpo::variables_map& cmdOpts,
                  /*out*/int& exitStatus)
 {
@@ -744,7 +1000,9 @@ createNewSession(arras4::sdk::SDK& sdk,
 
     ARRAS_LOG_INFO("Waiting for engine ready");
     setTelemetryClientMessage("Waiting for engine ready");
+    StartupReport::get().begin(StartupReport::Phase::ENGINE_READY_WAIT);
     bool ready = sdk.waitForEngineReady(cmdOpts["con-timeout"].as<unsigned short>());
+    StartupReport::get().end(StartupReport::Phase::ENGINE_READY_WAIT);
 
     if (!sdk.isConnected() || !ready || arrasStopped) {
         std::cerr << "Failed to connect!" << std::endl;
@@ -775,18 +1033,19 @@ createNewSession(arras4::sdk::SDK& sdk,
     while(!rdlSent && sdk.isConnected() && !arrasExceptionThrown && !arrasStopped) {
         if (sdk.isEngineReady()) {
             if (aovInterval > 0) {
+                StartupPhase phase(StartupReport::Phase::OUTPUT_RATES_SEND);
                 setOutputRate(sdk, aovInterval);
             }
 
             renderStart = std::chrono::steady_clock::now();
-            sendRDL(sdk, sceneCtx);
+            sendRDL(sdk, sceneCtx, editLatency);
             rdlSent = true;
             setTelemetryClientMessage("sent RDL");
         }
 
         sleep(1);
         if (delayedRender && rdlSent) {
-            sdk.sendMessage(mcrt::RenderMessages::createControlMessage(true));
+            sdk.sendMessage(mcrt::RenderMessages::createControlMessage(true), RenderSession::SendClass::BULK);
         }
     }
 
@@ -794,7 +1053,7 @@ createNewSession(arras4::sdk::SDK& sdk,
 }
 
 void
-logBenchmarkStatus(arras4::sdk::SDK& sdk,
+logBenchmarkStatus(RenderSession& sdk,
                    const char* infoMsg,
                    const std::string& stdoutMsg)
 {
@@ -805,7 +1064,7 @@ logBenchmarkStatus(arras4::sdk::SDK& sdk,
 }
 
 void
-benchLoop(arras4::sdk::SDK& sdk)
+benchLoop(RenderSession& sdk)
 {
     bool first = false;
     reachedOnePercent=false;
@@ -838,8 +1097,175 @@ benchLoop(arras4::sdk::SDK& sdk)
 }
 
 void
-execBenchmark(std::shared_ptr<arras4::sdk::SDK> pSdk, 
-              std::unique_ptr<scene_rdl2::rdl2::SceneContext> sceneCtx)
+addMilestoneStats(const EditLatency& editLatency,
+                  const uint32_t syncId,
+                  const std::string& prefix,
+                  BenchmarkStats& stats)
+//
+// Milestones are measured per syncId by EditLatency on every received frame, so they are not
+// quantized by the 1 sec polling of benchLoop().
+//
+{
+    float latency = 0.0f;
+    if (editLatency.waitMilestone(syncId, EditLatency::Milestone::FIRST_PIXEL, 0.0f, latency)) {
+        stats.add(prefix + "FirstFrame", latency);
+    }
+    if (editLatency.waitMilestone(syncId, EditLatency::Milestone::ONE_PERCENT, 0.0f, latency)) {
+        stats.add(prefix + "OnePercent", latency);
+    }
+    if (editLatency.waitMilestone(syncId, EditLatency::Milestone::TEN_PERCENT, 0.0f, latency)) {
+        stats.add(prefix + "TenPercent", latency);
+    }
+    if (editLatency.waitProgress(syncId, 1.0f, 0.0f, latency)) {
+        stats.add(prefix + "Complete", latency);
+    }
+}
+
+void
+execScenarioBenchmark(std::shared_ptr<RenderSession> pSdk,
+                      std::unique_ptr<scene_rdl2::rdl2::SceneContext> sceneCtx,
+                      std::shared_ptr<mcrt_dataio::ClientReceiverFb> pFbReceiver,
+                      EditLatency& editLatency,
+                      BenchmarkStats& stats,
+                      const unsigned aovInterval,
+                      const bpo::variables_map& cmdOpts)
+{
+    // scenarios start after the initial render reaches the target progress
+    const float targetProgress = cmdOpts["scenario-progress"].as<float>();
+    const float timeoutSec = cmdOpts["scenario-timeout"].as<float>();
+    float latency = 0.0f;
+    if (!editLatency.waitProgress(0, targetProgress / 100.0f, timeoutSec, latency)) {
+        std::cerr << "Initial render did not reach " << targetProgress << "% in "
+                  << timeoutSec << " sec. scenario benchmark skipped" << std::endl;
+        return;
+    }
+    logBenchmarkStatus(*pSdk,
+                       "Time to scenario start on initial render (session %s) %s",
+                       "BENCHMARK Time to scenario start on initial render (session "s);
+    addMilestoneStats(editLatency, 0, "initial", stats);
+
+    ScenarioBench scenarioBench(*pSdk, *sceneCtx, *pFbReceiver, editLatency, aovInterval, 1);
+    scenarioBench.setRepeat(cmdOpts["scenario-repeat"].as<unsigned>());
+    scenarioBench.setTargetProgress(targetProgress);
+    scenarioBench.setTimeoutSec(timeoutSec);
+    if (!scenarioBench.run(cmdOpts["scenario"].as<std::vector<std::string>>())) {
+        return;
+    }
+    std::cout << "BENCHMARK " << scenarioBench.showResult() << std::endl;
+
+    // median of each scenario is one sample of the trial
+    for (const auto& result : scenarioBench.getResult()) {
+        if (result.mFirstPixel.size()) {
+            stats.add(result.mName + "FirstPixelP50", result.mFirstPixel.getPercentile(50.0f));
+        }
+        if (result.mTargetProgress.size()) {
+            stats.add(result.mName + "TargetProgressP50", result.mTargetProgress.getPercentile(50.0f));
+        }
+    }
+}
+
+void
+execConvergenceBenchmark(std::shared_ptr<RenderSession> pSdk,
+                         std::shared_ptr<mcrt_dataio::ClientReceiverFb> pFbReceiver,
+                         EditLatency& editLatency,
+                         ConvergenceBench& convergenceBench,
+                         BenchmarkStats& stats,
+                         const bpo::variables_map& cmdOpts)
+//
+// Samples the error of the live beauty against the reference until the initial render completes.
+// The beauty is copied under the frame mutex and the error is computed outside of the lock.
+//
+{
+    const auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>
+        (std::chrono::duration<float>(cmdOpts["convergence-interval"].as<float>()));
+    convergenceBench.clear();
+
+    std::vector<float> beauty;
+    bool done = false;
+    while (!done && pSdk->isConnected() && !arrasExceptionThrown && !arrasStopped) {
+        std::this_thread::sleep_for(interval);
+        done = frameWritten; // one more sample of the final frame
+
+        unsigned width = 0, height = 0;
+        float progress = -1.0f;
+        {
+            StallLockGuard lock(getFrameMux(), StallWatchdog::Lock::FRAME_MUX);
+            progress = pFbReceiver->getProgress();
+            if (progress < 0.0f) continue; // no image data yet
+            width = pFbReceiver->getWidth();
+            height = pFbReceiver->getHeight();
+            beauty.resize(static_cast<size_t>(width) * height * 4);
+            pFbReceiver->getBeauty(beauty, true);
+        }
+        const float sec = std::chrono::duration<float>(std::chrono::steady_clock::now() - renderStart).count();
+
+        std::string error;
+        if (!convergenceBench.addSample(sec, progress, beauty, width, height, error)) {
+            std::cerr << "Convergence benchmark stopped. " << error << std::endl;
+            return;
+        }
+    }
+    std::cout << "BENCHMARK " << convergenceBench.show() << std::endl;
+
+    addMilestoneStats(editLatency, 0, "initial", stats);
+    for (float threshold : convergenceBench.getThresholds()) {
+        float sec = 0.0f;
+        if (convergenceBench.getThresholdTime(threshold, sec)) {
+            std::ostringstream ostr;
+            ostr << "convergenceRelMse" << threshold;
+            stats.add(ostr.str(), sec);
+        }
+    }
+    stats.setSection("convergence", convergenceBench.toJson()); // last trial
+
+    if (cmdOpts.count("convergence-csv")) {
+        std::string error;
+        if (!convergenceBench.saveCsv(cmdOpts["convergence-csv"].as<std::string>(), error)) {
+            std::cerr << "Failed to save convergence curve. " << error << std::endl;
+        }
+    }
+}
+
+void
+addEtaStats(const std::string& label, BenchmarkStats& stats)
+//
+// ETA accuracy of the last finished render : absolute error of the predicted finish time made at
+// each prediction point against the actual one
+//
+{
+    const Json::Value eta = renderEta->toJson();
+    for (const auto& itr : eta["predictions"]) {
+        if (!itr.isMember("errorSec")) continue;
+        std::ostringstream name;
+        name << "eta" << static_cast<int>(std::round(itr["progress"].asFloat() * 100.0f)) << "pctError_" << label;
+        stats.add(name.str(), std::abs(itr["errorSec"].asDouble()));
+    }
+    stats.setSection("eta_" + label, eta);
+}
+
+void
+addNodeStats(const std::string& label, BenchmarkStats& stats)
+//
+// Per MCRT node throughput of the last render, stragglers are reported with their host
+//
+{
+    std::cout << "BENCHMARK " << nodeStats->show() << std::endl;
+    for (const auto& node : nodeStats->getNodes()) {
+        if (node.mStraggler) {
+            std::cout << "BENCHMARK Straggler on " << label << " render : machineId " << node.mMachineId
+                      << " host " << node.mHostName << std::endl;
+        }
+    }
+    const float gap = nodeStats->getStragglerGapSec();
+    if (gap >= 0.0f) stats.add("stragglerGap_" + label, gap);
+    stats.setSection("nodes_" + label, nodeStats->toJson());
+}
+
+void
+execBenchmark(std::shared_ptr<RenderSession> pSdk, 
+              std::unique_ptr<scene_rdl2::rdl2::SceneContext> sceneCtx,
+              EditLatency& editLatency,
+              BenchmarkStats& stats)
 {
     // not in gui mode just sleep the main thread until we are done
     // or something bad happened
@@ -848,31 +1274,229 @@ execBenchmark(std::shared_ptr<arras4::sdk::SDK> pSdk,
     logBenchmarkStatus(*pSdk, 
                        "Time to 100%% on initial render (session %s) %s",
                        "BENCHMARK Time to 100% on initial render (session "s);
+    addMilestoneStats(editLatency, 0, "initial", stats);
+    addEtaStats("initial", stats);
+    addNodeStats("initial", stats);
 
+    TraceSpan serializeSpan("serializeScene");
     scene_rdl2::rdl2::BinaryWriter w(*sceneCtx);
     w.setDeltaEncoding(true);
 
     mcrt::RDLMessage::Ptr rdlMsg = std::make_shared<mcrt::RDLMessage>();
     w.toBytes(rdlMsg->mManifest, rdlMsg->mPayload);
     rdlMsg->mForceReload = false;
+    serializeSpan.setSize(rdlMsg->mManifest.size() + rdlMsg->mPayload.size());
+    serializeSpan.end();
 
     rdlMsg->mSyncId = 1;
 
     sceneCtx->commitAllChanges();
+    frameWritten = false;
+    editLatency.sendRecord(static_cast<uint32_t>(rdlMsg->mSyncId));
     pSdk->sendMessage(rdlMsg);
 
     renderStart = std::chrono::steady_clock::now();
 
     // There may still be progress messages from first pass
-    // Wait for the second pass to start
+    // Wait for the second pass to finish
     while(!frameWritten && pSdk->isConnected() && !arrasExceptionThrown && !arrasStopped) {
         sleep(1);
     }
 
-    benchLoop(*pSdk);
     logBenchmarkStatus(*pSdk, 
                        "Time to 100%% on second render (session %s) %s",
                        "BENCHMARK Time to 100% on second render (session "s);
+    addMilestoneStats(editLatency, 1, "second", stats);
+    addEtaStats("second", stats);
+    addNodeStats("second", stats);
+}
+
+std::shared_ptr<mcrt_dataio::ClientReceiverFb>
+createFbReceiver(const bpo::variables_map& cmdOpts)
+{
+    bool initialTelemetryOverlayCondition = cmdOpts["telemetry"].as<bool>();
+    std::shared_ptr<mcrt_dataio::ClientReceiverFb> pFbReceiver =
+        std::make_shared<mcrt_dataio::ClientReceiverFb>(initialTelemetryOverlayCondition);
+
+    pFbReceiver->setInfoRecInterval(cmdOpts["infoRec"].as<float>());
+    pFbReceiver->setInfoRecDisplayInterval(cmdOpts["infoRecDisp"].as<float>());
+    pFbReceiver->setInfoRecFileName(cmdOpts["infoRecFile"].as<std::string>());
+    pFbReceiver->setTelemetryInitialPanel(cmdOpts["telemetryPanel"].as<std::string>());
+    return pFbReceiver;
+}
+
+std::shared_ptr<RenderSession>
+createRenderSession(const bpo::variables_map& cmdOpts)
+{
+    std::shared_ptr<RenderSession> session;
+    if (cmdOpts["mock"].as<bool>()) {
+        MockSession::Config config;
+        config.mFps = cmdOpts["mock-fps"].as<float>();
+        config.mDurationSec = cmdOpts["mock-duration"].as<float>();
+        config.mTilePattern = cmdOpts["mock-tiles"].as<std::string>();
+        if (cmdOpts.count("mock-aov")) config.mAovs = cmdOpts["mock-aov"].as<std::vector<std::string>>();
+        session = std::make_shared<MockSession>(config);
+    } else {
+        session = std::make_shared<SdkSession>();
+    }
+    if (cmdOpts["send-direct"].as<bool>()) return session;
+    return std::make_shared<OutboundSession>(session);
+}
+
+std::shared_ptr<RenderSession>
+createSdk(std::shared_ptr<mcrt_dataio::ClientReceiverFb> pFbReceiver,
+          std::shared_ptr<EditLatency> pEditLatency,
+          std::shared_ptr<FramePublisher> pFramePublisher,
+          std::shared_ptr<JpegPipeline> pJpegPipeline,
+          std::shared_ptr<HeatMapAccum> pHeatMapAccum,
+          const std::string& exrFile,
+          const bpo::variables_map& cmdOpts)
+{
+    bool autoCredit = cmdOpts.count("auto-credit-off") == 0;
+    unsigned lag = cmdOpts["lag-ms"].as<unsigned>();
+
+    std::shared_ptr<RenderSession> pSdk = createRenderSession(cmdOpts);
+    pSdk->setAsyncSend(); // async send mode
+
+    pSdk->setMessageHandler(std::bind(&messageHandler,
+                                      pSdk,
+                                      autoCredit,
+                                      lag,
+                                      pFbReceiver,
+                                      pEditLatency,
+                                      pFramePublisher,
+                                      pJpegPipeline,
+                                      pHeatMapAccum,
+                                      exrFile,
+                                      std::placeholders::_1));
+
+    pSdk->setStatusHandler(std::bind(&statusHandler,
+                                     pSdk,
+                                     std::placeholders::_1));
+    pSdk->setExceptionCallback(&exceptionCallback);
+    pSdk->setProgressChannel(cmdOpts["progress-channel"].as<std::string>());  
+    if (auto outbound = std::dynamic_pointer_cast<OutboundSession>(pSdk)) {
+        // camera deltas dropped by a queued stop never render
+        outbound->setDropCallBack([pEditLatency](const uint32_t syncId) { pEditLatency->supersede(syncId); });
+        // the session is recreated by the benchmark trials, the probe does not keep the old one
+        std::weak_ptr<OutboundSession> weakOutbound = outbound;
+        StallWatchdog::get().setProbe("outboundPending", [weakOutbound]() -> int64_t {
+            std::shared_ptr<OutboundSession> session = weakOutbound.lock();
+            return session ? static_cast<int64_t>(session->getPending()) : 0;
+        });
+    }
+    return pSdk;
+}
+
+std::shared_ptr<RenderSession>
+createSdkB(std::shared_ptr<mcrt_dataio::ClientReceiverFb> pFbReceiver,
+           std::shared_ptr<EditLatency> pEditLatency,
+           const bpo::variables_map& cmdOpts)
+//
+// B session of the A/B comparison
+//
+{
+    bool autoCredit = cmdOpts.count("auto-credit-off") == 0;
+    unsigned lag = cmdOpts["lag-ms"].as<unsigned>();
+
+    std::shared_ptr<RenderSession> pSdk = createRenderSession(cmdOpts);
+    pSdk->setAsyncSend(); // async send mode
+
+    pSdk->setMessageHandler(std::bind(&abMessageHandler,
+                                      pSdk,
+                                      autoCredit,
+                                      lag,
+                                      pFbReceiver,
+                                      pEditLatency,
+                                      std::placeholders::_1));
+
+    pSdk->setStatusHandler(std::bind(&statusHandler,
+                                     pSdk,
+                                     std::placeholders::_1));
+    pSdk->setExceptionCallback(&exceptionCallback);
+    pSdk->setProgressChannel(cmdOpts["progress-channel"].as<std::string>());
+    if (auto outbound = std::dynamic_pointer_cast<OutboundSession>(pSdk)) {
+        outbound->setDropCallBack([pEditLatency](const uint32_t syncId) { pEditLatency->supersede(syncId); });
+    }
+    return pSdk;
+}
+
+void
+reportHeatMap(RenderSession& sdk, HeatMapAccum& heatMapAccum, const bpo::variables_map& cmdOpts)
+//
+// Hotspot report of the accumulated heat map. Pick data is requested while the session is still
+// connected, the responses come back as PICK_DATA messages in the order of the requests.
+//
+{
+    const size_t topN = cmdOpts["heatmap-top"].as<unsigned>();
+    const std::vector<mcrt::RenderMessages::PickModes> pickModes = {
+        mcrt::RenderMessages::PickModes::QUERY_GEOMETRY,
+        mcrt::RenderMessages::PickModes::QUERY_MATERIAL
+    };
+    const bool pick = cmdOpts["heatmap-pick"].as<bool>() && sdk.isConnected() && !arrasExceptionThrown;
+    if (pick) {
+        const std::vector<HeatMapAccum::Tile> tiles = heatMapAccum.rankTiles(topN);
+        const unsigned height = heatMapAccum.getHeight();
+        heatMapAccum.setPickPending(tiles.size() * pickModes.size());
+        for (const auto& tile : tiles) {
+            // pick position is bottom to top scanline like the render buffers
+            const int x = static_cast<int>(tile.mX + tile.mWidth / 2);
+            const int y = static_cast<int>(height - 1 - (tile.mY + tile.mHeight / 2));
+            for (const auto& mode : pickModes) {
+                sdk.sendMessage(mcrt::RenderMessages::createPickMessage(x, y, mode));
+            }
+        }
+        if (!heatMapAccum.waitPickData(HOTSPOT_PICK_TIMEOUT_SEC)) {
+            std::cerr << "Timed out waiting for hotspot pick data" << std::endl;
+        }
+    }
+
+    std::cout << heatMapAccum.show(topN) << std::endl;
+
+    std::string error;
+    if (cmdOpts.count("heatmap-exr") && !heatMapAccum.saveExr(cmdOpts["heatmap-exr"].as<std::string>(), error)) {
+        std::cerr << "Failed to save heat map EXR. " << error << std::endl;
+    }
+    if (cmdOpts.count("heatmap-report") &&
+        !heatMapAccum.saveReport(cmdOpts["heatmap-report"].as<std::string>(), topN,
+                                 pick ? static_cast<unsigned>(pickModes.size()) : 0, error)) {
+        std::cerr << "Failed to save heat map report. " << error << std::endl;
+    }
+}
+
+bool
+reportBenchmarkStats(const BenchmarkStats& stats, const bpo::variables_map& cmdOpts)
+//
+// Returns false if a statistically significant regression against the baseline is found
+//
+{
+    std::cout << "BENCHMARK " << stats.show() << std::endl;
+
+    std::string error;
+    if (cmdOpts.count("benchmark-out")) {
+        const std::string& filename = cmdOpts["benchmark-out"].as<std::string>();
+        if (!stats.save(filename, error)) {
+            std::cerr << "Failed to save benchmark result. " << error << std::endl;
+        } else {
+            std::cout << "Saved benchmark result " << filename << std::endl;
+        }
+    }
+
+    if (cmdOpts.count("benchmark-baseline")) {
+        Json::Value baseline;
+        if (!BenchmarkStats::load(cmdOpts["benchmark-baseline"].as<std::string>(), baseline, error)) {
+            std::cerr << "Failed to load benchmark baseline. " << error << std::endl;
+            return true;
+        }
+        std::string report;
+        const bool regression = stats.compare(baseline, cmdOpts["benchmark-threshold"].as<float>() / 100.0f, report);
+        std::cout << "BENCHMARK " << report << std::endl;
+        if (regression) {
+            std::cerr << "Benchmark regression detected against the baseline" << std::endl;
+            return false;
+        }
+    }
+    return true;
 }
 
 int
@@ -881,11 +1505,13 @@ main(int argc, char* argv[])
     // make cout unbuffered
     std::cout.setf(std::ios::unitbuf);
     std::chrono::time_point<std::chrono::steady_clock> programStart = std::chrono::steady_clock::now();
+    StartupReport::get().reset(programStart);
 
     bpo::options_description flags;
     bpo::variables_map cmdOpts;
 
     try {
+        StartupPhase phase(StartupReport::Phase::ARG_PARSE);
         parseCmdLine(argc, argv, flags, cmdOpts);
     } catch(std::exception& e) {
         std::cerr << "error: " << e.what() << std::endl;
@@ -899,9 +1525,33 @@ main(int argc, char* argv[])
         std::cout << flags << std::endl;
         return 0;
     }
+    if (cmdOpts["show-cpu-dispatch"].as<bool>()) {
+        std::cout << showCpuDispatch() << std::endl;
+        return 0;
+    }
 
-    bool autoCredit = cmdOpts.count("auto-credit-off") == 0;
-    unsigned lag = cmdOpts["lag-ms"].as<unsigned>();
+    // thread roles are configured before any client thread starts
+    {
+        std::string error;
+        if (cmdOpts.count("thread-affinity")) {
+            for (const auto& spec : cmdOpts["thread-affinity"].as<std::vector<std::string>>()) {
+                if (!ThreadRoles::get().setAffinity(spec, error)) {
+                    std::cerr << "Invalid --thread-affinity. " << error << std::endl;
+                    return 1;
+                }
+            }
+        }
+        if (cmdOpts.count("thread-priority")) {
+            for (const auto& spec : cmdOpts["thread-priority"].as<std::vector<std::string>>()) {
+                if (!ThreadRoles::get().setPriority(spec, error)) {
+                    std::cerr << "Invalid --thread-priority. " << error << std::endl;
+                    return 1;
+                }
+            }
+        }
+        ThreadRoles::get().enter(ThreadRole::MAIN);
+    }
+    StallWatchdog::get().start(static_cast<float>(cmdOpts["stall-ms"].as<unsigned>()) / 1000.0f);
 
     std::chrono::milliseconds minUpdateMs(cmdOpts["min-update-ms"].as<unsigned>());
     std::chrono::steady_clock::duration minUpdateInterval = 
@@ -933,6 +1583,98 @@ main(int argc, char* argv[])
         return 1;
     }
 
+    if (cmdOpts.count("scenario")) {
+        if (guiMode || !benchmarkMode) {
+            std::cerr << "--scenario requires --no-gui and --benchmark" << std::endl;
+            return 1;
+        }
+        for (const auto& name : cmdOpts["scenario"].as<std::vector<std::string>>()) {
+            if (!ScenarioBench::isScenario(name)) {
+                std::cerr << "Unknown scenario " << name << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    if (cmdOpts.count("convergence-ref")) {
+        if (guiMode || !benchmarkMode || cmdOpts.count("scenario")) {
+            std::cerr << "--convergence-ref requires --no-gui and --benchmark, and can not be used with --scenario"
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    if ((cmdOpts.count("benchmark-out") || cmdOpts.count("benchmark-baseline")) && !benchmarkMode) {
+        std::cerr << "--benchmark-out and --benchmark-baseline require --benchmark" << std::endl;
+        return 1;
+    }
+
+    std::unique_ptr<SessionSweep> pSessionSweep;
+    if (cmdOpts.count("sweep")) {
+        if (guiMode || !benchmarkMode) {
+            std::cerr << "--sweep requires --no-gui and --benchmark" << std::endl;
+            return 1;
+        }
+        if (cmdOpts.count("benchmark-out") || cmdOpts.count("benchmark-baseline")) {
+            std::cerr << "--benchmark-out and --benchmark-baseline can not be used with --sweep, use --sweep-out"
+                      << std::endl;
+            return 1;
+        }
+        pSessionSweep = std::make_unique<SessionSweep>();
+        for (const auto& param : cmdOpts["sweep"].as<std::vector<std::string>>()) {
+            std::string error;
+            if (!pSessionSweep->addParam(param, error)) {
+                std::cerr << error << std::endl;
+                return 1;
+            }
+        }
+    } else if (cmdOpts.count("sweep-out")) {
+        std::cerr << "--sweep-out requires --sweep" << std::endl;
+        return 1;
+    }
+
+    const bool abCompare = cmdOpts.count("ab-session") || cmdOpts.count("ab-num-mcrt") || cmdOpts.count("ab-override");
+    SessionSweep::Point abOverrides;
+    ImageView::AbView abView = ImageView::AbView::SIDE_BY_SIDE;
+    if (abCompare) {
+        if (!guiMode) {
+            std::cerr << "--ab-session, --ab-num-mcrt and --ab-override require --gui" << std::endl;
+            return 1;
+        }
+        const std::string& view = cmdOpts["ab-view"].as<std::string>();
+        if (view == "side") {
+            abView = ImageView::AbView::SIDE_BY_SIDE;
+        } else if (view == "diff") {
+            abView = ImageView::AbView::DIFFERENCE;
+        } else {
+            std::cerr << "Unknown --ab-view " << view << std::endl;
+            return 1;
+        }
+        if (cmdOpts.count("ab-override")) {
+            SessionSweep overrides; // single value grid
+            for (const auto& param : cmdOpts["ab-override"].as<std::vector<std::string>>()) {
+                std::string error;
+                if (!overrides.addParam(param, error)) {
+                    std::cerr << error << std::endl;
+                    return 1;
+                }
+            }
+            if (overrides.getPointTotal() != 1) {
+                std::cerr << "--ab-override takes a single value per parameter" << std::endl;
+                return 1;
+            }
+            abOverrides = overrides.getPoint(0);
+        }
+    } else if (cmdOpts.count("ab-log")) {
+        std::cerr << "--ab-log requires --ab-session, --ab-num-mcrt or --ab-override" << std::endl;
+        return 1;
+    }
+
+    if (cmdOpts["mock"].as<bool>() && !MockSession::isTilePattern(cmdOpts["mock-tiles"].as<std::string>())) {
+        std::cerr << "Unknown --mock-tiles " << cmdOpts["mock-tiles"].as<std::string>() << std::endl;
+        return 1;
+    }
+
     std::vector<std::string> rdlFiles;
     std::string exrFile;
     if (cmdOpts.count("rdl")) {
@@ -952,31 +1694,43 @@ main(int argc, char* argv[])
     }
 
     std::unique_ptr<scene_rdl2::rdl2::SceneContext> pSceneCtx(sceneFromRDLFiles(rdlFiles));
-    bool initialTelemetryOverlayCondition = cmdOpts["telemetry"].as<bool>();
-    std::shared_ptr<mcrt_dataio::ClientReceiverFb> pFbReceiver =
-        std::make_shared<mcrt_dataio::ClientReceiverFb>(initialTelemetryOverlayCondition);
-    std::shared_ptr<arras4::sdk::SDK> pSdk = std::make_shared<arras4::sdk::SDK>();
-
-    pSdk->setAsyncSend(); // async send mode
-
-    pFbReceiver->setInfoRecInterval(cmdOpts["infoRec"].as<float>());
-    pFbReceiver->setInfoRecDisplayInterval(cmdOpts["infoRecDisp"].as<float>());
-    pFbReceiver->setInfoRecFileName(cmdOpts["infoRecFile"].as<std::string>());
-    pFbReceiver->setTelemetryInitialPanel(cmdOpts["telemetryPanel"].as<std::string>());
-
-    pSdk->setMessageHandler(std::bind(&messageHandler,
-                                      pSdk,
-                                      autoCredit,
-                                      lag,
-                                      pFbReceiver,
-                                      exrFile,
-                                      std::placeholders::_1));
-
-    pSdk->setStatusHandler(std::bind(&statusHandler,
-                                     pSdk,
-                                     std::placeholders::_1));
-    pSdk->setExceptionCallback(&exceptionCallback);
-    pSdk->setProgressChannel(cmdOpts["progress-channel"].as<std::string>());  
+    std::shared_ptr<mcrt_dataio::ClientReceiverFb> pFbReceiver = createFbReceiver(cmdOpts);
+    std::shared_ptr<EditLatency> pEditLatency = std::make_shared<EditLatency>();
+    std::shared_ptr<FramePublisher> pFramePublisher;
+    if (cmdOpts.count("shm-publish")) {
+        pFramePublisher = std::make_shared<FramePublisher>(cmdOpts["shm-publish"].as<std::string>(),
+                                                           cmdOpts["shm-slots"].as<unsigned>(),
+                                                           pFbReceiver,
+                                                           getFrameMux);
+        std::string error;
+        if (!pFramePublisher->open(error)) {
+            std::cerr << "Failed to open shared memory frame publisher. " << error << std::endl;
+            return 1;
+        }
+        std::cout << "Publishing frames to shared memory " << pFramePublisher->getShmName() << std::endl;
+    }
+    std::shared_ptr<JpegPipeline> pJpegPipeline;
+    if (cmdOpts.count("jpeg-snapshot") || cmdOpts.count("jpeg-stream")) {
+        JpegPipeline::Config config;
+        if (cmdOpts.count("jpeg-snapshot")) config.mSnapshotPrefix = cmdOpts["jpeg-snapshot"].as<std::string>();
+        if (cmdOpts.count("jpeg-stream")) config.mStreamPath = cmdOpts["jpeg-stream"].as<std::string>();
+        config.mSnapshotIntervalSec = cmdOpts["jpeg-interval"].as<float>();
+        config.mSnapshotIntervalPercent = cmdOpts["jpeg-percent"].as<float>();
+        config.mQuality = cmdOpts["jpeg-quality"].as<unsigned>();
+        config.mThreadTotal = cmdOpts["jpeg-threads"].as<unsigned>();
+        pJpegPipeline = std::make_shared<JpegPipeline>(config);
+        std::string error;
+        if (!pJpegPipeline->open(error)) {
+            std::cerr << "Failed to open JPEG output. " << error << std::endl;
+            return 1;
+        }
+    }
+    std::shared_ptr<HeatMapAccum> pHeatMapAccum;
+    if (cmdOpts.count("heatmap-exr") || cmdOpts.count("heatmap-report")) {
+        pHeatMapAccum = std::make_shared<HeatMapAccum>(cmdOpts["heatmap-tile"].as<unsigned>());
+    }
+    std::shared_ptr<RenderSession> pSdk =
+        createSdk(pFbReceiver, pEditLatency, pFramePublisher, pJpegPipeline, pHeatMapAccum, exrFile, cmdOpts);
 
     std::string sessionName;
     unsigned short numMcrtMin = 1, numMcrtMax = 1;
@@ -991,6 +1745,20 @@ main(int argc, char* argv[])
     }
     unsigned aovInterval = cmdOpts["aov-interval"].as<unsigned>();
 
+    std::string sessionNameB = cmdOpts.count("ab-session") ? cmdOpts["ab-session"].as<std::string>() : sessionName;
+    unsigned short numMcrtMinB = numMcrtMin, numMcrtMaxB = numMcrtMax;
+    if (cmdOpts.count("ab-num-mcrt")) {
+        parseNumMCRT(cmdOpts, numMcrtMinB, numMcrtMaxB, "ab-num-mcrt"s);
+    }
+    std::shared_ptr<mcrt_dataio::ClientReceiverFb> pFbReceiverB;
+    std::shared_ptr<EditLatency> pEditLatencyB;
+    std::shared_ptr<RenderSession> pSdkB;
+    if (abCompare) {
+        pFbReceiverB = createFbReceiver(cmdOpts);
+        pEditLatencyB = std::make_shared<EditLatency>();
+        pSdkB = createSdkB(pFbReceiverB, pEditLatencyB, cmdOpts);
+    }
+
     std::chrono::time_point<std::chrono::steady_clock> sessionCreateStart = std::chrono::steady_clock::now();
 
     if (benchmarkMode) {
@@ -1018,6 +1786,62 @@ main(int argc, char* argv[])
                                              cmdOpts["exit-after-script"].as<bool>(),
                                              minUpdateInterval,
                                              cmdOpts["no-scale"].as<bool>());
+        imageView->setEditLatency(pEditLatency);
+        imageView->setJpegPipeline(pJpegPipeline);
+        imageView->setRenderEta(renderEta);
+        if (cmdOpts["history-mb"].as<unsigned>() > 0) {
+            const size_t historyBytes = static_cast<size_t>(cmdOpts["history-mb"].as<unsigned>()) * 1024 * 1024;
+            imageView->setFrameHistory(std::make_shared<FrameHistory>(historyBytes,
+                                                                      cmdOpts["history-progress"].as<float>()));
+        }
+        std::shared_ptr<PoseCache> pPoseCache;
+        if (cmdOpts["pose-cache-mb"].as<unsigned>() > 0) {
+            PoseCache::Config config;
+            config.mMemBytes = static_cast<size_t>(cmdOpts["pose-cache-mb"].as<unsigned>()) * 1024 * 1024;
+            config.mDiskBytes = static_cast<size_t>(cmdOpts["pose-cache-disk-mb"].as<unsigned>()) * 1024 * 1024;
+            if (cmdOpts.count("pose-cache-dir")) config.mSpillDir = cmdOpts["pose-cache-dir"].as<std::string>();
+            pPoseCache = std::make_shared<PoseCache>(config);
+            imageView->setPoseCache(pPoseCache);
+        }
+        if (cmdOpts["reproject"].as<bool>()) {
+            imageView->setReprojector(std::make_shared<DepthReprojector>(cmdOpts["reproject-aov"].as<std::string>(),
+                                                                         cmdOpts["reproject-threads"].as<unsigned>()));
+        }
+        {
+            auto displayTransform = std::make_shared<DisplayTransform>(cmdOpts["display-threads"].as<unsigned>());
+            displayTransform->setExposure(cmdOpts["exposure"].as<float>());
+            displayTransform->setGamma(cmdOpts["gamma"].as<float>());
+            if (cmdOpts.count("view-lut")) {
+                std::string error;
+                if (!displayTransform->loadLut(cmdOpts["view-lut"].as<std::string>(), error)) {
+                    std::cerr << "Failed to load view LUT. " << error << std::endl;
+                    return 1;
+                }
+            }
+            imageView->setDisplayTransform(displayTransform);
+        }
+        {
+            auto perfHud = std::make_shared<PerfHud>();
+            perfHud->setActive(cmdOpts["perf-hud"].as<bool>());
+            imageView->setPerfHud(perfHud);
+            StallWatchdog::get().setProbe("displayQueue",
+                                          [perfHud]() -> int64_t { return perfHud->getQueueDepth(); });
+        }
+        if (cmdOpts["denoise-async"].as<bool>()) {
+            DenoiseStage::Config config;
+            config.mDutyRatio = cmdOpts["denoise-duty"].as<float>();
+            imageView->setDenoiseStage(std::make_shared<DenoiseStage>(config));
+        }
+        if (abCompare) {
+            imageView->setAbCompare(pFbReceiverB, pEditLatencyB, abView, sessionNameB);
+            if (cmdOpts.count("ab-log")) {
+                std::string error;
+                if (!imageView->openAbLog(cmdOpts["ab-log"].as<std::string>(), error)) {
+                    std::cerr << "Failed to open A/B log. " << error << std::endl;
+                    return 1;
+                }
+            }
+        }
         pImageView.store(imageView);
 
         setTelemetryClientMessage("imageView construction done");
@@ -1025,15 +1849,18 @@ main(int argc, char* argv[])
         auto qtExec = [&]() {
             pImageView.load()->show();
             exitStatus = app.exec();
+            StallWatchdog::get().detachGui(); // shutdown is not an event loop stall
         };
             
         auto setupSession = [&]() {
+            ThreadRoleScope threadRole(ThreadRole::SETUP);
             if (!createNewSession(*pSdk,
                                   pImageView.load()->getSceneContext2(),
                                   sessionName,
                                   numMcrtMin,
                                   numMcrtMax,
                                   aovInterval,
+                                  *pEditLatency,
                                   cmdOpts,
                                   exitStatus)) {
                 std::cerr << ">> main.cc ERROR : createNewSession() failed\n";
@@ -1041,10 +1868,32 @@ main(int argc, char* argv[])
             }
             pImageView.load()->setup(pSdk);
 
+            if (pSdkB) {
+                // The B session starts after the A session is connected. Both of them receive
+                // every scene update from here on with the same syncId.
+                sessionOverrides = abOverrides;
+                const bool connectedB = createNewSession(*pSdkB,
+                                                         pImageView.load()->getSceneContext2(),
+                                                         sessionNameB,
+                                                         numMcrtMinB,
+                                                         numMcrtMaxB,
+                                                         aovInterval,
+                                                         *pEditLatencyB,
+                                                         cmdOpts,
+                                                         exitStatus);
+                sessionOverrides.clear();
+                if (!connectedB) {
+                    std::cerr << ">> main.cc ERROR : createNewSession() failed for the B session\n";
+                    return;
+                }
+                pImageView.load()->setupB(pSdkB);
+            }
+
             if (cmdOpts.count("debug-console")) {
                 int port = cmdOpts["debug-console"].as<int>();
                 if (port > 0) {
-                    arras_render::debugConsoleSetup(port, pSdk, pFbReceiver, pImageView);
+                    arras_render::debugConsoleSetup(port, pSdk, pFbReceiver, pEditLatency,
+                                                    pFramePublisher, pJpegPipeline, pHeatMapAccum, renderEta, nodeStats, pImageView);
                 }
             }
 
@@ -1064,6 +1913,9 @@ main(int argc, char* argv[])
             std::cerr << e.what() << '\n';
         }
 
+        if (pHeatMapAccum) reportHeatMap(*pSdk, *pHeatMapAccum, cmdOpts);
+        if (pPoseCache) std::cout << pPoseCache->show() << std::endl;
+
         // close down the connection before ImageView gets destroyed. Otherwise
         // the message handler thread might be using ImageView when it is destroyed
         if (pSdk->isConnected()) {
@@ -1073,19 +1925,129 @@ main(int argc, char* argv[])
 
             pSdk->disconnect();
         }
+        if (pSdkB && pSdkB->isConnected()) {
+            if (!arrasExceptionThrown) {
+                pSdkB->sendMessage(mcrt::RenderMessages::createControlMessage(true));
+            }
+
+            pSdkB->disconnect();
+        }
     } else if (benchmarkMode) {
-        if (!createNewSession(*pSdk,
-                              *pSceneCtx,
-                              sessionName,
-                              numMcrtMin,
-                              numMcrtMax,
-                              aovInterval,
-                              cmdOpts,
-                              exitStatus)) {
-            return exitStatus;
+        std::cout << "BENCHMARK " << showCpuDispatch() << std::endl;
+        std::unique_ptr<ConvergenceBench> pConvergenceBench;
+        if (cmdOpts.count("convergence-ref")) {
+            const std::string& refFile = cmdOpts["convergence-ref"].as<std::string>();
+            std::vector<float> reference;
+            unsigned width = 0, height = 0;
+            std::string error;
+            if (!readExrBeauty(refFile, reference, width, height, error)) {
+                std::cerr << "Failed to load convergence reference. " << error << std::endl;
+                return 1;
+            }
+            pConvergenceBench = std::make_unique<ConvergenceBench>(std::thread::hardware_concurrency());
+            pConvergenceBench->setReference(std::move(reference), width, height);
+            pConvergenceBench->setThresholds(cmdOpts.count("convergence-threshold") ?
+                                             cmdOpts["convergence-threshold"].as<std::vector<float>>() :
+                                             std::vector<float>{0.1f, 0.01f, 0.001f});
+        }
+        const unsigned trialTotal = std::max(cmdOpts["benchmark-repeat"].as<unsigned>(), 1u);
+        const size_t pointTotal = pSessionSweep ? pSessionSweep->getPointTotal() : 1;
+        for (size_t pointId = 0; pointId < pointTotal; ++pointId) {
+            BenchmarkStats benchmarkStats;
+            if (pSessionSweep) {
+                sessionOverrides = pSessionSweep->getPoint(pointId);
+                std::cout << "BENCHMARK Sweep point " << pointId + 1 << " of " << pointTotal << " : "
+                          << pSessionSweep->getPointLabel(pointId) << std::endl;
+            }
+            for (unsigned trialId = 0; trialId < trialTotal; ++trialId) {
+                if (pointId > 0 || trialId > 0) {
+                    // Every trial runs on a new session in order to include the session startup and
+                    // the initial render of a cold engine.
+                    if (pSdk->isConnected()) {
+                        pSdk->sendMessage(mcrt::RenderMessages::createControlMessage(true));
+                        pSdk->disconnect();
+                    }
+                    frameWritten = false;
+                    receivedFirstPixels = false;
+                    progressPercent = 0.0f;
+
+                    StartupReport::get().reset(std::chrono::steady_clock::now());
+                    pSceneCtx = sceneFromRDLFiles(rdlFiles);
+                    pFbReceiver = createFbReceiver(cmdOpts);
+                    if (pFramePublisher) pFramePublisher->setFbReceiver(pFbReceiver);
+                    if (pHeatMapAccum) pHeatMapAccum->clear(); // the report covers the last trial
+                    pSdk = createSdk(pFbReceiver, pEditLatency, pFramePublisher, pJpegPipeline, pHeatMapAccum, exrFile, cmdOpts);
+                }
+                if (trialTotal > 1) {
+                    std::cout << "BENCHMARK Trial " << trialId + 1 << " of " << trialTotal << std::endl;
+                }
+                // syncIds restart from 0 on the new session, the entries of the previous trial would
+                // be taken as already reached
+                pEditLatency->clear();
+                if (pEditLatencyB) pEditLatencyB->clear();
+
+                if (!createNewSession(*pSdk,
+                                      *pSceneCtx,
+                                      sessionName,
+                                      numMcrtMin,
+                                      numMcrtMax,
+                                      aovInterval,
+                                      *pEditLatency,
+                                      cmdOpts,
+                                      exitStatus)) {
+                    return exitStatus;
+                }
+
+                if (cmdOpts.count("scenario")) {
+                    execScenarioBenchmark(pSdk, std::move(pSceneCtx), pFbReceiver, *pEditLatency, benchmarkStats,
+                                          aovInterval, cmdOpts);
+                } else if (pConvergenceBench) {
+                    execConvergenceBenchmark(pSdk, pFbReceiver, *pEditLatency, *pConvergenceBench, benchmarkStats,
+                                             cmdOpts);
+                } else {
+                    execBenchmark(pSdk, std::move(pSceneCtx), *pEditLatency, benchmarkStats);
+                }
+                if (arrasExceptionThrown || arrasStopped) break;
+                benchmarkStats.addTrial();
+
+                std::cout << "BENCHMARK " << StartupReport::get().show() << std::endl;
+                float firstPixel = 0.0f;
+                if (StartupReport::get().getTimeToFirstPixel(firstPixel)) {
+                    benchmarkStats.add("startupFirstPixel", firstPixel);
+                }
+                benchmarkStats.setSection("startup", StartupReport::get().toJson()); // last trial
+                benchmarkStats.setSection("cpuDispatch", cpuDispatchToJson());
+                std::cout << "BENCHMARK " << ThreadRoles::get().show() << std::endl;
+                benchmarkStats.setSection("threadRoles", ThreadRoles::get().toJson()); // process total
+                if (auto outbound = std::dynamic_pointer_cast<OutboundSession>(pSdk)) {
+                    std::cout << "BENCHMARK " << outbound->show() << std::endl;
+                    benchmarkStats.setSection("outbound", outbound->toJson()); // last trial
+                }
+                if (StallWatchdog::get().isEnabled()) {
+                    std::cout << "BENCHMARK " << StallWatchdog::get().show() << std::endl;
+                    benchmarkStats.setSection("stalls", StallWatchdog::get().toJson()); // process total
+                }
+            }
+
+
+            if (pSessionSweep) {
+                std::cout << "BENCHMARK " << benchmarkStats.show() << std::endl;
+                pSessionSweep->setResult(pointId, benchmarkStats.toJson());
+            } else if (benchmarkStats.getTrialTotal() > 0 && !reportBenchmarkStats(benchmarkStats, cmdOpts)) {
+                exitStatus = BENCHMARK_REGRESSION_EXIT_STATUS;
+            }
+            if (arrasExceptionThrown || arrasStopped) break;
         }
 
-        execBenchmark(pSdk, std::move(pSceneCtx));
+        if (pSessionSweep) {
+            std::cout << "BENCHMARK " << pSessionSweep->showTable() << std::endl;
+            if (cmdOpts.count("sweep-out")) {
+                std::string error;
+                if (!pSessionSweep->save(cmdOpts["sweep-out"].as<std::string>(), error)) {
+                    std::cerr << "Failed to save sweep result. " << error << std::endl;
+                }
+            }
+        }
     } else {
         if (!createNewSession(*pSdk,
                               *pSceneCtx,
@@ -1093,6 +2055,7 @@ main(int argc, char* argv[])
                               numMcrtMin,
                               numMcrtMax,
                               aovInterval,
+                              *pEditLatency,
                               cmdOpts,
                               exitStatus)) {
             return exitStatus;
@@ -1101,7 +2064,8 @@ main(int argc, char* argv[])
         if (cmdOpts.count("debug-console")) {
             int port = cmdOpts["debug-console"].as<int>();
             if (port > 0) {
-                arras_render::debugConsoleSetup(port, pSdk, pFbReceiver, pImageView);
+                arras_render::debugConsoleSetup(port, pSdk, pFbReceiver, pEditLatency,
+                                                pFramePublisher, pJpegPipeline, pHeatMapAccum, renderEta, nodeStats, pImageView);
             }
         }
 
@@ -1112,6 +2076,8 @@ main(int argc, char* argv[])
         }
     }
 
+    if (pHeatMapAccum && !guiMode) reportHeatMap(*pSdk, *pHeatMapAccum, cmdOpts);
+
     if (pSdk->isConnected()) {
         if (!arrasExceptionThrown) {
             pSdk->sendMessage(mcrt::RenderMessages::createControlMessage(true));
@@ -1120,6 +2086,12 @@ main(int argc, char* argv[])
         pSdk->disconnect();
     }
 
+    if (pEditLatencyB) {
+        std::cout << pEditLatency->showSummaryCompare(sessionName, *pEditLatencyB, sessionNameB) << std::endl;
+    } else if (pEditLatency->getTotal(EditLatency::Milestone::FIRST_PIXEL) > 0) {
+        std::cout << pEditLatency->showSummary() << std::endl;
+    }
+
     if (arrasExceptionThrown || arrasStopped) {
         exitStatus = 1;
     }
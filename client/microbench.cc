@@ -0,0 +1,407 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+// arras_render_microbench : micro benchmarks of the client hot functions which run without any Arras
+// session or GUI. The result is saved as a BenchmarkStats JSON (--out) and compared against a previous
+// result (--baseline), so a client performance change can be reviewed with data.
+//
+
+#include "BenchmarkStats.h"
+#include "CamPlayback.h"
+#include "DisplayTransform.h"
+#include "encodingUtil.h"
+#include "FreeCam.h"
+#include "MicroBench.h"
+#include "PixelKernels.h"
+
+#include <algorithm>
+#include <cstdio> // std::remove
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h> // getpid
+
+#ifdef __ARM_NEON__
+// This works around OIIO including x86 based headers due to detection of SSE
+// support due to sse2neon.h being included elsewhere
+#define __IMMINTRIN_H
+#define __NMMINTRIN_H
+#define OIIO_NO_SSE 1
+#define OIIO_NO_AVX 1
+#define OIIO_NO_AVX2 1
+#endif
+
+#include <OpenImageIO/imageio.h>
+
+#include <boost/program_options.hpp>
+
+#include <QImage>
+
+#include <scene_rdl2/scene/rdl2/BinaryWriter.h>
+#include <scene_rdl2/scene/rdl2/Camera.h>
+#include <scene_rdl2/scene/rdl2/SceneContext.h>
+#include <scene_rdl2/scene/rdl2/Utils.h>
+#include <scene_rdl2/scene/rdl2/ValueContainerDeq.h>
+#include <scene_rdl2/scene/rdl2/ValueContainerEnq.h>
+
+namespace bpo = boost::program_options;
+
+using namespace arras_render;
+
+namespace {
+
+constexpr unsigned RANDOM_SEED = 1234; // the same input data every run
+constexpr float FRAME_DT = 1.0f / 24.0f;
+
+using Mat4f = scene_rdl2::math::Mat4f;
+
+std::vector<float>
+makeRandomFloat(const size_t size, const float maxValue)
+{
+    std::mt19937 gen(RANDOM_SEED);
+    std::uniform_real_distribution<float> dist(0.0f, maxValue);
+    std::vector<float> data(size);
+    for (auto& itr : data) itr = dist(gen);
+    return data;
+}
+
+std::vector<unsigned char>
+makeRandomRgb888(const size_t size)
+{
+    std::mt19937 gen(RANDOM_SEED);
+    std::uniform_int_distribution<int> dist(0, 255);
+    std::vector<unsigned char> data(size);
+    for (auto& itr : data) itr = static_cast<unsigned char>(dist(gen));
+    return data;
+}
+
+Mat4f
+makePathMatrix(const size_t eventId)
+{
+    // a slow turn with a forward move, like a recorded FreeCam path
+    const float angle = static_cast<float>(eventId) * 0.001f;
+    Mat4f rot;
+    rot.setToRotation(scene_rdl2::math::Vec4f(0.0f, 1.0f, 0.0f, 0.0f), angle);
+    return rot * Mat4f::translate(scene_rdl2::math::Vec4f(0.0f, 1.0f, static_cast<float>(eventId) * -0.01f, 1.0f));
+}
+
+void
+addCamCases(MicroBench& bench, const size_t pathEvents, const std::string& tmpPrefix)
+{
+    bench.add("freeCam.update", []() -> MicroBench::Func {
+            // forward key and a mouse drag are held : every term of update() is active
+            auto cam = std::make_shared<FreeCam>();
+            cam->resetTransform(makePathMatrix(1), true);
+            KeyEvent key(Press, Key_W, QT_NoModifier);
+            cam->processKeyboardEvent(&key, true);
+            MouseEvent press(0, 0, QT_NoModifier, QT_LeftButton, QT_LeftButton);
+            cam->processMousePressEvent(&press);
+            auto mouseX = std::make_shared<int>(0);
+            return [cam, mouseX]() {
+                *mouseX = (*mouseX == 0) ? 4 : 0;
+                MouseEvent move(*mouseX, 2, QT_NoModifier, QT_LeftButton, QT_LeftButton);
+                cam->processMouseMoveEvent(&move);
+                volatile float sink = cam->update(FRAME_DT)[3][2];
+                (void)sink;
+            };
+        });
+
+    bench.add("freeCam.resetTransform", []() -> MicroBench::Func {
+            auto cam = std::make_shared<FreeCam>();
+            const Mat4f xform = makePathMatrix(100);
+            return [cam, xform]() {
+                volatile float sink = cam->resetTransform(xform, false)[3][2];
+                (void)sink;
+            };
+        });
+
+    auto events = std::make_shared<std::vector<CamPlaybackEvent>>();
+    for (size_t i = 0; i < pathEvents; ++i) {
+        events->emplace_back(i, FRAME_DT, makePathMatrix(i));
+    }
+
+    bench.add("camPlaybackEvent.encodePath", [events]() -> MicroBench::Func {
+            auto data = std::make_shared<std::string>();
+            return [events, data]() {
+                data->clear();
+                scene_rdl2::rdl2::ValueContainerEnq enq(data.get());
+                for (const auto& itr : *events) itr.encode(enq);
+                enq.finalize();
+            };
+        });
+
+    bench.add("camPlaybackEvent.decodePath", [events]() -> MicroBench::Func {
+            auto data = std::make_shared<std::string>();
+            {
+                scene_rdl2::rdl2::ValueContainerEnq enq(data.get());
+                for (const auto& itr : *events) itr.encode(enq);
+                enq.finalize();
+            }
+            auto decoded = std::make_shared<std::vector<CamPlaybackEvent>>(events->size());
+            return [data, decoded]() {
+                scene_rdl2::rdl2::ValueContainerDeq deq(data->data(), data->size());
+                for (auto& itr : *decoded) itr.decode(deq);
+            };
+        });
+
+    // CamPlayback owns a thread, so a single instance is shared by the save and load cases
+    auto playback = std::make_shared<CamPlayback>();
+    for (size_t i = 0; i < pathEvents; ++i) {
+        playback->saveCam(makePathMatrix(i));
+        playback->recAdd(FRAME_DT);
+    }
+    const std::string camFile = tmpPrefix + ".cam";
+
+    bench.add("camPlayback.save", [playback, camFile]() -> MicroBench::Func {
+            return [playback, camFile]() {
+                std::string error;
+                if (!playback->save(camFile, error)) std::cerr << ">> microbench.cc " << error << '\n';
+            };
+        });
+
+    bench.add("camPlayback.load", [playback, camFile]() -> MicroBench::Func {
+            std::string error;
+            if (!playback->save(camFile, error)) {
+                std::cerr << ">> microbench.cc " << error << '\n';
+                return nullptr;
+            }
+            return [playback, camFile]() {
+                std::string error;
+                if (!playback->load(camFile, error)) std::cerr << ">> microbench.cc " << error << '\n';
+            };
+        });
+}
+
+std::shared_ptr<scene_rdl2::rdl2::SceneContext>
+makeCameraScene(const std::vector<std::string>& rdlFiles)
+//
+// The scene of the given RDL files, or a scene of a single camera (needs the camera DSO of the
+// RDL2_DSO_PATH). Returns nullptr if there is no camera.
+//
+{
+    auto sc = std::make_shared<scene_rdl2::rdl2::SceneContext>();
+    sc->setProxyModeEnabled(true);
+    try {
+        if (rdlFiles.empty()) {
+            sc->createSceneObject("PerspectiveCamera", "/microbench/camera");
+        }
+        for (const auto& itr : rdlFiles) {
+            scene_rdl2::rdl2::readSceneFromFile(itr, *sc);
+        }
+        sc->commitAllChanges();
+    } catch (const std::exception& e) {
+        std::cerr << ">> microbench.cc could not build the camera scene : " << e.what() << '\n';
+        return nullptr;
+    }
+    if (!sc->getPrimaryCamera()) return nullptr;
+    return sc;
+}
+
+void
+addSceneCases(MicroBench& bench, const std::vector<std::string>& rdlFiles)
+{
+    bench.add("binaryWriter.cameraDelta", [rdlFiles]() -> MicroBench::Func {
+            // same sequence as ImageView::sendSceneUpdate() of a camera move
+            std::shared_ptr<scene_rdl2::rdl2::SceneContext> sc = makeCameraScene(rdlFiles);
+            if (!sc) return nullptr;
+            scene_rdl2::rdl2::Camera* cam =
+                sc->getSceneObject(sc->getPrimaryCamera()->getName())->asA<scene_rdl2::rdl2::Camera>();
+            auto eventId = std::make_shared<size_t>(0);
+            return [sc, cam, eventId]() {
+                cam->beginUpdate();
+                cam->set(scene_rdl2::rdl2::Node::sNodeXformKey,
+                         scene_rdl2::math::toDouble(makePathMatrix((*eventId)++ % 1000)));
+                cam->endUpdate();
+
+                scene_rdl2::rdl2::BinaryWriter w(*sc);
+                w.setDeltaEncoding(true);
+                std::string manifest, payload;
+                w.toBytes(manifest, payload);
+                sc->commitAllChanges();
+            };
+        });
+}
+
+void
+addImageCases(MicroBench& bench, const unsigned width, const unsigned height, const unsigned scale,
+              const unsigned threads)
+{
+    const size_t pixTotal = static_cast<size_t>(width) * height;
+
+    // float -> RGB888 conversions of ImageView::populateRGBFrame()
+    bench.add("rgb888.quantize", [=]() -> MicroBench::Func {
+            auto planar = std::make_shared<std::vector<float>>(makeRandomFloat(pixTotal * 3, 1.2f));
+            auto rgb888 = std::make_shared<std::vector<unsigned char>>(pixTotal * 3);
+            return [=]() {
+                const float* src = planar->data();
+                getPixelKernels().mQuantizeRgb888(src, src + pixTotal, src + pixTotal * 2, pixTotal, rgb888->data());
+            };
+        });
+
+    auto addDisplayTransform = [&](const std::string& name, const float exposure, const float gamma) {
+        bench.add(name, [=]() -> MicroBench::Func {
+                auto transform = std::make_shared<DisplayTransform>(threads);
+                transform->setExposure(exposure);
+                transform->setGamma(gamma);
+                auto rgba = std::make_shared<std::vector<float>>(makeRandomFloat(pixTotal * 4, 1.2f));
+                auto rgb888 = std::make_shared<std::vector<unsigned char>>();
+                return [=]() { transform->apply(*rgba, 4, width, height, *rgb888); };
+            });
+    };
+    addDisplayTransform("displayTransform.identity", 0.0f, 1.0f);
+    addDisplayTransform("displayTransform.exposureGamma", 1.0f, 2.2f);
+
+    // display image downscale of ImageView::displayFrameSlot(), and the former QImage::scaled() for comparison
+    if (scale > 1) {
+        const unsigned scaledWidth = width / scale;
+        const unsigned scaledHeight = height / scale;
+        auto rgb888 = std::make_shared<std::vector<unsigned char>>(makeRandomRgb888(pixTotal * 3));
+
+        bench.add("imageView.scaleBox", [=]() -> MicroBench::Func {
+                auto scaled = std::make_shared<std::vector<unsigned char>>(
+                    static_cast<size_t>(scaledWidth) * scaledHeight * 3);
+                return [=]() {
+                    getPixelKernels().mDownscaleRgb888(rgb888->data(), width * 3, scaledWidth, scaledHeight, scale,
+                                                       scaled->data(), scaledWidth * 3);
+                };
+            });
+
+        bench.add("imageView.scaleQImage", [=]() -> MicroBench::Func {
+                return [=]() {
+                    QImage image(rgb888->data(), width, height, width * 3, QImage::Format_RGB888);
+                    QImage scaledImage = image.scaled(scaledWidth, scaledHeight);
+                    volatile int sink = scaledImage.width();
+                    (void)sink;
+                };
+            });
+    }
+}
+
+void
+addExrCases(MicroBench& bench, const unsigned width, const unsigned height, const std::string& tmpPrefix)
+{
+    // beauty RGBA + aovTotal RGB AOVs, as writeExrFile() writes them
+    for (unsigned aovTotal : {0u, 4u, 16u}) {
+        std::ostringstream name;
+        name << "exr.writeBuffers.aov" << aovTotal;
+        const std::string exrFile = tmpPrefix + ".exr";
+        bench.add(name.str(), [=]() -> MicroBench::Func {
+                auto specs = std::make_shared<std::vector<OIIO::ImageSpec>>();
+                auto buffers = std::make_shared<std::vector<std::vector<float>>>();
+                for (unsigned i = 0; i <= aovTotal; ++i) {
+                    const int numChannels = (i == 0) ? 4 : 3;
+                    const std::string outputName = (i == 0) ? std::string("beauty") : "aov" + std::to_string(i);
+                    specs->emplace_back(width, height, numChannels, OIIO::TypeDesc::FLOAT);
+                    specs->back().attribute("subimagename", outputName);
+                    specs->back().attribute("name", outputName);
+                    buffers->push_back(makeRandomFloat(static_cast<size_t>(width) * height * numChannels, 1.0f));
+                }
+                return [=]() { writeBuffersToExr(exrFile, *specs, *buffers); };
+            });
+    }
+}
+
+} // anon namespace
+
+int
+main(int argc, char* argv[])
+{
+    bpo::options_description flags;
+    flags.add_options()
+        ("help", "produce help message")
+        ("filter", bpo::value<std::string>()->default_value(""), "Run only the cases whose name contains this string")
+        ("repeat", bpo::value<unsigned>()->default_value(10), "Number of timed samples of each case")
+        ("min-sample-sec", bpo::value<float>()->default_value(0.05f), "Minimum duration of a sample, sets the iteration count of each case")
+        ("width", bpo::value<unsigned>()->default_value(1920), "Image width of the pixel cases")
+        ("height", bpo::value<unsigned>()->default_value(1080), "Image height of the pixel cases")
+        ("scale", bpo::value<unsigned>()->default_value(2), "Display downscale factor of the ImageView scaling cases")
+        ("threads", bpo::value<unsigned>()->default_value(1), "Display transform threads (1 gives the most stable numbers, 0 : auto)")
+        ("path-events", bpo::value<size_t>()->default_value(10000), "Number of camera events of the CamPlayback path cases")
+        ("rdl", bpo::value<std::vector<std::string>>()->multitoken(), "RDL files of the camera delta case (default : a scene of a single camera)")
+        ("tmp-dir", bpo::value<std::string>()->default_value("/tmp"), "Directory of the temporary files of the save/write cases")
+        ("out", bpo::value<std::string>(), "Save the result to a JSON file (usable as --baseline)")
+        ("baseline", bpo::value<std::string>(), "Compare the result against a baseline JSON file and exit non-zero on a significant regression")
+        ("threshold", bpo::value<float>()->default_value(5.0f), "Minimum slowdown percentage against the baseline reported as a regression")
+    ;
+
+    bpo::variables_map cmdOpts;
+    try {
+        bpo::store(bpo::parse_command_line(argc, argv, flags), cmdOpts);
+        bpo::notify(cmdOpts);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    if (cmdOpts.count("help")) {
+        std::cout << flags << std::endl;
+        return 0;
+    }
+
+    const unsigned width = std::max(cmdOpts["width"].as<unsigned>(), 1u);
+    const unsigned height = std::max(cmdOpts["height"].as<unsigned>(), 1u);
+    const unsigned scale = std::max(cmdOpts["scale"].as<unsigned>(), 1u);
+    const unsigned threads = cmdOpts["threads"].as<unsigned>();
+    const size_t pathEvents = std::max(cmdOpts["path-events"].as<size_t>(), size_t(1));
+    const std::vector<std::string> rdlFiles =
+        cmdOpts.count("rdl") ? cmdOpts["rdl"].as<std::vector<std::string>>() : std::vector<std::string>();
+    const std::string tmpPrefix =
+        cmdOpts["tmp-dir"].as<std::string>() + "/arras_render_microbench_" + std::to_string(getpid());
+
+    std::cout << "MICROBENCH " << showCpuDispatch() << std::endl;
+
+    MicroBench bench(cmdOpts["min-sample-sec"].as<float>(),
+                     std::max(cmdOpts["repeat"].as<unsigned>(), 2u), // stddev needs 2 samples
+                     cmdOpts["filter"].as<std::string>());
+    addCamCases(bench, pathEvents, tmpPrefix);
+    addSceneCases(bench, rdlFiles);
+    addImageCases(bench, width, height, scale, threads);
+    addExrCases(bench, width, height, tmpPrefix);
+
+    BenchmarkStats stats;
+    bench.run(stats);
+    std::remove((tmpPrefix + ".cam").c_str());
+    std::remove((tmpPrefix + ".exr").c_str());
+
+    Json::Value config;
+    config["width"] = width;
+    config["height"] = height;
+    config["scale"] = scale;
+    config["threads"] = threads;
+    config["pathEvents"] = static_cast<Json::UInt64>(pathEvents);
+    stats.setSection("config", config);
+    stats.setSection("microbench", bench.toJson());
+    stats.setSection("cpuDispatch", cpuDispatchToJson());
+
+    std::cout << "MICROBENCH " << bench.show(stats) << std::endl;
+
+    std::string error;
+    if (cmdOpts.count("out")) {
+        const std::string& filename = cmdOpts["out"].as<std::string>();
+        if (!stats.save(filename, error)) {
+            std::cerr << "Failed to save micro benchmark result. " << error << std::endl;
+        } else {
+            std::cout << "Saved micro benchmark result " << filename << std::endl;
+        }
+    }
+
+    if (cmdOpts.count("baseline")) {
+        Json::Value baseline;
+        if (!BenchmarkStats::load(cmdOpts["baseline"].as<std::string>(), baseline, error)) {
+            std::cerr << "Failed to load micro benchmark baseline. " << error << std::endl;
+            return 1;
+        }
+        std::string report;
+        const bool regression = stats.compare(baseline, cmdOpts["threshold"].as<float>() / 100.0f, report);
+        std::cout << "MICROBENCH " << report << std::endl;
+        if (regression) {
+            std::cerr << "Micro benchmark regression detected against the baseline" << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -2,13 +2,14 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "outputRate.h"
+#include "Trace.h"
 
 #include <mcrt_messages/OutputRates.h>
 
 namespace arras_render {
 
 void
-setOutputRate(arras4::sdk::SDK& sdk,
+setOutputRate(RenderSession& sdk,
               unsigned interval,
               unsigned offset,
               std::string priorityAov,
@@ -23,6 +24,7 @@ setOutputRate(arras4::sdk::SDK& sdk,
 
     rates.setSendAllWhenComplete(true);
 
+    TraceSpan span("sendOutputRates");
     sdk.sendMessage(rates.getAsMessage());
 }
 
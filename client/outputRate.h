@@ -6,11 +6,11 @@
 
 #include <string>
 
-#include <sdk/sdk.h>
+#include "RenderSession.h"
 
 namespace arras_render {
 
-void setOutputRate(arras4::sdk::SDK& sdk,
+void setOutputRate(RenderSession& sdk,
                    unsigned interval,
                    unsigned offset=1,
                    std::string priorityAov=std::string(),
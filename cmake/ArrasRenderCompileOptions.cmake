@@ -12,10 +12,9 @@ function(ArrasRender_cxx_compile_options target)
                 -fno-omit-frame-pointer         # TODO: add a note
                 -fno-strict-aliasing            # TODO: add a note
                 -fpermissive                    # Downgrade some diagnostics about nonconformant code from errors to warnings.
-                -march=core-avx2                # Specify the name of the target architecture
-                -mavx                           # x86 options
-                -mfma                           # x86 options
-                -msse                           # x86 options
+                $<$<BOOL:${ARRAS_RENDER_X86}>:
+                    -march=${ARRAS_RENDER_ARCH} # Specify the name of the target architecture
+                >
                 -pipe                           # Use pipes rather than intermediate files.
                 -pthread                        # Define additional macros required for using the POSIX threads library.
                 -w                              # Inhibit all warning messages.
@@ -39,7 +38,9 @@ function(ArrasRender_cxx_compile_options target)
         target_compile_options(${target}
             # TODO: Some if not all of these should probably be PUBLIC
             PRIVATE
-                -march=core-avx2                # Specify the name of the target architecture
+                $<$<BOOL:${ARRAS_RENDER_X86}>:
+                    -march=${ARRAS_RENDER_ARCH} # Specify the name of the target architecture
+                >
                 -fdelayed-template-parsing      # Shader.h has a template method that uses a moonray class which is no available to scene_rdl2 and is only used in moonray+
                 -Wno-deprecated-declarations    # disable auto_ptr deprecated warnings from log4cplus-1.
                 -Wno-unused-value               # caused by opt-debug build and MNRY_VERIFY.
@@ -48,7 +49,9 @@ function(ArrasRender_cxx_compile_options target)
         target_compile_options(${target}
             # TODO: Some if not all of these should probably be PUBLIC
             PRIVATE
-                -march=core-avx2                # Specify the name of the target architecture
+                $<$<BOOL:${ARRAS_RENDER_X86}>:
+                    -march=${ARRAS_RENDER_ARCH} # Specify the name of the target architecture
+                >
         )
     endif()
 endfunction()